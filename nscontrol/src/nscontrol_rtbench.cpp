@@ -0,0 +1,188 @@
+/*
+ * Copyright (C) 2012 Digitalis Education Solutions, Inc.
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 3
+ * of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place - Suite 330, Boston, MA  02111-1307, USA.
+ *
+ * Nightshade is a trademark of Digitalis Education Solutions, Inc.
+ * See the TRADEMARKS file for trademark usage requirements.
+ *
+ */
+
+
+/*
+ * Throughput and latency benchmark for the real time command channel.
+ * Forks a number of producer processes which push time stamped messages
+ * while the parent drains them, once through NshadeRTQueue and once through
+ * the mutex protected linked list the channel used previously.
+ *
+ * Not built by default:
+ *   g++ -O2 -o nscontrol_rtbench nscontrol_rtbench.cpp \
+ *       nshade_shared_memory_connection.cpp nshade_media.cpp -lboost_system -lpthread -lrt
+ *   ./nscontrol_rtbench [producers] [messages per producer] [message size]
+ */
+
+#include "nshade_shared_memory_connection.h"
+#include <boost/interprocess/sync/scoped_lock.hpp>
+#include <algorithm>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <vector>
+#include <sched.h>
+#include <sys/wait.h>
+#include <time.h>
+#include <unistd.h>
+
+using namespace boost::interprocess;
+using namespace std;
+
+static const char* segmentName = "/nscontrol_rtbench";
+
+static unsigned long long now_ns( void ) {
+	timespec ts;
+	clock_gettime( CLOCK_MONOTONIC, &ts );
+	return (unsigned long long)ts.tv_sec * 1000000000ull + ts.tv_nsec;
+}
+
+// The previous real time queue: a fixed ring of 1024 byte nodes guarded by a
+// reader mutex, a writer mutex and the global mutex around the fill count.
+struct LegacyQueue {
+	struct Node {
+		offset_ptr<Node> next;
+		NshadeCommand msg;
+	};
+	static const unsigned int size = 100;
+
+	LegacyQueue( managed_shared_memory* shm ) {
+		write = shm->construct<Node>(anonymous_instance)();
+		offset_ptr<Node> tmp = write;
+		for( unsigned int i = 0; i < size; i++ ) {
+			tmp->next = shm->construct<Node>(anonymous_instance)();
+			tmp = tmp->next;
+		}
+		read = tmp;
+		tmp->next = write;
+		gap = 1;
+	}
+
+	bool Push( const char* data, unsigned int len ) {
+		scoped_lock<interprocess_mutex> w( writerMutex );
+		{
+			scoped_lock<interprocess_mutex> g( mutex );
+			if( gap == size - 1 )
+				return false;
+		}
+		if( len >= NshadeCommand::szBuf )
+			len = NshadeCommand::szBuf - 1;
+		memcpy( write->msg.buf, data, len );
+		write->msg.length = len;
+		write = write->next;
+
+		scoped_lock<interprocess_mutex> g( mutex );
+		++gap;
+		return true;
+	}
+
+	bool Pop( std::string& data ) {
+		scoped_lock<interprocess_mutex> r( readerMutex );
+		{
+			scoped_lock<interprocess_mutex> g( mutex );
+			if( gap == 1 )
+				return false;
+		}
+		read = read->next;
+		data.assign( read->msg.buf, read->msg.length );
+
+		scoped_lock<interprocess_mutex> g( mutex );
+		--gap;
+		return true;
+	}
+
+	offset_ptr<Node> write, read;
+	unsigned int gap;
+	interprocess_mutex mutex, readerMutex, writerMutex;
+};
+
+template <class Q>
+static void run( const char* name, Q* queue, int producers, int count, int msgSize ) {
+	vector<pid_t> children;
+	unsigned long long start = now_ns();
+
+	for( int p = 0; p < producers; p++ ) {
+		pid_t pid = fork();
+		if( pid == 0 ) {
+			vector<char> msg( msgSize, ' ' );
+			for( int i = 0; i < count; i++ ) {
+				unsigned long long stamp = now_ns();
+				memcpy( &msg[0], &stamp, sizeof(stamp) );
+				while( !queue->Push( &msg[0], msgSize ) )
+					sched_yield();
+			}
+			_exit( 0 );
+		}
+		children.push_back( pid );
+	}
+
+	vector<unsigned long long> latency;
+	latency.reserve( (size_t)producers * count );
+	std::string data;
+
+	while( latency.size() < (size_t)producers * count ) {
+		if( !queue->Pop( data ) ) {
+			sched_yield();
+			continue;
+		}
+		unsigned long long stamp;
+		memcpy( &stamp, data.data(), sizeof(stamp) );
+		latency.push_back( now_ns() - stamp );
+	}
+
+	double seconds = (now_ns() - start) * 1e-9;
+	for( unsigned int i = 0; i < children.size(); i++ )
+		waitpid( children[i], NULL, 0 );
+
+	sort( latency.begin(), latency.end() );
+	unsigned long long sum = 0;
+	for( unsigned int i = 0; i < latency.size(); i++ )
+		sum += latency[i];
+
+	printf( "%-8s %12.0f msg/s   latency mean %8.1f us  p50 %8.1f us  p99 %8.1f us  max %9.1f us\n",
+			name, latency.size() / seconds,
+			sum / (double)latency.size() * 1e-3,
+			latency[latency.size() / 2] * 1e-3,
+			latency[latency.size() * 99 / 100] * 1e-3,
+			latency.back() * 1e-3 );
+}
+
+int main( int argc, char** argv ) {
+	int producers = argc > 1 ? atoi( argv[1] ) : 4;
+	int count     = argc > 2 ? atoi( argv[2] ) : 100000;
+	int msgSize   = argc > 3 ? atoi( argv[3] ) : 64;
+
+	if( producers < 1 || count < 1 || msgSize < (int)sizeof(unsigned long long) || msgSize >= NshadeCommand::szBuf ) {
+		fprintf( stderr, "usage: %s [producers] [messages per producer] [message size 8-1023]\n", argv[0] );
+		return 1;
+	}
+
+	shared_memory_object::remove( segmentName );
+	managed_shared_memory shm( create_only, segmentName, 1 << 22 );
+
+	printf( "%d producers, %d messages each, %d bytes\n", producers, count, msgSize );
+	run( "legacy", shm.construct<LegacyQueue>(anonymous_instance)( &shm ), producers, count, msgSize );
+	run( "ring", shm.construct<NshadeRTQueue>(anonymous_instance)(), producers, count, msgSize );
+
+	shared_memory_object::remove( segmentName );
+	return 0;
+}
@@ -39,31 +39,15 @@ NshadeSharedMemory::NshadeSharedMemory() {
 	const ShmAlloc allocator( m_shm->get_segment_manager() );
 	m_connections = m_shm->find_or_construct<ShmMap>(unique_instance)(std::less<boost::uuids::uuid>(), allocator);
 	m_mutex       = m_shm->find_or_construct<interprocess_mutex>("global_mutex")();
-	m_readerMutex = m_shm->find_or_construct<interprocess_mutex>("reader_mutex")();
-	m_writerMutex = m_shm->find_or_construct<interprocess_mutex>("writer_mutex")();
 	m_writeState  = m_shm->find_or_construct<NshadeWriteState>(unique_instance)(m_shm);
 	m_readState   = m_shm->find_or_construct<NshadeReadState>(unique_instance)(m_shm);
 	m_refCount    = m_shm->find_or_construct<ReferenceCounter>(unique_instance)();
 	m_nsConf      = m_shm->find_or_construct<NshadeConf>(unique_instance)(m_shm);
-	m_readPtr     = m_shm->find_or_construct<RTQPtr>("read_ptr")();
-	m_writePtr    = m_shm->find_or_construct<RTQPtr>("write_ptr")();
-	m_RTQGap      = m_shm->find_or_construct<RTQGap>(unique_instance)();
+	m_rtQueue     = m_shm->find_or_construct<NshadeRTQueue>("rt_queue")();
 
-	if( m_refCount->m_ref == 0 ) {
+	if( m_refCount->m_ref == 0 )
 		cout << "Nightshade Shared Memory Segment Initialized.\n";
 
-		// Initialize 'fast' circular message buffer
-		*m_writePtr = m_shm->construct<RTQueueNode>(anonymous_instance)();
-		offset_ptr<RTQueueNode> tmp = *m_writePtr;
-		for( unsigned int i = 0; i < RTQSIZE; i++ ) {
-			tmp->next = m_shm->construct<RTQueueNode>(anonymous_instance)();
-			tmp = tmp->next;
-		}
-		*m_readPtr = tmp;	     // Initialize reader one node behind writer
-		tmp->next = *m_writePtr; // Close the circle
-		*m_RTQGap = 1;
-	}
-
 	(m_refCount->m_ref)++;
 	m_clientType = NshadeSharedMemoryConnection::user;
 }
@@ -79,10 +63,7 @@ NshadeSharedMemory::~NshadeSharedMemory() {
 		// Cleanup shared instances
 		try {
 			m_shm->destroy<interprocess_mutex>("global_mutex");
-			m_shm->destroy<interprocess_mutex>("reader_mutex");
-			m_shm->destroy<interprocess_mutex>("writer_mutex");
-			m_shm->destroy<RTQPtr>("read_ptr");
-			m_shm->destroy<RTQPtr>("write_ptr");
+			m_shm->destroy<NshadeRTQueue>("rt_queue");
 
 			// Explicitly destroying unique instances consistently causes a
 			// crash on Fedora15. Since they're essentially singletons across
@@ -92,7 +73,6 @@ NshadeSharedMemory::~NshadeSharedMemory() {
 			// of that.
 		/*	m_shm->destroy<NshadeReadState>(unique_instance);
 			m_shm->destroy<NshadeWriteState>(unique_instance);
-			m_shm->destroy<RTQGap>(unique_instance);
 			m_shm->destroy<NshadeConf>(unique_instance);
 			m_shm->destroy<ReferenceCounter>(unique_instance);
 			m_shm->destroy<ShmMap>(unique_instance); */
@@ -203,57 +183,18 @@ void NshadeSharedMemory::Write( std::string data ) {
 }
 
 ///////////////////////////////////////////////////////////////////////////////
-// Experimental performance oriented RW methods. Do not currently have much
-// effect on performance in practice and more effort is needed to integrate and
-// encapsulate their data structures.
+// Real time channel. Lock-free, writers never wait on nightshade or on each
+// other; messages are dropped when the ring is full.
 ///////////////////////////////////////////////////////////////////////////////
 
 bool NshadeSharedMemory::ReadRT( std::string& data ) {
-	m_readerMutex->lock();
-
-	m_mutex->lock();
-	bool empty = *m_RTQGap == 1;
-	m_mutex->unlock();
-
-	if( empty ) {
-		m_readerMutex->unlock();
-		return false;
-	}
-
-	*m_readPtr = (*m_readPtr)->next;
-	data = std::string( (*m_readPtr)->msg.buf, (*m_readPtr)->msg.length );
-
-	m_mutex->lock();
-		--(*m_RTQGap);
-	m_mutex->unlock();
-
-	m_readerMutex->unlock();
-	return true;
+	return m_rtQueue->Pop( data );
 }
 
 void NshadeSharedMemory::WriteRT( std::string data ) {
-	m_writerMutex->lock();
-
-	m_mutex->lock();
-	bool full = *m_RTQGap == (RTQSIZE - 1);
-	m_mutex->unlock();
-
-	if( full ) {
-		m_writerMutex->unlock();
-		return;
-	}
-
-	unsigned int len = data.length();
-	if( len >= NshadeCommand::szBuf )
-		len = NshadeCommand::szBuf - 1;
-	memcpy( (void*)(*m_writePtr)->msg.buf, (void*)data.c_str(), len );
-	(*m_writePtr)->msg.length = len;
-	*m_writePtr = (*m_writePtr)->next;
-
-	m_mutex->lock();
-		++(*m_RTQGap);
-	m_mutex->unlock();
-
-	m_writerMutex->unlock();
+	m_rtQueue->Push( data.data(), data.length() );
 }
 
+unsigned int NshadeSharedMemory::DroppedRT( void ) {
+	return m_rtQueue->Dropped();
+}
@@ -55,6 +55,7 @@ public:
 	void Disconnect( void );
 	bool ReadRT( std::string& data );
 	void WriteRT( std::string data );
+	unsigned int DroppedRT( void );
 	bool Read( std::string& data );
 	void Write( std::string data );
 	boost::interprocess::offset_ptr<NshadeConf> Config( void );
@@ -70,8 +71,6 @@ public:
 	boost::interprocess::offset_ptr<NshadeReadState> m_readState;
 
 private:
-	static const unsigned int RTQSIZE = 100;
-
 	// Type definitions for IPC friendly linked-list container of connections to shared memory]
 	typedef boost::interprocess::pair<boost::uuids::uuid,
 			boost::interprocess::offset_ptr<NshadeSharedMemoryConnection> > ConnectionPair;
@@ -89,12 +88,8 @@ private:
 	boost::interprocess::offset_ptr<NshadeConf> m_nsConf;
 	boost::interprocess::offset_ptr<ReferenceCounter> m_refCount;
 	boost::interprocess::offset_ptr<ShmMap> m_connections;
-    boost::interprocess::offset_ptr<RTQPtr> m_writePtr;
-	boost::interprocess::offset_ptr<RTQPtr> m_readPtr;
-	boost::interprocess::offset_ptr<RTQGap> m_RTQGap;
+	boost::interprocess::offset_ptr<NshadeRTQueue> m_rtQueue;
 	boost::interprocess::offset_ptr<boost::interprocess::interprocess_mutex> m_mutex;
-	boost::interprocess::offset_ptr<boost::interprocess::interprocess_mutex> m_readerMutex;
-	boost::interprocess::offset_ptr<boost::interprocess::interprocess_mutex> m_writerMutex;
 
 	NshadeSharedMemoryConnection::Type m_clientType;
 	boost::uuids::uuid m_clsid;
@@ -24,6 +24,7 @@
  */
 
 #include "nshade_shared_memory_connection.h"
+#include <cstring>
 
 using namespace boost::interprocess;
 using namespace boost::uuids;
@@ -75,3 +76,75 @@ NshadeCommand NshadeSharedMemoryConnection::DeQueue( void ) {
 
 	return cmd;
 }
+
+NshadeRTQueue::NshadeRTQueue() : m_head(0), m_dropped(0), m_tail(0) {
+	memset( m_buf, 0, sizeof(m_buf) );
+}
+
+bool NshadeRTQueue::Push( const char* data, unsigned int length ) {
+	if( length > maxMessage ) {
+		__sync_fetch_and_add( &m_dropped, 1 );
+		return false;
+	}
+
+	const unsigned int size = (sizeof(Record) + length + 7) & ~7u;
+	unsigned int head, pad;
+
+	for(;;) {
+		head = m_head;
+		const unsigned int tail = m_tail;
+		const unsigned int room = capacity - (head & (capacity - 1));
+		pad = room < size ? room : 0;
+
+		if( head + pad + size - tail > capacity ) {
+			__sync_fetch_and_add( &m_dropped, 1 );
+			return false;
+		}
+		if( __sync_bool_compare_and_swap( &m_head, head, head + pad + size ) )
+			break;
+	}
+
+	// Records never wrap, the end of the buffer is skipped instead
+	if( pad ) {
+		Record* skip = At( head );
+		skip->length = 0;
+		__sync_synchronize();
+		skip->size = pad | padFlag;
+	}
+
+	Record* rec = At( head + pad );
+	memcpy( rec + 1, data, length );
+	rec->length = length;
+	__sync_synchronize();
+	rec->size = size;
+	return true;
+}
+
+bool NshadeRTQueue::Pop( std::string& data ) {
+	unsigned int tail = m_tail;
+
+	for(;;) {
+		Record* rec = At( tail );
+		const unsigned int size = rec->size;
+		if( size == 0 )
+			return false;	// empty, or the next producer hasn't published yet
+		__sync_synchronize();
+
+		const bool skip = (size & padFlag) != 0;
+		const unsigned int bytes = size & ~padFlag;
+		if( !skip )
+			data.assign( reinterpret_cast<const char*>(rec + 1), rec->length );
+
+		memset( rec, 0, bytes );
+		__sync_synchronize();
+		tail += bytes;
+		m_tail = tail;
+
+		if( !skip )
+			return true;
+	}
+}
+
+bool NshadeRTQueue::Empty( void ) const {
+	return m_head == m_tail;
+}
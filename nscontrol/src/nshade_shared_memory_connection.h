@@ -42,13 +42,43 @@ struct NshadeCommand {
 	char buf[szBuf];
 };
 
- struct RTQueueNode {
-	boost::interprocess::offset_ptr<RTQueueNode> next;
-	NshadeCommand msg;
-};
+// Lock-free ring of variable length records for the real time channel.
+// Any number of processes may Push concurrently; a single consumer
+// (nightshade) Pops. Producers reserve space by advancing m_head with a
+// compare-and-swap, fill in their record and then publish it by storing the
+// record size last. The consumer zeroes what it has read before handing the
+// space back through m_tail, so an unpublished record always reads as size 0.
+class NshadeRTQueue {
+public:
+	static const unsigned int capacity = 1 << 18;	// bytes, power of two
+	static const unsigned int maxMessage = 16384;
+
+	NshadeRTQueue();
 
-typedef unsigned int RTQGap;
-typedef boost::interprocess::offset_ptr<RTQueueNode> RTQPtr;
+	bool Push( const char* data, unsigned int length );
+	bool Pop( std::string& data );
+	bool Empty( void ) const;
+	unsigned int Dropped( void ) const { return m_dropped; }
+
+private:
+	struct Record {
+		volatile unsigned int size;	// bytes incl. header, 0 until published
+		unsigned int length;		// payload bytes
+	};
+	static const unsigned int padFlag = 0x80000000u;
+
+	Record* At( unsigned int pos ) {
+		return reinterpret_cast<Record*>( reinterpret_cast<char*>(m_buf) + (pos & (capacity - 1)) );
+	}
+
+	// Producer and consumer cursors kept on separate cache lines
+	volatile unsigned int m_head;
+	volatile unsigned int m_dropped;
+	char m_pad0[56];
+	volatile unsigned int m_tail;
+	char m_pad1[60];
+	unsigned long long m_buf[capacity / sizeof(unsigned long long)];
+};
 
 
 class NshadeSharedMemoryConnection {
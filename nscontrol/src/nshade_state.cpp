@@ -25,6 +25,7 @@
 
 #include "nshade_state.h"
 #include <stdlib.h>
+#include <sched.h>
 
 using namespace boost::interprocess;
 
@@ -33,6 +34,35 @@ static const double doubleMax = std::numeric_limits<double>::max();
 static const short shortMax = std::numeric_limits<short>::max();
 static const int intMax = std::numeric_limits<int>::max();
 
+// Seqlock write of one section, only ever called by nightshade
+template <class T>
+static void SeqWrite( volatile unsigned int& seq, T& dst, const T& src ) {
+	++seq;
+	__sync_synchronize();
+	dst = src;
+	__sync_synchronize();
+	++seq;
+}
+
+// Seqlock read, retried until the copy wasn't overlapped by a write
+template <class T>
+static void SeqRead( const volatile unsigned int& seq, const T& src, T& dst ) {
+	T tmp;
+	for(;;) {
+		unsigned int start = seq;
+		if( start & 1 ) {
+			sched_yield();
+			continue;
+		}
+		__sync_synchronize();
+		tmp = src;
+		__sync_synchronize();
+		if( seq == start )
+			break;
+	}
+	dst = tmp;
+}
+
 ///////////////////////////////////////////////////////////////////////////////
 // Observer ///////////////////////////////////////////////////////////////////
 ///////////////////////////////////////////////////////////////////////////////
@@ -225,6 +255,17 @@ void ObjectsState::operator =( const ObjectsState& obj ) {
 	memcpy( &m_state, &obj.m_state, sizeof(m_state) );
 }
 
+///////////////////////////////////////////////////////////////////////////////
+// Profile ////////////////////////////////////////////////////////////////////
+///////////////////////////////////////////////////////////////////////////////
+ProfileState::ProfileState() {
+	memset( &m_state, 0, sizeof(m_state) );
+}
+
+void ProfileState::operator =( const ProfileState& obj ) {
+	memcpy( &m_state, &obj.m_state, sizeof(m_state) );
+}
+
 ///////////////////////////////////////////////////////////////////////////////
 // ReadState //////////////////////////////////////////////////////////////////
 ///////////////////////////////////////////////////////////////////////////////
@@ -240,19 +281,39 @@ NshadeReadState::NshadeReadState( boost::interprocess::managed_shared_memory* sh
 	m_reference = shm->find_or_construct<ReferenceState>("read_reference")();
 	m_settings = shm->find_or_construct<SettingsState>("read_settings")();
 	m_objects = shm->find_or_construct<ObjectsState>("read_objects")();
+	m_profile = shm->find_or_construct<ProfileState>("read_profile")();
+	memset( (void*)m_seq, 0, sizeof(m_seq) );
 }
 
 void NshadeReadState::operator=( const NshadeWriteState& obj ) {
-	m_readMutex->lock();
 	m_globalMutex->lock();
-		*m_media = *obj.m_media;
-		*m_script = *obj.m_script;
-		*m_reference = *obj.m_reference;
-		*m_observer = *obj.m_observer;
-		*m_settings = *obj.m_settings;
-		*m_objects = *obj.m_objects;
+		Copy( obj, (1 << STATE_NB_SECTIONS) - 1 );
 	m_globalMutex->unlock();
-	m_readMutex->unlock();
+}
+
+// Copy only what changed since the last call
+void NshadeReadState::Publish( NshadeWriteState& obj ) {
+	m_globalMutex->lock();
+		Copy( obj, obj.m_dirty );
+		obj.m_dirty = 0;
+	m_globalMutex->unlock();
+}
+
+void NshadeReadState::Copy( const NshadeWriteState& obj, unsigned int sections ) {
+	if( sections & (1 << STATE_MEDIA) )
+		SeqWrite( m_seq[STATE_MEDIA], *m_media, *obj.m_media );
+	if( sections & (1 << STATE_SCRIPT) )
+		SeqWrite( m_seq[STATE_SCRIPT], *m_script, *obj.m_script );
+	if( sections & (1 << STATE_REFERENCE) )
+		SeqWrite( m_seq[STATE_REFERENCE], *m_reference, *obj.m_reference );
+	if( sections & (1 << STATE_OBSERVER) )
+		SeqWrite( m_seq[STATE_OBSERVER], *m_observer, *obj.m_observer );
+	if( sections & (1 << STATE_SETTINGS) )
+		SeqWrite( m_seq[STATE_SETTINGS], *m_settings, *obj.m_settings );
+	if( sections & (1 << STATE_OBJECTS) )
+		SeqWrite( m_seq[STATE_OBJECTS], *m_objects, *obj.m_objects );
+	if( sections & (1 << STATE_PROFILE) )
+		SeqWrite( m_seq[STATE_PROFILE], *m_profile, *obj.m_profile );
 }
 
 void NshadeReadState::CopyStaticData( const NshadeWriteState& obj ) {
@@ -265,39 +326,31 @@ void NshadeReadState::CopyStaticData( const NshadeWriteState& obj ) {
 }
 
 void NshadeReadState::Media( MediaState& obj ) {
-	m_readMutex->lock();
-		obj = *m_media;
-	m_readMutex->unlock();
+	SeqRead( m_seq[STATE_MEDIA], *m_media, obj );
 }
 
 void NshadeReadState::Script( ScriptState& obj ) {
-	m_readMutex->lock();
-		obj = *m_script;
-	m_readMutex->unlock();
+	SeqRead( m_seq[STATE_SCRIPT], *m_script, obj );
 }
 
 void NshadeReadState::Observer( ObserverState& obj ) {
-	m_readMutex->lock();
-		obj = *m_observer;
-	m_readMutex->unlock();
+	SeqRead( m_seq[STATE_OBSERVER], *m_observer, obj );
 }
 
 void NshadeReadState::Reference( ReferenceState& obj ) {
-	m_readMutex->lock();
-		obj = *m_reference;
-	m_readMutex->unlock();
+	SeqRead( m_seq[STATE_REFERENCE], *m_reference, obj );
 }
 
 void NshadeReadState::Settings( SettingsState& obj ) {
-	m_readMutex->lock();
-		obj = *m_settings;
-	m_readMutex->unlock();
+	SeqRead( m_seq[STATE_SETTINGS], *m_settings, obj );
 }
 
 void NshadeReadState::Objects( ObjectsState& obj ) {
-	m_readMutex->lock();
-		obj = *m_objects;
-	m_readMutex->unlock();
+	SeqRead( m_seq[STATE_OBJECTS], *m_objects, obj );
+}
+
+void NshadeReadState::Profile( ProfileState& obj ) {
+	SeqRead( m_seq[STATE_PROFILE], *m_profile, obj );
 }
 
 void NshadeReadState::SkyLanguages( std::string& langs ) {
@@ -326,6 +379,8 @@ NshadeWriteState::NshadeWriteState( boost::interprocess::managed_shared_memory*
 	m_reference = shm->find_or_construct<ReferenceState>("write_reference")( true );
 	m_settings = shm->find_or_construct<SettingsState>("write_settings")();
 	m_objects = shm->find_or_construct<ObjectsState>("write_objects")();
+	m_profile = shm->find_or_construct<ProfileState>("write_profile")();
+	m_dirty = (1 << STATE_NB_SECTIONS) - 1;
 }
 
 void NshadeWriteState::Media( const MediaState& obj ) {
@@ -336,6 +391,7 @@ void NshadeWriteState::Media( const MediaState& obj ) {
 		m_media->playStateVideo = obj.playStateVideo;
 	if( obj.playStateAudio != MediaState::UNK )
 		m_media->playStateAudio = obj.playStateAudio;
+	m_dirty |= 1 << STATE_MEDIA;
 	m_globalMutex->unlock();
 }
 
@@ -345,6 +401,7 @@ void NshadeWriteState::Script( const ScriptState& obj ) {
 			m_script->volume = obj.volume;
 		if( obj.playState != ScriptState::UNK )
 			m_script->playState = obj.playState;
+		m_dirty |= 1 << STATE_SCRIPT;
 	m_globalMutex->unlock();
 }
 
@@ -384,6 +441,7 @@ void NshadeWriteState::Reference( const ReferenceState& obj ) {
 			m_reference->show_tui_short_obj_info = obj.show_tui_short_obj_info;
 		if( obj.selected_landscape[0] )
 			memcpy( m_reference->selected_landscape, obj.selected_landscape, sizeof(m_reference->selected_landscape) );
+		m_dirty |= 1 << STATE_REFERENCE;
 	m_globalMutex->unlock();
 }
 
@@ -413,6 +471,7 @@ void NshadeWriteState::Observer( const ObserverState& obj ) {
 			memcpy( m_observer->home, obj.home, sizeof(m_observer->home) );
 		if( obj.tz[0] )
 			memcpy( m_observer->tz, obj.tz, sizeof(m_observer->tz) );
+		m_dirty |= 1 << STATE_OBSERVER;
 	m_globalMutex->unlock();
 }
 
@@ -506,6 +565,7 @@ void NshadeWriteState::Settings( const SettingsState& obj ) {
 	if( obj.m_state.flyto_duration != shortMax )
 		m_settings->m_state.flyto_duration = obj.m_state.flyto_duration;
 
+	m_dirty |= 1 << STATE_SETTINGS;
 	m_globalMutex->unlock();
 }
 
@@ -545,6 +605,13 @@ void NshadeWriteState::Objects( const ObjectsState& obj ) {
 			m_objects->m_state.star_labels = obj.m_state.star_labels;
 		if( obj.m_state.sky_culture[0] )
 			memcpy( m_objects->m_state.sky_culture, obj.m_state.sky_culture, sizeof(m_objects->m_state.sky_culture) );
+		m_dirty |= 1 << STATE_OBJECTS;
 	m_globalMutex->unlock();
 }
 
+void NshadeWriteState::Profile( const ProfileState& obj ) {
+	m_globalMutex->lock();
+		*m_profile = obj;
+		m_dirty |= 1 << STATE_PROFILE;
+	m_globalMutex->unlock();
+}
@@ -179,6 +179,28 @@ public:
 	} m_state;
 };
 
+// Frame profiler statistics, written as a whole once per frame
+class ProfileState {
+public:
+	enum { MAX_STAGES = 32, MAX_COUNTERS = 8, NAME_LEN = 32 };
+
+	ProfileState();
+	void operator =( const ProfileState& );
+
+	struct {
+		short enabled;
+		short nb_stages;
+		char stage_names[MAX_STAGES][NAME_LEN];
+		float cpu_mean[MAX_STAGES];		// ms
+		float cpu_max[MAX_STAGES];		// ms
+		float gpu_mean[MAX_STAGES];		// ms, -1 when not measured
+		short nb_counters;
+		char counter_names[MAX_COUNTERS][NAME_LEN];
+		float counter_mean[MAX_COUNTERS];	// per frame
+		float counter_max[MAX_COUNTERS];
+	} m_state;
+};
+
 struct TZRecord {
 	TZRecord():tzName(NULL){};
 	TZRecord( const char* name ):
@@ -309,6 +331,19 @@ struct ObjectRecord {
 };
 
 
+// Sections of the dynamic state. Each is republished to readers only when
+// nightshade changed it since the last push.
+enum StateSection {
+	STATE_MEDIA,
+	STATE_SCRIPT,
+	STATE_OBSERVER,
+	STATE_REFERENCE,
+	STATE_SETTINGS,
+	STATE_OBJECTS,
+	STATE_PROFILE,
+	STATE_NB_SECTIONS
+};
+
 class NshadeWriteState {
 	friend class NshadeReadState;
 
@@ -320,6 +355,7 @@ public:
 	void Reference( const ReferenceState& );
 	void Settings( const SettingsState& );
 	void Objects( const ObjectsState& );
+	void Profile( const ProfileState& );
 
 	void SkyLanguages( const std::string& );
 	void Landscapes( const std::string& );
@@ -333,11 +369,19 @@ private:
 	boost::interprocess::offset_ptr<ReferenceState> m_reference;
 	boost::interprocess::offset_ptr<SettingsState> m_settings;
 	boost::interprocess::offset_ptr<ObjectsState> m_objects;
+	boost::interprocess::offset_ptr<ProfileState> m_profile;
+
+	unsigned int m_dirty;	// one bit per StateSection, guarded by m_globalMutex
 
 	shared_string m_languages;
 	shared_string m_landscapes;
 };
 
+// Dynamic sections are published with one sequence counter each: the
+// renderer makes the counter odd while it copies a section and readers retry
+// until they see the same even value before and after their copy, so a slow
+// client can never hold up a frame. The static strings are still guarded by
+// m_readMutex as they are only written at startup.
 class NshadeReadState {
 public:
 	NshadeReadState( boost::interprocess::managed_shared_memory* );
@@ -347,14 +391,19 @@ public:
 	void Reference( ReferenceState& );
 	void Settings( SettingsState& );
 	void Objects( ObjectsState& );
+	void Profile( ProfileState& );
 
 	void operator =( const NshadeWriteState& obj );
+	void Publish( NshadeWriteState& obj );
 	void CopyStaticData( const NshadeWriteState& obj );
 
 	void SkyLanguages( std::string& );
 	void Landscapes( std::string& );
 
 private:
+	void Copy( const NshadeWriteState& obj, unsigned int sections );
+
+	volatile unsigned int m_seq[STATE_NB_SECTIONS];
 	boost::interprocess::offset_ptr<boost::interprocess::interprocess_mutex> m_readMutex;
 	boost::interprocess::offset_ptr<boost::interprocess::interprocess_mutex> m_globalMutex;
 
@@ -364,6 +413,7 @@ private:
 	boost::interprocess::offset_ptr<ReferenceState> m_reference;
 	boost::interprocess::offset_ptr<SettingsState> m_settings;
 	boost::interprocess::offset_ptr<ObjectsState> m_objects;
+	boost::interprocess::offset_ptr<ProfileState> m_profile;
 
 	shared_string m_languages;
 	shared_string m_landscapes;
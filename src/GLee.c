@@ -37,11 +37,19 @@
 	#pragma optimize( "g", off )
 #endif
 
+#ifdef HAVE_CONFIG_H
+#include <config.h>
+#endif
+
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
 #include "GLee.h"
 
+#ifdef HAVE_OSMESA
+	#include <GL/osmesa.h>
+#endif
+
 #if defined(__APPLE__) || defined(__APPLE_CC__)
 	#include <Carbon/Carbon.h>
 #endif
@@ -77,6 +85,11 @@ void * __GLeeGetProcAddress(const char *extname)
 
     return function;
 #else
+#ifdef HAVE_OSMESA
+	/* headless runs render through OSMesa, which has its own entry points */
+	if (OSMesaGetCurrentContext())
+		return (void*)OSMesaGetProcAddress(extname);
+#endif
 	return (void*)glXGetProcAddressARB((const GLubyte *)extname);
 #endif
 }
@@ -30,6 +30,8 @@
 #include "utility.h"
 #include "callbacks.hpp"
 #include "shared_data.h"
+#include "texture_loader.h"
+#include "kepler.h"
 #include <fastdb/fastdb.h>
 #include <exception>
 #include <Magick++.h>
@@ -44,7 +46,8 @@ static ConnectCallback connectCb("Bowen");
 App::App( SDLFacade* const sdl ) :
 		frame(0), timefr(0), timeBase(0), fps(0), maxfps(10000.f),  FlagTimePause(0),
 		is_mouse_moving_horiz(false), is_mouse_moving_vert(false), draw_mode(App::DM_NONE),
-		initialized(0), GMT_shift(0), m_OutputFrameNumber(0)
+		initialized(0), benchMode(false), GMT_shift(0), frameCapture(NULL), rtCommandBudget(5),
+		atlasHits(0), atlasMisses(0)
 {
 	Magick::InitializeMagick(NULL);
 	// Ensure shared data structures are initialized early
@@ -72,11 +75,13 @@ App::App( SDLFacade* const sdl ) :
 
 App::~App()
 {
+	delete frameCapture;
 	delete ui;
 	delete scripts;
 	delete commander;
 	delete core;
 	if (distorter) delete distorter;
+	TextureLoader::Destroy();
 
 	NamedSockets::Clear();
 	// This should be last, other objects may try to hit
@@ -137,6 +142,16 @@ void App::init(void)
 	conf.set_double("video:vertical_offset", 0);
 	//conf.set_double("navigation:init_fov", 180);
 
+	if (benchMode) {
+		// What a frame shows must not depend on the time spent drawing:
+		// load on this thread and let no time budget put work off
+		conf.set_int("video:texture_loading_threads", 0);
+		conf.set_int("video:texture_upload_budget", 0);
+		conf.set_boolean("stars:flag_background_loading", false);
+		conf.set_int("gui:script_command_budget", 0);
+		conf.set_int("gui:rt_command_budget", 0);
+	}
+
 #ifndef DESKTOP
 	conf.set_boolean("navigation:flag_enable_move_mouse", 0);
 	conf.set_double("viewing:constellation_art_fade_duration", 2);
@@ -150,11 +165,20 @@ void App::init(void)
 	maxfps 				= conf.get_double ("video","maximum_fps",10000);
 	minfps 				= conf.get_double ("video","minimum_fps",10000);
 	videoRecordFps		= conf.get_double ("video","video_record_fps",30);
+	captureFormat		= conf.get_str ("video","capture_format","png");
+	captureCommand		= conf.get_str ("video","capture_command",
+	                                    "ffmpeg -y -f rawvideo -pix_fmt bgra -s %wx%h -r %f -i - -pix_fmt yuv420p nightshade.mp4");
+	if (!frameCapture)
+		frameCapture = new FrameCapture(conf.get_int("video","capture_threads",-1), conf.get_int("video","capture_queue",8));
+	textureUploadBudget	= conf.get_int ("video","texture_upload_budget",4);
+	TextureLoader::Instance()->setThreads(conf.get_int("video","texture_loading_threads",-1));
 	string appLocaleName = conf.get_str("localization", "app_locale", "system");
 	time_format = string_to_s_time_format(conf.get_str("localization:time_display_format"));
 	date_format = string_to_s_date_format(conf.get_str("localization:date_display_format"));
 	setAppLanguage(appLocaleName);
 	scripts->set_allow_ui( conf.get_boolean("gui","flag_script_allow_ui",0) );
+	scripts->set_command_budget( conf.get_int("gui","script_command_budget",10) );
+	rtCommandBudget = conf.get_int("gui","rt_command_budget",5);
 
 	// time_zone used to be in init_location section of config,
 	// so use that as fallback when reading config - Rob
@@ -174,6 +198,8 @@ void App::init(void)
 		}
 	}
 
+	s_font::setFlagGlyphAtlas(conf.get_boolean("rendering", "flag_glyph_atlas", false));
+
 	Uint16 w, h;
 	m_sdl->getResolution( &w, &h );
 	core->init(conf, w, h);
@@ -285,12 +311,14 @@ void App::UpdateSharedData( void ) {
 		shared->Write(response);
 	}
 
-	// Asynchronous channel
-	bool have_asynch_data = shared->ReadRT( cmdData );
-	if( have_asynch_data ) {
+	// Asynchronous channel, drain everything queued since the last frame
+	// unless a burst takes longer than rtCommandBudget
+	Uint32 start = SDL_GetTicks();
+	while( shared->ReadRT( cmdData ) ) {
 		if( !m_skyCommander.execute_command(cmdData) ) {
 			commander->execute_command(cmdData, delay, 1);
 		}
+		if( rtCommandBudget && SDL_GetTicks() - start >= rtCommandBudget ) break;
 	}
 
 	// Nightshade 'dynamic' state push
@@ -349,13 +377,30 @@ double App::draw(int delta_time)
 	glEnd();
 	restoreFrom2DfullscreenProjection();
 
+	// Upload the textures decoded since the last frame
+	TextureLoader::Instance()->upload(textureUploadBudget);
+
 	// Render all the main objects of the application
 	double squaredDistance = core->draw(delta_time);
 
+	FrameProfiler *profiler = core->getProfiler();
+
 	// Draw the Graphical ui and the Text ui
+	profiler->begin(PROFILE_UI);
 	ui->draw();
 
 	distorter->distort();
+	profiler->end(PROFILE_UI);
+
+	// Glyph atlas use of all fonts during the frame, 0 without lookups
+	const unsigned long hits = s_font::getAtlasHits() - atlasHits;
+	const unsigned long misses = s_font::getAtlasMisses() - atlasMisses;
+	atlasHits += hits;
+	atlasMisses += misses;
+	profiler->setCounter(PROFILE_ATLAS_MEMORY, s_font::getAtlasMemory()/1024.f);
+	profiler->setCounter(PROFILE_ATLAS_HIT_RATE, hits+misses ? (float)hits/(hits+misses) : 0.f);
+
+	profiler->endFrame();
 
 	return squaredDistance;
 }
@@ -951,7 +996,10 @@ void App::start_main_loop()
 
 			case SDL_VIDEORESIZE:
 				// Recalculate The OpenGL Scene Data For The New Window
-				if (E.resize.h && E.resize.w) core->setViewportSize(E.resize.w, E.resize.h);
+				if (E.resize.h && E.resize.w) {
+					core->setViewportSize(E.resize.w, E.resize.h);
+					frameCapture->resize(E.resize.w, E.resize.h);
+				}
 				break;
 
 			case SDL_ACTIVEEVENT:
@@ -1024,12 +1072,11 @@ void App::start_main_loop()
 				// shift-ctrl-v starts recording video
 				if (E.key.keysym.sym==SDLK_v && (E.key.keysym.mod & COMPATIBLE_KMOD_CTRL) && 
 					(E.key.keysym.mod & KMOD_SHIFT)) {
-					if(m_OutputFrameNumber) {
-						m_OutputFrameNumber = 0;
+					if(frameCapture->isCapturing()) {
+						frameCapture->stop();
 						ui->show_message(_("Stopped recording video frames."), 5000);  // TODO not drawing
 						cout << _("Stopped recording video frames.") << endl;
-					} else {
-						m_OutputFrameNumber = 1;
+					} else if(startVideoCapture()) {
 						ui->show_message(_("Now recording video frames!\nPress CTRL-SHIFT-V to stop."), 1000);
 					}
 
@@ -1089,7 +1136,8 @@ void App::start_main_loop()
 
 				TickCount = SDL_GetTicks();			// Get present ticks
 				// Wait a while if drawing a frame right now would exceed our preferred framerate.
-				if (TickCount-LastCount < 1000./frameRate) {
+				// While recording the clock is fixed, draw as fast as the frames are written.
+				if (!frameCapture->isCapturing() && TickCount-LastCount < 1000./frameRate) {
 					unsigned int delay = (unsigned int) (1000./frameRate) - (TickCount-LastCount);
 //					printf("delay=%d\n", delay);
 					if (delay < 15) {
@@ -1108,7 +1156,7 @@ void App::start_main_loop()
 				TickCount = SDL_GetTicks();			// Get present ticks
 
 				// If outputting video frames, force output frame rate
-				if(m_OutputFrameNumber) {
+				if(frameCapture->isCapturing()) {
 					TickCount = LastCount + 1000./videoRecordFps; 
 				}
 
@@ -1116,22 +1164,86 @@ void App::start_main_loop()
 				double squaredDistance = this->draw(TickCount-LastCount);	// Do the drawings!
 
 				// write out video frame if recording video
-				if(m_OutputFrameNumber) {
-					char c[5];
-					snprintf(c,5,"%04u",m_OutputFrameNumber);
-					writeScreenshot(getScreenshotDirectory() + APP_LOWER_NAME + "-frame-" + string(c) + ".bmp");
-					m_OutputFrameNumber++;
-				}
+				frameCapture->capture();
 
 				animationSpeed = sqrt(squaredDistance) / (TickCount-LastCount);
 				LastCount = TickCount;				// Save the present tick probing
-				SDL_GL_SwapBuffers();				// And swap the buffers
+				m_sdl->swapBuffers();				// And swap the buffers
 			}
 		}
 	}
 }
 
 
+void App::runBenchmark(const string& scriptFile, unsigned int maxFrames, int timestep,
+                       const string& frameDir, const string& csvFile)
+{
+	FrameProfiler *profiler = core->getProfiler();
+	profiler->setEnabled(true);
+	profiler->setFlagGLTimers(true);
+	if (!csvFile.empty()) profiler->startCSV(csvFile);
+
+	string scriptPath;
+	string::size_type pos = scriptFile.find_last_of("/\\");
+	if (pos != string::npos) scriptPath = scriptFile.substr(0, pos+1);
+
+	if (!scripts->play_script(scriptFile, scriptPath)) {
+		cerr << "Benchmark: unable to play script " << scriptFile << endl;
+		return;
+	}
+
+	if (!frameDir.empty()) {
+		Uint16 w, h;
+		m_sdl->getResolution( &w, &h );
+		frameCapture->start(FrameCapture::FORMAT_PNG, frameDir + "/" + APP_LOWER_NAME + "-frame-", w, h, 1000./timestep);
+	}
+
+	SDL_Event E;
+	bool quit = false;
+	unsigned int nbFrames = 0;
+	const Uint32 start = SDL_GetTicks();
+
+	// The clock advances by timestep each frame whatever the time spent drawing
+	// and, with the settings forced by init() in bench mode and the orbit lines
+	// waited for, two runs of the same script draw the same frames
+	core->setFlagWaitOrbitSamples(true);
+	while (!quit && scripts->is_playing() && (!maxFrames || nbFrames < maxFrames)) {
+		while (SDL_PollEvent(&E)) {
+			if (E.type == SDL_QUIT) quit = true;
+		}
+
+		update(timestep);
+		draw(timestep);
+		frameCapture->capture();
+
+		m_sdl->swapBuffers();
+		nbFrames++;
+	}
+
+	const Uint32 elapsed = SDL_GetTicks() - start;
+	cout << "Benchmark: " << nbFrames << " frames of " << timestep << " ms in " << elapsed << " ms";
+	if (nbFrames) cout << " (" << (float)elapsed/nbFrames << " ms per frame)";
+	cout << endl << profiler->getReport();
+
+	frameCapture->stop();
+	profiler->stopCSV();
+	ImageMgr::cleanUp();
+}
+
+bool App::runChecks(void)
+{
+	bool passed = BenchmarkKeplerSolver(100000, 10, cout);
+
+	// One update sets the projection matrices
+	update(0);
+	passed = core->benchmarkProjection(100000, 10, cout) && passed;
+	passed = core->benchmarkNameSearch(5, 20, cout) && passed;
+	passed = commander->benchmarkCommands(2000, cout) && passed;
+
+	cout << (passed ? "Checks passed" : "Checks FAILED") << endl;
+	return passed;
+}
+
 // Write current video frame to a specified file
 void App::writeScreenshot(string filename) 
 {
@@ -1195,8 +1307,27 @@ string App::getScreenshotDirectory()
 }
 
 
+bool App::startVideoCapture(void)
+{
+	Uint16 w, h;
+	m_sdl->getResolution( &w, &h );
+
+	FrameCapture::FORMAT format = FrameCapture::formatFromString(captureFormat);
+	string path;
+	if (format == FrameCapture::FORMAT_Y4M)
+		path = getNextScreenshotFilename(".y4m");
+	else if (format == FrameCapture::FORMAT_PIPE)
+		path = captureCommand;
+	else
+		path = getScreenshotDirectory() + APP_LOWER_NAME + "-frame-";
+
+	if (!frameCapture->start(format, path, w, h, videoRecordFps)) return false;
+	cout << _("Recording video frames to ") << path << endl;
+	return true;
+}
+
 // Return the next sequential screenshot filename to use
-string App::getNextScreenshotFilename()
+string App::getNextScreenshotFilename(const string& extension)
 {
 	string tempName;
 	char c[3];
@@ -1207,7 +1338,7 @@ string App::getNextScreenshotFilename()
 	for (int j=0; j<=100; ++j) {
 		snprintf(c,3,"%d",j);
 
-		tempName = shotdir + APP_LOWER_NAME + c + ".bmp";
+		tempName = shotdir + APP_LOWER_NAME + c + extension;
 		fp = fopen(tempName.c_str(), "r");
 		if (fp == NULL)
 			break;
@@ -33,6 +33,7 @@
 #include "script_mgr.h"
 #include "app_settings.h"
 #include "sdl_facade.h"
+#include "frame_capture.h"
 #include <fastdb/fastdb.h>
 #include "named_sockets.h"
 
@@ -110,6 +111,12 @@ public:
 	//! Initialize application and core
 	void init(void);
 
+	//! Set before init() for runBenchmark: everything is loaded synchronously
+	//! and no time budget limits the work done per frame
+	void setBenchMode(bool b) {
+		benchMode = b;
+	}
+
 	//! Update all object according to the delta time
 	void update(int delta_time);
 
@@ -123,6 +130,16 @@ public:
 		start_main_loop();
 	}
 
+	//! Play a script with a fixed timestep instead of the main loop and report the frame times.
+	//! Stops at the end of the script or after maxFrames frames if not 0.
+	//! Frames are saved as PNG images in frameDir and per frame stage times in csvFile if not empty.
+	void runBenchmark(const string& scriptFile, unsigned int maxFrames, int timestep,
+	                  const string& frameDir, const string& csvFile);
+
+	//! Check the fast paths against the code they replaced, printing their timings.
+	//! Returns false and prints a FAIL line when one of them is out of tolerance.
+	bool runChecks(void);
+
 	// n.b. - do not confuse this with sky time rate
 	int getTimeMultiplier() {
 		return time_multiplier;
@@ -229,7 +246,10 @@ private:
 	string getScreenshotDirectory();
 
 	//! Return the next sequential screenshot filename to use
-	string getNextScreenshotFilename();
+	string getNextScreenshotFilename(const string& extension = ".bmp");
+
+	//! Start recording video frames in the configured format
+	bool startVideoCapture(void);
 
 	void UpdateSharedData( void );
 
@@ -237,6 +257,7 @@ private:
 	Core* core;
 	SDLFacade* m_sdl;
 	NshadeCommander m_skyCommander;
+	Uint32 rtCommandBudget;           // ms per frame spent draining the real time channel
 
 	// Script related
 	string SelectedScript;  // script filename (without directory) selected in a UI to run when exit UI
@@ -259,6 +280,8 @@ private:
 	float fps;
 	float minfps, maxfps;
 	float videoRecordFps;               // Rate to use when recording video frames 
+	unsigned int textureUploadBudget;   // ms per frame spent uploading loaded textures
+	unsigned long atlasHits, atlasMisses;  // glyph atlas lookups before the frame, for the profiler
 
 	int FlagTimePause;
 	double temp_time_velocity;			// Used to store time speed while in pause
@@ -276,6 +299,7 @@ private:
 
 	DRAWMODE draw_mode;					// Current draw mode
 	bool initialized;  // has the init method been called yet?
+	bool benchMode;    // repeatable frames for runBenchmark
 
 	// Date and time variables
 	S_TIME_FORMAT time_format;
@@ -293,7 +317,9 @@ private:
 	S_DATE_FORMAT string_to_s_date_format(const string& df) const;
 	string s_date_format_to_string(S_DATE_FORMAT df) const;
 
-	unsigned int m_OutputFrameNumber; // for writing out video frames to files
+	FrameCapture* frameCapture;       // for writing out video frames
+	string captureFormat;             // png, bmp, y4m or pipe
+	string captureCommand;            // encoder fed by the pipe format
 };
 
 #endif
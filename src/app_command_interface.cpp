@@ -31,9 +31,11 @@
 #include "app_command_interface.h"
 #include "core.h"
 #include "image.h"
+#include "texture_loader.h"
 #include "stellastro.h"
 #include "nightshade.h"
 #include "named_sockets.h"
+#include "frame_profiler.h"
 
 using namespace std;
 
@@ -102,574 +104,877 @@ int AppCommandInterface::execute_command(string command, int arg)
 // they are "trusted" - TODO details TBD when needed
 int AppCommandInterface::execute_command(string commandline, unsigned long int &wait, bool trusted)
 {
-	string command;
-	stringHash_t args;
-	int status = 0;  // true if command was understood
-	int recordable = 1;  // true if command should be recorded (if recording)
+	BoundCommand cmd;
+	bind_command(commandline, cmd);
 
-	wait = 0;  // default, no wait between commands
+	return execute_command(cmd, wait, trusted);
+}
 
-	status = parse_command(commandline, command, args);
 
-	// If command is empty then don't bother checking all these cases
-	if( command.length() < 1 )
-		return 0;
+// Flags of the flag command, in the order they used to be tested
+enum {
+	FLAG_ANTIALIAS_LINES, FLAG_CONSTELLATION_DRAWING, FLAG_CONSTELLATION_NAMES,
+	FLAG_CONSTELLATION_ART, FLAG_CONSTELLATION_BOUNDARIES, FLAG_CONSTELLATION_PICK,
+	FLAG_STAR_TWINKLE, FLAG_POINT_STAR, FLAG_SHOW_SELECTED_OBJECT_INFO, FLAG_SHOW_TUI_DATETIME,
+	FLAG_SHOW_TUI_SHORT_OBJ_INFO, FLAG_MANUAL_ZOOM, FLAG_LIGHT_TRAVEL_TIME, FLAG_SHOW_SCRIPT_BAR,
+	FLAG_FOG, FLAG_ATMOSPHERE, FLAG_AZIMUTHAL_GRID, FLAG_GALACTIC_GRID, FLAG_EQUATORIAL_GRID,
+	FLAG_EQUATOR_LINE, FLAG_ECLIPTIC_LINE, FLAG_PRECESSION_CIRCLE, FLAG_CIRCUMPOLAR_CIRCLE,
+	FLAG_TROPIC_LINES, FLAG_MERIDIAN_LINE, FLAG_CARDINAL_POINTS, FLAG_CLOUDS, FLAG_MOON_SCALED,
+	FLAG_LANDSCAPE, FLAG_STARS, FLAG_STAR_NAMES, FLAG_PLANETS, FLAG_PLANET_NAMES, FLAG_PLANET_ORBITS,
+	FLAG_NEBULAE, FLAG_NEBULA_NAMES, FLAG_MILKY_WAY, FLAG_BRIGHT_NEBULAE, FLAG_OBJECT_TRAILS,
+	FLAG_TRACK_OBJECT, FLAG_SCRIPT_GUI_DEBUG, NB_FLAGS
+};
+
+static const char *flag_names[NB_FLAGS] = {
+	"antialias_lines", "constellation_drawing", "constellation_names",
+	"constellation_art", "constellation_boundaries", "constellation_pick",
+	"star_twinkle", "point_star", "show_selected_object_info", "show_tui_datetime",
+	"show_tui_short_obj_info", "manual_zoom", "light_travel_time", "show_script_bar",
+	"fog", "atmosphere", "azimuthal_grid", "galactic_grid", "equatorial_grid",
+	"equator_line", "ecliptic_line", "precession_circle", "circumpolar_circle",
+	"tropic_lines", "meridian_line", "cardinal_points", "clouds", "moon_scaled",
+	"landscape", "stars", "star_names", "planets", "planet_names", "planet_orbits",
+	"nebulae", "nebula_names", "milky_way", "bright_nebulae", "object_trails",
+	"track_object", "script_gui_debug"
+};
+
+// Settings of the set command, in order of precedence when several are given
+enum {
+	SET_ATMOSPHERE_FADE_DURATION, SET_AUTO_MOVE_DURATION, SET_CONSTELLATION_ART_FADE_DURATION,
+	SET_CONSTELLATION_ART_INTENSITY, SET_LIGHT_POLLUTION_LIMITING_MAGNITUDE, SET_FLIGHT_DURATION,
+	SET_HEADING, SET_HOME_PLANET, SET_LANDSCAPE_NAME, SET_LINE_WIDTH, SET_MAX_MAG_NEBULA_NAME,
+	SET_MAX_MAG_STAR_NAME, SET_MOON_SCALE, SET_MILKY_WAY_TEXTURE, SET_SKY_CULTURE, SET_SKY_LOCALE,
+	SET_UI_LOCALE, SET_STAR_MAG_SCALE, SET_STAR_SIZE_LIMIT, SET_PLANET_SIZE_LIMIT, SET_STAR_SCALE,
+	SET_NEBULA_SCALE, SET_STAR_TWINKLE_AMOUNT, SET_STAR_LIMITING_MAG, SET_TIME_ZONE,
+	SET_MILKY_WAY_INTENSITY, SET_ZOOM_OFFSET, NB_SETTINGS
+};
+
+static const char *setting_names[NB_SETTINGS] = {
+	"atmosphere_fade_duration", "auto_move_duration", "constellation_art_fade_duration",
+	"constellation_art_intensity", "light_pollution_limiting_magnitude", "flight_duration",
+	"heading", "home_planet", "landscape_name", "line_width", "max_mag_nebula_name",
+	"max_mag_star_name", "moon_scale", "milky_way_texture", "sky_culture", "sky_locale",
+	"ui_locale", "star_mag_scale", "star_size_limit", "planet_size_limit", "star_scale",
+	"nebula_scale", "star_twinkle_amount", "star_limiting_mag", "time_zone",
+	"milky_way_intensity", "zoom_offset"
+};
+
+vector<AppCommandInterface::CommandHandler> AppCommandInterface::handlers;
+map<string, int> AppCommandInterface::command_table;
+map<string, int> AppCommandInterface::flag_table;
+map<string, int> AppCommandInterface::setting_table;
+
+void AppCommandInterface::init_tables(void)
+{
+	static const struct {
+		const char *name;
+		CommandHandler handler;
+	} commands[] = {
+		{ "flag", &AppCommandInterface::command_flag },
+		{ "wait", &AppCommandInterface::command_wait },
+		{ "set", &AppCommandInterface::command_set },
+		{ "select", &AppCommandInterface::command_select },
+		{ "deselect", &AppCommandInterface::command_deselect },
+		{ "look", &AppCommandInterface::command_look },
+		{ "zoom", &AppCommandInterface::command_zoom },
+		{ "timerate", &AppCommandInterface::command_timerate },
+		{ "multiplier", &AppCommandInterface::command_multiplier },
+		{ "date", &AppCommandInterface::command_date },
+		{ "body", &AppCommandInterface::command_body },
+		{ "moveto", &AppCommandInterface::command_moveto },
+		{ "image", &AppCommandInterface::command_image },
+		{ "audio", &AppCommandInterface::command_audio },
+		{ "script", &AppCommandInterface::command_script },
+		{ "sky_culture", &AppCommandInterface::command_sky_culture },
+		{ "nebula", &AppCommandInterface::command_nebula },
+		{ "clear", &AppCommandInterface::command_clear },
+		{ "landscape", &AppCommandInterface::command_landscape },
+		{ "meteors", &AppCommandInterface::command_meteors },
+		{ "external_viewer", &AppCommandInterface::command_external_viewer },
+		{ "configuration", &AppCommandInterface::command_configuration },
+		{ "shutdown", &AppCommandInterface::command_shutdown },
+		{ "cove_lights", &AppCommandInterface::command_cove_lights },
+		{ "color", &AppCommandInterface::command_color },
+		{ "profile", &AppCommandInterface::command_profile }
+	};
+
+	for (unsigned int i=0; i<sizeof(commands)/sizeof(commands[0]); i++) {
+		command_table[commands[i].name] = handlers.size();
+		handlers.push_back(commands[i].handler);
+	}
+	for (int i=0; i<NB_FLAGS; i++) flag_table[flag_names[i]] = i;
+	for (int i=0; i<NB_SETTINGS; i++) setting_table[setting_names[i]] = i;
+}
 
-	// application specific logic to run each command
-	if (command == "flag") {
+// Only the flag and set arguments are converted once here. The other
+// commands (zoom, look, date, moveto...) still read their arguments with
+// cmd.arg() and convert them with str_to_double each time they run.
+void AppCommandInterface::bind_command(const string &commandline, BoundCommand &cmd)
+{
+	if (command_table.empty()) init_tables();
 
-		// could loop if want to allow that syntax
-		if (args.begin() != args.end()) {
+	cmd.line = commandline;
+	cmd.command.clear();
+	cmd.args.clear();
+	parse_command(commandline, cmd.command, cmd.args);
 
-			bool val;
-			status = set_flag( args.begin()->first, args.begin()->second, val, trusted);
+	map<string, int>::const_iterator iter = command_table.find(cmd.command);
+	cmd.handler = (iter == command_table.end()) ? -1 : iter->second;
+	cmd.key = -1;
+	cmd.toggle = false;
+	cmd.value = 0;
 
-			// rewrite command for recording so that actual state is known (rather than "toggle")
-			if (args.begin()->second == "toggle") {
-				std::ostringstream oss;
-				oss << command << " " << args.begin()->first << " " << val;
-				commandline = oss.str();
+	if (cmd.command == "flag") {
+		// could loop if want to allow that syntax
+		if (!cmd.args.empty()) {
+			iter = flag_table.find(cmd.args.begin()->first);
+			if (iter != flag_table.end()) cmd.key = iter->second;
+
+			// value can be "on", "off", or "toggle"
+			const string &value = cmd.args.begin()->second;
+			cmd.toggle = (value == "toggle");
+			cmd.value = (value == "on" || value == "1");
+		}
+	} else if (cmd.command == "set") {
+		for (stringHashIter_t arg = cmd.args.begin(); arg != cmd.args.end(); ++arg) {
+			if (arg->second.empty()) continue;
+			iter = setting_table.find(arg->first);
+			if (iter != setting_table.end() && (cmd.key < 0 || iter->second < cmd.key)) {
+				cmd.key = iter->second;
+				cmd.value = str_to_double(arg->second);
 			}
-		} else status = 0;
+		}
+	}
+}
 
-	}  else if (command == "wait") {
+// execute a command prepared by bind_command, as stored in compiled scripts
+int AppCommandInterface::execute_command(const BoundCommand &cmd, unsigned long int &wait, bool trusted)
+{
+	wait = 0;  // default, no wait between commands
 
-		if ( args["until"]!="") {
-			float fseconds = str_time_to_seconds(args["until"]);
-			if (fseconds > 0) {
-				fseconds -= stapp->scripts->get_script_elapsed_seconds();
-				if(fseconds > 0 ) wait = (unsigned long int)(fseconds*1000);
-				else wait = 0;
-			}
-		} else if ( args["duration"]!="") {
-			float fdelay = str_to_double(args["duration"]);
-			if (fdelay > 0) wait = (int)(fdelay*1000);
-		}
+	// If command is empty then don't bother
+	if (cmd.command.empty())
+		return 0;
 
-		// Allow timer to be reset
-		if ( args["action"]=="reset_timer") stapp->scripts->reset_timer();
+	CommandCall call;
+	call.trusted = trusted;
+	call.wait = 0;
+	call.recordable = true;
 
-	} else if (command == "set") {
-		// set core variables
+	int status;  // true if command was understood
+	if (cmd.handler >= 0) {
+		status = (this->*handlers[cmd.handler])(cmd, call);
+	} else {
+		debug_message = _("Unrecognized or malformed command name.");
+		status = 0;
+	}
+	wait = call.wait;
 
-		// TODO: some bounds/error checking here
+	if (status ) {
 
-		if (args["atmosphere_fade_duration"]!="") stcore->setAtmosphereFadeDuration(str_to_double(args["atmosphere_fade_duration"]));
-		else if (args["auto_move_duration"]!="") stcore->setAutomoveDuration( str_to_double(args["auto_move_duration"]));
-		else if (args["constellation_art_fade_duration"]!="") stcore->setConstellationArtFadeDuration(str_to_double(args["constellation_art_fade_duration"]));
-		else if (args["constellation_art_intensity"]!="") stcore->setConstellationArtIntensity(str_to_double(args["constellation_art_intensity"]));
-		else if (args["light_pollution_limiting_magnitude"]!="") stcore->setLightPollutionLimitingMagnitude(str_to_double(args["light_pollution_limiting_magnitude"]));
-		else if (args["flight_duration"]!="") stcore->setFlightDuration( str_to_double(args["flight_duration"]));
-		else if (args["heading"]!="") {
+		// if recording commands, do that now
+		if (call.recordable) stapp->scripts->record_command(call.line.empty() ? cmd.line : call.line);
 
-			float fdelay = str_to_double(args["duration"]);
-			if (fdelay <= 0) fdelay = 0;
+		//    cout << commandline << endl;
 
-			stcore->getNavigation()->change_heading(str_to_double(args["heading"]), (int)(fdelay*1000));
+	} else {
 
-		} else if (args["home_planet"]!="") {
-			float duration = 0;
-			if( args["duration"] == "default" )
-				duration = stcore->getFlightDuration();
-			else
-				duration = str_to_double(args["duration"], 0);
-			stcore->setHomePlanet(args["home_planet"], duration);
-		} else if (args["landscape_name"]!="") stcore->setLandscape(args["landscape_name"]);
-		else if (args["line_width"]!="") stcore->setLineWidth(str_to_double(args["line_width"]));
-		else if (args["max_mag_nebula_name"]!="") stcore->setNebulaMaxMagHints(str_to_double(args["max_mag_nebula_name"]));
-		else if (args["max_mag_star_name"]!="") stcore->setMaxMagStarName(str_to_double(args["max_mag_star_name"]));
-		else if (args["moon_scale"]!="") {
-			stcore->setMoonScale(str_to_double(args["moon_scale"]));
-		} else if (args["milky_way_texture"]!="") {
-			if(args["milky_way_texture"]=="default") stcore->milkyswap(args["milky_way_texture"]);
-			else stcore->milkyswap(stapp->scripts->get_script_path() + args["milky_way_texture"]);
-		} else if (args["sky_culture"]!="") stcore->setSkyCultureDir(args["sky_culture"]);
-		else if (args["sky_locale"]!="") stcore->setSkyLanguage(args["sky_locale"]);
-		else if (args["ui_locale"]!="") stapp->setAppLanguage(args["ui_locale"]);
-		else if (args["star_mag_scale"]!="") stcore->setStarMagScale(str_to_double(args["star_mag_scale"]));
-		else if (args["star_size_limit"]!="") stcore->setStarSizeLimit(str_to_double(args["star_size_limit"]));
-		else if (args["planet_size_limit"]!="") stcore->setPlanetsSizeLimit(str_to_double(args["planet_size_limit"]));
-		else if (args["star_scale"]!="") {
-			float scale = str_to_double(args["star_scale"]);
-			stcore->setStarScale(scale);
-			stcore->setPlanetsScale(scale);
-		} else if (args["nebula_scale"]!="") {
-			float scale = str_to_double(args["nebula_scale"]);
-			stcore->setNebulaCircleScale(scale);
-		} else if (args["star_twinkle_amount"]!="") stcore->setStarTwinkleAmount(str_to_double(args["star_twinkle_amount"]));
-		else if (args["star_limiting_mag"]!="") stcore->setStarLimitingMag(str_to_double(args["star_limiting_mag"]));
-		else if (args["time_zone"]!="") stapp->setCustomTimezone(args["time_zone"]);
-		else if (args["milky_way_intensity"]!="") {
-			stcore->setMilkyWayIntensity(str_to_double(args["milky_way_intensity"]));
-			// safety feature to be able to turn back on
-			if (stcore->getMilkyWayIntensity()) stcore->setFlagMilkyWay(true);
-		} else if (args["zoom_offset"]!="") {
-			stcore->setViewOffset(str_to_double(args["zoom_offset"]));
+		// Show gui error window only if script asked for gui debugging
+		if (stapp->scripts->is_playing() && stapp->scripts->get_gui_debug())
+			stapp->ui->show_message(_("Could not execute command:") + string("\n\"") +
+			                        cmd.line + string("\"\n\n") + debug_message, 7000);
 
-		} else status = 0;
+		cerr << "Could not execute: " << cmd.line << endl << debug_message << endl;
+	}
 
+	return(status);
 
-		if (trusted) {
+}
 
-			// trusted commands disabled due to code reorg
 
-			//    else if(args["base_font_size"]!="") stcore->BaseFontSize = str_to_double(args["base_font_size"]);
-			//	else if(args["bbp_mode"]!="") stcore->BbpMode = str_to_double(args["bbp_mode"]);
-			//    else if(args["date_display_format"]!="") stcore->DateDisplayFormat = args["date_display_format"];
-			//	else if(args["fullscreen"]!="") stcore->Fullscreen = args["fullscreen"];
-			//	else if(args["horizontal_offset"]!="") stcore->HorizontalOffset = str_to_double(args["horizontal_offset"]);
-			//	else if(args["init_fov"]!="") stcore->InitFov = str_to_double(args["init_fov"]);
-			//	else if(args["preset_sky_time"]!="") stapp->PresetSkyTime = str_to_double(args["preset_sky_time"]);
-			//	else if(args["screen_h"]!="") stcore->ScreenH = str_to_double(args["screen_h"]);
-			//	else if(args["screen_w"]!="") stcore->ScreenW = str_to_double(args["screen_w"]);
-			//    else if(args["startup_time_mode"]!="") stapp->StartupTimeMode = args["startup_time_mode"];
-			// else if(args["time_display_format"]!="") stcore->TimeDisplayFormat = args["time_display_format"];
-			//else if(args["type"]!="") stcore->Type = args["type"];
-			//else if(args["version"]!="") stcore->Version = str_to_double(args["version"]);
-			//      else if(args["vertical_offset"]!="") stcore->VerticalOffset = str_to_double(args["vertical_offset"]);
-			//else if(args["viewing_mode"]!="") stcore->ViewingMode = args["viewing_mode"];
-			//else if(args["viewport"]!="") stcore->Viewport = args["viewport"];
+// application specific logic to run each command
 
-		}
+int AppCommandInterface::command_flag(const BoundCommand &cmd, CommandCall &call)
+{
+	if (cmd.key < 0) return 0;
 
-	} else if (command == "select") {
-
-		// default is to deselect current object
-		stcore->unSelect();
-
-
-		string select_type, identifier;
-
-		if (args["hp"]!="") {
-			select_type = "hp";
-			identifier = args["hp"];
-		} else if (args["star"]!="") {
-			select_type = "star";
-			identifier = args["star"];
-		} else if (args["planet"]!="") {
-			select_type = "planet";
-			identifier = args["planet"];
-
-			if (args["planet"] == "home_planet")
-				identifier = stcore->getNavigation()->getHomePlanet()->getEnglishName();
-		} else if (args["nebula"]!="") {
-			select_type = "nebula";
-			identifier = args["nebula"];
-		} else if (args["constellation"]!="") {
-			select_type = "constellation";
-			identifier = args["constellation"];
-		} else if (args["constellation_star"]!="") {
-			select_type = "constellation_star";
-			identifier = args["constellation_star"];
-		} else {
-			select_type = "";
+	const bool val = cmd.toggle ? !get_flag(cmd.key) : cmd.value != 0;
+	apply_flag(cmd.key, val, cmd.toggle);
+
+	// rewrite command for recording so that actual state is known (rather than "toggle")
+	if (cmd.toggle) {
+		std::ostringstream oss;
+		oss << cmd.command << " " << cmd.args.begin()->first << " " << val;
+		call.line = oss.str();
+	}
+
+	return 1;
+}
+
+int AppCommandInterface::command_wait(const BoundCommand &cmd, CommandCall &call)
+{
+	if ( cmd.arg("until")!="") {
+		float fseconds = str_time_to_seconds(cmd.arg("until"));
+		if (fseconds > 0) {
+			fseconds -= stapp->scripts->get_script_elapsed_seconds();
+			if(fseconds > 0 ) call.wait = (unsigned long int)(fseconds*1000);
+			else call.wait = 0;
 		}
+	} else if ( cmd.arg("duration")!="") {
+		float fdelay = str_to_double(cmd.arg("duration"));
+		if (fdelay > 0) call.wait = (int)(fdelay*1000);
+	}
 
-		if (select_type != "" ) stcore->selectObject(select_type, identifier);
+	// Allow timer to be reset
+	if ( cmd.arg("action")=="reset_timer") stapp->scripts->reset_timer();
 
-		// determine if selected object pointer should be displayed
-		if (args["pointer"]=="off" || args["pointer"]=="0") stcore->setFlagSelectedObjectPointer(false);
-		else stcore->setFlagSelectedObjectPointer(true);
+	// Hold the script until prefetched and loading images are ready
+	if ( cmd.arg("action")=="textures") stapp->scripts->wait_for_textures();
 
+	return 1;
+}
 
-	} else if (command == "deselect") {
-		if (args["constellation"] != "") {
-			stcore->unsetSelectedConstellation(args["constellation"]);
-		} else {
-			stcore->deselect();
-		}
-	} else if (command == "look") { // change direction of view
-		//	  double duration = str_to_pos_double(args["duration"]);
+int AppCommandInterface::command_set(const BoundCommand &cmd, CommandCall &call)
+{
+	// set core variables
+
+	// TODO: some bounds/error checking here
+
+	switch (cmd.key) {
+	case SET_ATMOSPHERE_FADE_DURATION:
+		stcore->setAtmosphereFadeDuration(cmd.value);
+		break;
+	case SET_AUTO_MOVE_DURATION:
+		stcore->setAutomoveDuration(cmd.value);
+		break;
+	case SET_CONSTELLATION_ART_FADE_DURATION:
+		stcore->setConstellationArtFadeDuration(cmd.value);
+		break;
+	case SET_CONSTELLATION_ART_INTENSITY:
+		stcore->setConstellationArtIntensity(cmd.value);
+		break;
+	case SET_LIGHT_POLLUTION_LIMITING_MAGNITUDE:
+		stcore->setLightPollutionLimitingMagnitude(cmd.value);
+		break;
+	case SET_FLIGHT_DURATION:
+		stcore->setFlightDuration(cmd.value);
+		break;
+	case SET_HEADING: {
+		float fdelay = str_to_double(cmd.arg("duration"));
+		if (fdelay <= 0) fdelay = 0;
+
+		stcore->getNavigation()->change_heading(cmd.value, (int)(fdelay*1000));
+		break;
+	}
+	case SET_HOME_PLANET: {
+		float duration = 0;
+		if( cmd.arg("duration") == "default" )
+			duration = stcore->getFlightDuration();
+		else
+			duration = str_to_double(cmd.arg("duration"), 0);
+		stcore->setHomePlanet(cmd.arg("home_planet"), duration);
+		break;
+	}
+	case SET_LANDSCAPE_NAME:
+		stcore->setLandscape(cmd.arg("landscape_name"));
+		break;
+	case SET_LINE_WIDTH:
+		stcore->setLineWidth(cmd.value);
+		break;
+	case SET_MAX_MAG_NEBULA_NAME:
+		stcore->setNebulaMaxMagHints(cmd.value);
+		break;
+	case SET_MAX_MAG_STAR_NAME:
+		stcore->setMaxMagStarName(cmd.value);
+		break;
+	case SET_MOON_SCALE:
+		stcore->setMoonScale(cmd.value);
+		break;
+	case SET_MILKY_WAY_TEXTURE:
+		if(cmd.arg("milky_way_texture")=="default") stcore->milkyswap(cmd.arg("milky_way_texture"));
+		else stcore->milkyswap(stapp->scripts->get_script_path() + cmd.arg("milky_way_texture"));
+		break;
+	case SET_SKY_CULTURE:
+		stcore->setSkyCultureDir(cmd.arg("sky_culture"));
+		break;
+	case SET_SKY_LOCALE:
+		stcore->setSkyLanguage(cmd.arg("sky_locale"));
+		break;
+	case SET_UI_LOCALE:
+		stapp->setAppLanguage(cmd.arg("ui_locale"));
+		break;
+	case SET_STAR_MAG_SCALE:
+		stcore->setStarMagScale(cmd.value);
+		break;
+	case SET_STAR_SIZE_LIMIT:
+		stcore->setStarSizeLimit(cmd.value);
+		break;
+	case SET_PLANET_SIZE_LIMIT:
+		stcore->setPlanetsSizeLimit(cmd.value);
+		break;
+	case SET_STAR_SCALE:
+		stcore->setStarScale(cmd.value);
+		stcore->setPlanetsScale(cmd.value);
+		break;
+	case SET_NEBULA_SCALE:
+		stcore->setNebulaCircleScale(cmd.value);
+		break;
+	case SET_STAR_TWINKLE_AMOUNT:
+		stcore->setStarTwinkleAmount(cmd.value);
+		break;
+	case SET_STAR_LIMITING_MAG:
+		stcore->setStarLimitingMag(cmd.value);
+		break;
+	case SET_TIME_ZONE:
+		stapp->setCustomTimezone(cmd.arg("time_zone"));
+		break;
+	case SET_MILKY_WAY_INTENSITY:
+		stcore->setMilkyWayIntensity(cmd.value);
+		// safety feature to be able to turn back on
+		if (stcore->getMilkyWayIntensity()) stcore->setFlagMilkyWay(true);
+		break;
+	case SET_ZOOM_OFFSET:
+		stcore->setViewOffset(cmd.value);
+		break;
+	default:
+		return 0;
+	}
 
-		if (args["delta_az"]!="" || args["delta_alt"]!="") {
-			// immediately change viewing direction
-			stcore->panView(str_to_double(args["delta_az"]),
-			                str_to_double(args["delta_alt"]));
-		}	else status = 0;
+	// trusted settings (base_font_size, fullscreen, screen_w...) were disabled due to code reorg
 
-		// TODO absolute settings (see RFE 1311031)
+	return 1;
+}
 
+int AppCommandInterface::command_select(const BoundCommand &cmd, CommandCall &call)
+{
+	// default is to deselect current object
+	stcore->unSelect();
+
+
+	string select_type, identifier;
+
+	if (cmd.arg("hp")!="") {
+		select_type = "hp";
+		identifier = cmd.arg("hp");
+	} else if (cmd.arg("star")!="") {
+		select_type = "star";
+		identifier = cmd.arg("star");
+	} else if (cmd.arg("planet")!="") {
+		select_type = "planet";
+		identifier = cmd.arg("planet");
+
+		if (cmd.arg("planet") == "home_planet")
+			identifier = stcore->getNavigation()->getHomePlanet()->getEnglishName();
+	} else if (cmd.arg("nebula")!="") {
+		select_type = "nebula";
+		identifier = cmd.arg("nebula");
+	} else if (cmd.arg("constellation")!="") {
+		select_type = "constellation";
+		identifier = cmd.arg("constellation");
+	} else if (cmd.arg("constellation_star")!="") {
+		select_type = "constellation_star";
+		identifier = cmd.arg("constellation_star");
+	} else {
+		select_type = "";
+	}
 
+	if (select_type != "" ) stcore->selectObject(select_type, identifier);
 
+	// determine if selected object pointer should be displayed
+	if (cmd.arg("pointer")=="off" || cmd.arg("pointer")=="0") stcore->setFlagSelectedObjectPointer(false);
+	else stcore->setFlagSelectedObjectPointer(true);
 
-	} else if (command == "zoom") {
-		double duration = str_to_pos_double(args["duration"]);
+	return 1;
+}
 
-		if (args["auto"]!="") {
-			// auto zoom using specified or default duration
-			if (args["duration"]=="") duration = stcore->getAutoMoveDuration();
+int AppCommandInterface::command_deselect(const BoundCommand &cmd, CommandCall &call)
+{
+	if (cmd.arg("constellation") != "") {
+		stcore->unsetSelectedConstellation(cmd.arg("constellation"));
+	} else {
+		stcore->deselect();
+	}
 
-			if (args["auto"]=="out") {
-				if (args["manual"]=="1") stcore->autoZoomOut(duration, 0, 1);
-				else stcore->autoZoomOut(duration, 0, 0);
-			} else if (args["auto"]=="initial") stcore->autoZoomOut(duration, 1, 0);
-			else if (args["manual"]=="1") {
-				stcore->autoZoomIn(duration, 1);  // have to explicity allow possible manual zoom
-			} else stcore->autoZoomIn(duration, 0);
+	return 1;
+}
 
-		} else if (args["fov"]!="") {
-			// zoom to specific field of view
-			stcore->zoomTo( str_to_double(args["fov"]), str_to_double(args["duration"]));
+// change direction of view
+int AppCommandInterface::command_look(const BoundCommand &cmd, CommandCall &call)
+{
+	int status = 1;
 
-		} else if (args["delta_fov"]!="") stcore->setFov(stcore->getFov() + str_to_double(args["delta_fov"]));
-		// should we record absolute fov instead of delta? isn't usually smooth playback
-		else status = 0;
+	//	  double duration = str_to_pos_double(cmd.arg("duration"));
 
-	} else if (command == "timerate") {  // NOTE: accuracy issue related to frame rate
+	if (cmd.arg("delta_az")!="" || cmd.arg("delta_alt")!="") {
+		// immediately change viewing direction
+		stcore->panView(str_to_double(cmd.arg("delta_az")),
+		                str_to_double(cmd.arg("delta_alt")));
+	}	else status = 0;
 
-		if (args["rate"]!="") {
-			stcore->setTimeSpeed(str_to_double(args["rate"])*JD_SECOND);
-			stapp->temp_time_velocity = stcore->getTimeSpeed();
-			stapp->FlagTimePause = 0;
-
-		} else if (args["action"]=="pause") {
-			// TODO why is this in stelapp?  should be in stelcore - Rob
-			stapp->FlagTimePause = !stapp->FlagTimePause;
-			if (stapp->FlagTimePause) {
-				// TODO pause should be all handled in core methods
-				stapp->temp_time_velocity = stcore->getTimeSpeed();
-				stcore->setTimeSpeed(0);
-			} else {
-				stcore->setTimeSpeed(stapp->temp_time_velocity);
-			}
+	// TODO absolute settings (see RFE 1311031)
+
+	return status;
+}
+
+int AppCommandInterface::command_zoom(const BoundCommand &cmd, CommandCall &call)
+{
+	int status = 1;
+
+	double duration = str_to_pos_double(cmd.arg("duration"));
+
+	if (cmd.arg("auto")!="") {
+		// auto zoom using specified or default duration
+		if (cmd.arg("duration")=="") duration = stcore->getAutoMoveDuration();
+
+		if (cmd.arg("auto")=="out") {
+			if (cmd.arg("manual")=="1") stcore->autoZoomOut(duration, 0, 1);
+			else stcore->autoZoomOut(duration, 0, 0);
+		} else if (cmd.arg("auto")=="initial") stcore->autoZoomOut(duration, 1, 0);
+		else if (cmd.arg("manual")=="1") {
+			stcore->autoZoomIn(duration, 1);  // have to explicity allow possible manual zoom
+		} else stcore->autoZoomIn(duration, 0);
 
-		} else if (args["action"]=="resume") {
-			stapp->FlagTimePause = 0;
+	} else if (cmd.arg("fov")!="") {
+		// zoom to specific field of view
+		stcore->zoomTo( str_to_double(cmd.arg("fov")), str_to_double(cmd.arg("duration")));
+
+	} else if (cmd.arg("delta_fov")!="") stcore->setFov(stcore->getFov() + str_to_double(cmd.arg("delta_fov")));
+	// should we record absolute fov instead of delta? isn't usually smooth playback
+	else status = 0;
+
+	return status;
+}
+
+// NOTE: accuracy issue related to frame rate
+int AppCommandInterface::command_timerate(const BoundCommand &cmd, CommandCall &call)
+{
+	int status = 1;
+
+	if (cmd.arg("rate")!="") {
+		stcore->setTimeSpeed(str_to_double(cmd.arg("rate"))*JD_SECOND);
+		stapp->temp_time_velocity = stcore->getTimeSpeed();
+		stapp->FlagTimePause = 0;
+
+	} else if (cmd.arg("action")=="pause") {
+		// TODO why is this in stelapp?  should be in stelcore - Rob
+		stapp->FlagTimePause = !stapp->FlagTimePause;
+		if (stapp->FlagTimePause) {
+			// TODO pause should be all handled in core methods
+			stapp->temp_time_velocity = stcore->getTimeSpeed();
+			stcore->setTimeSpeed(0);
+		} else {
 			stcore->setTimeSpeed(stapp->temp_time_velocity);
+		}
 
-		} else if (args["action"]=="increment") {
-			// speed up time rate
-			stapp->FlagTimePause = 0;
-			double s = stcore->getTimeSpeed();
-			double sstep = 10.;
+	} else if (cmd.arg("action")=="resume") {
+		stapp->FlagTimePause = 0;
+		stcore->setTimeSpeed(stapp->temp_time_velocity);
+
+	} else if (cmd.arg("action")=="increment") {
+		// speed up time rate
+		stapp->FlagTimePause = 0;
+		double s = stcore->getTimeSpeed();
+		double sstep = 10.;
+
+		if( !cmd.arg("step").empty() )
+			sstep = str_to_double(cmd.arg("step"));
+
+		if (s>=JD_SECOND) s*=sstep;
+		else if (s<-JD_SECOND) s/=sstep;
+		else if (s>=0. && s<JD_SECOND) s=JD_SECOND;
+		else if (s>=-JD_SECOND && s<0.) s=0.;
+		stcore->setTimeSpeed(s);
+		stapp->temp_time_velocity = stcore->getTimeSpeed();
+		// for safest script replay, record as absolute amount
+		call.line = "timerate rate " + double_to_str(s/JD_SECOND);
+
+	} else if (cmd.arg("action")=="decrement") {
+		stapp->FlagTimePause = 0;
+		double s = stcore->getTimeSpeed();
+		double sstep = 10.;
+
+		if( !cmd.arg("step").empty() )
+			sstep = str_to_double(cmd.arg("step"));
+
+		if (s>JD_SECOND) s/=sstep;
+		else if (s<=-JD_SECOND) s*=sstep;
+		else if (s>-JD_SECOND && s<=0.) s=-JD_SECOND;
+		else if (s>0. && s<=JD_SECOND) s=0.;
+		stcore->setTimeSpeed(s);
+		stapp->temp_time_velocity = stcore->getTimeSpeed();
+		// for safest script replay, record as absolute amount
+		call.line = "timerate rate " + double_to_str(s/JD_SECOND);
+	} else status=0;
+
+	return status;
+}
 
-			if( !args["step"].empty() )
-				sstep = str_to_double(args["step"]);
+// script rate multiplier
+int AppCommandInterface::command_multiplier(const BoundCommand &cmd, CommandCall &call)
+{
+	int status = 1;
 
-			if (s>=JD_SECOND) s*=sstep;
-			else if (s<-JD_SECOND) s/=sstep;
-			else if (s>=0. && s<JD_SECOND) s=JD_SECOND;
-			else if (s>=-JD_SECOND && s<0.) s=0.;
-			stcore->setTimeSpeed(s);
+	if (cmd.arg("rate")!="") {
+		stapp->setTimeMultiplier(str_to_double(cmd.arg("rate")));
+		if (!stapp->FlagTimePause)
 			stapp->temp_time_velocity = stcore->getTimeSpeed();
-			// for safest script replay, record as absolute amount
-			commandline = "timerate rate " + double_to_str(s/JD_SECOND);
-
-		} else if (args["action"]=="decrement") {
-			stapp->FlagTimePause = 0;
-			double s = stcore->getTimeSpeed();
-			double sstep = 10.;
-
-			if( !args["step"].empty() )
-				sstep = str_to_double(args["step"]);
-
-			if (s>JD_SECOND) s/=sstep;
-			else if (s<=-JD_SECOND) s*=sstep;
-			else if (s>-JD_SECOND && s<=0.) s=-JD_SECOND;
-			else if (s>0. && s<=JD_SECOND) s=0.;
-			stcore->setTimeSpeed(s);
+
+	} else if (cmd.arg("action")=="increment") {
+		// speed up script rate
+		double s = stapp->getTimeMultiplier();
+		double sstep = 10.0;
+
+		if( !cmd.arg("step").empty() )
+			sstep = str_to_double(cmd.arg("step"));
+
+		stapp->setTimeMultiplier(s*sstep);
+		if (!stapp->FlagTimePause)
 			stapp->temp_time_velocity = stcore->getTimeSpeed();
-			// for safest script replay, record as absolute amount
-			commandline = "timerate rate " + double_to_str(s/JD_SECOND);
-		} else status=0;
-
-	} else if (command == "multiplier") {  // script rate multiplier
-		if (args["rate"]!="") {
-			stapp->setTimeMultiplier(str_to_double(args["rate"]));
-			if (!stapp->FlagTimePause)
-				stapp->temp_time_velocity = stcore->getTimeSpeed();
-
-		} else if (args["action"]=="increment") {
-			// speed up script rate
-			double s = stapp->getTimeMultiplier();
-			double sstep = 10.0;
-
-			if( !args["step"].empty() )
-				sstep = str_to_double(args["step"]);
-
-			stapp->setTimeMultiplier(s*sstep);
-			if (!stapp->FlagTimePause)
-				stapp->temp_time_velocity = stcore->getTimeSpeed();
-
-			// for safest script replay, record as absolute amount
-			commandline = "multiplier rate " + double_to_str(s*sstep);
-
-		} else if (args["action"]=="decrement") {
-			// slow rate
-			double s = stapp->getTimeMultiplier();
-			double sstep = 10.0;
-
-			if( !args["step"].empty() )
-				sstep = str_to_double(args["step"]);
-
-			if (!stapp->FlagTimePause)
-				stapp->temp_time_velocity = stcore->getTimeSpeed();
-			stapp->setTimeMultiplier(s/sstep);
-
-			// for safest script replay, record as absolute amount
-			commandline = "multiplier rate " + double_to_str(s/sstep);
-		} else status=0;
-
-	} else if (command == "date") {
-		if (args["jday"] != "") {
-			stcore->setJDay( str_to_double(args["jday"]) );
+
+		// for safest script replay, record as absolute amount
+		call.line = "multiplier rate " + double_to_str(s*sstep);
+
+	} else if (cmd.arg("action")=="decrement") {
+		// slow rate
+		double s = stapp->getTimeMultiplier();
+		double sstep = 10.0;
+
+		if( !cmd.arg("step").empty() )
+			sstep = str_to_double(cmd.arg("step"));
+
+		if (!stapp->FlagTimePause)
+			stapp->temp_time_velocity = stcore->getTimeSpeed();
+		stapp->setTimeMultiplier(s/sstep);
+
+		// for safest script replay, record as absolute amount
+		call.line = "multiplier rate " + double_to_str(s/sstep);
+	} else status=0;
+
+	return status;
+}
+
+int AppCommandInterface::command_date(const BoundCommand &cmd, CommandCall &call)
+{
+	int status = 1;
+
+	if (cmd.arg("jday") != "") {
+		stcore->setJDay( str_to_double(cmd.arg("jday")) );
+	}
+	else if (cmd.arg("local")!="") {
+		// ISO 8601-like format [[+/-]YYYY-MM-DD]Thh:mm:ss (no timzone offset, T is literal)
+		double jd;
+		string new_date;
+
+		if (cmd.arg("local")[0] == 'T') {
+			// set time only (don't change day)
+			string sky_date = stapp->get_ISO8601_time_local(stcore->getJDay());
+			new_date = sky_date.substr(0,10) + cmd.arg("local");
+		} else new_date = cmd.arg("local");
+
+		if (NShadeDateTime::StringToJday( new_date, jd )) {
+			stcore->setJDay(jd - (stapp->get_GMT_shift(jd) * JD_HOUR));
+		} else {
+			debug_message = _("Error parsing date.");
+			status = 0;
 		}
-		else if (args["local"]!="") {
-			// ISO 8601-like format [[+/-]YYYY-MM-DD]Thh:mm:ss (no timzone offset, T is literal)
-			double jd;
-			string new_date;
-
-			if (args["local"][0] == 'T') {
-				// set time only (don't change day)
-				string sky_date = stapp->get_ISO8601_time_local(stcore->getJDay());
-				new_date = sky_date.substr(0,10) + args["local"];
-			} else new_date = args["local"];
-
-			if (NShadeDateTime::StringToJday( new_date, jd )) {
-				stcore->setJDay(jd - (stapp->get_GMT_shift(jd) * JD_HOUR));
-			} else {
-				debug_message = _("Error parsing date.");
-				status = 0;
-			}
 
-		} else if (args["utc"]!="") {
-			double jd;
-			if (NShadeDateTime::StringToJday( args["utc"], jd ) ) {
-				stcore->setJDay(jd);
-			} else {
-				debug_message = _("Error parsing date.");
-				status = 0;
-			}
+	} else if (cmd.arg("utc")!="") {
+		double jd;
+		if (NShadeDateTime::StringToJday( cmd.arg("utc"), jd ) ) {
+			stcore->setJDay(jd);
+		} else {
+			debug_message = _("Error parsing date.");
+			status = 0;
+		}
 
-		} else if (args["relative"]!="") { // value is a float number of days
-			double days = str_to_double(args["relative"]);
-			stcore->setJDay(stcore->getJDay() + days );
+	} else if (cmd.arg("relative")!="") { // value is a float number of days
+		double days = str_to_double(cmd.arg("relative"));
+		stcore->setJDay(stcore->getJDay() + days );
 
-		} else if (args["sidereal"]!="") { // value is a float number of sidereal days
-			double days = str_to_double(args["sidereal"]);
+	} else if (cmd.arg("sidereal")!="") { // value is a float number of sidereal days
+		double days = str_to_double(cmd.arg("sidereal"));
 
-			const Planet* home = stcore->getObservatory()->getHomePlanet();
-			if (home->getEnglishName() != "Solar System Observer")
-				days *= home->getSiderealDay();
-			stcore->getNavigation()->set_JDay(stcore->getNavigation()->get_JDay() + days );
+		const Planet* home = stcore->getObservatory()->getHomePlanet();
+		if (home->getEnglishName() != "Solar System Observer")
+			days *= home->getSiderealDay();
+		stcore->getNavigation()->set_JDay(stcore->getNavigation()->get_JDay() + days );
 
-		} else if (args["load"]=="current") {
-			// set date to current date
-			stcore->setJDay(NShadeDateTime::JulianFromSys());
-		} else if (args["load"]=="preset") {
-			// set date to preset (or current) date, based on user setup
-			// TODO: should this record as the actual date used?
-			if (stapp->StartupTimeMode=="preset" || stapp->StartupTimeMode=="Preset")
-				stcore->setJDay(stapp->PresetSkyTime -
-				                stapp->get_GMT_shift(stapp->PresetSkyTime) * JD_HOUR);
-			else stcore->setJDay(NShadeDateTime::JulianFromSys());
+	} else if (cmd.arg("load")=="current") {
+		// set date to current date
+		stcore->setJDay(NShadeDateTime::JulianFromSys());
+	} else if (cmd.arg("load")=="preset") {
+		// set date to preset (or current) date, based on user setup
+		// TODO: should this record as the actual date used?
+		if (stapp->StartupTimeMode=="preset" || stapp->StartupTimeMode=="Preset")
+			stcore->setJDay(stapp->PresetSkyTime -
+			                stapp->get_GMT_shift(stapp->PresetSkyTime) * JD_HOUR);
+		else stcore->setJDay(NShadeDateTime::JulianFromSys());
 
-		} else status=0;
+	} else status=0;
 
-	} else if (command == "body") {  // add to svn when reimplement scripting
+	return status;
+}
 
-		if (args["action"] == "load" ) {
-			// Load a new solar system object
+// add to svn when reimplement scripting
+int AppCommandInterface::command_body(const BoundCommand &cmd, CommandCall &call)
+{
+	int status = 1;
 
-			// textures relative to script
-			args["path"] = stapp->scripts->get_script_path();
+	if (cmd.arg("action") == "load" ) {
+		// Load a new solar system object
+		stringHash_t args = cmd.args;
 
-			string error_string = stcore->addSolarSystemBody(args);
-			if (error_string != "" ) {
-				debug_message = error_string;
-				status = 0;
-			}
+		// textures relative to script
+		args["path"] = stapp->scripts->get_script_path();
 
-		} else if (args["action"] == "drop" && args["name"] != "") {
+		string error_string = stcore->addSolarSystemBody(args);
+		if (error_string != "" ) {
+			debug_message = error_string;
+			status = 0;
+		}
 
-			//	    if(args["parent"] == "" ) args["parent"] = "none";
+	} else if (cmd.arg("action") == "drop" && cmd.arg("name") != "") {
 
-			// Delete an existing object, but only if was added by a script!
-			string error_string = stcore->removeSolarSystemBody( args["name"] );
-			if (error_string != "" ) {
-				debug_message = error_string;
-				status = 0;
-			}
+		//	    if(args["parent"] == "" ) args["parent"] = "none";
 
-		} else if (args["action"] == "clear") {
+		// Delete an existing object, but only if was added by a script!
+		string error_string = stcore->removeSolarSystemBody( cmd.arg("name") );
+		if (error_string != "" ) {
+			debug_message = error_string;
+			status = 0;
+		}
 
-			// drop all bodies that are not in the original config file
-			string error_string = stcore->removeSupplementalSolarSystemBodies();
-			if (error_string != "" ) {
-				debug_message = error_string;
-				status = 0;
-			}
+	} else if (cmd.arg("action") == "clear") {
 
-		} else {
+		// drop all bodies that are not in the original config file
+		string error_string = stcore->removeSupplementalSolarSystemBodies();
+		if (error_string != "" ) {
+			debug_message = error_string;
 			status = 0;
 		}
 
-	} else if (command == "moveto") {
+	} else {
+		status = 0;
+	}
 
-		if(args["lat"]=="") args["lat"] = args["latitude"];
-		if(args["lon"]=="") args["lon"] = args["longitude"];
-		if(args["alt"]=="") args["alt"] = args["altitude"];
+	return status;
+}
 
-		if (args["lat"]!="" || args["lon"]!="" || args["alt"]!="" || args["heading"]!="") {
+int AppCommandInterface::command_moveto(const BoundCommand &cmd, CommandCall &call)
+{
+	int status = 1;
 
-			Observer *observatory = stcore->getObservatory();
+	const string &lat_arg = cmd.arg("lat").empty() ? cmd.arg("latitude") : cmd.arg("lat");
+	const string &lon_arg = cmd.arg("lon").empty() ? cmd.arg("longitude") : cmd.arg("lon");
+	const string &alt_arg = cmd.arg("alt").empty() ? cmd.arg("altitude") : cmd.arg("alt");
 
-			double lat = observatory->get_latitude();
-			double lon = observatory->get_realLongitude();
-			double alt = observatory->get_altitude();
-			double heading = stcore->getHeading();
-			string name;
-			int delay;
+	if (lat_arg!="" || lon_arg!="" || alt_arg!="" || cmd.arg("heading")!="") {
 
-			if (args["name"]!="") name = args["name"];
-			if (args["lat"]!="") {
-				if (args["lat"]=="default") lat = observatory->getDefaultLatitude();
-				else lat = str_to_double(args["lat"]);
-			}
-			if (args["lon"]!="") {
-				if (args["lon"]=="default") lon = observatory->getDefaultLongitude();
-				else lon = str_to_double(args["lon"]);
-			}
-			if (args["alt"]!="") {
-				if (args["alt"]=="default") alt = observatory->getDefaultAltitude();
-				else alt = str_to_double(args["alt"]);
-			}
-			if (args["heading"]!="") {
-				if (args["heading"]=="default") heading = stcore->getNavigation()->get_defaultHeading();
-				else heading = str_to_double(args["heading"]);
-			}
+		Observer *observatory = stcore->getObservatory();
 
-			delay = (int)(1000.*str_to_double(args["duration"]));
+		double lat = observatory->get_latitude();
+		double lon = observatory->get_realLongitude();
+		double alt = observatory->get_altitude();
+		double heading = stcore->getHeading();
+		string name;
+		int delay;
 
-			stcore->moveObserver(lat,lon,alt,delay,name);
-			stcore->getNavigation()->change_heading(heading, delay);
-		} else status = 0;
+		if (cmd.arg("name")!="") name = cmd.arg("name");
+		if (lat_arg!="") {
+			if (lat_arg=="default") lat = observatory->getDefaultLatitude();
+			else lat = str_to_double(lat_arg);
+		}
+		if (lon_arg!="") {
+			if (lon_arg=="default") lon = observatory->getDefaultLongitude();
+			else lon = str_to_double(lon_arg);
+		}
+		if (alt_arg!="") {
+			if (alt_arg=="default") alt = observatory->getDefaultAltitude();
+			else alt = str_to_double(alt_arg);
+		}
+		if (cmd.arg("heading")!="") {
+			if (cmd.arg("heading")=="default") heading = stcore->getNavigation()->get_defaultHeading();
+			else heading = str_to_double(cmd.arg("heading"));
+		}
 
-	} else if (command=="image") {
+		delay = (int)(1000.*str_to_double(cmd.arg("duration")));
 
-		ImageMgr& script_images = ImageMgr::getImageMgr("script");
+		stcore->moveObserver(lat,lon,alt,delay,name);
+		stcore->getNavigation()->change_heading(heading, delay);
+	} else status = 0;
 
-		//cout << "Check " << args["name"] << " " << args["alpha"] << endl;
+	return status;
+}
 
-		if (args["name"]=="") {
-			debug_message = _("Image name required.");
-			status = 0;
-		} else if (args["action"]=="drop") {
-			script_images.drop_image(args["name"]);
-		} else {
-			if (args["action"]=="load" && args["filename"]!="") {
+int AppCommandInterface::command_image(const BoundCommand &cmd, CommandCall &call)
+{
+	int status = 1;
 
-				Image::IMAGE_POSITIONING img_pos = Image::POS_VIEWPORT;
-				if (args["coordinate_system"] == "horizontal") img_pos = Image::POS_HORIZONTAL;
-				else if (args["coordinate_system"] == "equatorial") img_pos = Image::POS_EQUATORIAL;
-				else if (args["coordinate_system"] == "j2000") img_pos = Image::POS_J2000;
-				else if (args["coordinate_system"] == "dome") img_pos = Image::POS_DOME;
+	ImageMgr& script_images = ImageMgr::getImageMgr("script");
 
-				string image_filename;
-				if (!trusted)
-					image_filename = stapp->scripts->get_script_path() + args["filename"];
-				else
-					image_filename = stcore->getDataRoot() + "/" + args["filename"];
+	//cout << "Check " << cmd.arg("name") << " " << cmd.arg("alpha") << endl;
 
-				bool mipmap = 0; // Default off for historical reasons
-				if (args["mipmap"] == "on" || args["mipmap"] == "1") mipmap = 1;
+	if (cmd.arg("action")=="prefetch") {
+		// decode in the background so that a later load is immediate
+		if (cmd.arg("filename")!="") {
+			string image_filename;
+			if (!call.trusted)
+				image_filename = stapp->scripts->get_script_path() + cmd.arg("filename");
+			else
+				image_filename = stcore->getDataRoot() + "/" + cmd.arg("filename");
+			TextureLoader::Instance()->prefetch(image_filename, PNG_ALPHA);
+		} else status = 0;
+	} else if (cmd.arg("name")=="") {
+		debug_message = _("Image name required.");
+		status = 0;
+	} else if (cmd.arg("action")=="drop") {
+		script_images.drop_image(cmd.arg("name"));
+	} else {
+		if (cmd.arg("action")=="load" && cmd.arg("filename")!="") {
 
-				status = script_images.load_image(image_filename, args["name"], img_pos, mipmap);
+			Image::IMAGE_POSITIONING img_pos = Image::POS_VIEWPORT;
+			if (cmd.arg("coordinate_system") == "horizontal") img_pos = Image::POS_HORIZONTAL;
+			else if (cmd.arg("coordinate_system") == "equatorial") img_pos = Image::POS_EQUATORIAL;
+			else if (cmd.arg("coordinate_system") == "j2000") img_pos = Image::POS_J2000;
+			else if (cmd.arg("coordinate_system") == "dome") img_pos = Image::POS_DOME;
 
-				if (status==0) debug_message = _("Unable to open file: ") + image_filename;
-			}
+			string image_filename;
+			if (!call.trusted)
+				image_filename = stapp->scripts->get_script_path() + cmd.arg("filename");
+			else
+				image_filename = stcore->getDataRoot() + "/" + cmd.arg("filename");
 
-			if ( status ) {
-				Image * img = script_images.get_image(args["name"]);
-
-				if (img != NULL) {
-					if (args["alpha"]!="") img->set_alpha(str_to_double(args["alpha"]),
-						                                      str_to_double(args["duration"]));
-					if (args["scale"]!="") img->set_scale(str_to_double(args["scale"]),
-						                                      str_to_double(args["duration"]));
-					if (args["rotation"]!="") img->set_rotation(str_to_double(args["rotation"]),
-						        str_to_double(args["duration"]));
-					if (args["xpos"]!="" || args["ypos"]!="")
-						img->set_location(str_to_double(args["xpos"]), args["xpos"]!="",
-						                  str_to_double(args["ypos"]), args["ypos"]!="",
-						                  str_to_double(args["duration"]));
-					// for more human readable scripts, as long as someone doesn't do both...
-					if (args["altitude"]!="" || args["azimuth"]!="")
-						img->set_location(str_to_double(args["altitude"]), args["altitude"]!="",
-						                  str_to_double(args["azimuth"]), args["azimuth"]!="",
-						                  str_to_double(args["duration"]));
-				} else {
-					debug_message = _("Unable to find image: ") + args["name"];
-					status=0;
-				}
+			bool mipmap = 0; // Default off for historical reasons
+			if (cmd.arg("mipmap") == "on" || cmd.arg("mipmap") == "1") mipmap = 1;
+
+			status = script_images.load_image(image_filename, cmd.arg("name"), img_pos, mipmap);
+
+			if (status==0) debug_message = _("Unable to open file: ") + image_filename;
+		}
+
+		if ( status ) {
+			Image * img = script_images.get_image(cmd.arg("name"));
+
+			if (img != NULL) {
+				if (cmd.arg("alpha")!="") img->set_alpha(str_to_double(cmd.arg("alpha")),
+					                                      str_to_double(cmd.arg("duration")));
+				if (cmd.arg("scale")!="") img->set_scale(str_to_double(cmd.arg("scale")),
+					                                      str_to_double(cmd.arg("duration")));
+				if (cmd.arg("rotation")!="") img->set_rotation(str_to_double(cmd.arg("rotation")),
+					        str_to_double(cmd.arg("duration")));
+				if (cmd.arg("xpos")!="" || cmd.arg("ypos")!="")
+					img->set_location(str_to_double(cmd.arg("xpos")), cmd.arg("xpos")!="",
+					                  str_to_double(cmd.arg("ypos")), cmd.arg("ypos")!="",
+					                  str_to_double(cmd.arg("duration")));
+				// for more human readable scripts, as long as someone doesn't do both...
+				if (cmd.arg("altitude")!="" || cmd.arg("azimuth")!="")
+					img->set_location(str_to_double(cmd.arg("altitude")), cmd.arg("altitude")!="",
+					                  str_to_double(cmd.arg("azimuth")), cmd.arg("azimuth")!="",
+					                  str_to_double(cmd.arg("duration")));
+			} else {
+				debug_message = _("Unable to find image: ") + cmd.arg("name");
+				status=0;
 			}
 		}
-	} else if (command=="audio") {
+	}
+
+	return status;
+}
+
+int AppCommandInterface::command_audio(const BoundCommand &cmd, CommandCall &call)
+{
+	int status = 1;
 
 #ifndef HAVE_SDL_MIXER_H
-		debug_message = _("This executable was compiled without audio support.");
-		status = 0;
+	debug_message = _("This executable was compiled without audio support.");
+	status = 0;
 #else
 
-		if (args["action"]=="drop") {
-			bool fromscript = true;
-			if(args["from_script"] == "false")
-				fromscript = false;
+	if (cmd.arg("action")=="drop") {
+		bool fromscript = true;
+		if(cmd.arg("from_script") == "false")
+			fromscript = false;
 
-			if (audio && audio->drop(fromscript) ) {
-				audio = NULL;
-			}
+		if (audio && audio->drop(fromscript) ) {
+			audio = NULL;
+		}
 
-		} else if (args["action"]=="sync") {
-			if (audio) audio->sync();
+	} else if (cmd.arg("action")=="sync") {
+		if (audio) audio->sync();
 
-		} else if (args["action"]=="pause") {
-			if (audio) audio->pause();
+	} else if (cmd.arg("action")=="pause") {
+		if (audio) audio->pause();
 
-		} else if ( args["action"]=="play" && args["filename"]!="") {
-			// only one track at a time allowed.
-			if (audio) delete audio;
+	} else if ( cmd.arg("action")=="play" && cmd.arg("filename")!="") {
+		// only one track at a time allowed.
+		if (audio) delete audio;
 
-			// if from script, local to that path
-			string path;
-			if (!trusted) path = stapp->scripts->get_script_path();
-			else path = "";
+		// if from script, local to that path
+		string path;
+		if (!call.trusted) path = stapp->scripts->get_script_path();
+		else path = "";
 
-			bool fromscript = true;
-			if(args["from_script"] == "false")
-				fromscript = false;
+		bool fromscript = true;
+		if(cmd.arg("from_script") == "false")
+			fromscript = false;
 
-			audio = new Audio(path + args["filename"], "default track", str_to_long(args["output_rate"]), fromscript);
-			audio->play(args["loop"]=="on");
+		audio = new Audio(path + cmd.arg("filename"), "default track", str_to_long(cmd.arg("output_rate")), fromscript);
+		audio->play(cmd.arg("loop")=="on");
 
-			if (audioDisabled) audio->disable();
-			else audio->enable();
+		if (audioDisabled) audio->disable();
+		else audio->enable();
 
-			// if fast forwarding mute (pause) audio
-	//		if(stapp->getTimeMultiplier()!=1) audio->pause();
+		// if fast forwarding mute (pause) audio
+//		if(stapp->getTimeMultiplier()!=1) audio->pause();
 
-		} else if ( args["action"]=="play" || args["action"]=="resume") {
+	} else if ( cmd.arg("action")=="play" || cmd.arg("action")=="resume") {
 // resume paused track
-			if (audio) audio->resume();
+		if (audio) audio->resume();
 
-		} else if (args["volume"]!="") {
+	} else if (cmd.arg("volume")!="") {
 
-			recordable = 0;
-			if (args["volume"] == "increment") {
-				AudioPlayer::Instance().increment_volume();
-			} else if (args["volume"] == "decrement") {
-				AudioPlayer::Instance().decrement_volume();
-			} else AudioPlayer::Instance().set_volume( str_to_double(args["volume"]) );
+		call.recordable = false;
+		if (cmd.arg("volume") == "increment") {
+			AudioPlayer::Instance().increment_volume();
+		} else if (cmd.arg("volume") == "decrement") {
+			AudioPlayer::Instance().decrement_volume();
+		} else AudioPlayer::Instance().set_volume( str_to_double(cmd.arg("volume")) );
 
-		} else status = 0;
+	} else status = 0;
 #endif
-	} else if (command == "script") {
 
-		ImageMgr& script_images = ImageMgr::getImageMgr("script");
+	return status;
+}
+
+int AppCommandInterface::command_script(const BoundCommand &cmd, CommandCall &call)
+{
+	int status = 1;
+
+	ImageMgr& script_images = ImageMgr::getImageMgr("script");
+
+	if (cmd.arg("action")=="end") {
+		// stop script, audio, and unload any loaded images
+		if (audio && audio->from_script()) {
+			delete audio;
+			audio = NULL;
+		}
+		if (ExtViewer) {
+			delete ExtViewer;
+			ExtViewer = NULL;
+			// throttle up application
+			stapp->set_minfps(10000);
+		}
+		stapp->scripts->cancel_script();
+		script_images.drop_all_images();
+		enableAudio(); // make sure will work next time
+
+	} else if (cmd.arg("action")=="play" && cmd.arg("filename")!="") {
+		string script_path = stapp->scripts->get_script_path();
+		
+		if (stapp->scripts->is_playing()) {
 
-		if (args["action"]=="end") {
 			// stop script, audio, and unload any loaded images
-			if (audio && audio->from_script()) {
+			if (audio) {
 				delete audio;
 				audio = NULL;
 			}
@@ -681,698 +986,690 @@ int AppCommandInterface::execute_command(string commandline, unsigned long int &
 			}
 			stapp->scripts->cancel_script();
 			script_images.drop_all_images();
-			enableAudio(); // make sure will work next time
-
-		} else if (args["action"]=="play" && args["filename"]!="") {
-			string script_path = stapp->scripts->get_script_path();
-			
-			if (stapp->scripts->is_playing()) {
 
-				// stop script, audio, and unload any loaded images
-				if (audio) {
-					delete audio;
-					audio = NULL;
-				}
-				if (ExtViewer) {
-					delete ExtViewer;
-					ExtViewer = NULL;
-					// throttle up application
-					stapp->set_minfps(10000);
-				}
-				stapp->scripts->cancel_script();
-				script_images.drop_all_images();
+			// keep same script path
+			if( !stapp->scripts->play_script(script_path + cmd.arg("filename"), script_path) ) {
+				debug_message = string(_("Unable to execute script")) + ": " + script_path + cmd.arg("filename");
+				status = 0;
+			}
 
-				// keep same script path
-				if( !stapp->scripts->play_script(script_path + args["filename"], script_path) ) {
-					debug_message = string(_("Unable to execute script")) + ": " + script_path + args["filename"];
+		} else {
+			// Absolute path is only allowed if trusted caller (application, not script or nscontrol)
+			if(cmd.arg("path")=="" || !call.trusted) {
+				// Default to local script directory or force relative path
+				script_path += cmd.arg("path");
+				if( !stapp->scripts->play_script(script_path + cmd.arg("filename"), script_path) ) {
+					debug_message = string(_("Unable to execute script")) + ": " + script_path + cmd.arg("filename");
 					status = 0;
 				}
-
 			} else {
-				// Absolute path is only allowed if trusted caller (application, not script or nscontrol)
-				if(args["path"]=="" || !trusted) {
-					// Default to local script directory or force relative path
-					script_path += args["path"];
-					if( !stapp->scripts->play_script(script_path + args["filename"], script_path) ) {
-						debug_message = string(_("Unable to execute script")) + ": " + script_path + args["filename"];
-						status = 0;
-					}
-				} else {
-					if( !stapp->scripts->play_script(args["path"] + args["filename"], args["path"]) ) {
-						debug_message = string(_("Unable to execute script")) + ": " + script_path + args["filename"];
-						status = 0;
-					}
+				if( !stapp->scripts->play_script(cmd.arg("path") + cmd.arg("filename"), cmd.arg("path")) ) {
+					debug_message = string(_("Unable to execute script")) + ": " + script_path + cmd.arg("filename");
+					status = 0;
 				}
 			}
-
-		} else if (args["action"]=="record") {
-			stapp->scripts->record_script(args["filename"]);
-			recordable = 0;  // don't record this command!
-		} else if (args["action"]=="cancelrecord") {
-			stapp->scripts->cancel_record_script();
-			recordable = 0;  // don't record this command!
-		} else if (args["action"]=="pause" && !stapp->scripts->is_paused()) {
-			// n.b. action=pause TOGGLES pause
-			disableAudio();
-
-			if (ExtViewer)
-				ExtViewer->pause();
-
-			stapp->scripts->pause_script();
-		} else if (args["action"]=="pause" || args["action"]=="resume") {
-			stapp->scripts->resume_script();
-
-			if( !stapp->scripts->is_faster() )
-				enableAudio();
-
-			if (ExtViewer) ExtViewer->resume();
-		} else if (args["action"]=="faster") {
-			disableAudio();
-			stapp->scripts->faster_script();
-		} else if (args["action"]=="slower") {
-			stapp->scripts->slower_script();
-
-			if (!stapp->scripts->is_faster())
-				enableAudio();
-		} else status =0;
-
-	} else if (command=="sky_culture") {
-
-		// NEW 201005
-		if (args["path"]!="" && args["action"]=="load") {
-			string path;
-			if(trusted) path = args["path"];
-			else path = stapp->scripts->get_script_path() + args["path"];
-
-			status = stcore->loadSkyCulture(path);
-			debug_message = "Error loading sky culture from path specified.";
 		}
 
-	} else if (command=="nebula") {
+	} else if (cmd.arg("action")=="record") {
+		stapp->scripts->record_script(cmd.arg("filename"));
+		call.recordable = false;  // don't record this command!
+	} else if (cmd.arg("action")=="cancelrecord") {
+		stapp->scripts->cancel_record_script();
+		call.recordable = false;  // don't record this command!
+	} else if (cmd.arg("action")=="pause" && !stapp->scripts->is_paused()) {
+		// n.b. action=pause TOGGLES pause
+		disableAudio();
+
+		if (ExtViewer)
+			ExtViewer->pause();
 
-		// NEW 201005
-		if (args["action"]=="load") {
+		stapp->scripts->pause_script();
+	} else if (cmd.arg("action")=="pause" || cmd.arg("action")=="resume") {
+		stapp->scripts->resume_script();
 
-			string path = stapp->scripts->get_script_path() + args["path"];
-			if (args["path"]!="" && trusted) path = args["path"];
+		if( !stapp->scripts->is_faster() )
+			enableAudio();
 
-			status = stcore->loadNebula(str_to_double(args["ra"]), str_to_double(args["de"]), str_to_double(args["magnitude"]),
-										str_to_double(args["angular_size"]), str_to_double(args["rotation"]), args["name"],
-										path + args["filename"], args["credit"], str_to_double(args["texture_luminance_adjust"], 1),
-										str_to_double(args["distance"], -1));
+		if (ExtViewer) ExtViewer->resume();
+	} else if (cmd.arg("action")=="faster") {
+		disableAudio();
+		stapp->scripts->faster_script();
+	} else if (cmd.arg("action")=="slower") {
+		stapp->scripts->slower_script();
 
-			debug_message = "Error loading nebula.";
+		if (!stapp->scripts->is_faster())
+			enableAudio();
+	} else status =0;
 
-		} else if (args["action"] == "drop" && args["name"] != "") {
+	return status;
+}
 
-			// Delete an existing nebulae, but only if was added by a script!
-			string error_string = stcore->removeNebula( args["name"] );
-			if (error_string != "" ) {
-				debug_message = error_string;
-				status = 0;
-			}
+int AppCommandInterface::command_sky_culture(const BoundCommand &cmd, CommandCall &call)
+{
+	int status = 1;
 
-		} else if (args["action"] == "clear") {
+	// NEW 201005
+	if (cmd.arg("path")!="" && cmd.arg("action")=="load") {
+		string path;
+		if(call.trusted) path = cmd.arg("path");
+		else path = stapp->scripts->get_script_path() + cmd.arg("path");
 
-			// drop all nebulae that are not in the original config file
-			string error_string = stcore->removeSupplementalNebulae();
-			if (error_string != "" ) {
-				debug_message = error_string;
-				status = 0;
-			}
+		status = stcore->loadSkyCulture(path);
+		debug_message = "Error loading sky culture from path specified.";
+	}
 
-		} else {
+	return status;
+}
+
+int AppCommandInterface::command_nebula(const BoundCommand &cmd, CommandCall &call)
+{
+	int status = 1;
+
+	// NEW 201005
+	if (cmd.arg("action")=="load") {
+
+		string path = stapp->scripts->get_script_path() + cmd.arg("path");
+		if (cmd.arg("path")!="" && call.trusted) path = cmd.arg("path");
+
+		status = stcore->loadNebula(str_to_double(cmd.arg("ra")), str_to_double(cmd.arg("de")), str_to_double(cmd.arg("magnitude")),
+									str_to_double(cmd.arg("angular_size")), str_to_double(cmd.arg("rotation")), cmd.arg("name"),
+									path + cmd.arg("filename"), cmd.arg("credit"), str_to_double(cmd.arg("texture_luminance_adjust"), 1),
+									str_to_double(cmd.arg("distance"), -1));
+
+		debug_message = "Error loading nebula.";
+
+	} else if (cmd.arg("action") == "drop" && cmd.arg("name") != "") {
+
+		// Delete an existing nebulae, but only if was added by a script!
+		string error_string = stcore->removeNebula( cmd.arg("name") );
+		if (error_string != "" ) {
+			debug_message = error_string;
 			status = 0;
 		}
 
-	} else if (command=="clear") {
+	} else if (cmd.arg("action") == "clear") {
+
+		// drop all nebulae that are not in the original config file
+		string error_string = stcore->removeSupplementalNebulae();
+		if (error_string != "" ) {
+			debug_message = error_string;
+			status = 0;
+		}
 
-		// TODO move to stelcore
+	} else {
+		status = 0;
+	}
 
-		// set sky to known, standard states (used by scripts for simplicity)
-		execute_command("set home_planet Earth");
+	return status;
+}
 
-		if (args["state"] == "natural") {
-			execute_command("flag atmosphere on");
-			execute_command("flag landscape on");
-		} else {
-			execute_command("flag atmosphere off");
-			execute_command("flag landscape off");
-		}
+int AppCommandInterface::command_clear(const BoundCommand &cmd, CommandCall &call)
+{
+	// TODO move to stelcore
 
-		// turn off all labels
-		execute_command("flag azimuthal_grid off");
-		execute_command("flag galactic_grid off");
-		execute_command("flag meridian_line off");
-		execute_command("flag cardinal_points off");
-		execute_command("flag constellation_art off");
-		execute_command("flag constellation_drawing off");
-		execute_command("flag constellation_names off");
-		execute_command("flag constellation_boundaries off");
-		execute_command("flag ecliptic_line off");
-		execute_command("flag equatorial_grid off");
-		execute_command("flag equator_line off");
-		execute_command("flag tropic_lines off");
-		execute_command("flag circumpolar_circle off");
-		execute_command("flag precession_circle off");
-		execute_command("flag fog off");
-		execute_command("flag nebula_names off");
-		execute_command("flag object_trails off");
-		execute_command("flag planet_names off");
-		execute_command("flag planet_orbits off");
-		execute_command("flag show_tui_datetime off");
-		execute_command("flag star_names off");
-		execute_command("flag show_tui_short_obj_info off");
-
-		// make sure planets, stars, etc. are turned on!
-		// milkyway is left to user, for those without 3d cards
-		execute_command("flag stars on");
-		execute_command("flag planets on");
-		execute_command("flag nebulae on");
-
-		// also deselect everything, set to default fov and real time rate
-		execute_command("deselect");
-		execute_command("timerate rate 1");
-		execute_command("zoom auto initial");
-
-	} else if (command=="landscape" && args["action"] == "load") {
-
-		// textures are relative to script
-		args["path"] = stapp->scripts->get_script_path();
-		stcore->loadLandscape(args);
+	// set sky to known, standard states (used by scripts for simplicity)
+	execute_command("set home_planet Earth");
 
-	} else if (command=="meteors") {
-		if (args["zhr"]!="") {
-			stcore->setMeteorsRate(str_to_int(args["zhr"]));
-		} else status =0;
+	if (cmd.arg("state") == "natural") {
+		execute_command("flag atmosphere on");
+		execute_command("flag landscape on");
+	} else {
+		execute_command("flag atmosphere off");
+		execute_command("flag landscape off");
+	}
 
-	} else if (command=="external_viewer") {
-		if (args["action"]=="play" && args["filename"]!="") {
-			if (ExtViewer) {
-				delete(ExtViewer);
-				ExtViewer = NULL;
-			}
+	// turn off all labels
+	execute_command("flag azimuthal_grid off");
+	execute_command("flag galactic_grid off");
+	execute_command("flag meridian_line off");
+	execute_command("flag cardinal_points off");
+	execute_command("flag constellation_art off");
+	execute_command("flag constellation_drawing off");
+	execute_command("flag constellation_names off");
+	execute_command("flag constellation_boundaries off");
+	execute_command("flag ecliptic_line off");
+	execute_command("flag equatorial_grid off");
+	execute_command("flag equator_line off");
+	execute_command("flag tropic_lines off");
+	execute_command("flag circumpolar_circle off");
+	execute_command("flag precession_circle off");
+	execute_command("flag fog off");
+	execute_command("flag nebula_names off");
+	execute_command("flag object_trails off");
+	execute_command("flag planet_names off");
+	execute_command("flag planet_orbits off");
+	execute_command("flag show_tui_datetime off");
+	execute_command("flag star_names off");
+	execute_command("flag show_tui_short_obj_info off");
+
+	// make sure planets, stars, etc. are turned on!
+	// milkyway is left to user, for those without 3d cards
+	execute_command("flag stars on");
+	execute_command("flag planets on");
+	execute_command("flag nebulae on");
+
+	// also deselect everything, set to default fov and real time rate
+	execute_command("deselect");
+	execute_command("timerate rate 1");
+	execute_command("zoom auto initial");
+
+	return 1;
+}
 
-			string script_path = stapp->scripts->get_script_path();
-			if(trusted) script_path = "";  // Allow absolute filename
+int AppCommandInterface::command_landscape(const BoundCommand &cmd, CommandCall &call)
+{
+	if (cmd.arg("action") != "load") {
+		debug_message = _("Unrecognized or malformed command name.");
+		return 0;
+	}
 
-			ExtViewer = new ExternalViewer(script_path + args["filename"],
-			                               stcore->getDataDir(), args["coordinate_system"]);
-			// throttle down application
-			int rate = 24; // fps
-			if (args["background_framerate"]!="") {
-				rate = str_to_int(args["background_framerate"]);
-				if (rate < 10 ) rate = 10;
-			}
-			stapp->set_minfps(rate);
+	// textures are relative to script
+	stringHash_t args = cmd.args;
+	args["path"] = stapp->scripts->get_script_path();
+	stcore->loadLandscape(args);
 
-#ifdef DESKTOP
-			stapp->ui->show_message("Started external viewer:\n\n" +
-			                        args["filename"], 5000);
-#endif
-		} else if ((args["action"]=="play" || args["action"]=="resume") && ExtViewer) {
-			ExtViewer->resume();
-		} else if (args["action"]=="stop" && ExtViewer) {
+	return 1;
+}
+
+int AppCommandInterface::command_meteors(const BoundCommand &cmd, CommandCall &call)
+{
+	int status = 1;
+
+	if (cmd.arg("zhr")!="") {
+		stcore->setMeteorsRate(str_to_int(cmd.arg("zhr")));
+	} else status =0;
+
+	return status;
+}
+
+int AppCommandInterface::command_external_viewer(const BoundCommand &cmd, CommandCall &call)
+{
+	if (cmd.arg("action")=="play" && cmd.arg("filename")!="") {
+		if (ExtViewer) {
 			delete(ExtViewer);
 			ExtViewer = NULL;
-			// throttle up application
-			stapp->set_minfps(10000);
-		} else if (args["action"]=="pause" && ExtViewer) {
-			ExtViewer->pause();
 		}
 
-		if (ExtViewer) {
+		string script_path = stapp->scripts->get_script_path();
+		if(call.trusted) script_path = "";  // Allow absolute filename
 
-			if (args["alpha"]!="") ExtViewer->set_alpha(str_to_double(args["alpha"]),
-				        str_to_double(args["duration"]));
-			if (args["scale"]!="") ExtViewer->set_scale(str_to_double(args["scale"]),
-				        str_to_double(args["duration"]));
-			if (args["rotation"]!="") ExtViewer->set_rotation(str_to_double(args["rotation"]),
-				        str_to_double(args["duration"]), str_to_bool(args["shortPath"]));
-			if (args["altitude"]!="" || args["azimuth"]!="")
-				ExtViewer->set_location(str_to_double(args["altitude"]), args["altitude"]!="",
-				                        stcore->getHeading() + str_to_double(args["azimuth"]), args["azimuth"]!="",
-				                        str_to_double(args["duration"]));
-			if (args["clone"]!="") ExtViewer->set_clone(str_to_int(args["clone"]));
-			if (args["coordinate_system"]!="") ExtViewer->set_viewport(args["coordinate_system"]);
+		ExtViewer = new ExternalViewer(script_path + cmd.arg("filename"),
+		                               stcore->getDataDir(), cmd.arg("coordinate_system"));
+		// throttle down application
+		int rate = 24; // fps
+		if (cmd.arg("background_framerate")!="") {
+			rate = str_to_int(cmd.arg("background_framerate"));
+			if (rate < 10 ) rate = 10;
 		}
+		stapp->set_minfps(rate);
 
-	} else if (command=="configuration") {
+#ifdef DESKTOP
+		stapp->ui->show_message("Started external viewer:\n\n" +
+		                        cmd.arg("filename"), 5000);
+#endif
+	} else if ((cmd.arg("action")=="play" || cmd.arg("action")=="resume") && ExtViewer) {
+		ExtViewer->resume();
+	} else if (cmd.arg("action")=="stop" && ExtViewer) {
+		delete(ExtViewer);
+		ExtViewer = NULL;
+		// throttle up application
+		stapp->set_minfps(10000);
+	} else if (cmd.arg("action")=="pause" && ExtViewer) {
+		ExtViewer->pause();
+	}
 
-		if(args["action"]=="load") {
+	if (ExtViewer) {
+
+		if (cmd.arg("alpha")!="") ExtViewer->set_alpha(str_to_double(cmd.arg("alpha")),
+			        str_to_double(cmd.arg("duration")));
+		if (cmd.arg("scale")!="") ExtViewer->set_scale(str_to_double(cmd.arg("scale")),
+			        str_to_double(cmd.arg("duration")));
+		if (cmd.arg("rotation")!="") ExtViewer->set_rotation(str_to_double(cmd.arg("rotation")),
+			        str_to_double(cmd.arg("duration")), str_to_bool(cmd.arg("shortPath")));
+		if (cmd.arg("altitude")!="" || cmd.arg("azimuth")!="")
+			ExtViewer->set_location(str_to_double(cmd.arg("altitude")), cmd.arg("altitude")!="",
+			                        stcore->getHeading() + str_to_double(cmd.arg("azimuth")), cmd.arg("azimuth")!="",
+			                        str_to_double(cmd.arg("duration")));
+		if (cmd.arg("clone")!="") ExtViewer->set_clone(str_to_int(cmd.arg("clone")));
+		if (cmd.arg("coordinate_system")!="") ExtViewer->set_viewport(cmd.arg("coordinate_system"));
+	}
 
-			stapp->init();
+	return 1;
+}
 
-			#ifndef DESKTOP
+int AppCommandInterface::command_configuration(const BoundCommand &cmd, CommandCall &call)
+{
+	int status = 1;
 
-				system( ( stcore->getDataDir() + "script_load_config_after " ).c_str() );
+	if(cmd.arg("action")=="load") {
 
-			#endif
+		stapp->init();
 
-		} else if(args["action"]=="save"){
+		#ifndef DESKTOP
 
-			if(!trusted) {
-				status = 0;
-				debug_message = "Must be trusted to save config.";
-			} else {
+			system( ( stcore->getDataDir() + "script_load_config_after " ).c_str() );
 
-			#ifndef DESKTOP
+		#endif
 
-				system( ( stcore->getDataDir() + "script_save_config_before " ).c_str() );
+	} else if(cmd.arg("action")=="save"){
 
-			#endif
+		if(!call.trusted) {
+			status = 0;
+			debug_message = "Must be trusted to save config.";
+		} else {
 
-				stapp->saveCurrentConfig(AppSettings::Instance()->getConfigFile());
+		#ifndef DESKTOP
 
-			#ifndef DESKTOP
+			system( ( stcore->getDataDir() + "script_save_config_before " ).c_str() );
 
-				system( ( stcore->getDataDir() + "script_save_config_after " ).c_str() );
+		#endif
 
-			#endif
+			stapp->saveCurrentConfig(AppSettings::Instance()->getConfigFile());
 
-			}
+		#ifndef DESKTOP
 
-		} else {
-			status = 0;
-		}
-	} else if(command=="shutdown") {
-		if(trusted) {
-			if( AppSettings::Instance()->Digitarium() )
-				::system( ( stcore->getDataDir() + "script_shutdown" ).c_str() );
-			stapp->quit();
-		}
-		else {
-			status = 0;
-			debug_message = "Must be trusted to shutdown.";
-		}
-	} else if(command=="cove_lights") {
-		if(args["protocol"] == "bowen") {
-			string cmd("");
-			if(args["function"] == "all") {
-				RangeMap<float> rmap(1.0, 0.0, 100, 0);
-				cmd = "covelights_all_x:x_";
-				if( !args["r"].empty() )
-					cmd += double_to_str(floor(rmap.Map(str_to_double(args["r"])))) + "_";
-				else
-					cmd += "-1_";
-				if( !args["g"].empty() )
-					cmd += double_to_str(floor(rmap.Map(str_to_double(args["g"])))) + "_";
-				else
-					cmd += "-1_";
-				if( !args["b"].empty() )
-					cmd += double_to_str(floor(rmap.Map(str_to_double(args["b"])))) + "_";
-				else
-					cmd += "-1_";
-
-				if( !args["duration"].empty() )
-					cmd += args["duration"];
-				else
-					cmd += "0";
-			}
-			else if(args["function"] == "preset") {
-				cmd = "covelights_preset_";
-				cmd += args["number"];
-			}
-			else if(args["function"] == "connect") {
-				cmd.clear();
-				if( !NamedSockets::Instance().Connected("Bowen") )
-					NamedSockets::Instance().CreateOnCurrentSubnet( "Bowen", "245", 6005 );
-			}
+			system( ( stcore->getDataDir() + "script_save_config_after " ).c_str() );
+
+		#endif
 
-			if( !cmd.empty() ) {
-				cmd += "*";
-				if( NamedSockets::Instance().Connected("Bowen") )
-					NamedSockets::Instance().Send( "Bowen", cmd );
-			}
-		}
-		else {
-			status = 0;
-			debug_message = "Unsupported cove-light protocol.";
-		}
-	} else if(command=="color") {
-		if( !args["property"].empty() && !args["r"].empty() && !args["g"].empty() && !args["b"].empty()) {
-			float r = str_to_double(args["r"]), g = str_to_double(args["g"]), b = str_to_double(args["b"]);
-
-			if(args["property"] == "circumpolar_circle")
-				stcore->setColorCircumpolarCircle( Vec3f(r, g, b) );
-			else if(args["property"] == "constellation_lines")
-				stcore->setColorConstellationLine( Vec3f(r, g, b) );
-			else if(args["property"] == "constellation_names")
-				stcore->setColorConstellationNames( Vec3f(r, g, b) );
-			else if(args["property"] == "constellation_art")
-				stcore->setColorConstellationArt( Vec3f(r, g, b) );
-			else if(args["property"] == "constellation_boundaries")
-				stcore->setColorConstellationBoundaries( Vec3f(r, g, b) );
-			else if(args["property"] == "cardinal_points")
-				stcore->setColorCardinalPoints( Vec3f(r, g, b) );
-			else if(args["property"] == "planet_orbits")
-				stcore->setColorPlanetsOrbits( Vec3f(r, g, b) );
-			else if(args["property"] == "satellite_orbits")
-				stcore->setColorSatelliteOrbits( Vec3f(r, g, b) );
-			else if(args["property"] == "planet_names")
-				stcore->setColorPlanetsNames( Vec3f(r, g, b) );
-			else if(args["property"] == "planet_trails")
-				stcore->setColorPlanetsTrails( Vec3f(r, g, b) );
-			else if(args["property"] == "azimuthal_grid")
-				stcore->setColorAzimutalGrid( Vec3f(r, g, b) );
-			else if(args["property"] == "galactic_grid")
-				stcore->setColorGalacticGrid( Vec3f(r, g, b) );
-			else if(args["property"] == "equator_grid")
-				stcore->setColorEquatorGrid( Vec3f(r, g, b) );
-			else if(args["property"] == "equator_line")
-				stcore->setColorEquatorLine( Vec3f(r, g, b) );
-			else if(args["property"] == "ecliptic_line")
-				stcore->setColorEclipticLine( Vec3f(r, g, b) );
-			else if(args["property"] == "meridian_line")
-				stcore->setColorMeridianLine( Vec3f(r, g, b) );
-			else if(args["property"] == "nebula_names")
-				stcore->setColorNebulaLabels( Vec3f(r, g, b) );
-			else if(args["property"] == "nebula_circle")
-				stcore->setColorNebulaCircle( Vec3f(r, g, b) );
-			else if(args["property"] == "precession_circle")
-				stcore->setColorPrecessionCircle( Vec3f(r, g, b) );
-			else
-				debug_message = _("Command 'color': bad value for property argument.");
 		}
-		else
-			debug_message = _("Command 'color': missing expected argument 'property', 'r', 'g' or 'b'.");
+
 	} else {
-		debug_message = _("Unrecognized or malformed command name.");
 		status = 0;
 	}
 
-	if (status ) {
+	return status;
+}
 
-		// if recording commands, do that now
-		if (recordable) stapp->scripts->record_command(commandline);
+int AppCommandInterface::command_shutdown(const BoundCommand &cmd, CommandCall &call)
+{
+	int status = 1;
 
-		//    cout << commandline << endl;
+	if(call.trusted) {
+		if( AppSettings::Instance()->Digitarium() )
+			::system( ( stcore->getDataDir() + "script_shutdown" ).c_str() );
+		stapp->quit();
+	}
+	else {
+		status = 0;
+		debug_message = "Must be trusted to shutdown.";
+	}
 
-	} else {
+	return status;
+}
 
-		// Show gui error window only if script asked for gui debugging
-		if (stapp->scripts->is_playing() && stapp->scripts->get_gui_debug())
-			stapp->ui->show_message(_("Could not execute command:") + string("\n\"") +
-			                        commandline + string("\"\n\n") + debug_message, 7000);
+int AppCommandInterface::command_cove_lights(const BoundCommand &cmd, CommandCall &call)
+{
+	int status = 1;
+
+	if(cmd.arg("protocol") == "bowen") {
+		string light_cmd("");
+		if(cmd.arg("function") == "all") {
+			RangeMap<float> rmap(1.0, 0.0, 100, 0);
+			light_cmd = "covelights_all_x:x_";
+			if( !cmd.arg("r").empty() )
+				light_cmd += double_to_str(floor(rmap.Map(str_to_double(cmd.arg("r"))))) + "_";
+			else
+				light_cmd += "-1_";
+			if( !cmd.arg("g").empty() )
+				light_cmd += double_to_str(floor(rmap.Map(str_to_double(cmd.arg("g"))))) + "_";
+			else
+				light_cmd += "-1_";
+			if( !cmd.arg("b").empty() )
+				light_cmd += double_to_str(floor(rmap.Map(str_to_double(cmd.arg("b"))))) + "_";
+			else
+				light_cmd += "-1_";
 
-		cerr << "Could not execute: " << commandline << endl << debug_message << endl;
-	}
+			if( !cmd.arg("duration").empty() )
+				light_cmd += cmd.arg("duration");
+			else
+				light_cmd += "0";
+		}
+		else if(cmd.arg("function") == "preset") {
+			light_cmd = "covelights_preset_";
+			light_cmd += cmd.arg("number");
+		}
+		else if(cmd.arg("function") == "connect") {
+			light_cmd.clear();
+			if( !NamedSockets::Instance().Connected("Bowen") )
+				NamedSockets::Instance().CreateOnCurrentSubnet( "Bowen", "245", 6005 );
+		}
 
-	return(status);
+		if( !light_cmd.empty() ) {
+			light_cmd += "*";
+			if( NamedSockets::Instance().Connected("Bowen") )
+				NamedSockets::Instance().Send( "Bowen", light_cmd );
+		}
+	}
+	else {
+		status = 0;
+		debug_message = "Unsupported cove-light protocol.";
+	}
 
+	return status;
 }
 
-// set flags
-// if caller is not trusted, some flags can't be changed
-// newval is new value of flag changed
-
-int AppCommandInterface::set_flag(string name, string value, bool &newval, bool trusted)
+int AppCommandInterface::command_color(const BoundCommand &cmd, CommandCall &call)
 {
+	if( !cmd.arg("property").empty() && !cmd.arg("r").empty() && !cmd.arg("g").empty() && !cmd.arg("b").empty()) {
+		float r = str_to_double(cmd.arg("r")), g = str_to_double(cmd.arg("g")), b = str_to_double(cmd.arg("b"));
+
+		if(cmd.arg("property") == "circumpolar_circle")
+			stcore->setColorCircumpolarCircle( Vec3f(r, g, b) );
+		else if(cmd.arg("property") == "constellation_lines")
+			stcore->setColorConstellationLine( Vec3f(r, g, b) );
+		else if(cmd.arg("property") == "constellation_names")
+			stcore->setColorConstellationNames( Vec3f(r, g, b) );
+		else if(cmd.arg("property") == "constellation_art")
+			stcore->setColorConstellationArt( Vec3f(r, g, b) );
+		else if(cmd.arg("property") == "constellation_boundaries")
+			stcore->setColorConstellationBoundaries( Vec3f(r, g, b) );
+		else if(cmd.arg("property") == "cardinal_points")
+			stcore->setColorCardinalPoints( Vec3f(r, g, b) );
+		else if(cmd.arg("property") == "planet_orbits")
+			stcore->setColorPlanetsOrbits( Vec3f(r, g, b) );
+		else if(cmd.arg("property") == "satellite_orbits")
+			stcore->setColorSatelliteOrbits( Vec3f(r, g, b) );
+		else if(cmd.arg("property") == "planet_names")
+			stcore->setColorPlanetsNames( Vec3f(r, g, b) );
+		else if(cmd.arg("property") == "planet_trails")
+			stcore->setColorPlanetsTrails( Vec3f(r, g, b) );
+		else if(cmd.arg("property") == "azimuthal_grid")
+			stcore->setColorAzimutalGrid( Vec3f(r, g, b) );
+		else if(cmd.arg("property") == "galactic_grid")
+			stcore->setColorGalacticGrid( Vec3f(r, g, b) );
+		else if(cmd.arg("property") == "equator_grid")
+			stcore->setColorEquatorGrid( Vec3f(r, g, b) );
+		else if(cmd.arg("property") == "equator_line")
+			stcore->setColorEquatorLine( Vec3f(r, g, b) );
+		else if(cmd.arg("property") == "ecliptic_line")
+			stcore->setColorEclipticLine( Vec3f(r, g, b) );
+		else if(cmd.arg("property") == "meridian_line")
+			stcore->setColorMeridianLine( Vec3f(r, g, b) );
+		else if(cmd.arg("property") == "nebula_names")
+			stcore->setColorNebulaLabels( Vec3f(r, g, b) );
+		else if(cmd.arg("property") == "nebula_circle")
+			stcore->setColorNebulaCircle( Vec3f(r, g, b) );
+		else if(cmd.arg("property") == "precession_circle")
+			stcore->setColorPrecessionCircle( Vec3f(r, g, b) );
+		else
+			debug_message = _("Command 'color': bad value for property argument.");
+	}
+	else
+		debug_message = _("Command 'color': missing expected argument 'property', 'r', 'g' or 'b'.");
 
-	bool status = 1;
+	return 1;
+}
 
-	// value can be "on", "off", or "toggle"
-	if (value == "toggle") {
-
-		if (trusted) {
-
-			/* disabled due to code rework
-
-			// normal scripts shouldn't be able to change these user settings
-			if(name=="enable_zoom_keys") {
-				newval = !stcore->getFlagEnableZoomKeys();
-				stcore->setFlagEnableZoomKeys(newval); }
-			else if(name=="enable_move_keys") {
-				newval = !stcore->getFlagEnableMoveKeys();
-				stcore->setFlagEnableMoveKeys(newval); }
-			else if(name=="enable_move_mouse") newval = (stapp->FlagEnableMoveMouse = !stapp->FlagEnableMoveMouse);
-			else if(name=="menu") newval = (stapp->ui->FlagMenu = !stapp->ui->FlagMenu);
-			else if(name=="help") newval = (stapp->ui->FlagHelp = !stapp->ui->FlagHelp);
-			else if(name=="infos") newval = (stapp->ui->FlagInfos = !stapp->ui->FlagInfos);
-			else if(name=="show_topbar") newval = (stapp->ui->FlagShowTopBar = !stapp->ui->FlagShowTopBar);
-			else if(name=="show_time") newval = (stapp->ui->FlagShowTime = !stapp->ui->FlagShowTime);
-			else if(name=="show_date") newval = (stapp->ui->FlagShowDate = !stapp->ui->FlagShowDate);
-			else if(name=="show_appname") newval = (stapp->ui->FlagShowAppName = !stapp->ui->FlagShowAppName);
-			else if(name=="show_fps") newval = (stapp->ui->FlagShowFps = !stapp->ui->FlagShowFps);
-			else if(name=="show_fov") newval = (stapp->ui->FlagShowFov = !stapp->ui->FlagShowFov);
-			else if(name=="enable_tui_menu") newval = (stapp->ui->FlagEnableTuiMenu = !stapp->ui->FlagEnableTuiMenu);
-			else if(name=="show_gravity_ui") newval = (stapp->ui->FlagShowGravityUi = !stapp->ui->FlagShowGravityUi);
-			else if(name=="gravity_labels") {
-				newval = !stcore->getFlagGravityLabels();
-				stcore->setFlagGravityLabels(newval);
-				}
-			else status = 0;  // no match here, anyway
-			*/
+int AppCommandInterface::command_profile(const BoundCommand &cmd, CommandCall &call)
+{
+	int status = 1;
+
+	FrameProfiler *profiler = stcore->getProfiler();
+	call.recordable = false;
+
+	if(!cmd.arg("gl").empty())
+		profiler->setFlagGLTimers(cmd.arg("gl") == "on" || cmd.arg("gl") == "1");
+
+	if(cmd.arg("action") == "on")
+		profiler->setEnabled(true);
+	else if(cmd.arg("action") == "off")
+		profiler->setEnabled(false);
+	else if(cmd.arg("action") == "reset")
+		profiler->reset();
+	else if(cmd.arg("action") == "print")
+		cout << profiler->getReport();
+	else if(cmd.arg("action") == "star_batching") {
+		// Stalls the render thread and draws over the frame
+		if(!call.trusted) {
+			debug_message = "Must be trusted to run benchmarks.";
 			status = 0;
-
-		} else status = 0;
-
-
- 		if (name=="antialias_lines") {
-			newval = !stcore->getFlagAntialiasLines();
-			stcore->setFlagAntialiasLines(newval);
-		} else if (name=="constellation_drawing") {
-			newval = !stcore->getFlagConstellationLines();
-			stcore->setFlagConstellationLines(newval);
-		} else if (name=="constellation_names") {
-			newval = !stcore->getFlagConstellationNames();
-			stcore->setFlagConstellationNames(newval);
-		} else if (name=="constellation_art") {
-			newval = !stcore->getFlagConstellationArt();
-			stcore->setFlagConstellationArt(newval);
-		} else if (name=="constellation_boundaries") {
-			newval = !stcore->getFlagConstellationBoundaries();
-			stcore->setFlagConstellationBoundaries(newval);
-		} else if (name=="constellation_pick") {
-			newval = !stcore->getFlagConstellationIsolateSelected();
-			stcore->setFlagConstellationIsolateSelected(newval);
-		} else if (name=="star_twinkle") {
-			newval = !stcore->getFlagStarTwinkle();
-			stcore->setFlagStarTwinkle(newval);
-		} else if (name=="point_star") {
-			newval = !stcore->getFlagPointStar();
-			stcore->setFlagPointStar(newval);
-		} else if (name=="show_selected_object_info") newval = (stapp->ui->FlagShowSelectedObjectInfo = !stapp->ui->FlagShowSelectedObjectInfo);
-		else if (name=="show_tui_datetime") {
-			newval = (stapp->ui->FlagShowTuiDateTime = !stapp->ui->FlagShowTuiDateTime);
-			ReferenceState state;
-			state.show_tui_date_time = newval;
-			SharedData::Instance()->References( state );
-		}
-		else if (name=="show_tui_short_obj_info") {
-			newval = (stapp->ui->FlagShowTuiShortObjInfo = !stapp->ui->FlagShowTuiShortObjInfo);
-			ReferenceState state;
-			state.show_tui_short_obj_info = newval;
-			SharedData::Instance()->References( state );
-		}
-		else if (name=="manual_zoom") {
-			newval = !stcore->getFlagManualAutoZoom();
-			stcore->setFlagManualAutoZoom(newval);
-		} else if (name=="light_travel_time") {
-			newval = !stcore->getFlagLightTravelTime();
-			stcore->setFlagLightTravelTime(newval);
-		} else if (name=="show_script_bar") newval = (stapp->ui->FlagShowScriptBar = !stapp->ui->FlagShowScriptBar);
-		else if (name=="fog") {
-			newval = !stcore->getFlagFog();
-			stcore->setFlagFog(newval);
-		} else if (name=="atmosphere") {
-			newval = !stcore->getFlagAtmosphere();
-			stcore->setFlagAtmosphere(newval);
-			if (!newval) stcore->setFlagFog(false); // turn off fog with atmosphere
-		}
-		/*		else if(name=="chart") {
-			newval = !stapp->getVisionModeChart();
-			if (newval) stapp->setVisionModeChart();
+		} else
+			cout << stcore->compareStarBatching(2);
+	}
+	else if(cmd.arg("action") == "csv") {
+		// Only trusted callers may write outside the screenshot directory,
+		// others only give a file name so that ../ can not climb out of it
+		string csv_path = cmd.arg("filename");
+		if(!call.trusted) {
+			const string::size_type slash = csv_path.find_last_of("/\\");
+			if(slash != string::npos) csv_path.erase(0, slash + 1);
+			if(csv_path == "." || csv_path == "..") csv_path.clear();
 		}
-		else if(name=="night") {
-			newval = !stapp->getVisionModeNight();
-			if (newval) stapp->setVisionModeNight();
+		if(csv_path.empty()) {
+			debug_message = _("Command 'profile': missing expected argument 'filename'.");
+			status = 0;
+		} else {
+			if(!call.trusted || csv_path[0] != '/')
+				csv_path = stapp->getScreenshotDirectory() + csv_path;
+			if(profiler->startCSV(csv_path))
+				profiler->setEnabled(true);
+			else {
+				debug_message = _("Unable to open file: ") + csv_path;
+				status = 0;
+			}
 		}
-		*/
-		//else if(name=="use_common_names") newval = (stcore->FlagUseCommonNames = !stcore->FlagUseCommonNames);
-		else if (name=="azimuthal_grid") {
-			newval = !stcore->getFlagAzimutalGrid();
-			stcore->setFlagAzimutalGrid(newval);
-		} else if (name=="galactic_grid") {
-			newval = !stcore->getFlagGalacticGrid();
-			stcore->setFlagGalacticGrid(newval);
-		} else if (name=="equatorial_grid") {
-			newval = !stcore->getFlagEquatorGrid();
-			stcore->setFlagEquatorGrid(newval);
-		} else if (name=="equator_line") {
-			newval = !stcore->getFlagEquatorLine();
-			stcore->setFlagEquatorLine(newval);
-		} else if (name=="ecliptic_line") {
-			newval = !stcore->getFlagEclipticLine();
-			stcore->setFlagEclipticLine(newval);
-		} else if (name=="precession_circle") {
-			newval = !stcore->getFlagPrecessionCircle();
-			stcore->setFlagPrecessionCircle(newval);
-		} else if (name=="tropic_lines") {
-			newval = !stcore->getFlagTropicLines();
-			stcore->setFlagTropicLines(newval);
-		} else if (name=="circumpolar_circle") {
-			newval = !stcore->getFlagCircumpolarCircle();
-			stcore->setFlagCircumpolarCircle(newval);
-		} else if (name=="meridian_line") {
-			newval = !stcore->getFlagMeridianLine();
-			stcore->setFlagMeridianLine(newval);
-		} else if (name=="cardinal_points") {
-			newval = !stcore->getFlagCardinalsPoints();
-			stcore->setFlagCardinalsPoints(newval);
-		} else if (name=="clouds") {
-			newval = !stcore->getFlagClouds();
-			stcore->setFlagClouds(newval);
-		} else if (name=="moon_scaled") {
-			newval = !stcore->getFlagMoonScaled();
-			stcore->setFlagMoonScaled(newval);
-		} else if (name=="landscape") {
-			newval = !stcore->getFlagLandscape();
-			stcore->setFlagLandscape(newval);
-		} else if (name=="stars") {
-			newval = !stcore->getFlagStars();
-			stcore->setFlagStars(newval);
-		} else if (name=="star_names") {
-			newval = !stcore->getFlagStarName();
-			stcore->setFlagStarName(newval);
-		} else if (name=="planets") {
-			newval = !stcore->getFlagPlanets();
-			stcore->setFlagPlanets(newval);
-		} else if (name=="planet_names") {
-			newval = !stcore->getFlagPlanetsHints();
-			stcore->setFlagPlanetsHints(newval);
-			if (stcore->getFlagPlanetsHints()) stcore->setFlagPlanets(true); // for safety if script turns planets off
-		} else if (name=="planet_orbits") {
-			newval = !stcore->getFlagPlanetsOrbits();
-			stcore->setFlagPlanetsOrbits(newval);
-		} else if (name=="nebulae") {
-			newval = !stcore->getFlagNebula();
-			stcore->setFlagNebula(newval);
-		} else if (name=="nebula_names") {
-			newval = !stcore->getFlagNebulaHints();
-			if (newval) stcore->setFlagNebula(true); // make sure visible
-			stcore->setFlagNebulaHints(newval);
-		} else if (name=="milky_way") {
-			newval = !stcore->getFlagMilkyWay();
-			stcore->setFlagMilkyWay(newval);
-		} else if (name=="bright_nebulae") {
-			newval = !stcore->getFlagBrightNebulae();
-			stcore->setFlagBrightNebulae(newval);
-		} else if (name=="object_trails") {
-			newval = !stcore->getFlagPlanetsTrails();
-			stcore->setFlagPlanetsTrails(newval);
-		} else if (name=="track_object") {
-			newval = !stcore->getFlagTracking();
-			stcore->setFlagTracking(newval);
-		} else if (name=="script_gui_debug") {  // Not written to config - script specific
-			newval = !stapp->scripts->get_gui_debug();
-			stapp->scripts->set_gui_debug(newval);
-		} else return(status); // no matching flag found untrusted, but maybe trusted matched
+	} else if(cmd.arg("action") == "stop_csv")
+		profiler->stopCSV();
+	else if(cmd.arg("gl").empty()) {
+		debug_message = _("Command 'profile': unknown action value.");
+		status = 0;
+	}
 
-	} else {
+	return status;
+}
 
-		newval = (value == "on" || value == "1");
-
-		if (trusted) {
-
-			/* disabled due to code rework
-			// normal scripts shouldn't be able to change these user settings
-			if(name=="enable_zoom_keys") stcore->setFlagEnableZoomKeys(newval);
-			else if(name=="enable_move_keys") stcore->setFlagEnableMoveKeys(newval);
-			else if(name=="enable_move_mouse") stapp->FlagEnableMoveMouse = newval;
-			else if(name=="menu") stapp->ui->FlagMenu = newval;
-			else if(name=="help") stapp->ui->FlagHelp = newval;
-			else if(name=="infos") stapp->ui->FlagInfos = newval;
-			else if(name=="show_topbar") stapp->ui->FlagShowTopBar = newval;
-			else if(name=="show_time") stapp->ui->FlagShowTime = newval;
-			else if(name=="show_date") stapp->ui->FlagShowDate = newval;
-			else if(name=="show_appname") stapp->ui->FlagShowAppName = newval;
-			else if(name=="show_fps") stapp->ui->FlagShowFps = newval;
-			else if(name=="show_fov") stapp->ui->FlagShowFov = newval;
-			else if(name=="enable_tui_menu") stapp->ui->FlagEnableTuiMenu = newval;
-			else if(name=="show_gravity_ui") stapp->ui->FlagShowGravityUi = newval;
-			else if(name=="gravity_labels") stcore->setFlagGravityLabels(newval);
-			else status = 0;
-
-			*/
-			status = 0;
+// set flags
+// if caller is not trusted, some flags can't be changed
+// newval is new value of flag changed
 
-		} else status = 0;
+int AppCommandInterface::set_flag(string name, string value, bool &newval, bool trusted)
+{
+	if (flag_table.empty()) init_tables();
 
- 		if (name=="antialias_lines") stcore->setFlagAntialiasLines(newval);
-		else if (name=="constellation_drawing") stcore->setFlagConstellationLines(newval);
-		else if (name=="constellation_names") stcore->setFlagConstellationNames(newval);
-		else if (name=="constellation_art") stcore->setFlagConstellationArt(newval);
-		else if (name=="constellation_boundaries") stcore->setFlagConstellationBoundaries(newval);
-		else if (name=="constellation_pick") stcore->setFlagConstellationIsolateSelected(newval);
-		else if (name=="star_twinkle") stcore->setFlagStarTwinkle(newval);
-		else if (name=="point_star") stcore->setFlagPointStar(newval);
-		else if (name=="show_selected_object_info") stapp->ui->FlagShowSelectedObjectInfo = newval;
-		else if (name=="show_tui_datetime") {
-			stapp->ui->FlagShowTuiDateTime = newval;
-			ReferenceState state;
-			state.show_tui_date_time = newval;
-			SharedData::Instance()->References( state );
-		}
-		else if (name=="show_tui_short_obj_info") {
-			stapp->ui->FlagShowTuiShortObjInfo = newval;
-			ReferenceState state;
-			state.show_tui_short_obj_info = newval;
-			SharedData::Instance()->References( state );
-		}
-		else if (name=="manual_zoom") stcore->setFlagManualAutoZoom(newval);
-		else if (name=="light_travel_time") stcore->setFlagLightTravelTime(newval);
-		else if (name=="show_script_bar") stapp->ui->FlagShowScriptBar = newval;
-		else if (name=="fog") stcore->setFlagFog(newval);
-		else if (name=="atmosphere") {
-			stcore->setFlagAtmosphere ( newval);
-			if (!newval) stcore->setFlagFog(false); // turn off fog with atmosphere
-		}
-		/*		else if(name=="chart") {
-			if (newval) stapp->setVisionModeChart();
-		}
-		else if(name=="night") {
-			if (newval) stapp->setVisionModeNight();
-		}
-		*/
-		else if (name=="azimuthal_grid") stcore->setFlagAzimutalGrid(newval);
-		else if (name=="galactic_grid") stcore->setFlagGalacticGrid(newval);
-		else if (name=="equatorial_grid") stcore->setFlagEquatorGrid(newval);
-		else if (name=="equator_line") stcore->setFlagEquatorLine(newval);
-		else if (name=="ecliptic_line") stcore->setFlagEclipticLine(newval);
-		else if (name=="precession_circle") stcore->setFlagPrecessionCircle(newval);
-		else if (name=="circumpolar_circle") stcore->setFlagCircumpolarCircle(newval);
-		else if (name=="tropic_lines") stcore->setFlagTropicLines(newval);
-		else if (name=="meridian_line") stcore->setFlagMeridianLine(newval);
-		else if (name=="cardinal_points") stcore->setFlagCardinalsPoints(newval);
-		else if (name=="clouds") stcore->setFlagClouds(newval);
-		else if (name=="moon_scaled") stcore->setFlagMoonScaled(newval);
-		else if (name=="landscape") stcore->setFlagLandscape(newval);
-		else if (name=="stars") stcore->setFlagStars(newval);
-		else if (name=="star_names") stcore->setFlagStarName(newval);
-		else if (name=="planets") {
-			stcore->setFlagPlanets(newval);
-			if (!stcore->getFlagPlanets()) stcore->setFlagPlanetsHints(false);
-		} else if (name=="planet_names") {
-			stcore->setFlagPlanetsHints(newval);
-			if (stcore->getFlagPlanetsHints()) stcore->setFlagPlanets(true); // for safety if script turns planets off
-		} else if (name=="planet_orbits") stcore->setFlagPlanetsOrbits(newval);
-		else if (name=="nebulae") stcore->setFlagNebula(newval);
-		else if (name=="nebula_names") {
-			stcore->setFlagNebula(true);  // make sure visible
-			stcore->setFlagNebulaHints(newval);
-		} else if (name=="milky_way") stcore->setFlagMilkyWay(newval);
-		else if (name=="bright_nebulae") stcore->setFlagBrightNebulae(newval);
-		else if (name=="object_trails") stcore->setFlagPlanetsTrails(newval);
-		else if (name=="track_object") stcore->setFlagTracking(newval);
-		else if (name=="script_gui_debug") stapp->scripts->set_gui_debug(newval); // Not written to config - script specific
-		else return(status);
+	// the flags only trusted callers could change (enable_zoom_keys, menu,
+	// show_fps...) are disabled due to code rework
 
-	}
+	map<string, int>::const_iterator iter = flag_table.find(name);
+	if (iter == flag_table.end()) return 0;
 
+	// value can be "on", "off", or "toggle"
+	const bool toggle = (value == "toggle");
+	newval = toggle ? !get_flag(iter->second) : (value == "on" || value == "1");
+	apply_flag(iter->second, newval, toggle);
 
 	return(1);  // flag was found and updated
+}
 
+// current value of one of the FLAG_ enum
+bool AppCommandInterface::get_flag(int flag)
+{
+	switch (flag) {
+	case FLAG_ANTIALIAS_LINES: return stcore->getFlagAntialiasLines();
+	case FLAG_CONSTELLATION_DRAWING: return stcore->getFlagConstellationLines();
+	case FLAG_CONSTELLATION_NAMES: return stcore->getFlagConstellationNames();
+	case FLAG_CONSTELLATION_ART: return stcore->getFlagConstellationArt();
+	case FLAG_CONSTELLATION_BOUNDARIES: return stcore->getFlagConstellationBoundaries();
+	case FLAG_CONSTELLATION_PICK: return stcore->getFlagConstellationIsolateSelected();
+	case FLAG_STAR_TWINKLE: return stcore->getFlagStarTwinkle();
+	case FLAG_POINT_STAR: return stcore->getFlagPointStar();
+	case FLAG_SHOW_SELECTED_OBJECT_INFO: return stapp->ui->FlagShowSelectedObjectInfo;
+	case FLAG_SHOW_TUI_DATETIME: return stapp->ui->FlagShowTuiDateTime;
+	case FLAG_SHOW_TUI_SHORT_OBJ_INFO: return stapp->ui->FlagShowTuiShortObjInfo;
+	case FLAG_MANUAL_ZOOM: return stcore->getFlagManualAutoZoom();
+	case FLAG_LIGHT_TRAVEL_TIME: return stcore->getFlagLightTravelTime();
+	case FLAG_SHOW_SCRIPT_BAR: return stapp->ui->FlagShowScriptBar;
+	case FLAG_FOG: return stcore->getFlagFog();
+	case FLAG_ATMOSPHERE: return stcore->getFlagAtmosphere();
+	case FLAG_AZIMUTHAL_GRID: return stcore->getFlagAzimutalGrid();
+	case FLAG_GALACTIC_GRID: return stcore->getFlagGalacticGrid();
+	case FLAG_EQUATORIAL_GRID: return stcore->getFlagEquatorGrid();
+	case FLAG_EQUATOR_LINE: return stcore->getFlagEquatorLine();
+	case FLAG_ECLIPTIC_LINE: return stcore->getFlagEclipticLine();
+	case FLAG_PRECESSION_CIRCLE: return stcore->getFlagPrecessionCircle();
+	case FLAG_CIRCUMPOLAR_CIRCLE: return stcore->getFlagCircumpolarCircle();
+	case FLAG_TROPIC_LINES: return stcore->getFlagTropicLines();
+	case FLAG_MERIDIAN_LINE: return stcore->getFlagMeridianLine();
+	case FLAG_CARDINAL_POINTS: return stcore->getFlagCardinalsPoints();
+	case FLAG_CLOUDS: return stcore->getFlagClouds();
+	case FLAG_MOON_SCALED: return stcore->getFlagMoonScaled();
+	case FLAG_LANDSCAPE: return stcore->getFlagLandscape();
+	case FLAG_STARS: return stcore->getFlagStars();
+	case FLAG_STAR_NAMES: return stcore->getFlagStarName();
+	case FLAG_PLANETS: return stcore->getFlagPlanets();
+	case FLAG_PLANET_NAMES: return stcore->getFlagPlanetsHints();
+	case FLAG_PLANET_ORBITS: return stcore->getFlagPlanetsOrbits();
+	case FLAG_NEBULAE: return stcore->getFlagNebula();
+	case FLAG_NEBULA_NAMES: return stcore->getFlagNebulaHints();
+	case FLAG_MILKY_WAY: return stcore->getFlagMilkyWay();
+	case FLAG_BRIGHT_NEBULAE: return stcore->getFlagBrightNebulae();
+	case FLAG_OBJECT_TRAILS: return stcore->getFlagPlanetsTrails();
+	case FLAG_TRACK_OBJECT: return stcore->getFlagTracking();
+	case FLAG_SCRIPT_GUI_DEBUG: return stapp->scripts->get_gui_debug();
+	}
+	return false;
+}
+
+// set one of the FLAG_ enum, toggled if the caller asked to toggle it
+void AppCommandInterface::apply_flag(int flag, bool newval, bool toggled)
+{
+	switch (flag) {
+	case FLAG_ANTIALIAS_LINES:
+		stcore->setFlagAntialiasLines(newval);
+		break;
+	case FLAG_CONSTELLATION_DRAWING:
+		stcore->setFlagConstellationLines(newval);
+		break;
+	case FLAG_CONSTELLATION_NAMES:
+		stcore->setFlagConstellationNames(newval);
+		break;
+	case FLAG_CONSTELLATION_ART:
+		stcore->setFlagConstellationArt(newval);
+		break;
+	case FLAG_CONSTELLATION_BOUNDARIES:
+		stcore->setFlagConstellationBoundaries(newval);
+		break;
+	case FLAG_CONSTELLATION_PICK:
+		stcore->setFlagConstellationIsolateSelected(newval);
+		break;
+	case FLAG_STAR_TWINKLE:
+		stcore->setFlagStarTwinkle(newval);
+		break;
+	case FLAG_POINT_STAR:
+		stcore->setFlagPointStar(newval);
+		break;
+	case FLAG_SHOW_SELECTED_OBJECT_INFO:
+		stapp->ui->FlagShowSelectedObjectInfo = newval;
+		break;
+	case FLAG_SHOW_TUI_DATETIME: {
+		stapp->ui->FlagShowTuiDateTime = newval;
+		ReferenceState state;
+		state.show_tui_date_time = newval;
+		SharedData::Instance()->References( state );
+		break;
+	}
+	case FLAG_SHOW_TUI_SHORT_OBJ_INFO: {
+		stapp->ui->FlagShowTuiShortObjInfo = newval;
+		ReferenceState state;
+		state.show_tui_short_obj_info = newval;
+		SharedData::Instance()->References( state );
+		break;
+	}
+	case FLAG_MANUAL_ZOOM:
+		stcore->setFlagManualAutoZoom(newval);
+		break;
+	case FLAG_LIGHT_TRAVEL_TIME:
+		stcore->setFlagLightTravelTime(newval);
+		break;
+	case FLAG_SHOW_SCRIPT_BAR:
+		stapp->ui->FlagShowScriptBar = newval;
+		break;
+	case FLAG_FOG:
+		stcore->setFlagFog(newval);
+		break;
+	case FLAG_ATMOSPHERE:
+		stcore->setFlagAtmosphere(newval);
+		if (!newval) stcore->setFlagFog(false); // turn off fog with atmosphere
+		break;
+	case FLAG_AZIMUTHAL_GRID:
+		stcore->setFlagAzimutalGrid(newval);
+		break;
+	case FLAG_GALACTIC_GRID:
+		stcore->setFlagGalacticGrid(newval);
+		break;
+	case FLAG_EQUATORIAL_GRID:
+		stcore->setFlagEquatorGrid(newval);
+		break;
+	case FLAG_EQUATOR_LINE:
+		stcore->setFlagEquatorLine(newval);
+		break;
+	case FLAG_ECLIPTIC_LINE:
+		stcore->setFlagEclipticLine(newval);
+		break;
+	case FLAG_PRECESSION_CIRCLE:
+		stcore->setFlagPrecessionCircle(newval);
+		break;
+	case FLAG_CIRCUMPOLAR_CIRCLE:
+		stcore->setFlagCircumpolarCircle(newval);
+		break;
+	case FLAG_TROPIC_LINES:
+		stcore->setFlagTropicLines(newval);
+		break;
+	case FLAG_MERIDIAN_LINE:
+		stcore->setFlagMeridianLine(newval);
+		break;
+	case FLAG_CARDINAL_POINTS:
+		stcore->setFlagCardinalsPoints(newval);
+		break;
+	case FLAG_CLOUDS:
+		stcore->setFlagClouds(newval);
+		break;
+	case FLAG_MOON_SCALED:
+		stcore->setFlagMoonScaled(newval);
+		break;
+	case FLAG_LANDSCAPE:
+		stcore->setFlagLandscape(newval);
+		break;
+	case FLAG_STARS:
+		stcore->setFlagStars(newval);
+		break;
+	case FLAG_STAR_NAMES:
+		stcore->setFlagStarName(newval);
+		break;
+	case FLAG_PLANETS:
+		stcore->setFlagPlanets(newval);
+		if (!toggled && !stcore->getFlagPlanets()) stcore->setFlagPlanetsHints(false);
+		break;
+	case FLAG_PLANET_NAMES:
+		stcore->setFlagPlanetsHints(newval);
+		if (stcore->getFlagPlanetsHints()) stcore->setFlagPlanets(true); // for safety if script turns planets off
+		break;
+	case FLAG_PLANET_ORBITS:
+		stcore->setFlagPlanetsOrbits(newval);
+		break;
+	case FLAG_NEBULAE:
+		stcore->setFlagNebula(newval);
+		break;
+	case FLAG_NEBULA_NAMES:
+		if (newval || !toggled) stcore->setFlagNebula(true); // make sure visible
+		stcore->setFlagNebulaHints(newval);
+		break;
+	case FLAG_MILKY_WAY:
+		stcore->setFlagMilkyWay(newval);
+		break;
+	case FLAG_BRIGHT_NEBULAE:
+		stcore->setFlagBrightNebulae(newval);
+		break;
+	case FLAG_OBJECT_TRAILS:
+		stcore->setFlagPlanetsTrails(newval);
+		break;
+	case FLAG_TRACK_OBJECT:
+		stcore->setFlagTracking(newval);
+		break;
+	case FLAG_SCRIPT_GUI_DEBUG:  // Not written to config - script specific
+		stapp->scripts->set_gui_debug(newval);
+		break;
+	}
 }
 
 string AppCommandInterface::getErrorString( void ) {
@@ -1383,3 +1680,158 @@ void AppCommandInterface::update(int delta_time)
 {
 	if (audio) audio->update(delta_time);
 }
+
+// Benchmark -------------------------------------------------------------
+
+// How execute_command told commands, flags and settings apart before the
+// dispatch tables, kept to check bind_command against. Handlers are numbered
+// in the order of init_tables.
+static void bind_command_reference(const string &commandline, BoundCommand &cmd)
+{
+	cmd.line = commandline;
+	cmd.command.clear();
+	cmd.args.clear();
+	CommandInterface::parse_command(commandline, cmd.command, cmd.args);
+	cmd.key = -1;
+	cmd.toggle = false;
+	cmd.value = 0;
+
+	const string &command = cmd.command;
+	if (command == "flag") cmd.handler = 0;
+	else if (command == "wait") cmd.handler = 1;
+	else if (command == "set") cmd.handler = 2;
+	else if (command == "select") cmd.handler = 3;
+	else if (command == "deselect") cmd.handler = 4;
+	else if (command == "look") cmd.handler = 5;
+	else if (command == "zoom") cmd.handler = 6;
+	else if (command == "timerate") cmd.handler = 7;
+	else if (command == "multiplier") cmd.handler = 8;
+	else if (command == "date") cmd.handler = 9;
+	else if (command == "body") cmd.handler = 10;
+	else if (command == "moveto") cmd.handler = 11;
+	else if (command == "image") cmd.handler = 12;
+	else if (command == "audio") cmd.handler = 13;
+	else if (command == "script") cmd.handler = 14;
+	else if (command == "sky_culture") cmd.handler = 15;
+	else if (command == "nebula") cmd.handler = 16;
+	else if (command == "clear") cmd.handler = 17;
+	else if (command == "landscape") cmd.handler = 18;
+	else if (command == "meteors") cmd.handler = 19;
+	else if (command == "external_viewer") cmd.handler = 20;
+	else if (command == "configuration") cmd.handler = 21;
+	else if (command == "shutdown") cmd.handler = 22;
+	else if (command == "cove_lights") cmd.handler = 23;
+	else if (command == "color") cmd.handler = 24;
+	else if (command == "profile") cmd.handler = 25;
+	else cmd.handler = -1;
+
+	if (command == "flag" && !cmd.args.empty()) {
+		// set_flag compared the name with each flag in turn
+		const string &name = cmd.args.begin()->first;
+		for (int i=0; i<NB_FLAGS && cmd.key < 0; i++)
+			if (name == flag_names[i]) cmd.key = i;
+		const string &value = cmd.args.begin()->second;
+		cmd.toggle = (value == "toggle");
+		cmd.value = (value == "on" || value == "1");
+	} else if (command == "set") {
+		// the first setting given wins, in the order they were tested
+		for (int i=0; i<NB_SETTINGS && cmd.key < 0; i++) {
+			const string &value = cmd.arg(setting_names[i]);
+			if (value != "") {
+				cmd.key = i;
+				cmd.value = str_to_double(value);
+			}
+		}
+	}
+}
+
+bool AppCommandInterface::benchmarkCommands(int repeat, ostream &os)
+{
+	if (command_table.empty()) init_tables();
+
+	// Every command, flag and setting, toggles, several settings at once
+	// and unknown names
+	vector<string> checked;
+	for (map<string, int>::const_iterator iter = command_table.begin(); iter != command_table.end(); ++iter)
+		checked.push_back(iter->first + " action on");
+	for (int i=0; i<NB_FLAGS; i++) {
+		checked.push_back(string("flag ") + flag_names[i] + " on");
+		checked.push_back(string("flag ") + flag_names[i] + " toggle");
+	}
+	for (int i=0; i<NB_SETTINGS; i++) checked.push_back(string("set ") + setting_names[i] + " 1.5");
+	checked.push_back("set star_scale 2 atmosphere_fade_duration 3 zoom_offset 4");
+	checked.push_back("set unknown_setting 1");
+	checked.push_back("flag unknown_flag on");
+	checked.push_back("unknown_command fov 10");
+
+	unsigned int mismatches = 0;
+	vector<BoundCommand> fromTables(checked.size()), fromChain(checked.size());
+	double t = FrameProfiler::getTime();
+	for (int r=0; r<repeat; ++r)
+		for (unsigned int i=0; i<checked.size(); ++i) bind_command_reference(checked[i], fromChain[i]);
+	const double chain = FrameProfiler::getTime() - t;
+
+	t = FrameProfiler::getTime();
+	for (int r=0; r<repeat; ++r)
+		for (unsigned int i=0; i<checked.size(); ++i) bind_command(checked[i], fromTables[i]);
+	const double tables = FrameProfiler::getTime() - t;
+
+	for (unsigned int i=0; i<checked.size(); ++i) {
+		if (fromTables[i].handler != fromChain[i].handler || fromTables[i].key != fromChain[i].key
+		        || fromTables[i].toggle != fromChain[i].toggle || fromTables[i].value != fromChain[i].value) {
+			cerr << "Commands: " << checked[i] << " binds differently from the string chain" << endl;
+			mismatches++;
+		}
+	}
+
+	const double nbBound = (double)checked.size() * repeat;
+	os << "Commands, " << nbBound << " bindings of " << checked.size() << " command lines" << endl
+	   << "  string chain: " << chain*1000./nbBound << " us/command" << endl
+	   << "  tables:       " << tables*1000./nbBound << " us/command" << endl
+	   << "  " << mismatches << " lines binding differently" << (mismatches ? " FAIL" : " OK") << endl;
+
+	// the commands would be recorded
+	if (stapp->scripts->is_recording()) {
+		os << "  execution not benchmarked while recording a script" << endl;
+		return !mismatches;
+	}
+
+	// Frequent kinds of command, with values that leave the state as it is
+	vector<string> lines;
+	ostringstream twinkle, mag_scale;
+	twinkle.precision(9);
+	mag_scale.precision(9);
+	twinkle << "set star_twinkle_amount " << stcore->getStarTwinkleAmount();
+	mag_scale << "set star_mag_scale " << stcore->getStarMagScale();
+	lines.push_back(string("flag stars ") + (stcore->getFlagStars() ? "on" : "off"));
+	lines.push_back(string("flag fog ") + (stcore->getFlagFog() ? "on" : "off"));
+	lines.push_back(twinkle.str());
+	lines.push_back(mag_scale.str());
+	lines.push_back("zoom delta_fov 0");
+	lines.push_back("date relative 0");
+	lines.push_back("wait duration 0");
+
+	unsigned long int wait;
+	t = FrameProfiler::getTime();
+	for (int r=0; r<repeat; ++r)
+		for (unsigned int i=0; i<lines.size(); ++i) execute_command(lines[i], wait, true);
+	const double text = FrameProfiler::getTime() - t;
+
+	vector<BoundCommand> bound(lines.size());
+	t = FrameProfiler::getTime();
+	for (int r=0; r<repeat; ++r)
+		for (unsigned int i=0; i<lines.size(); ++i) bind_command(lines[i], bound[i]);
+	const double binding = FrameProfiler::getTime() - t;
+
+	t = FrameProfiler::getTime();
+	for (int r=0; r<repeat; ++r)
+		for (unsigned int i=0; i<lines.size(); ++i) execute_command(bound[i], wait, true);
+	const double prebound = FrameProfiler::getTime() - t;
+
+	const double nb = (double)lines.size() * repeat;
+	os << "  " << nb << " executions of " << lines.size() << " command lines" << endl
+	   << "  from text: " << nb*1000./text << " commands/s" << endl
+	   << "  pre-bound: " << nb*1000./prebound << " commands/s" << endl
+	   << "  binding:   " << binding*1000./nb << " us/command" << endl;
+	return !mismatches;
+}
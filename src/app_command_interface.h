@@ -25,6 +25,8 @@
 
 /* This class handles parsing of a simple command syntax for scripting,
    UI components, network commands, etc.
+   Commands are dispatched through a table of handlers; callers that repeat
+   a command can bind it once and skip the parsing and lookups.
 */
 
 #ifndef _APP_COMMAND_INTERFACE_H_
@@ -53,13 +55,71 @@ public:
 	virtual int execute_command(string command, double arg);
 	virtual int execute_command(string command, int arg);
 	virtual int execute_command(string command, unsigned long int &wait, bool trusted);
+	int execute_command(const BoundCommand &cmd, unsigned long int &wait, bool trusted);
 	virtual int set_flag(string name, string value, bool &newval, bool trusted);
+
+	// Parse a command line and look up its handler, and for flag and set
+	// commands the flag or setting (key) and its value
+	static void bind_command(const string &commandline, BoundCommand &cmd);
+
+	// Binding through the tables against the string comparison chains they
+	// replaced, then commands per second executed from command lines and
+	// pre-bound. Returns false when a line binds differently.
+	bool benchmarkCommands(int repeat, ostream &os);
+
 	void update(int delta_time);
 	void enableAudio();
 	void disableAudio();
 	string getErrorString();
 
 private:
+	// What a handler reports besides its status
+	struct CommandCall {
+		bool trusted;
+		unsigned long int wait; // before the next command (ms)
+		bool recordable;
+		string line;            // recorded instead of the command line if not empty
+	};
+	typedef int (AppCommandInterface::*CommandHandler)(const BoundCommand &cmd, CommandCall &call);
+
+	// Command, flag and setting names to indices in handlers or the
+	// FLAG_ and SET_ enums, filled on first use
+	static vector<CommandHandler> handlers;
+	static map<string, int> command_table;
+	static map<string, int> flag_table;
+	static map<string, int> setting_table;
+	static void init_tables(void);
+
+	bool get_flag(int flag);
+	void apply_flag(int flag, bool value, bool toggled);
+
+	int command_flag(const BoundCommand &cmd, CommandCall &call);
+	int command_wait(const BoundCommand &cmd, CommandCall &call);
+	int command_set(const BoundCommand &cmd, CommandCall &call);
+	int command_select(const BoundCommand &cmd, CommandCall &call);
+	int command_deselect(const BoundCommand &cmd, CommandCall &call);
+	int command_look(const BoundCommand &cmd, CommandCall &call);
+	int command_zoom(const BoundCommand &cmd, CommandCall &call);
+	int command_timerate(const BoundCommand &cmd, CommandCall &call);
+	int command_multiplier(const BoundCommand &cmd, CommandCall &call);
+	int command_date(const BoundCommand &cmd, CommandCall &call);
+	int command_body(const BoundCommand &cmd, CommandCall &call);
+	int command_moveto(const BoundCommand &cmd, CommandCall &call);
+	int command_image(const BoundCommand &cmd, CommandCall &call);
+	int command_audio(const BoundCommand &cmd, CommandCall &call);
+	int command_script(const BoundCommand &cmd, CommandCall &call);
+	int command_sky_culture(const BoundCommand &cmd, CommandCall &call);
+	int command_nebula(const BoundCommand &cmd, CommandCall &call);
+	int command_clear(const BoundCommand &cmd, CommandCall &call);
+	int command_landscape(const BoundCommand &cmd, CommandCall &call);
+	int command_meteors(const BoundCommand &cmd, CommandCall &call);
+	int command_external_viewer(const BoundCommand &cmd, CommandCall &call);
+	int command_configuration(const BoundCommand &cmd, CommandCall &call);
+	int command_shutdown(const BoundCommand &cmd, CommandCall &call);
+	int command_cove_lights(const BoundCommand &cmd, CommandCall &call);
+	int command_color(const BoundCommand &cmd, CommandCall &call);
+	int command_profile(const BoundCommand &cmd, CommandCall &call);
+
 	Core * stcore;
 	App * stapp;
 	Audio * audio;  // for audio track from script
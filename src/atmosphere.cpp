@@ -26,7 +26,19 @@
 //	Class which compute and display the daylight sky color using openGL
 //	the sky is computed with the Skylight class.
 
-// TODO : Adaptative resolution for optimization
+// The sky is computed on a grid of sky_resolution x sky_resolution cells
+// covering the viewport, a structure of arrays processed in batches by
+// Skylight::get_xyY_valuesv, Skybright::get_luminances and
+// ToneReproductor::xyY_to_RGBs, split between the calling thread and a
+// pool of workers. Nothing is recomputed while the sun, moon, view and
+// other inputs stay within tolerance.
+
+#include <cmath>
+#include <iostream>
+
+#ifndef WIN32
+#include <unistd.h>
+#endif
 
 #include "GLee.h"
 #include "atmosphere.h"
@@ -36,23 +48,115 @@
 #include "projector.h"
 #include "shared_data.h"
 
-Atmosphere::Atmosphere() : sky_resolution(48), tab_sky(NULL), world_adaptation_luminance(0.f), atm_intensity(0),
-		lightPollutionLuminance(0)
+// Largest change of a sun, moon or view direction (radians, about 2")
+// for which the previous grid is kept
+#define DIRECTION_TOLERANCE 1.e-5
+
+// Grid points computed in one batch
+#define BATCH_SIZE 64
+
+Atmosphere::Atmosphere() : requested_resolution(48), sky_resolution(0), mean_sky_luminance(0.), state_valid(false),
+		directions_valid(false), frame_prj(NULL), frame_eye(NULL), generation(0), busy(0), quit(false),
+		world_adaptation_luminance(0.f), atm_intensity(0), lightPollutionLuminance(0)
 {
-	// Create the vector array used to store the sky color on the full field of view
-	tab_sky = new Vec3f*[sky_resolution+1];
-	for (int k=0; k<sky_resolution+1 ; k++) {
-		tab_sky[k] = new Vec3f[sky_resolution+1];
-	}
+	lock = SDL_CreateMutex();
+	work_available = SDL_CreateCond();
+	work_finished = SDL_CreateCond();
+	resizeGrid(requested_resolution);
 	setFadeDuration(3.f);
 }
 
 Atmosphere::~Atmosphere()
 {
-	for (int k=0; k<sky_resolution+1 ; k++) {
-		if (tab_sky[k]) delete [] tab_sky[k];
+	stopWorkers();
+	SDL_DestroyCond(work_finished);
+	SDL_DestroyCond(work_available);
+	SDL_DestroyMutex(lock);
+}
+
+void Atmosphere::setNbThreads(int nb_threads)
+{
+	stopWorkers();
+
+	if (nb_threads < 0) {
+#ifndef WIN32
+		nb_threads = sysconf(_SC_NPROCESSORS_ONLN) - 1;
+#else
+		nb_threads = 1;
+#endif
+		if (nb_threads < 0) nb_threads = 0;
+	}
+
+	quit = false;
+	for (int t=0; t<nb_threads; t++) {
+		Worker *w = new Worker;
+		w->atm = this;
+		w->first = w->count = 0;
+		w->done_generation = generation;
+		w->thread = SDL_CreateThread(&Atmosphere::workerThread, w);
+		if (!w->thread) {
+			cerr << "Can't create atmosphere thread, " << t << " available" << endl;
+			delete w;
+			break;
+		}
+		workers.push_back(w);
+	}
+}
+
+void Atmosphere::stopWorkers(void)
+{
+	SDL_mutexP(lock);
+	quit = true;
+	SDL_CondBroadcast(work_available);
+	SDL_mutexV(lock);
+
+	for (vector<Worker*>::iterator iter = workers.begin(); iter != workers.end(); ++iter) {
+		SDL_WaitThread((*iter)->thread, NULL);
+		delete *iter;
 	}
-	if (tab_sky) delete [] tab_sky;
+	workers.clear();
+}
+
+int Atmosphere::workerThread(void *data)
+{
+	Worker *w = (Worker*)data;
+	Atmosphere *a = w->atm;
+
+	SDL_mutexP(a->lock);
+	for (;;) {
+		while (!a->quit && a->generation == w->done_generation) SDL_CondWait(a->work_available, a->lock);
+		if (a->quit) break;
+		w->done_generation = a->generation;
+		SDL_mutexV(a->lock);
+
+		a->computePoints(w->first, w->count);
+
+		SDL_mutexP(a->lock);
+		if (--a->busy == 0) SDL_CondSignal(a->work_finished);
+	}
+	SDL_mutexV(a->lock);
+
+	return 0;
+}
+
+void Atmosphere::resizeGrid(int resolution)
+{
+	sky_resolution = resolution;
+	const unsigned int nb = (sky_resolution+1)*(sky_resolution+1);
+	dir_x.resize(nb);
+	dir_y.resize(nb);
+	dir_z.resize(nb);
+	sky_color.assign(3*nb, 0.f);
+	sky_luminance.resize(nb);
+	directions_valid = false;
+	state_valid = false;
+}
+
+// Points outside a fisheye disk may unproject to NaN, which compares near to itself
+static bool Near(const Vec3d &a, const Vec3d &b)
+{
+	return !(fabs(a[0]-b[0]) >= DIRECTION_TOLERANCE) && !(fabs(a[1]-b[1]) >= DIRECTION_TOLERANCE) &&
+	       !(fabs(a[2]-b[2]) >= DIRECTION_TOLERANCE);
 }
 
 void Atmosphere::compute_color(double JD, Vec3d sunPos, Vec3d moonPos, float moon_phase,
@@ -67,15 +171,12 @@ void Atmosphere::compute_color(double JD, Vec3d sunPos, Vec3d moonPos, float moo
 		atm_intensity = 0;
 		world_adaptation_luminance = 3.75f + lightPollutionLuminance;
 		milkyway_adaptation_luminance = min_mw_lum;  // brighter than without atm, since no drawing addition of atm brightness
+		state_valid = false;
 		return;
 	} else {
 		atm_intensity = fader.getInterstate();
 	}
 
-
-	//Vec3d obj;
-	skylight_struct2 b2;
-
 	// these are for radii
 	double sun_angular_size = atan(696000./AU/sunPos.length());
 	double moon_angular_size = atan(1738./AU/moonPos.length());
@@ -112,80 +213,165 @@ void Atmosphere::compute_color(double JD, Vec3d sunPos, Vec3d moonPos, float moo
 		//		printf("atm int %f (min %f)\n", atm_intensity, min);
 	}
 
-	float sun_pos[3];
-	sun_pos[0] = sunPos[0];
-	sun_pos[1] = sunPos[1];
-	sun_pos[2] = sunPos[2];
-
-	float moon_pos[3];
-	moon_pos[0] = moonPos[0];
-	moon_pos[1] = moonPos[1];
-	moon_pos[2] = moonPos[2];
-
-	sky.set_paramsv(sun_pos, 5.f);
+	// Adaptive resolution: cells of about 24 pixels, at least the default 48
+	int resolution = requested_resolution;
+	if (resolution <= 0) {
+		resolution = MY_MAX(prj->getViewportWidth(), prj->getViewportHeight()) / 24;
+		resolution = MY_MIN(MY_MAX(resolution, 48), 256);
+	}
+	if (resolution != sky_resolution) resizeGrid(resolution);
 
-	skyb.set_loc(latitude * M_PI/180., altitude, temperature, relative_humidity);
-	skyb.set_sun_moon(moon_pos[2], sun_pos[2]);
+	float stepX = (float)prj->getViewportWidth() / sky_resolution;
+	float stepY = (float)prj->getViewportHeight() / sky_resolution;
+	float viewport_left = (float)prj->getViewportPosX();
+	float viewport_bottom = (float)prj->getViewportPosY();
 
 	// Calculate the date from the julian day.
 	ln_date date;
 	NShadeDateTime::JulianToDate(JD, &date);
 
+	// Skip everything if nothing visible changed since the last time
+	State s;
+	s.sun = sunPos;
+	s.moon = moonPos;
+	const double corners[5][2] = {{0, 0}, {sky_resolution, 0}, {0, sky_resolution},
+		{sky_resolution, sky_resolution}, {0.5*sky_resolution, 0.5*sky_resolution}
+	};
+	for (int k=0; k<5; k++) {
+		prj->unproject_local(viewport_left+corners[k][0]*stepX, viewport_bottom+corners[k][1]*stepY, s.view[k]);
+		s.view[k].normalize();
+	}
+	s.viewport = prj->getViewport();
+	s.moon_phase = moon_phase;
+	s.latitude = latitude;
+	s.altitude = altitude;
+	s.temperature = temperature;
+	s.relative_humidity = relative_humidity;
+	s.year = date.years;
+	s.month = date.months;
+	s.intensity = atm_intensity;
+	s.eye_adaptation = eye->get_world_adaptation_luminance();
+
+	bool view_same = state_valid && s.viewport == state.viewport;
+	for (int k=0; view_same && k<5; k++) view_same = Near(s.view[k], state.view[k]);
+	if (!view_same) directions_valid = false;
+
+	if (view_same && Near(s.sun, state.sun) && Near(s.moon, state.moon) &&
+	        s.moon_phase == state.moon_phase && s.latitude == state.latitude &&
+	        s.altitude == state.altitude && s.temperature == state.temperature &&
+	        s.relative_humidity == state.relative_humidity && s.year == state.year &&
+	        s.month == state.month && s.intensity == state.intensity &&
+	        s.eye_adaptation == state.eye_adaptation) {
+		// the light pollution is not part of the state, only of the adaptation
+		updateAdaptation(min_mw_lum);
+		return;
+	}
+	state = s;
+	state_valid = true;
+
+	for (int k=0; k<3; k++) {
+		frame_sun[k] = sunPos[k];
+		frame_moon[k] = moonPos[k];
+	}
+
+	sky.set_paramsv(frame_sun, 5.f);
+
+	// set_loc depends on the month given to set_date
 	skyb.set_date(date.years, date.months, moon_phase);
+	skyb.set_loc(latitude * M_PI/180., altitude, temperature, relative_humidity);
+	skyb.set_sun_moon(frame_moon[2], frame_sun[2]);
 
-	float stepX = (float)prj->getViewportWidth() / sky_resolution;
-	float stepY = (float)prj->getViewportHeight() / sky_resolution;
-	float viewport_left = (float)prj->getViewportPosX();
-	float viewport_bottom = (float)prj->getViewportPosY();
+	frame_prj = prj;
+	frame_eye = eye;
+
+	// Compute the sky color for every grid point, the calling thread takes the last share
+	const unsigned int nb = dir_x.size();
+	const unsigned int share = (nb / (workers.size()+1) + BATCH_SIZE-1) / BATCH_SIZE * BATCH_SIZE;
+	if (workers.empty() || nb <= share) {
+		computePoints(0, nb);
+	} else {
+		SDL_mutexP(lock);
+		unsigned int first = 0;
+		busy = 0;
+		for (unsigned int t=0; t<workers.size(); t++) {
+			workers[t]->first = first;
+			workers[t]->count = MY_MIN(share, nb-first);
+			first += workers[t]->count;
+			busy++;
+		}
+		generation++;
+		SDL_CondBroadcast(work_available);
+		SDL_mutexV(lock);
 
-	Vec3d point(1., 0., 0.);
+		computePoints(first, nb-first);
+
+		SDL_mutexP(lock);
+		while (busy > 0) SDL_CondWait(work_finished, lock);
+		SDL_mutexV(lock);
+	}
+	directions_valid = true;
 
 	// Variables used to compute the average sky luminance
 	double sum_lum = 0.;
-	unsigned int nb_lum = 0;
+	for (unsigned int i=0; i<nb; i++) sum_lum += sky_luminance[i];
+	mean_sky_luminance = sum_lum/nb;
 
-	// Compute the sky color for every point above the ground
-	for (int x=0; x<=sky_resolution; ++x) {
-		for (int y=0; y<=sky_resolution; ++y) {
-			prj->unproject_local((double)viewport_left+x*stepX, (double)viewport_bottom+y*stepY,point);
-			point.normalize();
+	updateAdaptation(min_mw_lum);
+}
 
-			if (point[2]<=0) {
-				point[2] = -point[2];
+void Atmosphere::updateAdaptation(float min_mw_lum)
+{
+	world_adaptation_luminance = 3.75f + lightPollutionLuminance + 3.5*mean_sky_luminance*atm_intensity;
+	milkyway_adaptation_luminance = min_mw_lum*(1-atm_intensity) + 30*mean_sky_luminance*atm_intensity;
+}
+
+void Atmosphere::computePoints(unsigned int first, unsigned int count)
+{
+	const int n = sky_resolution+1;
+	const float stepX = (float)frame_prj->getViewportWidth() / sky_resolution;
+	const float stepY = (float)frame_prj->getViewportHeight() / sky_resolution;
+	const float viewport_left = (float)frame_prj->getViewportPosX();
+	const float viewport_bottom = (float)frame_prj->getViewportPosY();
+
+	double cos_moon[BATCH_SIZE], cos_sun[BATCH_SIZE];
+	float color_x[BATCH_SIZE], color_y[BATCH_SIZE], color_Y[BATCH_SIZE];
+
+	for (unsigned int b=first; b<first+count; b+=BATCH_SIZE) {
+		const int nb = MY_MIN(BATCH_SIZE, first+count-b);
+		double *const x = &dir_x[b], *const y = &dir_y[b], *const z = &dir_z[b];
+
+		if (!directions_valid) {
+			Vec3d point(1., 0., 0.);
+			for (int k=0; k<nb; k++) {
+				frame_prj->unproject_local((double)viewport_left+((b+k)/n)*stepX,
+				                           (double)viewport_bottom+((b+k)%n)*stepY, point);
+				point.normalize();
 				// The sky below the ground is the symetric of the one above :
 				// it looks nice and gives proper values for brightness estimation
+				x[k] = point[0];
+				y[k] = point[1];
+				z[k] = fabs(point[2]);
 			}
+		}
 
-			b2.pos[0] = point[0];
-			b2.pos[1] = point[1];
-			b2.pos[2] = point[2];
-
-			// Use the Skylight model for the color
-			sky.get_xyY_valuev(b2);
-
-			// Use the Skybright.cpp 's models for brightness which gives better results.
-			b2.color[2] = skyb.get_luminance(moon_pos[0]*b2.pos[0]+moon_pos[1]*b2.pos[1]+
-			                                 moon_pos[2]*b2.pos[2], sun_pos[0]*b2.pos[0]+sun_pos[1]*b2.pos[1]+
-			                                 sun_pos[2]*b2.pos[2], b2.pos[2]);
-
+		// Use the Skylight model for the color
+		sky.get_xyY_valuesv(x, y, z, color_x, color_y, color_Y, nb);
 
-			sum_lum+=b2.color[2];
-			++nb_lum;
-			eye->xyY_to_RGB(b2.color);
-			tab_sky[x][y].set(atm_intensity*b2.color[0],atm_intensity*b2.color[1],atm_intensity*b2.color[2]);
+		// Use the Skybright.cpp 's models for brightness which gives better results.
+		for (int k=0; k<nb; k++) {
+			cos_moon[k] = frame_moon[0]*x[k] + frame_moon[1]*y[k] + frame_moon[2]*z[k];
+			cos_sun[k] = frame_sun[0]*x[k] + frame_sun[1]*y[k] + frame_sun[2]*z[k];
 		}
-	}
-
-	world_adaptation_luminance = 3.75f + lightPollutionLuminance + 3.5*sum_lum/nb_lum*atm_intensity;
-	milkyway_adaptation_luminance = min_mw_lum*(1-atm_intensity) + 30*sum_lum/nb_lum*atm_intensity;
+		skyb.get_luminances(cos_moon, cos_sun, z, &sky_luminance[b], nb);
 
-	sum_lum = 0.f;
-	nb_lum = 0;
+		float *const c = &sky_color[3*b];
+		frame_eye->xyY_to_RGBs(color_x, color_y, &sky_luminance[b], c, nb);
+		for (int k=0; k<3*nb; k++) c[k] *= atm_intensity;
+	}
 }
 
 
-
-// Draw the atmosphere using the precalc values stored in tab_sky
+// Draw the atmosphere using the precalc values stored in sky_color
 void Atmosphere::draw(Projector* prj, int delta_time)
 {
 	if (fader.getInterstate()) {
@@ -200,6 +386,7 @@ void Atmosphere::draw(Projector* prj, int delta_time)
 		float stepY = (float)prj->getViewportHeight() / sky_resolution;
 		float viewport_left = (float)prj->getViewportPosX();
 		float view_bottom = (float)prj->getViewportPosY();
+		const int n = sky_resolution+1;
 
 		glDisable(GL_TEXTURE_2D);
 		glEnable(GL_BLEND);
@@ -208,9 +395,9 @@ void Atmosphere::draw(Projector* prj, int delta_time)
 		for (int y2=0; y2<sky_resolution; ++y2) {
 			glBegin(GL_QUAD_STRIP);
 			for (int x2=0; x2<sky_resolution+1; ++x2) {
-				glColor3fv(tab_sky[x2][y2]);
+				glColor3fv(&sky_color[3*(x2*n+y2)]);
 				glVertex2i((int)(viewport_left+x2*stepX),(int)(view_bottom+y2*stepY));
-				glColor3fv(tab_sky[x2][y2+1]);
+				glColor3fv(&sky_color[3*(x2*n+y2+1)]);
 				glVertex2i((int)(viewport_left+x2*stepX),(int)(view_bottom+(y2+1)*stepY));
 			}
 			glEnd();
@@ -31,6 +31,9 @@
 #ifndef _ATMOSTPHERE_H_
 #define _ATMOSTPHERE_H_
 
+#include <vector>
+
+#include "SDL_thread.h"
 #include "skylight.h"
 #include "vecmath.h"
 #include "navigator.h"
@@ -51,6 +54,18 @@ public:
 	                   float latitude = 45.f, float altitude = 200.f,
 	                   float temperature = 15.f, float relative_humidity = 40.f);
 	void draw(Projector* prj, int delta_time);
+
+	//! Set the number of grid cells across the viewport, 0 to adapt it to the viewport size
+	void setResolution(int resolution) {
+		requested_resolution = resolution;
+	}
+	int getResolution(void) const {
+		return requested_resolution;
+	}
+
+	//! Set the number of threads helping compute_color, <0 for automatic, 0 for none
+	void setNbThreads(int nb_threads);
+
 	void update(int delta_time) {
 		fader.update(delta_time);
 	}
@@ -94,10 +109,60 @@ public:
 	}
 
 private:
+	// Directions and colors of the grid points from first to first+count-1
+	void computePoints(unsigned int first, unsigned int count);
+	void updateAdaptation(float min_mw_lum);
+	void resizeGrid(int resolution);
+
 	Skylight sky;
 	Skybright skyb;
+	int requested_resolution;
 	int sky_resolution;
-	Vec3f ** tab_sky;	// For Atmosphere calculation
+
+	// Sky grid, point (x, y) at index x*(sky_resolution+1)+y
+	std::vector<double> dir_x, dir_y, dir_z;	// local direction, mirrored above the horizon
+	std::vector<float> sky_color;	// RGB, for draw
+	std::vector<float> sky_luminance;
+	double mean_sky_luminance;	// of the last computation
+
+	// Inputs of the last computation, which is skipped while they stay the same
+	struct State {
+		Vec3d sun, moon;
+		Vec3d view[5];		// directions of the viewport corners and center
+		Vec4i viewport;
+		float moon_phase, latitude, altitude, temperature, relative_humidity;
+		int year, month;
+		float intensity;
+		float eye_adaptation;
+	};
+	State state;
+	bool state_valid;
+	bool directions_valid;
+
+	// During compute_color, for the workers
+	Projector *frame_prj;
+	ToneReproductor *frame_eye;
+	float frame_sun[3], frame_moon[3];
+
+	// Fork-join pool, as in MinorBodyMgr
+	struct Worker {
+		Atmosphere *atm;
+		SDL_Thread *thread;
+		unsigned int first;
+		unsigned int count;
+		unsigned int done_generation;   // set before the thread starts, which may be after work was posted
+	};
+	static int workerThread(void *data);
+	void stopWorkers(void);
+
+	std::vector<Worker*> workers;
+	SDL_mutex *lock;
+	SDL_cond *work_available;
+	SDL_cond *work_finished;
+	unsigned int generation;
+	unsigned int busy;
+	bool quit;
+
 	int startY;			// intern variable used to store the Horizon Y screen value
 	float world_adaptation_luminance;
 	float milkyway_adaptation_luminance;
@@ -43,6 +43,14 @@ CommandInterface::~CommandInterface()
 }
 
 
+const string &BoundCommand::arg(const string &name) const
+{
+	static const string empty;
+	stringHashIter_t iter = args.find(name);
+	return iter == args.end() ? empty : iter->second;
+}
+
+
 int CommandInterface::parse_command(string command_line, string &command, stringHash_t &arguments)
 {
 
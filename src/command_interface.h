@@ -37,6 +37,28 @@
 
 using namespace std;
 
+// A command line split by parse_command and looked up once by the interface
+// that bound it, to be executed any number of times without parsing or
+// dispatching on strings again
+struct BoundCommand {
+	BoundCommand() : handler(-1), key(-1), toggle(false), value(0) {}
+
+	// Value of argument name, empty if not given
+	// Unlike stringHash_t::operator[] nothing is inserted
+	const string &arg(const string &name) const;
+
+	string line;            // as given, for recording and error messages
+	string command;
+	stringHash_t args;
+	int handler;            // index in the interface command table, -1 if unknown
+
+	// Argument naming what the command changes (a flag, a setting) and its
+	// value, converted once
+	int key;                // -1 if none
+	bool toggle;
+	double value;
+};
+
 class CommandInterface
 {
 
@@ -45,8 +67,8 @@ public:
 	virtual ~CommandInterface();
 	virtual int execute_command(string command) = 0;
 
-protected:
-	int parse_command(string command_line, string &command, stringHash_t &arguments);
+	// split a command line into the command name and its arguments
+	static int parse_command(string command_line, string &command, stringHash_t &arguments);
 
 };
 
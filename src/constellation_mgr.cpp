@@ -34,6 +34,7 @@
 #include "hip_star_mgr.h"
 #include "hip_star.h"
 #include "utility.h"
+#include "name_index.h"
 #include <nshade_state.h>
 
 // constructor which loads all data from appropriate files
@@ -269,11 +270,11 @@ int ConstellationMgr::loadLinesAndArt(const string &skyCultureDir, LoadingBar& l
 				FILE *ftest = fopen(localFile.c_str(), "r");
 				if (!ftest) {
 					// Load from application texture directory
-					cons->art_tex = new s_texture(texfile, TEX_LOAD_TYPE_PNG_BLEND1, true);  // use mipmaps
+					cons->art_tex = new s_texture(false, texfile, TEX_LOAD_TYPE_PNG_BLEND1, true, true);  // use mipmaps
 				} else {
 					// Load from local directory
 					fclose(ftest);
-					cons->art_tex = new s_texture(true, localFile, TEX_LOAD_TYPE_PNG_BLEND1, true);  // use mipmaps
+					cons->art_tex = new s_texture(true, localFile, TEX_LOAD_TYPE_PNG_BLEND1, true, true);  // use mipmaps
 				}
 
 				if(cons->art_tex->getID() == 0) continue;  // otherwise no texture
@@ -902,3 +903,14 @@ vector<string> ConstellationMgr::listMatchingObjectsI18n(const string& objPrefix
 	}
 	return result;
 }
+
+void ConstellationMgr::addNamesToIndex(NameIndex& index) const
+{
+	for (unsigned int i=0; i<asterisms.size(); ++i) {
+		const Constellation *c = asterisms[i];
+		ObjectBaseP brightest = c->getBrightestStarInConstellation();
+		const float rank = brightest ? brightest->get_mag(0) : 99.f;
+		index.add(c->getNameI18n(), c->getNameI18n(), ObjectRecord::OBJECT_CONSTELLATION, i, rank);
+		index.add(c->getEnglishName(), c->getNameI18n(), ObjectRecord::OBJECT_CONSTELLATION, i, rank);
+	}
+}
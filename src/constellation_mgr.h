@@ -37,6 +37,7 @@ class HipStarMgr;
 class Constellation;
 class Projector;
 class Navigator;
+class NameIndex;
 
 class ConstellationMgr
 {
@@ -173,6 +174,9 @@ public:
 	//! @param maxNbItem the maximum number of returned object names
 	//! @return a vector of matching object name by order of relevance, or an empty vector if nothing match
 	vector<string> listMatchingObjectsI18n(const string& objPrefix, unsigned int maxNbItem=5) const;
+
+	//! Add the constellation names to the search index, ranked by their brightest star
+	void addNamesToIndex(NameIndex& index) const;
 private:
 	bool loadBoundaries(const string& conCatFile);
 	void draw_lines(Projector * prj) const;
@@ -0,0 +1,226 @@
+/*
+ * Nightshade (TM) astronomy simulation and visualization
+ *
+ * Copyright (C) 2012 Digitalis Education Solutions, Inc.
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 3
+ * of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place - Suite 330, Boston, MA  02111-1307, USA.
+ *
+ * Nightshade is a trademark of Digitalis Education Solutions, Inc.
+ * See the TRADEMARKS file for trademark usage requirements.
+ *
+ */
+
+// nightshade-convert-stars: converts a Star2 or Star3 catalogue
+// (stars_2_*.cat, stars_3_*.cat) to the structure-of-arrays format
+// described in soa_zone_file.h. The output is in the byte order of this
+// machine and is mapped by nightshade without any fixup.
+//
+// usage: nightshade-convert-stars input.cat output.cat
+
+#include <cstdio>
+#include <cstring>
+#include <vector>
+
+#include "geodesic_grid.h"
+#include "hip_star.h"
+#include "soa_zone_file.h"
+
+using namespace std;
+using namespace BigStarCatalogExtension;
+
+#define FILE_MAGIC 0x835f040a
+#define FILE_MAGIC_NATIVE 0x835f040b
+
+struct ZoneAxes {
+	ZoneAxes(int level, int nr_of_zones) : level(level), zones(nr_of_zones), scale(0.0) {}
+	const int level;
+	vector<ZoneData> zones;
+	double scale;
+};
+
+static void InitTriangleFunc(int lev, int index,
+                             const Vec3d &c0,
+                             const Vec3d &c1,
+                             const Vec3d &c2,
+                             void *context)
+{
+	ZoneAxes *const axes = reinterpret_cast<ZoneAxes*>(context);
+	if (lev == axes->level) InitZoneAxes(c0, c1, c2, axes->zones[index], axes->scale);
+}
+
+// Write size bytes and the zeros up to the next SOA_FILE_ALIGN boundary
+static bool WriteAligned(FILE *f, const void *data, size_t size, size_t &offset)
+{
+	static const char zeros[SOA_FILE_ALIGN] = {0};
+	if (size > 0 && fwrite(data, 1, size, f) != size) return false;
+	offset += size;
+	const size_t pad = SoaAlign(offset) - offset;
+	if (pad > 0 && fwrite(zeros, 1, pad, f) != pad) return false;
+	offset += pad;
+	return true;
+}
+
+template <class T>
+static bool WriteArray(FILE *f, const vector<T> &a, size_t &offset)
+{
+	return WriteAligned(f, &a[0], a.size()*sizeof(T), offset);
+}
+
+static int GetDx0(const Star2 &s) {return s.dx0;}
+static int GetDx0(const Star3 &s) {return 0;}
+static int GetDx1(const Star2 &s) {return s.dx1;}
+static int GetDx1(const Star3 &s) {return 0;}
+
+template <class Star>
+static int Convert(FILE *in, FILE *out, SoaFileHeader &header, bool proper_motion)
+{
+	const unsigned int nr_of_zones = GeodesicGrid::nrOfZones(header.level);
+	vector<unsigned int> zone_size(nr_of_zones);
+	if (fread(&zone_size[0], sizeof(unsigned int), nr_of_zones, in) != nr_of_zones) {
+		fprintf(stderr, "can't read the zone sizes\n");
+		return 1;
+	}
+
+	// Zone axes as ZoneArray::initTriangle and scaleAxis would set them
+	ZoneAxes axes(header.level, nr_of_zones);
+	{
+		GeodesicGrid grid(header.level);
+		grid.visitTriangles(header.level, InitTriangleFunc, &axes);
+	}
+	axes.scale /= Star::max_pos_val;
+
+	vector<SoaZone> zones(nr_of_zones);
+	unsigned int nr_of_stars = 0, nr_of_slots = 0;
+	for (unsigned int z=0; z<nr_of_zones; z++) {
+		const ZoneData &d(axes.zones[z]);
+		for (int k=0; k<3; k++) {
+			zones[z].center[k] = d.center[k];
+			zones[z].axis0[k] = d.axis0[k]*axes.scale;
+			zones[z].axis1[k] = d.axis1[k]*axes.scale;
+		}
+		zones[z].first = nr_of_slots;
+		zones[z].size = zone_size[z];
+		nr_of_stars += zone_size[z];
+		nr_of_slots += (zone_size[z] + SOA_ZONE_ALIGN-1) & ~(SOA_ZONE_ALIGN-1);
+	}
+
+	vector<Star> stars(nr_of_stars);
+	if (nr_of_stars > 0 &&
+	        fread(&stars[0], sizeof(Star), nr_of_stars, in) != nr_of_stars) {
+		fprintf(stderr, "can't read the stars\n");
+		return 1;
+	}
+
+	vector<Int32> x0(nr_of_slots, 0), x1(nr_of_slots, 0);
+	vector<Int16> dx0(nr_of_slots, 0), dx1(nr_of_slots, 0);
+	vector<unsigned char> mag(nr_of_slots, 0), b_v(nr_of_slots, 0);
+	unsigned int s = 0;
+	for (unsigned int z=0; z<nr_of_zones; z++) {
+		for (unsigned int i=0; i<zones[z].size; i++, s++) {
+			const unsigned int slot = zones[z].first + i;
+			x0[slot] = stars[s].x0;
+			x1[slot] = stars[s].x1;
+			dx0[slot] = GetDx0(stars[s]);
+			dx1[slot] = GetDx1(stars[s]);
+			mag[slot] = stars[s].mag;
+			b_v[slot] = stars[s].b_v;
+		}
+	}
+
+	header.nr_of_zones = nr_of_zones;
+	header.nr_of_stars = nr_of_stars;
+	header.nr_of_slots = nr_of_slots;
+	header.proper_motion = proper_motion ? 1 : 0;
+	header.star_position_scale = axes.scale;
+
+	size_t offset = 0;
+	bool ok = WriteAligned(out, &header, sizeof(header), offset) &&
+	          WriteAligned(out, &zones[0], nr_of_zones*sizeof(SoaZone), offset) &&
+	          WriteArray(out, x0, offset) &&
+	          WriteArray(out, x1, offset);
+	if (ok && proper_motion) {
+		ok = WriteArray(out, dx0, offset) && WriteArray(out, dx1, offset);
+	}
+	ok = ok && WriteArray(out, mag, offset) && WriteArray(out, b_v, offset);
+	if (!ok || offset != SoaFileLayout(header).size) {
+		fprintf(stderr, "write failed\n");
+		return 1;
+	}
+	printf("level %u, %u zones, %u stars, %lu bytes\n",
+	       header.level, nr_of_zones, nr_of_stars, (unsigned long)offset);
+	return 0;
+}
+
+int main(int argc, char **argv)
+{
+	if (argc != 3) {
+		fprintf(stderr, "usage: %s input.cat output.cat\n", argv[0]);
+		return 1;
+	}
+
+	FILE *in = fopen(argv[1], "rb");
+	if (!in) {
+		fprintf(stderr, "can't open %s\n", argv[1]);
+		return 1;
+	}
+
+	unsigned int h[8];
+	if (fread(h, sizeof(unsigned int), 8, in) != 8) {
+		fprintf(stderr, "%s: bad file\n", argv[1]);
+		fclose(in);
+		return 1;
+	}
+	// The Star structs are read with the bit fields of this compiler,
+	// as nightshade does when mapping a legacy catalogue
+	if (h[0] != FILE_MAGIC && h[0] != FILE_MAGIC_NATIVE) {
+		fprintf(stderr, "%s: not a catalogue of this byte order\n", argv[1]);
+		fclose(in);
+		return 1;
+	}
+	if (h[1] != 1 && h[1] != 2) {
+		fprintf(stderr, "%s: only Star2 and Star3 catalogues (types 1 and 2) "
+		        "can be converted\n", argv[1]);
+		fclose(in);
+		return 1;
+	}
+
+	FILE *out = fopen(argv[2], "wb");
+	if (!out) {
+		fprintf(stderr, "can't create %s\n", argv[2]);
+		fclose(in);
+		return 1;
+	}
+
+	SoaFileHeader header;
+	memset(&header, 0, sizeof(header));
+	header.magic = FILE_MAGIC_SOA;
+	header.type = h[1];
+	header.major = SOA_FILE_VERSION;
+	header.minor = 0;
+	header.level = h[4];
+	header.mag_min = h[5];
+	header.mag_range = h[6];
+	header.mag_steps = h[7];
+
+	const int rval = (header.type == 1)
+	                 ? Convert<Star2>(in, out, header, true)
+	                 : Convert<Star3>(in, out, header, false);
+	fclose(in);
+	if (fclose(out) != 0 || rval != 0) {
+		remove(argv[2]);
+		return 1;
+	}
+	return 0;
+}
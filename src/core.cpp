@@ -25,12 +25,15 @@
 // Manage all the objects to be used in the program
 
 #include <algorithm>
+#include <sstream>
+#include <cstdlib>
 #include <boost/algorithm/string.hpp>
 
 #include "core.h"
 #include "stellastro.h"
 #include "utility.h"
 #include "hip_star_mgr.h"
+#include "app_settings.h"
 
 // TODO this needs to be replaced with a scriptable spherical image feature
 void Core::milkyswap(string mdir) {
@@ -42,7 +45,8 @@ Core::Core(const string& LDIR, const string& DATA_ROOT, const boost::callback<vo
 		projection(NULL), selected_object(NULL), hip_stars(NULL),
 		nebulas(NULL), ssystem(NULL), milky_way(NULL), 
 		deltaFov(0.),
-		deltaAlt(0.), deltaAz(0.), move_speed(0.00025), firstTime(1)
+		deltaAlt(0.), deltaAz(0.), move_speed(0.00025), firstTime(1),
+		nameIndexDirty(true)
 {
 	localeDir = LDIR;
 	dataRoot = DATA_ROOT;
@@ -58,6 +62,7 @@ Core::Core(const string& LDIR, const string& DATA_ROOT, const boost::callback<vo
 	navigation = new Navigator(observatory);
 	nebulas = new NebulaMgr();
 	milky_way = new MilkyWay();
+	profiler = new FrameProfiler();
 	equ_grid = new SkyGrid(SkyGrid::EQUATORIAL);
 	azi_grid = new SkyGrid(SkyGrid::ALTAZIMUTAL);
 	gal_grid = new SkyGrid(SkyGrid::GALACTIC);
@@ -111,6 +116,7 @@ Core::~Core()
 	delete atmosphere;
 	delete tone_converter;
 	delete ssystem;
+	delete profiler;
 	delete skyloc;
 	skyloc = NULL;
 	Object::delete_textures(); // Unload the pointer textures
@@ -130,6 +136,8 @@ void Core::init(const InitParser& conf, const int viewW, const int viewH )
 	setLineWidth(conf.get_double("rendering", "line_width", 1));
 	setFlagAntialiasLines(conf.get_boolean("rendering", "flag_antialias_lines", false));
 	setFlagShaders(conf.get_boolean("rendering", "flag_shaders", true));
+	profiler->setEnabled(conf.get_boolean("rendering", "flag_profiler", false));
+	profiler->setFlagGLTimers(conf.get_boolean("rendering", "flag_profiler_gl_timers", false));
 
 	// Projector
 	string tmpstr = conf.get_str("projection:type");
@@ -155,7 +163,21 @@ void Core::init(const InitParser& conf, const int viewW, const int viewH )
 		lb.Draw(0);
 
 		// Init the solar system first
+		Planet::setMaxTrail(conf.get_int("astro", "object_trails_length", Planet::getMaxTrail()));
 		ssystem->load(getDataDir() + "ssystem.ini", lb);
+		if (conf.get_boolean("astro", "flag_ephemeris_cache", false)) {
+			string cache_file = conf.get_str("astro", "ephemeris_cache_file", "ephemeris.cache");
+			if (!cache_file.empty() && cache_file[0] != '/') cache_file = getDataDir() + cache_file;
+			ssystem->loadEphemerisCache(cache_file);
+		}
+		if (conf.get_boolean("astro", "flag_minor_bodies", false)) {
+			string asteroid_file = conf.get_str("astro", "minor_body_file", "MPCORB.DAT");
+			string comet_file = conf.get_str("astro", "minor_comet_file", "CometEls.txt");
+			if (!asteroid_file.empty() && asteroid_file[0] != '/') asteroid_file = getDataDir() + asteroid_file;
+			if (!comet_file.empty() && comet_file[0] != '/') comet_file = getDataDir() + comet_file;
+			ssystem->loadMinorBodies(asteroid_file, comet_file, AppSettings::Instance()->getConfigDir(),
+			                         conf.get_int("astro", "minor_body_threads", -1), lb);
+		}
 		// Init stars
 		hip_stars->init(FontSizeGeneral, baseFontFile, lb, conf);
 		hip_stars->load_sci_names(getDataDir() + "name.fab");
@@ -173,6 +195,7 @@ void Core::init(const InitParser& conf, const int viewW, const int viewH )
 	setMaxMagStarName(conf.get_double ("stars", "max_mag_star_name", 1.5));
 	setStarMagScale(conf.get_double ("stars", "star_mag_scale", 1));
 	setFlagPointStar(conf.get_boolean("stars", "flag_point_star", false));
+	setFlagStarBatching(conf.get_boolean("stars", "flag_star_batching", true));
 	setMagConverterMaxFov(conf.get_double("stars","mag_converter_max_fov",60.0));
 	setMagConverterMinFov(conf.get_double("stars","mag_converter_min_fov",0.1));
 	setMagConverterMagShift(conf.get_double("stars","mag_converter_mag_shift",0.0));
@@ -182,7 +205,10 @@ void Core::init(const InitParser& conf, const int viewW, const int viewH )
 	setFlagPlanets(conf.get_boolean("astro:flag_planets"));
 	setFlagPlanetsHints(conf.get_boolean("astro:flag_planets_hints"));
 	setFlagPlanetsOrbits(conf.get_boolean("astro:flag_planets_orbits"));
+	setOrbitSamplingThreads(conf.get_int("astro", "orbit_sampling_threads", -1));
 	setFlagLightTravelTime(conf.get_boolean("astro", "flag_light_travel_time", 0));
+	setFlagMinorBodies(conf.get_boolean("astro", "flag_minor_bodies", false));
+	setMinorBodyMaxMag(conf.get_double("astro", "minor_body_max_mag", 12));
 	setFlagPlanetsTrails(conf.get_boolean("astro", "flag_object_trails", false));
 	startPlanetsTrails(conf.get_boolean("astro", "flag_object_trails", false));
 	setFlagNebula(conf.get_boolean("astro:flag_nebula"));
@@ -256,6 +282,7 @@ void Core::init(const InitParser& conf, const int viewW, const int viewH )
 	int grid_level = hip_stars->getMaxGridLevel();
 	geodesic_grid = new GeodesicGrid(grid_level);
 	hip_stars->setGrid(geodesic_grid);
+	nebulas->setGrid(geodesic_grid);
 
 	FlagEnableZoomKeys	= conf.get_boolean("navigation:flag_enable_zoom_keys");
 	FlagEnableMoveKeys  = conf.get_boolean("navigation:flag_enable_move_keys");
@@ -300,6 +327,8 @@ void Core::init(const InitParser& conf, const int viewW, const int viewH )
 	setFlagFog(conf.get_boolean("landscape:flag_fog"));
 	setFlagAtmosphere(conf.get_boolean("landscape:flag_atmosphere"));
 	setAtmosphereFadeDuration(conf.get_double("landscape","atmosphere_fade_duration",1.5));
+	setAtmosphereResolution(conf.get_int("landscape", "atmosphere_resolution", 48));
+	setAtmosphereThreads(conf.get_int("landscape", "atmosphere_threads", -1));
 
 	// Viewing section
 	setFlagConstellationLines(		conf.get_boolean("viewing:flag_constellation_drawing"));
@@ -339,23 +368,38 @@ void Core::update(int delta_time)
    if( firstTime ) // Trystan 7-8-10: Do not update prior to Init. Causes intermittent problems at startup
       return;
 
-	// Update the position of observation and time etc...
-	observatory->update(delta_time);
-	navigation->update_time(delta_time);
+	ProfileScope updateScope(profiler, PROFILE_UPDATE);
 
-	// Position of sun and all the satellites (ie planets)
-	ssystem->computePositions(navigation->get_JDay(),
-	                          navigation->getHomePlanet());
+	{
+		ProfileScope scope(profiler, PROFILE_UPDATE_NAVIGATION);
+		// Update the position of observation and time etc...
+		observatory->update(delta_time);
+		navigation->update_time(delta_time);
+	}
 
-	// Transform matrices between coordinates systems
-	navigation->update_transform_matrices();
-	// Direction of vision
-	navigation->update_vision_vector(delta_time, selected_object);
-	// Field of view
-	projection->update_auto_zoom(delta_time, FlagManualZoom);
+	{
+		ProfileScope scope(profiler, PROFILE_UPDATE_SOLARSYSTEM);
+		// Position of sun and all the satellites (ie planets)
+		ssystem->computePositions(navigation->get_JDay(),
+		                          navigation->getHomePlanet());
+	}
+	profiler->setCounter(PROFILE_ORBIT_POINTS, getOrbitPointsLastFrame());
+
+	{
+		ProfileScope scope(profiler, PROFILE_UPDATE_NAVIGATION);
+		// Transform matrices between coordinates systems
+		navigation->update_transform_matrices();
+		// Direction of vision
+		navigation->update_vision_vector(delta_time, selected_object);
+		// Field of view
+		projection->update_auto_zoom(delta_time, FlagManualZoom);
+	}
 
-	// update faders and Planet trails (call after nav is updated)
-	ssystem->update(delta_time, navigation);
+	{
+		ProfileScope scope(profiler, PROFILE_UPDATE_SOLARSYSTEM);
+		// update faders and Planet trails (call after nav is updated)
+		ssystem->update(delta_time, navigation);
+	}
 
 	// Move the view direction and/or fov
 	updateMove(delta_time);
@@ -363,6 +407,7 @@ void Core::update(int delta_time)
 	// Update info about selected object
 	selected_object.update();
 
+	profiler->begin(PROFILE_UPDATE_FADERS);
 	// Update faders
 	equ_grid->update(delta_time);
 	azi_grid->update(delta_time);
@@ -380,6 +425,7 @@ void Core::update(int delta_time)
 	nebulas->update(delta_time);
 	cardinals_points->update(delta_time);
 	milky_way->update(delta_time);
+	profiler->end(PROFILE_UPDATE_FADERS);
 
 	// Compute the sun position in local coordinate
 	Vec3d temp(0.,0.,0.);
@@ -401,11 +447,13 @@ void Core::update(int delta_time)
 										navigation->get_dome_fixed_mat());
 
 	// Compute the atmosphere color and intensity
+	profiler->begin(PROFILE_UPDATE_ATMOSPHERE);
 	atmosphere->compute_color(navigation->get_JDay(), sunPos, moonPos,
 	                          ssystem->getMoon()->get_phase(ssystem->getEarth()->get_heliocentric_ecliptic_pos()),
 	                          tone_converter, projection, observatory->get_latitude(), observatory->get_altitude(),
 	                          15.f, 40.f);	// Temperature = 15c, relative humidity = 40%
 	tone_converter->set_world_adaptation_luminance(atmosphere->get_world_adaptation_luminance());
+	profiler->end(PROFILE_UPDATE_ATMOSPHERE);
 
 	sunPos.normalize();
 	moonPos.normalize();
@@ -437,6 +485,7 @@ void Core::update(int delta_time)
 // Execute all the drawing functions
 double Core::draw(int delta_time)
 {
+	ProfileScope drawScope(profiler, PROFILE_DRAW);
 
 	// Init openGL viewing with fov, screen size and clip planes
 	//	projection->set_clipping_planes(0.000001 ,50);
@@ -455,13 +504,19 @@ double Core::draw(int delta_time)
 	glBlendFunc(GL_ONE, GL_ONE);
 
 	// Draw the milky way.
+	profiler->begin(PROFILE_MILKY_WAY);
 	milky_way->draw(tone_converter, projection, navigation);
+	profiler->end(PROFILE_MILKY_WAY);
 
 	// Draw the nebula
+	profiler->begin(PROFILE_NEBULAE);
 	nebulas->draw(projection, navigation, tone_converter, getFlagAtmosphere() ? sky_brightness : 0);
+	profiler->end(PROFILE_NEBULAE);
 
 	// Draw all the constellations
+	profiler->begin(PROFILE_CONSTELLATIONS);
 	asterisms->draw(projection, navigation);
+	profiler->end(PROFILE_CONSTELLATIONS);
 
 	// Draw the hipparcos stars
 // for onscreen test with offset view
@@ -469,8 +524,11 @@ double Core::draw(int delta_time)
 //	Vec3d tempv;
 //	projection->unproject_j2000(center[0], center[1], tempv);
 //	Vec3f temp(tempv[0],tempv[1],tempv[2]);
+	profiler->begin(PROFILE_STARS);
 	hip_stars->draw(this, tone_converter, projection);
+	profiler->end(PROFILE_STARS);
 
+	profiler->begin(PROFILE_GRIDS);
 	// Draw the equatorial grid
 	equ_grid->draw(projection);
 
@@ -497,13 +555,16 @@ double Core::draw(int delta_time)
 
 	// Draw the meridian line
 	meridian_line->draw(projection, navigation);
+	profiler->end(PROFILE_GRIDS);
 
 	// Draw the planets
+	profiler->begin(PROFILE_PLANETS);
 	double squaredDistance = ssystem->draw(projection,
 	                                       navigation,
 	                                       tone_converter,
 	                                       getFlagPointStar(),
 	                                       aboveHomePlanet );
+	profiler->end(PROFILE_PLANETS);
 
 	// Draw the pointer on the currently selected object
 	// TODO: this would be improved if pointer was drawn at same time as object for correct depth in scene
@@ -513,6 +574,7 @@ double Core::draw(int delta_time)
 	navigation->switch_to_local();
 
 	// Update meteors
+	profiler->begin(PROFILE_METEORS);
 	meteors->update(projection, navigation, tone_converter, delta_time);
 
 	if (!aboveHomePlanet && (!getFlagAtmosphere() || sky_brightness<0.1)) {
@@ -520,23 +582,32 @@ double Core::draw(int delta_time)
 		meteors->draw(projection, navigation);
 		projection->reset_perspective_projection();
 	}
+	profiler->end(PROFILE_METEORS);
 
 	// Draw the atmosphere
+	profiler->begin(PROFILE_ATMOSPHERE);
 	atmosphere->draw(projection, delta_time);
+	profiler->end(PROFILE_ATMOSPHERE);
 
 	// Draw the landscape
+	profiler->begin(PROFILE_LANDSCAPE);
 	if (!aboveHomePlanet) // TODO decide if useful or too confusing to leave alone
 		landscape->draw(tone_converter, projection, navigation);
+	profiler->end(PROFILE_LANDSCAPE);
 
 	// Draw the cardinal points
 	//if (FlagCardinalPoints)
+	profiler->begin(PROFILE_CARDINALS);
 	cardinals_points->draw(projection, observatory->get_latitude());
+	profiler->end(PROFILE_CARDINALS);
 
 	// draw all loaded images, by a script or remote interface
+	profiler->begin(PROFILE_IMAGES);
 	projection->set_orthographic_projection();
 	ImageMgr::drawAll(navigation, projection);
 
 	projection->reset_perspective_projection();
+	profiler->end(PROFILE_IMAGES);
 
 	projection->draw_viewport_shape();
 
@@ -586,6 +657,7 @@ bool Core::loadLandscape(stringHash_t& param)
 //! Load a solar system body based on a hash of parameters mirroring the ssystem.ini file
 string Core::addSolarSystemBody(stringHash_t& param)
 {
+	invalidateNameIndex();
 	return ssystem->addBody(param);
 }
 
@@ -607,6 +679,7 @@ string Core::removeSolarSystemBody(string name)
 		//}
 	}
 
+	invalidateNameIndex();
 	return ssystem->removeBody(name);
 }
 
@@ -626,6 +699,7 @@ string Core::removeSupplementalSolarSystemBodies()
 	// Make sure not standing on an object we will delete!
 	const Planet *p = navigation->getHomePlanet();
 
+	invalidateNameIndex();
 	return ssystem->removeSupplementalBodies(p);
 
 }
@@ -757,7 +831,14 @@ bool Core::selectObject(const string &type, const string &id)
 //! Find and select an object near given equatorial position
 bool Core::findAndSelect(const Vec3d& pos)
 {
-	Object tempselect = clever_find(pos);
+	int minor_body;
+	Object tempselect = clever_find(pos, &minor_body);
+
+	// the minor body joins the solar system only now that it is selected
+	if (minor_body >= 0) {
+		Planet *promoted = ssystem->promoteMinorBody(minor_body);
+		if (promoted) tempselect = promoted;
+	}
 	return selectObject(tempselect);
 }
 
@@ -781,8 +862,11 @@ void Core::deselect(void)
 // and do not select hidden planets
 
 // Find an object in a "clever" way
-Object Core::clever_find(const Vec3d& v) const
+Object Core::clever_find(const Vec3d& v, int *minor_body) const
 {
+	if (minor_body) *minor_body = -1;
+	int minor = -1;
+
 	Object sobj;
 	Object default_object;
 	bool is_default_object = false;
@@ -814,6 +898,19 @@ Object Core::clever_find(const Vec3d& v) const
 			// should never get here
 			is_default_object = false;
 		}
+
+		// a minor body under the cursor is only made a Planet once selected,
+		// until then it competes by index
+		if (minor_body && !is_default_object) {
+			minor = ssystem->searchMinorBody(v, fov_around, navigation);
+			if (minor >= 0) {
+				Planet *promoted = ssystem->searchByEnglishName(ssystem->getMinorBodyName(minor));
+				if (promoted) {
+					candidates.push_back(promoted);
+					minor = -1;
+				}
+			}
+		}
 	}
 
 	// nebulas and stars used precessed equ coords
@@ -865,6 +962,17 @@ Object Core::clever_find(const Vec3d& v) const
 		iter++;
 	}
 
+	// scored as a planet
+	if (minor >= 0) {
+		projection->project_earth_equ(ssystem->getMinorBodyEarthEquPos(minor, navigation), winpos);
+		float distance = sqrt((xpos-winpos[0])*(xpos-winpos[0]) + (ypos-winpos[1])*(ypos-winpos[1]));
+		float mag = ssystem->getMinorBodyMag(minor) - (getFlagPlanetsHints() ? 15.f : 8.f);
+		if (distance + mag < best_object_value) {
+			*minor_body = minor;
+			return Object();
+		}
+	}
+
 // when large planet disk is hiding anything else
 	if (is_default_object && sobj.get_type()!=ObjectRecord::OBJECT_PLANET)
 		return default_object;
@@ -1025,6 +1133,7 @@ bool Core::setSkyCultureDir(const string& cultureDir)
 
 	// translate
 	hip_stars->updateI18n(skyTranslator);
+	invalidateNameIndex();
 
 	ObjectsState state;
 	strncpy( state.m_state.sky_culture, cultureDir.c_str(), sizeof(state.m_state.sky_culture) );
@@ -1067,6 +1176,7 @@ bool Core::loadSkyCulture(const string& culturePath)
 
 	// translate
 	hip_stars->updateI18n(skyTranslator);
+	invalidateNameIndex();
 
 	return 1;
 }
@@ -1114,6 +1224,7 @@ void Core::setSkyLanguage(const std::string& newSkyLocaleName)
 	ssystem->translateNames(skyTranslator);
 	nebulas->translateNames(skyTranslator);
 	hip_stars->updateI18n(skyTranslator);
+	invalidateNameIndex();
 
 	SettingsState state;
 	strcpy( state.m_state.sky_language, newSkyLocaleName.c_str() );
@@ -1461,6 +1572,21 @@ bool Core::selectObject(const Object &obj)
 //! @param maxNbItem the maximum number of returned object names
 //! @return a vector of matching object name by order of relevance, or an empty vector if nothing match
 vector<string> Core::listMatchingObjectsI18n(const string& objPrefix, unsigned int maxNbItem) const
+{
+	if (nameIndexDirty) {
+		nameIndex.clear();
+		ssystem->addNamesToIndex(nameIndex, navigation);
+		asterisms->addNamesToIndex(nameIndex);
+		nebulas->addNamesToIndex(nameIndex);
+		hip_stars->addNamesToIndex(nameIndex);
+		nameIndex.finalize();
+		nameIndexDirty = false;
+	}
+
+	return nameIndex.find(objPrefix, maxNbItem);
+}
+
+vector<string> Core::listMatchingObjectsI18nScan(const string& objPrefix, unsigned int maxNbItem) const
 {
 	vector<string> result;
 	vector <string>::const_iterator iter;
@@ -1494,6 +1620,103 @@ vector<string> Core::listMatchingObjectsI18n(const string& objPrefix, unsigned i
 	return result;
 }
 
+bool Core::benchmarkNameSearch(unsigned int maxNbItem, int repeat, ostream &os) const
+{
+	vector<string> prefixes;
+	for (char a='A'; a<='Z'; ++a) {
+		prefixes.push_back(string(1, a));
+		for (char b='A'; b<='Z'; ++b) prefixes.push_back(string(1, a) + b);
+	}
+
+	// Build the index outside of the timing
+	double t = FrameProfiler::getTime();
+	nameIndexDirty = true;
+	listMatchingObjectsI18n("", maxNbItem);
+	const double build = FrameProfiler::getTime() - t;
+
+	unsigned int found = 0, foundScan = 0;
+	t = FrameProfiler::getTime();
+	for (int r=0; r<repeat; ++r)
+		for (unsigned int i=0; i<prefixes.size(); ++i) found += listMatchingObjectsI18n(prefixes[i], maxNbItem).size();
+	const double indexed = FrameProfiler::getTime() - t;
+
+	t = FrameProfiler::getTime();
+	for (int r=0; r<repeat; ++r)
+		for (unsigned int i=0; i<prefixes.size(); ++i) foundScan += listMatchingObjectsI18nScan(prefixes[i], maxNbItem).size();
+	const double scanned = FrameProfiler::getTime() - t;
+
+	// The two searches rank and fold accents differently, so only compare
+	// whether they find something. Short queries are answered from the best
+	// names kept in each node, larger ones walk the subtree: both must agree.
+	unsigned int missed = 0, misranked = 0;
+	for (unsigned int i=0; i<prefixes.size(); ++i) {
+		const vector<string> top = listMatchingObjectsI18n(prefixes[i], maxNbItem);
+		vector<string> all = nameIndex.find(prefixes[i], NameIndex::TOP_K+1);
+		if (all.size() > top.size()) all.resize(top.size());
+		if (top.size() > maxNbItem || top != all) misranked++;
+		if (top.empty() && !listMatchingObjectsI18nScan(prefixes[i], maxNbItem).empty()) missed++;
+	}
+
+	const double queries = (double)prefixes.size() * repeat;
+	const bool passed = !missed && !misranked;
+	os << "Name search, " << queries << " queries of at most " << maxNbItem << " names" << endl
+	   << "  index: " << nameIndex.size() << " names built in " << build << " ms, "
+	   << indexed*1000./queries << " us/query, " << found << " results" << endl
+	   << "  scan:  " << scanned*1000./queries << " us/query, " << foundScan << " results" << endl
+	   << "  " << missed << " prefixes found by the scan only, " << misranked
+	   << " differing from a full search" << (passed ? " OK" : " FAIL") << endl;
+	return passed;
+}
+
+string Core::compareStarBatching(int tolerance)
+{
+	const int x = projection->getViewportPosX();
+	const int y = projection->getViewportPosY();
+	const int w = projection->getViewportWidth();
+	const int h = projection->getViewportHeight();
+	if (w <= 0 || h <= 0) return "Star batching: empty viewport\n";
+
+	// Twinkling is random per star, draw both passes without it
+	const bool old_batching = hip_stars->getFlagStarBatching();
+	const bool old_twinkle = hip_stars->getFlagTwinkle();
+	hip_stars->setFlagTwinkle(false);
+
+	vector<unsigned char> image[2];
+	double time[2];
+	for (int pass=0; pass<2; ++pass) {
+		hip_stars->setFlagStarBatching(pass == 1);
+		glClear(GL_COLOR_BUFFER_BIT);
+		glEnable(GL_BLEND);
+		const double t = FrameProfiler::getTime();
+		hip_stars->draw(this, tone_converter, projection);
+		glFinish();
+		time[pass] = FrameProfiler::getTime() - t;
+		image[pass].resize(w*h*3);
+		glPixelStorei(GL_PACK_ALIGNMENT, 1);
+		glReadPixels(x, y, w, h, GL_RGB, GL_UNSIGNED_BYTE, &image[pass][0]);
+	}
+
+	hip_stars->setFlagStarBatching(old_batching);
+	hip_stars->setFlagTwinkle(old_twinkle);
+
+	int max_diff = 0;
+	unsigned int over = 0, lit = 0;
+	for (int i=0; i<w*h; ++i) {
+		int diff = 0;
+		for (int c=0; c<3; ++c) diff = max(diff, abs((int)image[0][3*i+c] - (int)image[1][3*i+c]));
+		if (diff > tolerance) ++over;
+		if (image[0][3*i] || image[0][3*i+1] || image[0][3*i+2]) ++lit;
+		max_diff = max(max_diff, diff);
+	}
+
+	ostringstream os;
+	os << "Star batching, " << w << "x" << h << " viewport, " << lit << " lit pixels" << endl
+	   << "  immediate: " << time[0] << " ms, batched: " << time[1] << " ms" << endl
+	   << "  max channel difference " << max_diff << ", " << over
+	   << " pixels over tolerance " << tolerance << (over ? " FAIL" : " OK") << endl;
+	return os.str();
+}
+
 
 //! font file and scaling to use for a given locale
 void Core::getFontForLocale(const string &_locale, string &_fontFile, float &_fontScale,
@@ -1636,6 +1859,15 @@ bool Core::getFlagPointStar(void) const
 	return hip_stars->getFlagPointStar();
 }
 
+void Core::setFlagStarBatching(bool b)
+{
+	hip_stars->setFlagStarBatching(b);
+}
+bool Core::getFlagStarBatching(void) const
+{
+	return hip_stars->getFlagStarBatching();
+}
+
 void Core::setMaxMagStarName(float f)
 {
 	hip_stars->setMaxMagName(f);
@@ -1811,6 +2043,7 @@ bool Core::loadNebula(double ra, double de, double magnitude, double angular_siz
 	if(nebulas) {
 		created = nebulas->loadNebula(ra, de, magnitude, angular_size, rotation,
 									  name, filename, credit, texture_luminance_adjust, distance);
+		invalidateNameIndex();
 
 		if( created && updateSelection ) {
 			selected_object = nebulas->search(name);
@@ -1836,6 +2069,7 @@ string Core::removeNebula(const string& name)
 	}
 
 	string error = nebulas->removeNebula(name, true);
+	invalidateNameIndex();
 
 	// Try to find original version, if any
 	if( updateSelection ) selected_object = nebulas->search(name);
@@ -1855,6 +2089,7 @@ string Core::removeSupplementalNebulae()
 		unSelect();
 	}
 
+	invalidateNameIndex();
 	return nebulas->removeSupplementalNebulae();
 
 }
@@ -51,6 +51,8 @@
 #include "image_mgr.h"
 #include "callbacks.hpp"
 #include "geodesic_grid.h"
+#include "frame_profiler.h"
+#include "name_index.h"
 
 //!  @brief Main class for application core processing.
 //!
@@ -333,6 +335,29 @@ public:
 	//! @return a vector of matching object name by order of relevance, or an empty vector if nothing match
 	vector<string> listMatchingObjectsI18n(const string& objPrefix, unsigned int maxNbItem=5) const;
 
+	//! Same as listMatchingObjectsI18n but asking each manager in turn, without the name index
+	vector<string> listMatchingObjectsI18nScan(const string& objPrefix, unsigned int maxNbItem=5) const;
+
+	//! Time all one and two letter prefix searches through the name index and through the managers
+	//! @return false when the index misses names the managers find, or when the names kept
+	//! per node differ from a full search of the subtree
+	bool benchmarkNameSearch(unsigned int maxNbItem, int repeat, ostream &os) const;
+
+	//! Compare the scalar and batch projection of the current projector
+	//! @return false when they disagree, see Projector::compareBatchProjection
+	bool benchmarkProjection(unsigned int count, int repeat, ostream &os) const {
+		return projection->compareBatchProjection(count, repeat, os);
+	}
+
+	//! Draw the stars once immediate and once batched, and compare the two images
+	//! @param tolerance largest allowed difference per colour channel (0-255)
+	string compareStarBatching(int tolerance);
+
+	//! Rebuild the name index before the next search, after names or objects changed
+	void invalidateNameIndex(void) {
+		nameIndexDirty = true;
+	}
+
 	//! Return whether an object is currently selected
 	bool getFlagHasSelected(void) {
 		return selected_object;
@@ -535,6 +560,11 @@ public:
 	//! Get flag for displaying Star as GLpoints (faster but not so nice)
 	bool getFlagPointStar(void) const;
 
+	//! Set flag for drawing the stars of a frame as vertex array batches
+	void setFlagStarBatching(bool b);
+	//! Get flag for drawing the stars of a frame as vertex array batches
+	bool getFlagStarBatching(void) const;
+
 	//! Set maximum magnitude at which stars names are displayed
 	void setMaxMagStarName(float f);
 	//! Get maximum magnitude at which stars names are displayed
@@ -631,6 +661,39 @@ public:
 		return ssystem->getFlagOrbits();
 	}
 
+	//! Set number of threads computing orbit lines, <0 for automatic, 0 for none
+	void setOrbitSamplingThreads(int n) {
+		ssystem->setOrbitSamplingThreads(n);
+	}
+	//! Get number of orbit points computed during the previous frame
+	unsigned int getOrbitPointsLastFrame(void) const {
+		return ssystem->getOrbitPointsLastFrame();
+	}
+	//! Draw the orbit lines computed for the current date, waiting for them if needed
+	void setFlagWaitOrbitSamples(bool b) {
+		ssystem->setFlagWaitOrbitSamples(b);
+	}
+
+	//! Get the frame profiler timing the update and draw stages
+	FrameProfiler* getProfiler(void) {
+		return profiler;
+	}
+
+	//! Set/Get flag for displaying the minor body layer (asteroids and comets as points)
+	void setFlagMinorBodies(bool b) {
+		ssystem->setFlagMinorBodies(b);
+	}
+	bool getFlagMinorBodies(void) const {
+		return ssystem->getFlagMinorBodies();
+	}
+	//! Set/Get the faintest magnitude of the minor bodies drawn
+	void setMinorBodyMaxMag(float mag) {
+		ssystem->setMinorBodyMaxMag(mag);
+	}
+	float getMinorBodyMaxMag(void) const {
+		return ssystem->getMinorBodyMaxMag();
+	}
+
 	void setFlagLightTravelTime(bool b) {
 		ssystem->setFlagLightTravelTime(b);
 	}
@@ -1115,6 +1178,19 @@ public:
 		return atmosphere->getFadeDuration();
 	}
 
+	//! Set the atmosphere grid resolution, 0 to adapt it to the viewport
+	void setAtmosphereResolution(int r) {
+		atmosphere->setResolution(r);
+	}
+	int getAtmosphereResolution(void) const {
+		return atmosphere->getResolution();
+	}
+
+	//! Set number of threads computing the atmosphere, <0 for automatic, 0 for none
+	void setAtmosphereThreads(int n) {
+		atmosphere->setNbThreads(n);
+	}
+
 	//! Set light pollution limiting magnitude (naked eye)
 	void setLightPollutionLimitingMagnitude(float mag) {
 		lightPollutionLimitingMagnitude = mag;
@@ -1288,7 +1364,9 @@ private:
 	Object searchByNameI18n(const string &name) const;
 
 	//! Find in a "clever" way an object from its equatorial position
-	Object clever_find(const Vec3d& pos) const;
+	//! When minor_body is given, a minor body may be found: the Object is then
+	//! empty and *minor_body its index for SolarSystem::promoteMinorBody
+	Object clever_find(const Vec3d& pos, int *minor_body = NULL) const;
 
 	//! Find in a "clever" way an object from its screen position
 	Object clever_find(int x, int y) const;
@@ -1324,6 +1402,9 @@ private:
 	MeteorMgr * meteors;				// Manage meteor showers
 	Landscape * landscape;				// The landscape ie the fog, the ground and "decor"
 	ToneReproductor * tone_converter;	// Tones conversion between simulation world and display device
+	FrameProfiler * profiler;			// Time spent in each stage of update and draw
+	mutable NameIndex nameIndex;		// Names of all searchable objects
+	mutable bool nameIndexDirty;		// Rebuilt lazily by the next search
 	SkyLocalizer *skyloc;				// for sky cultures and locales
 	class TelescopeMgr *telescope_mgr;
 
@@ -37,6 +37,11 @@ CustomProjector::CustomProjector(const Vec4i& viewport, double _fov)
 	                   0., 0., 0., 1.);
 }
 
+CustomProjector::~CustomProjector()
+{
+	clearSphereMeshes();
+}
+
 // Init the viewing matrix, setting the field of view, the clipping planes, and screen ratio
 // The function is a reimplementation of glOrtho
 void CustomProjector::init_project_matrix(void)
@@ -72,43 +77,35 @@ void CustomProjector::oVertex3(double x, double y, double z, const Mat4d& mat) c
 }
 
 
-void CustomProjector::sSphere(GLdouble radius, GLdouble one_minus_oblateness,
-                              GLint slices, GLint stacks,
-                              const Mat4d& mat, int orient_inside) const
-{
-	glPushMatrix();
-	glLoadMatrixd(mat);
+// Maximum number of cached sphere shapes, planets alone use a few dozen
+#define MAX_SPHERE_MESHES 64
 
-	// It is really good for performance to have Vec4f,Vec3f objects
-	// static rather than on the stack. But why?
-	// Is the constructor/destructor so expensive?
-	static Vec4f lightPos4;
-	static Vec3f lightPos3;
-	GLboolean isLightOn;
-	static Vec3f transNorm;
-	float c;
+bool CustomProjector::SphereKey::operator<(const SphereKey& k) const
+{
+	if (slices != k.slices) return slices < k.slices;
+	if (stacks != k.stacks) return stacks < k.stacks;
+	if (orient_inside != k.orient_inside) return orient_inside < k.orient_inside;
+	if (one_minus_oblateness != k.one_minus_oblateness) return one_minus_oblateness < k.one_minus_oblateness;
+	if (rho0 != k.rho0) return rho0 < k.rho0;
+	return drho < k.drho;
+}
 
-	static Vec4f ambientLight;
-	static Vec4f diffuseLight;
+// Build the sphere in model coordinates as the immediate mode version
+// did, rows of slices+1 vertices from rho0 down by drho
+const CustomProjector::SphereMesh& CustomProjector::getSphereMesh(const SphereKey& key) const
+{
+	std::map<SphereKey, SphereMesh*>::const_iterator it = sphereMeshes.find(key);
+	if (it != sphereMeshes.end()) return *it->second;
 
-	glGetBooleanv(GL_LIGHTING, &isLightOn);
+	if (sphereMeshes.size() >= MAX_SPHERE_MESHES) clearSphereMeshes();
 
-	if (isLightOn) {
-		glGetLightfv(GL_LIGHT0, GL_POSITION, lightPos4);
-		lightPos3 = lightPos4;
-		lightPos3 -= mat * Vec3d(0.,0.,0.); // -posCenterEye
-		lightPos3.normalize();
-		glGetLightfv(GL_LIGHT0, GL_AMBIENT, ambientLight);
-		glGetLightfv(GL_LIGHT0, GL_DIFFUSE, diffuseLight);
-		glDisable(GL_LIGHTING);
-	}
+	SphereMesh *mesh = new SphereMesh;
+	sphereMeshes[key] = mesh;
 
-	GLfloat x, y, z;
 	GLfloat s, t;
-	GLint i, j;
 	GLfloat nsign;
 
-	if (orient_inside) {
+	if (key.orient_inside) {
 		nsign = -1.0;
 		t=0.0; // from inside texture is reversed
 	} else {
@@ -116,110 +113,80 @@ void CustomProjector::sSphere(GLdouble radius, GLdouble one_minus_oblateness,
 		t=1.0;
 	}
 
-	const GLfloat drho = M_PI / (GLfloat) stacks;
-	double cos_sin_rho[2*(stacks+1)];
-	double *cos_sin_rho_p = cos_sin_rho;
-	for (i = 0; i <= stacks; i++) {
-		double rho = i * drho;
-		*cos_sin_rho_p++ = cos(rho);
-		*cos_sin_rho_p++ = sin(rho);
-	}
-
-	const GLfloat dtheta = 2.0 * M_PI / (GLfloat) slices;
-	double cos_sin_theta[2*(slices+1)];
-	double *cos_sin_theta_p = cos_sin_theta;
-	for (i = 0; i <= slices; i++) {
-		double theta = (i == slices) ? 0.0 : i * dtheta;
-		*cos_sin_theta_p++ = cos(theta);
-		*cos_sin_theta_p++ = sin(theta);
-	}
-
 	// texturing: s goes from 0.0/0.25/0.5/0.75/1.0 at +y/+x/-y/-x/+y axis
 	// t goes from -1.0/+1.0 at z = -radius/+radius (linear along longitudes)
-	// cannot use triangle fan on texturing (s coord. at top/bottom tip varies)
-	const GLfloat ds = 1.0 / slices;
-	const GLfloat dt = nsign / stacks; // from inside texture is reversed
-
-
-	// draw intermediate  as quad strips
-	for (i = 0,cos_sin_rho_p = cos_sin_rho; i < stacks;
-	        i++,cos_sin_rho_p+=2) {
-		glBegin(GL_QUAD_STRIP);
+	const GLfloat dtheta = 2.0 * M_PI / (GLfloat) key.slices;
+	const GLfloat ds = 1.0 / key.slices;
+	const GLfloat dt = nsign / key.stacks; // from inside texture is reversed
+	const double omo = key.one_minus_oblateness;
+
+	for (int i = 0; i <= key.stacks; i++) {
+		const double rho = key.rho0 + i * key.drho;
+		const double cos_rho = cos(rho);
+		const double sin_rho = sin(rho);
 		s = 0.0;
-		for (j = 0,cos_sin_theta_p = cos_sin_theta; j <= slices;
-		        j++,cos_sin_theta_p+=2) {
-			x = -cos_sin_theta_p[1] * cos_sin_rho_p[1];
-			y = cos_sin_theta_p[0] * cos_sin_rho_p[1];
-			z = nsign * cos_sin_rho_p[0];
-			glTexCoord2f(s, t);
-			if (isLightOn) {
-				transNorm = mat.multiplyWithoutTranslation(
-				                Vec3d(x * one_minus_oblateness * nsign,
-				                      y * one_minus_oblateness * nsign,
-				                      z * nsign));
-				c = lightPos3.dot(transNorm);
-				if (c<0) c=0;
-				glColor3f(c*diffuseLight[0] + ambientLight[0],
-				          c*diffuseLight[1] + ambientLight[1],
-				          c*diffuseLight[2] + ambientLight[2]);
-			}
-			sVertex3(x * radius, y * radius, z * one_minus_oblateness * radius, mat);
-			x = -cos_sin_theta_p[1] * cos_sin_rho_p[3];
-			y = cos_sin_theta_p[0] * cos_sin_rho_p[3];
-			z = nsign * cos_sin_rho_p[2];
-			glTexCoord2f(s, t - dt);
-			if (isLightOn) {
-				transNorm = mat.multiplyWithoutTranslation(
-				                Vec3d(x * one_minus_oblateness * nsign,
-				                      y * one_minus_oblateness * nsign,
-				                      z * nsign));
-				c = lightPos3.dot(transNorm);
-				if (c<0) c=0;
-				glColor3f(c*diffuseLight[0] + ambientLight[0],
-				          c*diffuseLight[1] + ambientLight[1],
-				          c*diffuseLight[2] + ambientLight[2]);
-			}
-			sVertex3(x * radius, y * radius, z * one_minus_oblateness * radius, mat);
+		for (int j = 0; j <= key.slices; j++) {
+			const double theta = (j == key.slices) ? 0.0 : j * dtheta;
+			const GLfloat x = -sin(theta) * sin_rho;
+			const GLfloat y = cos(theta) * sin_rho;
+			const GLfloat z = nsign * cos_rho;
+
+			mesh->dir.push_back(x);
+			mesh->dir.push_back(y);
+			mesh->dir.push_back(z);
+			mesh->pos.push_back(x);
+			mesh->pos.push_back(y);
+			mesh->pos.push_back(z * omo);
+			mesh->normal.push_back(x * omo * nsign);
+			mesh->normal.push_back(y * omo * nsign);
+			mesh->normal.push_back(z * nsign);
+			mesh->texcoord.push_back(s);
+			mesh->texcoord.push_back(t);
 			s += ds;
 		}
-		glEnd();
 		t -= dt;
 	}
-	glPopMatrix();
-	if (isLightOn) glEnable(GL_LIGHTING);
-}
-
 
+	// the quads of the former quad strips, with the same orientation
+	const unsigned int row = key.slices + 1;
+	for (int i = 0; i < key.stacks; i++) {
+		for (int j = 0; j < key.slices; j++) {
+			const unsigned int a = i * row + j;
+			const unsigned int b = a + row;
+			mesh->index.push_back(a);
+			mesh->index.push_back(b);
+			mesh->index.push_back(b + 1);
+			mesh->index.push_back(a);
+			mesh->index.push_back(b + 1);
+			mesh->index.push_back(a + 1);
+		}
+	}
 
-// save on spherical texture sizes since a lot is transparent
-// Draw only a partial sphere with top and/or bottom missing
+	return *mesh;
+}
 
-// bottom_altitude is angle above (- for below) horizon for bottom of texture
-// top_altitude is altitude angle for top of texture
-// both are in degrees
+void CustomProjector::clearSphereMeshes(void) const
+{
+	std::map<SphereKey, SphereMesh*>::iterator it;
+	for (it = sphereMeshes.begin(); it != sphereMeshes.end(); ++it) {
+		delete it->second;
+	}
+	sphereMeshes.clear();
+}
 
-void CustomProjector::sPartialSphere(GLdouble radius, GLdouble one_minus_oblateness,
-                                     GLint slices, GLint stacks,
-                                     const Mat4d& mat, int orient_inside,
-                                     double bottom_altitude, double top_altitude ) const
+// Project all the vertices of a sphere in one batch, then bring them back
+// in model coordinates as sVertex3 does and submit them as a vertex array
+void CustomProjector::drawSphereMesh(const SphereMesh& mesh, double radius, double color_radius,
+                                     const Mat4d& mat, bool shader) const
 {
 	glPushMatrix();
 	glLoadMatrixd(mat);
 
-	// It is really good for performance to have Vec4f,Vec3f objects
-	// static rather than on the stack. But why?
-	// Is the constructor/destructor so expensive?
-	static Vec4f lightPos4;
-	static Vec3f lightPos3;
+	Vec4f lightPos4;
+	Vec3f lightPos3;
 	GLboolean isLightOn;
-	static Vec3f transNorm;
-	float c;
-
-	static Vec4f ambientLight;
-	static Vec4f diffuseLight;
-
-	double bottom = M_PI / 180. * bottom_altitude;
-	double angular_height = M_PI / 180. * top_altitude - bottom;
+	Vec4f ambientLight;
+	Vec4f diffuseLight;
 
 	glGetBooleanv(GL_LIGHTING, &isLightOn);
 
@@ -233,92 +200,130 @@ void CustomProjector::sPartialSphere(GLdouble radius, GLdouble one_minus_oblaten
 		glDisable(GL_LIGHTING);
 	}
 
-	GLfloat x, y, z;
-	GLfloat s, t;
-	GLint i, j;
-	GLfloat nsign;
+	const unsigned int n = mesh.texcoord.size() / 2;
+	const double *pos = &mesh.pos[0];
 
-	if (orient_inside) {
-		nsign = -1.0;
-		t=0.0; // from inside texture is reversed
-	} else {
-		nsign = 1.0;
-		t=1.0;
+	sphereBatch.resize(n);
+	for (unsigned int i = 0; i < n; i++, pos += 3) {
+		sphereBatch.x[i] = pos[0] * radius;
+		sphereBatch.y[i] = pos[1] * radius;
+		sphereBatch.z[i] = pos[2] * radius;
+	}
+	project_custom_batch(sphereBatch, mat);
+
+	// gluUnProject with the matrix inverted once for all the vertices
+	const Mat4d inv = (mat_projection * mat).inverse();
+	sphereVertices.resize(3 * n);
+	for (unsigned int i = 0; i < n; i++) {
+		const Vec4d in((sphereBatch.win_x[i] - vec_viewport[0]) * 2. / vec_viewport[2] - 1.,
+		               (sphereBatch.win_y[i] - vec_viewport[1]) * 2. / vec_viewport[3] - 1.,
+		               2. * sphereBatch.win_z[i] - 1.,
+		               1.);
+		const Vec4d out = inv * in;
+		if (out[3] == 0.) {
+			// left unchanged, as by a failed gluUnProject
+			sphereVertices[3*i] = sphereBatch.x[i];
+			sphereVertices[3*i+1] = sphereBatch.y[i];
+			sphereVertices[3*i+2] = sphereBatch.z[i];
+		} else {
+			sphereVertices[3*i] = out[0] / out[3];
+			sphereVertices[3*i+1] = out[1] / out[3];
+			sphereVertices[3*i+2] = out[2] / out[3];
+		}
 	}
 
-	const GLfloat drho = angular_height / (GLfloat) stacks;
-	double cos_sin_rho[2*(stacks+1)];
-	double *cos_sin_rho_p = cos_sin_rho;
-	for (i = 0; i <= stacks; i++) {
-		double rho = M_PI_2 + bottom + i * drho;
-		*cos_sin_rho_p++ = cos(rho);
-		*cos_sin_rho_p++ = sin(rho);
+	if (isLightOn) {
+		sphereColors.resize(3 * n);
+		for (unsigned int i = 0; i < n; i++) {
+			float *color = &sphereColors[3*i];
+			if (shader) {
+				//Ljubov: something for shaders
+				color[0] = mesh.pos[3*i] * color_radius;
+				color[1] = mesh.pos[3*i+1] * color_radius;
+				color[2] = mesh.pos[3*i+2] * color_radius;
+			} else {
+				const float *normal = &mesh.normal[3*i];
+				const Vec3f transNorm = mat.multiplyWithoutTranslation(Vec3d(normal[0], normal[1], normal[2]));
+				float c = lightPos3.dot(transNorm);
+				if (c<0) c=0;
+				color[0] = c*diffuseLight[0] + ambientLight[0];
+				color[1] = c*diffuseLight[1] + ambientLight[1];
+				color[2] = c*diffuseLight[2] + ambientLight[2];
+			}
+		}
 	}
 
-	const GLfloat dtheta = 2.0 * M_PI / (GLfloat) slices;
-	double cos_sin_theta[2*(slices+1)];
-	double *cos_sin_theta_p = cos_sin_theta;
-	for (i = 0; i <= slices; i++) {
-		double theta = (i == slices) ? 0.0 : i * dtheta;
-		*cos_sin_theta_p++ = cos(theta);
-		*cos_sin_theta_p++ = sin(theta);
+	glEnableClientState(GL_VERTEX_ARRAY);
+	glVertexPointer(3, GL_DOUBLE, 0, &sphereVertices[0]);
+	glEnableClientState(GL_TEXTURE_COORD_ARRAY);
+	glTexCoordPointer(2, GL_FLOAT, 0, &mesh.texcoord[0]);
+	if (shader) {
+		glEnableClientState(GL_NORMAL_ARRAY);
+		glNormalPointer(GL_FLOAT, 0, &mesh.dir[0]);
+	}
+	if (isLightOn) {
+		glEnableClientState(GL_COLOR_ARRAY);
+		glColorPointer(3, GL_FLOAT, 0, &sphereColors[0]);
 	}
 
-	// texturing: s goes from 0.0/0.25/0.5/0.75/1.0 at +y/+x/-y/-x/+y axis
-	// t goes from -1.0/+1.0 at z = -radius/+radius (linear along longitudes)
-	// cannot use triangle fan on texturing (s coord. at top/bottom tip varies)
-	const GLfloat ds = 1.0 / slices;
-	const GLfloat dt = nsign / stacks; // from inside texture is reversed
+	glDrawElements(GL_TRIANGLES, mesh.index.size(), GL_UNSIGNED_INT, &mesh.index[0]);
 
+	glDisableClientState(GL_VERTEX_ARRAY);
+	glDisableClientState(GL_TEXTURE_COORD_ARRAY);
+	if (shader) glDisableClientState(GL_NORMAL_ARRAY);
+	if (isLightOn) glDisableClientState(GL_COLOR_ARRAY);
+
+	// leave the current color and normal of the last vertex, as before
+	if (shader) glNormal3fv(&mesh.dir[3*(n-1)]);
+	if (isLightOn) glColor3fv(&sphereColors[3*(n-1)]);
 
-	// draw intermediate  as quad strips
-	for (i = 0,cos_sin_rho_p = cos_sin_rho; i < stacks;
-	        i++,cos_sin_rho_p+=2) {
-		glBegin(GL_QUAD_STRIP);
-		s = 0.0;
-		for (j = 0,cos_sin_theta_p = cos_sin_theta; j <= slices;
-		        j++,cos_sin_theta_p+=2) {
-			x = -cos_sin_theta_p[1] * cos_sin_rho_p[1];
-			y = cos_sin_theta_p[0] * cos_sin_rho_p[1];
-			z = nsign * cos_sin_rho_p[0];
-			glTexCoord2f(s, t);
-			if (isLightOn) {
-				transNorm = mat.multiplyWithoutTranslation(
-				                Vec3d(x * one_minus_oblateness * nsign,
-				                      y * one_minus_oblateness * nsign,
-				                      z * nsign));
-				c = lightPos3.dot(transNorm);
-				if (c<0) c=0;
-				glColor3f(c*diffuseLight[0] + ambientLight[0],
-				          c*diffuseLight[1] + ambientLight[1],
-				          c*diffuseLight[2] + ambientLight[2]);
-			}
-			sVertex3(x * radius, y * radius, z * one_minus_oblateness * radius, mat);
-			x = -cos_sin_theta_p[1] * cos_sin_rho_p[3];
-			y = cos_sin_theta_p[0] * cos_sin_rho_p[3];
-			z = nsign * cos_sin_rho_p[2];
-			glTexCoord2f(s, t - dt);
-			if (isLightOn) {
-				transNorm = mat.multiplyWithoutTranslation(
-				                Vec3d(x * one_minus_oblateness * nsign,
-				                      y * one_minus_oblateness * nsign,
-				                      z * nsign));
-				c = lightPos3.dot(transNorm);
-				if (c<0) c=0;
-				glColor3f(c*diffuseLight[0] + ambientLight[0],
-				          c*diffuseLight[1] + ambientLight[1],
-				          c*diffuseLight[2] + ambientLight[2]);
-			}
-			sVertex3(x * radius, y * radius, z * one_minus_oblateness * radius, mat);
-			s += ds;
-		}
-		glEnd();
-		t -= dt;
-	}
 	glPopMatrix();
 	if (isLightOn) glEnable(GL_LIGHTING);
 }
 
+void CustomProjector::sSphere(GLdouble radius, GLdouble scale, GLdouble one_minus_oblateness,
+                              GLint slices, GLint stacks,
+                              const Mat4d& mat, int orient_inside, bool shader) const
+{
+	SphereKey key;
+	key.slices = slices;
+	key.stacks = stacks;
+	key.orient_inside = orient_inside;
+	key.one_minus_oblateness = one_minus_oblateness;
+	key.rho0 = 0.;
+	key.drho = (GLfloat)(M_PI / (GLfloat) stacks);
+
+	drawSphereMesh(getSphereMesh(key), radius * scale, radius, mat, shader);
+}
+
+
+
+// save on spherical texture sizes since a lot is transparent
+// Draw only a partial sphere with top and/or bottom missing
+
+// bottom_altitude is angle above (- for below) horizon for bottom of texture
+// top_altitude is altitude angle for top of texture
+// both are in degrees
+
+void CustomProjector::sPartialSphere(GLdouble radius, GLdouble one_minus_oblateness,
+                                     GLint slices, GLint stacks,
+                                     const Mat4d& mat, int orient_inside,
+                                     double bottom_altitude, double top_altitude ) const
+{
+	double bottom = M_PI / 180. * bottom_altitude;
+	double angular_height = M_PI / 180. * top_altitude - bottom;
+
+	SphereKey key;
+	key.slices = slices;
+	key.stacks = stacks;
+	key.orient_inside = orient_inside;
+	key.one_minus_oblateness = one_minus_oblateness;
+	key.rho0 = M_PI_2 + bottom;
+	key.drho = (GLfloat)(angular_height / (GLfloat) stacks);
+
+	drawSphereMesh(getSphereMesh(key), radius, radius, mat, false);
+}
+
 // Reimplementation of gluCylinder : glu is overrided for non standard projection
 void CustomProjector::sCylinder(GLdouble radius, GLdouble height, GLint slices, GLint stacks,
                                 const Mat4d& mat, int orient_inside) const
@@ -26,6 +26,8 @@
 #ifndef _CUSTOM_PROJECTOR_H_
 #define _CUSTOM_PROJECTOR_H_
 
+#include <map>
+#include <vector>
 #include "projector.h"
 
 // Class which handle projection modes and projection matrix
@@ -34,11 +36,13 @@ class CustomProjector : public Projector
 {
 protected:
 	CustomProjector(const Vec4i& viewport, double _fov = 175.);
+public:
+	virtual ~CustomProjector();
 private:
 	// Reimplementation of gluSphere : glu is overrided for non standard projection
-	void sSphere(GLdouble radius, GLdouble one_minus_oblateness,
+	void sSphere(GLdouble radius, GLdouble scale, GLdouble one_minus_oblateness,
 	             GLint slices, GLint stacks,
-	             const Mat4d& mat, int orient_inside = 0) const;
+	             const Mat4d& mat, int orient_inside = 0, bool shader = false) const;
 
 	// Draw only a partial sphere with top and/or bottom missing
 	void sPartialSphere(GLdouble radius, GLdouble one_minus_oblateness,
@@ -55,6 +59,31 @@ private:
 	void oVertex3(double x, double y, double z, const Mat4d& mat) const;
 
 	const Vec3d convert_pos(const Vec3d& v, const Mat4d& mat) const;
+
+	// Sphere geometry before projection, only the projection of its
+	// vertices changes from frame to frame
+	struct SphereKey {
+		int slices, stacks, orient_inside;
+		double one_minus_oblateness;
+		double rho0, drho;			// latitude rings, from the +z pole
+		bool operator<(const SphereKey& k) const;
+	};
+	struct SphereMesh {
+		std::vector<double> pos;		// unit sphere with oblateness applied
+		std::vector<float> dir;			// unit sphere, also normals for shaders
+		std::vector<float> normal;		// lighting normals
+		std::vector<float> texcoord;
+		std::vector<unsigned int> index;	// two triangles per quad
+	};
+	const SphereMesh& getSphereMesh(const SphereKey& key) const;
+	void clearSphereMeshes(void) const;
+	void drawSphereMesh(const SphereMesh& mesh, double radius, double color_radius,
+	                    const Mat4d& mat, bool shader) const;
+
+	mutable std::map<SphereKey, SphereMesh*> sphereMeshes;
+	mutable ProjectionBatch sphereBatch;
+	mutable std::vector<double> sphereVertices;
+	mutable std::vector<float> sphereColors;
 protected:
 	// Init the viewing matrix from the fov, the clipping planes and screen ratio
 	// The function is a reimplementation of gluPerspective
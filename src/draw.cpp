@@ -39,15 +39,19 @@ SkyGrid::SkyGrid(SKY_GRID_TYPE grid_type, unsigned int _nb_meridian, unsigned in
 	switch (grid_type) {
 	case ALTAZIMUTAL :
 		proj_func = &Projector::project_local;
+		proj_batch_func = &Projector::project_local_batch;
 		break;
 	case EQUATORIAL :
 		proj_func = &Projector::project_earth_equ;
+		proj_batch_func = &Projector::project_earth_equ_batch;
 		break;
 	case GALACTIC :
 		proj_func = &Projector::project_galactic;
+		proj_batch_func = &Projector::project_galactic_batch;
 		break;
 	default :
 		proj_func = &Projector::project_earth_equ;
+		proj_batch_func = &Projector::project_earth_equ_batch;
 	}
 
 	// Alt points are the points to draw along the meridian
@@ -71,6 +75,15 @@ SkyGrid::SkyGrid(SKY_GRID_TYPE grid_type, unsigned int _nb_meridian, unsigned in
 			azi_points[np][i] *= radius;
 		}
 	}
+
+	// The grid never moves in its own frame, so the batch input is set once
+	batch.resize(nb_meridian*(nb_alt_segment+1) + nb_parallel*(nb_azi_segment+1));
+	for (unsigned int nm=0; nm<nb_meridian; ++nm)
+		for (unsigned int i=0; i<nb_alt_segment+1; ++i)
+			batch.set(altIndex(nm, i), alt_points[nm][i]);
+	for (unsigned int np=0; np<nb_parallel; ++np)
+		for (unsigned int i=0; i<nb_azi_segment+1; ++i)
+			batch.set(aziIndex(np, i), azi_points[np][i]);
 }
 
 SkyGrid::~SkyGrid()
@@ -107,13 +120,15 @@ void SkyGrid::draw(const Projector* prj) const
 	Vec3d pt1;
 	Vec3d pt2;
 
+	(prj->*proj_batch_func)(batch);
+
 	prj->set_orthographic_projection();	// set 2D coordinate
 
 	// Draw meridians
 	for (unsigned int nm=0; nm<nb_meridian; ++nm) {
 		if (transparent_top) {	// Transparency for the first and last points
-			if ((prj->*proj_func)(alt_points[nm][0], pt1) &&
-				(prj->*proj_func)(alt_points[nm][1], pt2) ) {
+			if (getProjected(altIndex(nm, 0), pt1) &&
+				getProjected(altIndex(nm, 1), pt2) ) {
 				glColor4f(color[0],color[1],color[2],0.f);
 
 				glBegin (GL_LINES);
@@ -126,8 +141,8 @@ void SkyGrid::draw(const Projector* prj) const
 			glColor4f(color[0],color[1],color[2],fader.getInterstate());
 
 			for (unsigned int i=1; i<nb_alt_segment-1; ++i) {
-				if ((prj->*proj_func)(alt_points[nm][i], pt1) &&
-					(prj->*proj_func)(alt_points[nm][i+1], pt2) ) {
+				if (getProjected(altIndex(nm, i), pt1) &&
+					getProjected(altIndex(nm, i+1), pt2) ) {
 					glBegin(GL_LINES);
 					glVertex2f(pt1[0],pt1[1]);
 					glVertex2f(pt2[0],pt2[1]);
@@ -210,8 +225,8 @@ void SkyGrid::draw(const Projector* prj) const
 
 			}
 
-			if ((prj->*proj_func)(alt_points[nm][nb_alt_segment-1], pt1) &&
-				(prj->*proj_func)(alt_points[nm][nb_alt_segment], pt2) ) {
+			if (getProjected(altIndex(nm, nb_alt_segment-1), pt1) &&
+				getProjected(altIndex(nm, nb_alt_segment), pt2) ) {
 				glColor4f(color[0],color[1],color[2],fader.getInterstate());
 				glBegin (GL_LINES);
 				glVertex2f(pt1[0],pt1[1]);
@@ -223,8 +238,8 @@ void SkyGrid::draw(const Projector* prj) const
 		} else {
 			glColor4f(color[0],color[1],color[2],fader.getInterstate());
 			for (unsigned int i=0; i<nb_alt_segment; ++i) {
-				if ((prj->*proj_func)(alt_points[nm][i], pt1) &&
-					(prj->*proj_func)(alt_points[nm][i+1], pt2) ) {
+				if (getProjected(altIndex(nm, i), pt1) &&
+					getProjected(altIndex(nm, i+1), pt2) ) {
 					glBegin (GL_LINES);
 					glVertex2f(pt1[0],pt1[1]);
 					glVertex2f(pt2[0],pt2[1]);
@@ -238,8 +253,8 @@ void SkyGrid::draw(const Projector* prj) const
 	glColor4f(color[0],color[1],color[2],fader.getInterstate());
 	for (unsigned int np=0; np<nb_parallel; ++np) {
 		for (unsigned int i=0; i<nb_azi_segment; ++i) {
-			if ((prj->*proj_func)(azi_points[np][i], pt1) &&
-				(prj->*proj_func)(azi_points[np][i+1], pt2) ) {
+			if (getProjected(aziIndex(np, i), pt1) &&
+				getProjected(aziIndex(np, i+1), pt2) ) {
 				glBegin (GL_LINES);
 				glVertex2f(pt1[0],pt1[1]);
 				glVertex2f(pt2[0],pt2[1]);
@@ -264,30 +279,38 @@ SkyLine::SkyLine(SKY_LINE_TYPE _line_type, double _radius, unsigned int _nb_segm
 	switch (line_type) {
 	case LOCAL :
 		proj_func = &Projector::project_local;
+		proj_batch_func = &Projector::project_local_batch;
 		break;
 	case MERIDIAN :
 		proj_func = &Projector::project_local;
+		proj_batch_func = &Projector::project_local_batch;
 		inclination = 90;
 		break;
 	case ECLIPTIC :
 		proj_func = &Projector::project_j2000;
+		proj_batch_func = &Projector::project_j2000_batch;
 		inclination = 23.4392803055555555556;
 		break;
 	case PRECESSION :
 		proj_func = &Projector::project_j2000;
+		proj_batch_func = &Projector::project_j2000_batch;
 		inclination = 23.4392803055555555556;
 		break;
 	case EQUATOR :
 		proj_func = &Projector::project_earth_equ;
+		proj_batch_func = &Projector::project_earth_equ_batch;
 		break;
 	case CIRCUMPOLAR :
 		proj_func = &Projector::project_earth_equ;
+		proj_batch_func = &Projector::project_earth_equ_batch;
 		break;
 	case TROPIC :
 		proj_func = &Projector::project_earth_equ;
+		proj_batch_func = &Projector::project_earth_equ_batch;
 		break;
 	default :
 		proj_func = &Projector::project_earth_equ;
+		proj_batch_func = &Projector::project_earth_equ_batch;
 	}
 
 	Mat4f rotation = Mat4f::xrotation(inclination*M_PI/180.f);
@@ -364,14 +387,18 @@ void SkyLine::draw(const Projector *prj,const Navigator *nav) const
 		// start labeling from the vernal equinox
 		//	  const double corr = draw_labels ? (atan2(m.r[4],m.r[0]) - 3*M_PI/6) : 0.0;
 		const double corr = draw_labels ? (atan2(m.r[4],m.r[0]) - 2.68*M_PI/6) : 0.0;
-		Vec3d point(radius*cos(corr),radius*sin(corr),0.0);
-		point.transfo4d(m);
-		bool prev_on_screen = prj->project_earth_equ(point,pt1);
-		for (unsigned int i=1; i<nb_segment+1; ++i) {
+		batch.resize(nb_segment+1);
+		for (unsigned int i=0; i<nb_segment+1; ++i) {
 			const double phi = corr+2*i*M_PI/nb_segment;
 			Vec3d point(radius*cos(phi),radius*sin(phi),0.0);
 			point.transfo4d(m);
-			const bool on_screen = prj->project_earth_equ(point,pt2);
+			batch.set(i, point);
+		}
+		prj->project_earth_equ_batch(batch);
+
+		bool prev_on_screen = getProjected(0, pt1);
+		for (unsigned int i=1; i<nb_segment+1; ++i) {
+			const bool on_screen = getProjected(i, pt2);
 			if (on_screen && prev_on_screen) {
 				const double dx = pt2[0]-pt1[0];
 				const double dy = pt2[1]-pt1[1];
@@ -496,26 +523,49 @@ void SkyLine::draw(const Projector *prj,const Navigator *nav) const
 				
 	} else {
 
+		// Not valid on non-planets
+		const bool tropic_valid = line_type == TROPIC &&
+		                          !(nav->getHomePlanet()->isSatellite()) &&
+		                          nav->getHomePlanet()->getEnglishName() != "Sun";
+		unsigned int nb_points = nb_segment+1;
+
+		// Tropic and circumpolar circles depend on the home planet and
+		// latitude, regenerate them once per frame
+		if (tropic_valid) {
+			inclination=nav->getHomePlanet()->getAxialTilt()*M_PI/180.;
+			for (unsigned int j=0; j<nb_segment+1; ++j) {
+				sphe_to_rect((float)j/(nb_segment)*2.f*M_PI, inclination, points[j+nb_segment+1]);
+				points[j+nb_segment+1] *= radius;
+				sphe_to_rect((float)j/(nb_segment)*2.f*M_PI, -inclination, points[j+2*nb_segment+2]);
+				points[j+2*nb_segment+2] *= radius;
+			}
+			nb_points = 3*nb_segment+3;
+		} else if (line_type == CIRCUMPOLAR) {
+			inclination=(90.0-abs(nav->get_latitude()))*M_PI/180.;
+			if (nav->get_latitude()<0.0) inclination *= -1;
+			for (unsigned int j=0; j<nb_segment+1; ++j) {
+				sphe_to_rect((float)j/(nb_segment)*2.f*M_PI, inclination, points[j+nb_segment+1]);
+				points[j+nb_segment+1] *= radius;
+			}
+			nb_points = 2*nb_segment+2;
+		}
+
+		batch.resize(nb_points);
+		for (unsigned int j=0; j<nb_points; ++j) batch.set(j, points[j]);
+		(prj->*proj_batch_func)(batch);
+
 		for (unsigned int i=0; i<nb_segment; ++i) {
 			
 			// Only draw for planets
 			if(line_type == TROPIC) {
 
 				// Not valid on non-planets
-				if(!(nav->getHomePlanet()->isSatellite()) && nav->getHomePlanet()->getEnglishName() != "Sun") {
-
-					inclination=nav->getHomePlanet()->getAxialTilt()*M_PI/180.;
-					for (unsigned int j=0; j<nb_segment+1; ++j) {
-						sphe_to_rect((float)j/(nb_segment)*2.f*M_PI, inclination, points[j+nb_segment+1]);
-						points[j+nb_segment+1] *= radius;
-						sphe_to_rect((float)j/(nb_segment)*2.f*M_PI, -inclination, points[j+2*nb_segment+2]);
-						points[j+2*nb_segment+2] *= radius;
-					}
-				
+				if(tropic_valid) {
+
 #ifdef LSS
 					// Draw equator
-					if ((prj->*proj_func)(points[i], pt1) &&
-						(prj->*proj_func)(points[i+1], pt2) ) {
+					if (getProjected(i, pt1) &&
+						getProjected(i+1, pt2) ) {
 						
 						glBegin (GL_LINES);
 						glVertex2f(pt1[0],pt1[1]);
@@ -549,8 +599,8 @@ void SkyLine::draw(const Projector *prj,const Navigator *nav) const
 					}
 #endif				
 
-					if((prj->*proj_func)(points[nb_segment+1+i], pt1) 
-					   && (prj->*proj_func)(points[nb_segment+1+i+1], pt2)) {
+					if(getProjected(nb_segment+1+i, pt1) 
+					   && getProjected(nb_segment+1+i+1, pt2)) {
 						
 						glBegin (GL_LINES);
 						glVertex2f(pt1[0],pt1[1]);
@@ -581,8 +631,8 @@ void SkyLine::draw(const Projector *prj,const Navigator *nav) const
 							glPopMatrix();
 						}
 					
-						if( (prj->*proj_func)(points[2*nb_segment+2+i], pt1) 
-							&& (prj->*proj_func)(points[2*nb_segment+2+i+1], pt2)) {
+						if( getProjected(2*nb_segment+2+i, pt1) 
+							&& getProjected(2*nb_segment+2+i+1, pt2)) {
 						
 							glBegin (GL_LINES);
 							glVertex2f(pt1[0],pt1[1]);
@@ -596,14 +646,8 @@ void SkyLine::draw(const Projector *prj,const Navigator *nav) const
 					}
 				}	
 			} else if(line_type == CIRCUMPOLAR) {
-					inclination=(90.0-abs(nav->get_latitude()))*M_PI/180.;
-					if (nav->get_latitude()<0.0) inclination *= -1;
-					for (unsigned int j=0; j<nb_segment+1; ++j) {
-						sphe_to_rect((float)j/(nb_segment)*2.f*M_PI, inclination, points[j+nb_segment+1]);
-						points[j+nb_segment+1] *= radius;
-					}
-					if((prj->*proj_func)(points[nb_segment+1+i], pt1) 
-					   && (prj->*proj_func)(points[nb_segment+1+i+1], pt2)) {
+					if(getProjected(nb_segment+1+i, pt1) 
+					   && getProjected(nb_segment+1+i+1, pt2)) {
 						glBegin (GL_LINES);
 						glVertex2f(pt1[0],pt1[1]);
 						glVertex2f(pt2[0],pt2[1]);
@@ -627,8 +671,8 @@ void SkyLine::draw(const Projector *prj,const Navigator *nav) const
 							  
 			} else {  // not TROPIC
 
-				if ((prj->*proj_func)(points[i], pt1) &&
-					(prj->*proj_func)(points[i+1], pt2) ) {
+				if (getProjected(i, pt1) &&
+					getProjected(i+1, pt2) ) {
 					const double dx = pt1[0]-pt2[0];
 					const double dy = pt1[1]-pt2[1];
 					const double dq = dx*dx+dy*dy;
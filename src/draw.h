@@ -110,6 +110,19 @@ private:
 	Vec3f** alt_points;
 	Vec3f** azi_points;
 	bool (Projector::*proj_func)(const Vec3d&, Vec3d&) const;
+	void (Projector::*proj_batch_func)(ProjectionBatch&) const;
+	// alt_points then azi_points, projected once per frame
+	mutable ProjectionBatch batch;
+	unsigned int altIndex(unsigned int nm, unsigned int i) const {
+		return nm*(nb_alt_segment+1) + i;
+	}
+	unsigned int aziIndex(unsigned int np, unsigned int i) const {
+		return nb_meridian*(nb_alt_segment+1) + np*(nb_azi_segment+1) + i;
+	}
+	bool getProjected(unsigned int k, Vec3d& win) const {
+		batch.getWin(k, win);
+		return batch.visible[k];
+	}
 	s_font* font;
 	SKY_GRID_TYPE gtype;
 	LinearFader fader;
@@ -206,6 +219,12 @@ private:
 	Vec3f color;
 	Vec3f* points;
 	bool (Projector::*proj_func)(const Vec3d&, Vec3d&) const;
+	void (Projector::*proj_batch_func)(ProjectionBatch&) const;
+	mutable ProjectionBatch batch;
+	bool getProjected(unsigned int k, Vec3d& win) const {
+		batch.getWin(k, win);
+		return batch.visible[k];
+	}
 	LinearFader fader;
 	s_font * font;
 	string month[13]; // labels for translating on ecliptic
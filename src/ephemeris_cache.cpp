@@ -0,0 +1,423 @@
+/*
+ * Nightshade (TM) astronomy simulation and visualization
+ *
+ * Copyright (C) 2012 Digitalis Education Solutions, Inc.
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 3
+ * of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place - Suite 330, Boston, MA  02111-1307, USA.
+ *
+ * Nightshade is a trademark of Digitalis Education Solutions, Inc.
+ * See the TRADEMARKS file for trademark usage requirements.
+ *
+ */
+
+
+#include <algorithm>
+#include <cerrno>
+#include <cmath>
+#include <cstdio>
+#include <cstring>
+#include <iostream>
+#include <sstream>
+#include <sys/time.h>
+
+#ifndef WIN32
+#include <sys/mman.h>
+#else
+#include <io.h>
+#endif
+
+#include "ephemeris_cache.h"
+
+using namespace std;
+
+const EphemerisFunction ephemeris_functions[] = {
+	{"mercury_special", &get_mercury_helio_coordsv_ctx},
+	{"venus_special", &get_venus_helio_coordsv_ctx},
+	{"earth_special", &get_earth_helio_coordsv_ctx},
+	{"emb_special", &get_emb_helio_coordsv_ctx},
+	{"lunar_special", &get_lunar_parent_coordsv_ctx},
+	{"mars_special", &get_mars_helio_coordsv_ctx},
+	{"phobos_special", &get_phobos_parent_coordsv_ctx},
+	{"deimos_special", &get_deimos_parent_coordsv_ctx},
+	{"jupiter_special", &get_jupiter_helio_coordsv_ctx},
+	{"io_special", &get_io_parent_coordsv_ctx},
+	{"europa_special", &get_europa_parent_coordsv_ctx},
+	{"ganymede_special", &get_ganymede_parent_coordsv_ctx},
+	{"calisto_special", &get_callisto_parent_coordsv_ctx},
+	{"saturn_special", &get_saturn_helio_coordsv_ctx},
+	{"mimas_special", &get_mimas_parent_coordsv_ctx},
+	{"enceladus_special", &get_enceladus_parent_coordsv_ctx},
+	{"tethys_special", &get_tethys_parent_coordsv_ctx},
+	{"dione_special", &get_dione_parent_coordsv_ctx},
+	{"rhea_special", &get_rhea_parent_coordsv_ctx},
+	{"titan_special", &get_titan_parent_coordsv_ctx},
+	{"hyperion_special", &get_hyperion_parent_coordsv_ctx},
+	{"iapetus_special", &get_iapetus_parent_coordsv_ctx},
+	{"uranus_special", &get_uranus_helio_coordsv_ctx},
+	{"miranda_special", &get_miranda_parent_coordsv_ctx},
+	{"ariel_special", &get_ariel_parent_coordsv_ctx},
+	{"umbriel_special", &get_umbriel_parent_coordsv_ctx},
+	{"titania_special", &get_titania_parent_coordsv_ctx},
+	{"oberon_special", &get_oberon_parent_coordsv_ctx},
+	{"neptune_special", &get_neptune_helio_coordsv_ctx},
+	{"pluto_special", &get_pluto_helio_coordsv_ctx},
+	{NULL, NULL}
+};
+
+typedef void (PositionFunction)(EphemerisContext *ctx, double jd, double xyz[3]);
+
+static const double AU_KM = 149597870.691;
+
+static PositionFunction *FindFunction(const string& name)
+{
+	for (const EphemerisFunction *f = ephemeris_functions; f->name; f++) {
+		if (name == f->name) return f->function;
+	}
+	return NULL;
+}
+
+// The context functions interpolate the elements between calls at nearby
+// dates, which leaves kinks in the positions that no polynomial follows.
+// Fitting and validation use the theory itself, with a fresh context per date.
+static void ExactPosition(PositionFunction *function, EphemerisContext *ctx,
+                          double jd, double xyz[3])
+{
+	InitEphemerisContext(ctx);
+	(*function)(ctx, jd, xyz);
+}
+
+static double GetTime(void)
+{
+	struct timeval tv;
+	gettimeofday(&tv, NULL);
+	return tv.tv_sec*1000.0 + tv.tv_usec/1000.0;
+}
+
+EphemerisCache::EphemerisCache(void)
+	: header(NULL), bodies(NULL), data(NULL), data_size(0)
+#ifdef WIN32
+	, mapping_handle(NULL)
+#endif
+{
+}
+
+EphemerisCache::~EphemerisCache(void)
+{
+	unload();
+}
+
+void EphemerisCache::unload(void)
+{
+	if (data) {
+#ifndef WIN32
+		munmap((void*)data, data_size);
+#else
+		UnmapViewOfFile(data);
+		CloseHandle(mapping_handle);
+		mapping_handle = NULL;
+#endif
+	}
+	header = NULL;
+	bodies = NULL;
+	data = NULL;
+	data_size = 0;
+}
+
+bool EphemerisCache::load(const string& file_name)
+{
+	unload();
+
+	FILE *f = fopen(file_name.c_str(), "rb");
+	if (!f) {
+		cerr << "Can't open ephemeris cache " << file_name << endl;
+		return false;
+	}
+	EphemerisCacheHeader h;
+	if (fread(&h, sizeof(h), 1, f) != 1 || h.magic != EPHEMERIS_CACHE_MAGIC ||
+	        h.version != EPHEMERIS_CACHE_VERSION) {
+		cerr << "ERROR: " << file_name << " is not an ephemeris cache of this version and byte order" << endl;
+		fclose(f);
+		return false;
+	}
+	fseek(f, 0, SEEK_END);
+	data_size = ftell(f);
+
+#ifndef WIN32
+	void *const m = mmap(0, data_size, PROT_READ, MAP_SHARED, fileno(f), 0);
+	if (m == MAP_FAILED) {
+		cerr << "ERROR: EphemerisCache::load: mmap(" << file_name << ") failed: "
+		     << strerror(errno) << endl;
+	} else {
+		data = (const double*)m;
+	}
+#else
+	HANDLE file_handle = (void*)_get_osfhandle(_fileno(f));
+	if (file_handle != INVALID_HANDLE_VALUE) {
+		mapping_handle = CreateFileMapping(file_handle, NULL, PAGE_READONLY, 0, 0, NULL);
+		if (mapping_handle != NULL) {
+			data = (const double*)MapViewOfFile(mapping_handle, FILE_MAP_READ, 0, 0, data_size);
+			if (data == NULL) {
+				CloseHandle(mapping_handle);
+				mapping_handle = NULL;
+			}
+		}
+	}
+	if (data == NULL) {
+		cerr << "ERROR: EphemerisCache::load: mapping " << file_name << " failed: "
+		     << GetLastError() << endl;
+	}
+#endif
+	fclose(f);
+	if (!data) {
+		data_size = 0;
+		return false;
+	}
+
+	header = (const EphemerisCacheHeader*)data;
+	bodies = (const EphemerisCacheBody*)(header + 1);
+
+	// refuse truncated files rather than fault while drawing
+	bool ok = sizeof(EphemerisCacheHeader) + header->nr_of_bodies*sizeof(EphemerisCacheBody) <= data_size;
+	for (unsigned int i=0; ok && i<header->nr_of_bodies; i++) {
+		const EphemerisCacheBody &b(bodies[i]);
+		ok = b.nr_of_coefficients > 0 && b.nr_of_coefficients <= EPHEMERIS_CACHE_MAX_COEFFICIENTS &&
+		     b.segment_length > 0 &&
+		     (b.offset + 3.0*b.nr_of_segments*b.nr_of_coefficients)*sizeof(double) <= data_size;
+	}
+	if (!ok) {
+		cerr << "ERROR: ephemeris cache " << file_name << " is truncated" << endl;
+		unload();
+		return false;
+	}
+
+	printf("Ephemeris cache %s: %u bodies from JD %.1f to %.1f\n", file_name.c_str(),
+	       header->nr_of_bodies, header->jd_begin, header->jd_end);
+	return true;
+}
+
+int EphemerisCache::findBody(const string& name) const
+{
+	for (unsigned int i=0; i<getNbBodies(); i++) {
+		if (name == bodies[i].name) return i;
+	}
+	return -1;
+}
+
+void EphemerisCache::evaluate(const double *c, unsigned int n, double x, double xyz[3])
+{
+	const double x2 = 2.0*x;
+	for (int k=0; k<3; k++, c+=n) {
+		double b1 = 0.0, b2 = 0.0;
+		for (unsigned int j=n-1; j>0; j--) {
+			const double b = x2*b1 - b2 + c[j];
+			b2 = b1;
+			b1 = b;
+		}
+		xyz[k] = x*b1 - b2 + c[0];
+	}
+}
+
+
+// Generation ------------------------------------------------------------
+
+// Coefficients per coordinate and segment, fitted by interpolating at as
+// many Chebyshev nodes
+#define FIT_COEFFICIENTS 14
+
+// Fit one segment of length days starting at jd into c (3*FIT_COEFFICIENTS)
+// and return the largest error found between the nodes
+static double FitSegment(PositionFunction *function, EphemerisContext *ctx,
+                         double jd, double length, double *c)
+{
+	const int n = FIT_COEFFICIENTS;
+	double f[3][FIT_COEFFICIENTS];
+	for (int k=0; k<n; k++) {
+		const double x = cos(M_PI*(k+0.5)/n);
+		double xyz[3];
+		ExactPosition(function, ctx, jd + 0.5*(x+1.0)*length, xyz);
+		for (int i=0; i<3; i++) f[i][k] = xyz[i];
+	}
+	for (int i=0; i<3; i++) {
+		for (int j=0; j<n; j++) {
+			double sum = 0.0;
+			for (int k=0; k<n; k++) sum += f[i][k]*cos(M_PI*j*(k+0.5)/n);
+			c[i*n+j] = (j == 0 ? 1.0 : 2.0)*sum/n;
+		}
+	}
+
+	// halfway between the nodes, and the segment ends
+	double max_error = 0.0;
+	for (int k=-1; k<n; k++) {
+		const double x = (k < 0) ? -1.0 : (k == n-1) ? 1.0 : cos(M_PI*(k+1.0)/n);
+		double xyz[3], fit[3];
+		ExactPosition(function, ctx, jd + 0.5*(x+1.0)*length, xyz);
+		EphemerisCache::evaluate(c, n, x, fit);
+		const double error = sqrt((fit[0]-xyz[0])*(fit[0]-xyz[0]) +
+		                          (fit[1]-xyz[1])*(fit[1]-xyz[1]) +
+		                          (fit[2]-xyz[2])*(fit[2]-xyz[2]));
+		if (error > max_error) max_error = error;
+	}
+	return max_error;
+}
+
+bool EphemerisCache::generate(const string& file_name, double jd_begin, double jd_end,
+                              double tolerance, const vector<string>& names)
+{
+	vector<string> todo(names);
+	if (todo.empty()) {
+		for (const EphemerisFunction *f = ephemeris_functions; f->name; f++) todo.push_back(f->name);
+	}
+	for (unsigned int i=0; i<todo.size(); i++) {
+		if (!FindFunction(todo[i]) || todo[i].size() >= sizeof(((EphemerisCacheBody*)0)->name)) {
+			cerr << "Unknown ephemeris " << todo[i] << endl;
+			return false;
+		}
+	}
+
+	FILE *f = fopen(file_name.c_str(), "wb");
+	if (!f) {
+		cerr << "Can't create " << file_name << endl;
+		return false;
+	}
+
+	EphemerisCacheHeader header;
+	memset(&header, 0, sizeof(header));
+	header.magic = EPHEMERIS_CACHE_MAGIC;
+	header.version = EPHEMERIS_CACHE_VERSION;
+	header.nr_of_bodies = todo.size();
+	header.jd_begin = jd_begin;
+	header.jd_end = jd_end;
+	header.tolerance = tolerance;
+
+	// the body table is rewritten at the end with the offsets and errors
+	vector<EphemerisCacheBody> bodies(todo.size());
+	memset(&bodies[0], 0, bodies.size()*sizeof(EphemerisCacheBody));
+	bool ok = fwrite(&header, sizeof(header), 1, f) == 1 &&
+	          fwrite(&bodies[0], sizeof(EphemerisCacheBody), bodies.size(), f) == bodies.size();
+	size_t offset = (sizeof(header) + bodies.size()*sizeof(EphemerisCacheBody)) / sizeof(double);
+
+	EphemerisContext ctx;
+	vector<double> coefficients;
+	for (unsigned int i=0; ok && i<todo.size(); i++) {
+		PositionFunction *function = FindFunction(todo[i]);
+		const double t0 = GetTime();
+
+		// Longest power of two segment, at most 64 days, that fits a few
+		// sample segments to half the tolerance; shortened if the whole
+		// range then turns out worse than the tolerance
+		double length = 64.0;
+		double sample[3*FIT_COEFFICIENTS];
+		while (length > 1.0/64) {
+			double error = 0.0;
+			for (int s=0; s<16; s++) {
+				const double jd = jd_begin + (jd_end - jd_begin - length)*s/15.0;
+				error = max(error, FitSegment(function, &ctx, jd, length, sample));
+			}
+			if (error <= 0.5*tolerance) break;
+			length *= 0.5;
+		}
+
+		unsigned int nr_of_segments;
+		double max_error;
+		for (;;) {
+			nr_of_segments = (unsigned int)ceil((jd_end - jd_begin)/length);
+			coefficients.resize(3*FIT_COEFFICIENTS*nr_of_segments);
+			max_error = 0.0;
+			for (unsigned int s=0; s<nr_of_segments; s++) {
+				max_error = max(max_error, FitSegment(function, &ctx, jd_begin + s*length, length,
+				                                      &coefficients[3*FIT_COEFFICIENTS*s]));
+			}
+			if (max_error <= tolerance || length <= 1.0/64) break;
+			length *= 0.5;
+		}
+
+		EphemerisCacheBody &b(bodies[i]);
+		strcpy(b.name, todo[i].c_str());
+		b.segment_length = length;
+		b.nr_of_segments = nr_of_segments;
+		b.nr_of_coefficients = FIT_COEFFICIENTS;
+		b.offset = offset;
+		b.max_error = max_error;
+		ok = fwrite(&coefficients[0], sizeof(double), coefficients.size(), f) == coefficients.size();
+		offset += coefficients.size();
+
+		printf("%-18s %4u segments of %8.4f days, max error %.3g km, %.1f s\n",
+		       b.name, nr_of_segments, length, max_error*AU_KM, (GetTime()-t0)/1000.0);
+		fflush(stdout);
+	}
+
+	ok = ok && fseek(f, sizeof(header), SEEK_SET) == 0 &&
+	     fwrite(&bodies[0], sizeof(EphemerisCacheBody), bodies.size(), f) == bodies.size();
+	if (fclose(f) != 0 || !ok) {
+		cerr << "Writing " << file_name << " failed" << endl;
+		remove(file_name.c_str());
+		return false;
+	}
+	return true;
+}
+
+string EphemerisCache::validate(unsigned int nb_samples) const
+{
+	ostringstream os;
+	char line[256];
+	snprintf(line, sizeof(line), "Ephemeris cache, JD %.1f to %.1f, %u dates per body\n",
+	         getBegin(), getEnd(), nb_samples);
+	os << line;
+
+	EphemerisContext ctx;
+	for (unsigned int i=0; i<getNbBodies(); i++) {
+		const EphemerisCacheBody &b(bodies[i]);
+		PositionFunction *function = FindFunction(b.name);
+		if (!function) {
+			os << "  " << b.name << ": unknown ephemeris" << endl;
+			continue;
+		}
+
+		// dates spread over the range, visited in random order like time jumps
+		vector<double> dates(nb_samples);
+		unsigned int seed = 12345 + i;
+		for (unsigned int k=0; k<nb_samples; k++) {
+			seed = seed*1103515245 + 12345;
+			dates[k] = getBegin() + (getEnd()-getBegin())*((seed >> 8)/16777216.0);
+		}
+
+		vector<double> exact(3*nb_samples), cached(3*nb_samples);
+		double t = GetTime();
+		for (unsigned int k=0; k<nb_samples; k++) ExactPosition(function, &ctx, dates[k], &exact[3*k]);
+		const double analytic_time = GetTime() - t;
+
+		t = GetTime();
+		unsigned int missed = 0;
+		for (unsigned int k=0; k<nb_samples; k++) {
+			if (!position(i, dates[k], &cached[3*k])) missed++;
+		}
+		const double cache_time = GetTime() - t;
+
+		double max_error = 0.0;
+		for (unsigned int k=0; k<nb_samples; k++) {
+			const double *e = &exact[3*k], *c = &cached[3*k];
+			max_error = max(max_error, sqrt((e[0]-c[0])*(e[0]-c[0]) + (e[1]-c[1])*(e[1]-c[1]) +
+			                                (e[2]-c[2])*(e[2]-c[2])));
+		}
+
+		snprintf(line, sizeof(line),
+		         "  %-18s max error %10.4g km (%.4g km when fitted), analytic %8.0f ns, cache %5.0f ns%s\n",
+		         b.name, max_error*AU_KM, b.max_error*AU_KM,
+		         analytic_time*1.e6/nb_samples, cache_time*1.e6/nb_samples,
+		         missed ? ", DATES OUT OF RANGE" : "");
+		os << line;
+	}
+	return os.str();
+}
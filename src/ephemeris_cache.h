@@ -0,0 +1,146 @@
+/*
+ * Nightshade (TM) astronomy simulation and visualization
+ *
+ * Copyright (C) 2012 Digitalis Education Solutions, Inc.
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 3
+ * of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place - Suite 330, Boston, MA  02111-1307, USA.
+ *
+ * Nightshade is a trademark of Digitalis Education Solutions, Inc.
+ * See the TRADEMARKS file for trademark usage requirements.
+ *
+ */
+
+
+// Precomputed positions of the bodies with special ephemerides (VSOP87,
+// ELP82B, L1, TASS17, GUST86...) as Chebyshev polynomials over fixed length
+// segments, so that dates anywhere in the generated range cost a few dozen
+// multiplications. The file is written by nightshade-ephemeris and mapped
+// read only; dates outside its range fall back to the analytic theories.
+//
+// File layout, all in the byte order of the generating machine:
+//   EphemerisCacheHeader
+//   nr_of_bodies EphemerisCacheBody
+//   for each body, at its offset: nr_of_segments segments of
+//   nr_of_coefficients x, y and z coefficients (doubles)
+
+#ifndef _EPHEMERIS_CACHE_H_
+#define _EPHEMERIS_CACHE_H_
+
+#include <string>
+#include <vector>
+
+#include "stellplanet.h"
+
+#ifdef WIN32
+#include <windows.h>
+#endif
+
+#define EPHEMERIS_CACHE_MAGIC 0x45434801
+#define EPHEMERIS_CACHE_VERSION 1
+#define EPHEMERIS_CACHE_MAX_COEFFICIENTS 32
+
+struct EphemerisCacheHeader {
+	unsigned int magic;
+	unsigned int version;
+	unsigned int nr_of_bodies;
+	unsigned int reserved;
+	double jd_begin;
+	double jd_end;
+	double tolerance;               // AU, requested when generating
+	double reserved2[3];
+};
+
+struct EphemerisCacheBody {
+	char name[32];                  // ephemeris name as in ssystem.ini coord_func
+	double segment_length;          // days
+	unsigned int nr_of_segments;
+	unsigned int nr_of_coefficients;
+	unsigned int offset;            // of the coefficients, in doubles from the start of the file
+	unsigned int reserved;
+	double max_error;               // AU, measured between the nodes when generating
+};
+
+// Special ephemerides the cache can hold, NULL terminated
+struct EphemerisFunction {
+	const char *name;
+	void (*function)(EphemerisContext *ctx, double jd, double xyz[3]);
+};
+extern const EphemerisFunction ephemeris_functions[];
+
+class EphemerisCache
+{
+public:
+	EphemerisCache(void);
+	~EphemerisCache(void);
+
+	// Map the file, false if it can't be used
+	bool load(const std::string& file_name);
+
+	double getBegin(void) const {
+		return header ? header->jd_begin : 0;
+	}
+	double getEnd(void) const {
+		return header ? header->jd_end : 0;
+	}
+	unsigned int getNbBodies(void) const {
+		return header ? header->nr_of_bodies : 0;
+	}
+	const EphemerisCacheBody& getBody(unsigned int i) const {
+		return bodies[i];
+	}
+
+	// Index of the named ephemeris, -1 if not in the cache
+	int findBody(const std::string& name) const;
+
+	// Position of body i at jd, false outside the cached range
+	bool position(int i, double jd, double xyz[3]) const {
+		const EphemerisCacheBody &b(bodies[i]);
+		const double t = (jd - header->jd_begin) / b.segment_length;
+		if (!(t >= 0.0 && t < b.nr_of_segments)) return false;
+		const unsigned int s = (unsigned int)t;
+		evaluate(data + b.offset + 3*s*b.nr_of_coefficients, b.nr_of_coefficients,
+		         2.0*(t - s) - 1.0, xyz);
+		return true;
+	}
+
+	// Fit the ephemerides named in names (all known ones if empty) over
+	// [jd_begin, jd_end] to within tolerance AU and write the file.
+	// Progress goes to standard output.
+	static bool generate(const std::string& file_name, double jd_begin, double jd_end,
+	                     double tolerance, const std::vector<std::string>& names);
+
+	// Compare the cache with the analytic theories at nb_samples dates per
+	// body and return a printable report of the errors and timings
+	std::string validate(unsigned int nb_samples) const;
+
+	// Clenshaw evaluation of n coefficients per coordinate at x in [-1, 1]
+	static void evaluate(const double *c, unsigned int n, double x, double xyz[3]);
+
+private:
+	EphemerisCache(const EphemerisCache&);
+	const EphemerisCache &operator=(const EphemerisCache&);
+
+	void unload(void);
+
+	const EphemerisCacheHeader *header;
+	const EphemerisCacheBody *bodies;
+	const double *data;
+	size_t data_size;
+#ifdef WIN32
+	HANDLE mapping_handle;
+#endif
+};
+
+#endif // _EPHEMERIS_CACHE_H_
@@ -0,0 +1,71 @@
+/*
+ * Nightshade (TM) astronomy simulation and visualization
+ *
+ * Copyright (C) 2012 Digitalis Education Solutions, Inc.
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 3
+ * of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place - Suite 330, Boston, MA  02111-1307, USA.
+ *
+ * Nightshade is a trademark of Digitalis Education Solutions, Inc.
+ * See the TRADEMARKS file for trademark usage requirements.
+ *
+ */
+
+// nightshade-ephemeris: writes and checks the ephemeris cache described
+// in ephemeris_cache.h.
+//
+// usage: nightshade-ephemeris generate file jd_begin jd_end [tolerance_km [ephemeris...]]
+//        nightshade-ephemeris validate file [nb_samples]
+
+#include <cstdio>
+#include <cstdlib>
+#include <iostream>
+
+#include "ephemeris_cache.h"
+
+using namespace std;
+
+static int Usage(void)
+{
+	fprintf(stderr,
+	        "usage: nightshade-ephemeris generate file jd_begin jd_end [tolerance_km [ephemeris...]]\n"
+	        "       nightshade-ephemeris validate file [nb_samples]\n"
+	        "ephemerides:");
+	for (const EphemerisFunction *f = ephemeris_functions; f->name; f++) {
+		fprintf(stderr, " %s", f->name);
+	}
+	fprintf(stderr, "\n");
+	return 1;
+}
+
+int main(int argc, char *argv[])
+{
+	if (argc >= 5 && string(argv[1]) == "generate") {
+		const double jd_begin = atof(argv[3]);
+		const double jd_end = atof(argv[4]);
+		const double tolerance_km = (argc > 5) ? atof(argv[5]) : 1.0;
+		if (!(jd_end > jd_begin) || !(tolerance_km > 0.0)) return Usage();
+		vector<string> names;
+		for (int i=6; i<argc; i++) names.push_back(argv[i]);
+		return EphemerisCache::generate(argv[2], jd_begin, jd_end,
+		                                tolerance_km/149597870.691, names) ? 0 : 1;
+	}
+	if (argc >= 3 && string(argv[1]) == "validate") {
+		EphemerisCache cache;
+		if (!cache.load(argv[2])) return 1;
+		cout << cache.validate(argc > 3 ? atoi(argv[3]) : 10000);
+		return 0;
+	}
+	return Usage();
+}
@@ -30,6 +30,7 @@
 
 #include "fisheye_projector.h"
 #include "utility.h"
+#include "simd_math.h"
 
 FisheyeProjector::FisheyeProjector(const Vec4i& viewport, double _fov)
 		:CustomProjector(viewport, _fov)
@@ -125,6 +126,89 @@ bool FisheyeProjector::project_custom(const Vec3d &v,Vec3d &win,
 
 }
 
+// Vectorized project_custom over SSE2/AVX lanes, with the atan from
+// simd_math.h. Results differ from the scalar path by less than 1e-10
+// pixel ('profile action projection' measures it). Lanes falling on the view axis and the remainder of the
+// arrays go through the scalar function.
+void FisheyeProjector::project_custom_batch(const double *x, const double *y, const double *z,
+                                            unsigned int count,
+                                            double *win_x, double *win_y, double *win_z,
+                                            unsigned char *visible, const Mat4d& mat) const
+{
+	unsigned int i = 0;
+
+#ifdef HAVE_SIMD_DOUBLE
+	using namespace SimdMath;
+	typedef SimdD S;
+
+	// the offset_y case renormalizes twice, leave it to the scalar code
+	if (!offset_y) {
+		const S::V m0 = S::set1(mat.r[0]), m1 = S::set1(mat.r[1]), m2 = S::set1(mat.r[2]);
+		const S::V m4 = S::set1(mat.r[4]), m5 = S::set1(mat.r[5]), m6 = S::set1(mat.r[6]);
+		const S::V m8 = S::set1(mat.r[8]), m9 = S::set1(mat.r[9]), m10 = S::set1(mat.r[10]);
+		const S::V m12 = S::set1(mat.r[12]), m13 = S::set1(mat.r[13]), m14 = S::set1(mat.r[14]);
+		const S::V one = S::set1(1.0);
+		const S::V half_pi = S::set1(M_PI_2);
+		const S::V scale = S::set1(fisheye_scale_factor*fov_scale);
+		const S::V radius = S::set1(viewport_radius);
+		const S::V cx = S::set1(viewport_center[0]);
+		const S::V cy = S::set1(viewport_center[1]);
+		const S::V shear = S::set1(shear_horz);
+		const S::V z_near = S::set1(zNear);
+		const S::V z_inv_range = S::set1(1.0/(zFar-zNear));
+		const S::V a_limit = S::set1(0.9*M_PI);
+
+		for (; i+S::width<=count; i+=S::width) {
+			const S::V vx = S::load(x+i), vy = S::load(y+i), vz = S::load(z+i);
+			const S::V wx = madd(m0, vx, madd(m4, vy, madd(m8, vz, m12)));
+			const S::V wy = madd(m1, vx, madd(m5, vy, madd(m9, vz, m13)));
+			const S::V wz = madd(m2, vx, madd(m6, vy, madd(m10, vz, m14)));
+
+			const S::V rq1 = madd(wx, wx, S::mul(wy, wy));
+			const S::V depth = S::sqrt(madd(wz, wz, rq1));
+			const S::V oneoverh = S::div(one, S::sqrt(rq1));
+			const S::V a = S::add(half_pi, atan(S::mul(wz, oneoverh)));
+			S::V f = S::mul(a, scale);
+
+			if (Lens == 0) {
+				f = S::select(S::lt(f, S::set1(1.01)),
+				              S::mul(f, madd(S::set1(-.1889), f, S::set1(1.1798))),
+				              S::sub(f, S::set1(0.01)));
+			} else {
+				const distort_params_t *d[2] = { &geometryDistortion, &lensDistortion };
+				for (int k=0; k<2; k++) {
+					const S::V poly = S::mul(f, madd(madd(S::set1(d[k]->pc), f, S::set1(d[k]->pb)), f, S::set1(d[k]->pa)));
+					f = S::select(S::lt(f, S::set1(d[k]->plimit)), poly, S::add(f, S::set1(d[k]->pfactor)));
+				}
+			}
+
+			f = S::mul(f, S::mul(radius, oneoverh));
+
+			S::store(win_x+i, madd(S::mul(shear, wx), f, cx));
+			S::store(win_y+i, madd(wy, f, cy));
+			S::store(win_z+i, S::mul(S::sub(abs(depth), z_near), z_inv_range));
+
+			const int vis = S::movemask(S::lt(a, a_limit));
+			const int degenerate = S::movemask(S::le(rq1, S::zero()));
+			for (int k=0; k<S::width; k++) {
+				if (degenerate & (1<<k)) {
+					Vec3d win;
+					visible[i+k] = project_custom(Vec3d(x[i+k], y[i+k], z[i+k]), win, mat);
+					win_x[i+k] = win[0];
+					win_y[i+k] = win[1];
+					win_z[i+k] = win[2];
+				} else {
+					visible[i+k] = (vis >> k) & 1;
+				}
+			}
+		}
+	}
+#endif
+
+	if (i < count)
+		Projector::project_custom_batch(x+i, y+i, z+i, count-i, win_x+i, win_y+i, win_z+i, visible+i, mat);
+}
+
 bool FisheyeProjector::project_custom_fixed_fov(const Vec3d &v,Vec3d &win,
         const Mat4d &mat) const
 {
@@ -65,6 +65,10 @@ private:
 		return FISHEYE_PROJECTOR;
 	}
 	bool project_custom(const Vec3d &v, Vec3d &win, const Mat4d &mat) const;
+	void project_custom_batch(const double *x, const double *y, const double *z,
+	                          unsigned int count,
+	                          double *win_x, double *win_y, double *win_z,
+	                          unsigned char *visible, const Mat4d& mat) const;
 	bool project_custom_fixed_fov(const Vec3d &v, Vec3d &win, const Mat4d &mat) const;
 	void unproject(double x, double y, const Mat4d& m, Vec3d& v) const;
 	bool projectorConfigurationSupported();
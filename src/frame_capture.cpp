@@ -0,0 +1,400 @@
+/*
+ * Nightshade (TM) astronomy simulation and visualization
+ *
+ * Copyright (C) 2012 Digitalis Education Solutions, Inc.
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 3
+ * of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place - Suite 330, Boston, MA  02111-1307, USA.
+ *
+ * Nightshade is a trademark of Digitalis Education Solutions, Inc.
+ * See the TRADEMARKS file for trademark usage requirements.
+ *
+ */
+
+
+#include <iostream>
+#include <cstring>
+
+#ifndef WIN32
+#include <csignal>
+#include <unistd.h>
+#else
+#define popen _popen
+#define pclose _pclose
+#endif
+
+#include <Magick++.h>
+
+#include "frame_capture.h"
+#include "utility.h"
+
+using namespace std;
+
+FrameCapture::FrameCapture(int nb_threads, unsigned int queue_size) :
+	format(FORMAT_PNG), width(0), height(0), fps(30), capturing(false), frameCount(0),
+	nbThreads(nb_threads), queueSize(queue_size), inFlight(0), quit(false),
+	stream(NULL), nextStreamFrame(0), streamError(false),
+	usePBO(false), nextPBO(0), pendingPBO(0)
+{
+	if (nbThreads < 0) {
+#ifndef WIN32
+		nbThreads = sysconf(_SC_NPROCESSORS_ONLN) - 1;
+#else
+		nbThreads = 1;
+#endif
+		if (nbThreads < 1) nbThreads = 1;
+	}
+	if (queueSize < 1) queueSize = 1;
+
+	lock = SDL_CreateMutex();
+	work_available = SDL_CreateCond();
+	frame_done = SDL_CreateCond();
+	stream_lock = SDL_CreateMutex();
+	stream_turn = SDL_CreateCond();
+
+	memset(pbo, 0, sizeof(pbo));
+}
+
+FrameCapture::~FrameCapture()
+{
+	stop();
+
+	for (vector<Frame*>::iterator iter = freeFrames.begin(); iter != freeFrames.end(); ++iter) delete *iter;
+	if (pbo[0]) glDeleteBuffers(NB_PBO, pbo);
+
+	SDL_DestroyCond(stream_turn);
+	SDL_DestroyMutex(stream_lock);
+	SDL_DestroyCond(frame_done);
+	SDL_DestroyCond(work_available);
+	SDL_DestroyMutex(lock);
+}
+
+FrameCapture::FORMAT FrameCapture::formatFromString(const string& s)
+{
+	if (s == "bmp") return FORMAT_BMP;
+	if (s == "y4m") return FORMAT_Y4M;
+	if (s == "pipe") return FORMAT_PIPE;
+	return FORMAT_PNG;
+}
+
+bool FrameCapture::start(FORMAT _format, const string& _path, unsigned int w, unsigned int h, float _fps)
+{
+	stop();
+
+	format = _format;
+	path = _path;
+	width = w;
+	height = h;
+	fps = _fps > 0 ? _fps : 30;
+	frameCount = 0;
+	nextStreamFrame = 0;
+	streamError = false;
+
+	if (format == FORMAT_Y4M) {
+		stream = fopen(path.c_str(), "wb");
+		if (stream) {
+			// C420jpeg: full range BT.601, chroma centered between the samples
+			fprintf(stream, "YUV4MPEG2 W%u H%u F%d:1000 Ip A1:1 C420jpeg\n", width, height, (int)(fps*1000+0.5));
+		}
+	} else if (format == FORMAT_PIPE) {
+		string command = path;
+		string::size_type pos;
+		while ((pos = command.find("%w")) != string::npos) command.replace(pos, 2, Utility::intToString(width));
+		while ((pos = command.find("%h")) != string::npos) command.replace(pos, 2, Utility::intToString(height));
+		while ((pos = command.find("%f")) != string::npos) command.replace(pos, 2, Utility::doubleToString(fps));
+#ifndef WIN32
+		// A dead encoder shows up as a write error instead of killing us
+		signal(SIGPIPE, SIG_IGN);
+#endif
+		stream = popen(command.c_str(), "w");
+	}
+
+	if ((format == FORMAT_Y4M || format == FORMAT_PIPE) && !stream) {
+		cerr << "Frame capture: unable to open " << path << endl;
+		return false;
+	}
+
+	// Asynchronous readback, falls back to glReadPixels into the frame
+	usePBO = GLEE_VERSION_1_5 && GLEE_ARB_pixel_buffer_object;
+	if (usePBO) {
+		if (!pbo[0]) glGenBuffers(NB_PBO, pbo);
+		for (int i=0; i<NB_PBO; i++) {
+			glBindBuffer(GL_PIXEL_PACK_BUFFER_ARB, pbo[i]);
+			glBufferData(GL_PIXEL_PACK_BUFFER_ARB, width*height*4, NULL, GL_STREAM_READ);
+		}
+		glBindBuffer(GL_PIXEL_PACK_BUFFER_ARB, 0);
+	}
+	nextPBO = 0;
+	pendingPBO = 0;
+
+	quit = false;
+	for (int i=0; i<nbThreads; i++) {
+		SDL_Thread *thread = SDL_CreateThread(&FrameCapture::writerThread, this);
+		if (!thread) {
+			cerr << "Can't create frame writer thread, " << i << " available" << endl;
+			break;
+		}
+		writers.push_back(thread);
+	}
+
+	capturing = true;
+	return true;
+}
+
+void FrameCapture::stop(void)
+{
+	if (!capturing) return;
+
+	// Oldest pending readback first
+	if (usePBO) {
+		for (int i=pendingPBO; i>0; i--) readPBO((nextPBO+NB_PBO-i) % NB_PBO);
+		pendingPBO = 0;
+		glBindBuffer(GL_PIXEL_PACK_BUFFER_ARB, 0);
+	}
+
+	SDL_mutexP(lock);
+	while (inFlight) SDL_CondWait(frame_done, lock);
+	quit = true;
+	SDL_CondBroadcast(work_available);
+	SDL_mutexV(lock);
+
+	for (vector<SDL_Thread*>::iterator iter = writers.begin(); iter != writers.end(); ++iter) {
+		SDL_WaitThread(*iter, NULL);
+	}
+	writers.clear();
+
+	if (stream) {
+		if (format == FORMAT_PIPE) pclose(stream);
+		else fclose(stream);
+		stream = NULL;
+	}
+
+	capturing = false;
+}
+
+void FrameCapture::capture(void)
+{
+	if (!capturing) return;
+
+	glPixelStorei(GL_PACK_ALIGNMENT, 4);
+
+	if (!usePBO) {
+		Frame *frame = getFreeFrame();
+		frame->number = frameCount++;
+		glReadPixels(0, 0, width, height, GL_BGRA, GL_UNSIGNED_BYTE, &frame->pixels[0]);
+		queueFrame(frame);
+		return;
+	}
+
+	// Start the transfer of this frame and collect the one read NB_PBO-1 frames ago
+	glBindBuffer(GL_PIXEL_PACK_BUFFER_ARB, pbo[nextPBO]);
+	glReadPixels(0, 0, width, height, GL_BGRA, GL_UNSIGNED_BYTE, 0);
+	pboFrame[nextPBO] = frameCount++;
+	nextPBO = (nextPBO+1) % NB_PBO;
+
+	if (++pendingPBO == NB_PBO) {
+		readPBO(nextPBO);
+		pendingPBO--;
+	}
+	glBindBuffer(GL_PIXEL_PACK_BUFFER_ARB, 0);
+}
+
+void FrameCapture::readPBO(int index)
+{
+	Frame *frame = getFreeFrame();
+	frame->number = pboFrame[index];
+
+	glBindBuffer(GL_PIXEL_PACK_BUFFER_ARB, pbo[index]);
+	const void *data = glMapBuffer(GL_PIXEL_PACK_BUFFER_ARB, GL_READ_ONLY);
+	if (data) {
+		memcpy(&frame->pixels[0], data, frame->pixels.size());
+		glUnmapBuffer(GL_PIXEL_PACK_BUFFER_ARB);
+	} else {
+		// The frame is lost, queued empty so that streams keep their order
+		cerr << "Frame capture: unable to map the read buffer, frame " << frame->number << " dropped" << endl;
+		frame->pixels.clear();
+	}
+	queueFrame(frame);
+}
+
+void FrameCapture::resize(unsigned int w, unsigned int h)
+{
+	if (!capturing || (w == width && h == height)) return;
+
+	// Streams announce their size up front and the read buffers have the
+	// old one, the recording can not go on
+	stop();
+	cerr << "Frame capture: window resized to " << w << "x" << h << ", recording stopped" << endl;
+}
+
+// Blocks while queueSize frames are in flight
+FrameCapture::Frame *FrameCapture::getFreeFrame(void)
+{
+	Frame *frame = NULL;
+
+	SDL_mutexP(lock);
+	while (inFlight >= queueSize) SDL_CondWait(frame_done, lock);
+	if (!freeFrames.empty()) {
+		frame = freeFrames.back();
+		freeFrames.pop_back();
+	}
+	inFlight++;
+	SDL_mutexV(lock);
+
+	if (!frame) frame = new Frame;
+	frame->pixels.resize(width*height*4);
+	return frame;
+}
+
+void FrameCapture::queueFrame(Frame *frame)
+{
+	if (writers.empty()) {
+		static vector<unsigned char> buffer;
+		writeFrame(frame, buffer);
+		SDL_mutexP(lock);
+		freeFrames.push_back(frame);
+		inFlight--;
+		SDL_mutexV(lock);
+		return;
+	}
+
+	SDL_mutexP(lock);
+	todo.push_back(frame);
+	SDL_CondSignal(work_available);
+	SDL_mutexV(lock);
+}
+
+int FrameCapture::writerThread(void *data)
+{
+	FrameCapture *c = (FrameCapture *)data;
+	vector<unsigned char> buffer;
+
+	SDL_mutexP(c->lock);
+	while (1) {
+		while (!c->quit && c->todo.empty()) SDL_CondWait(c->work_available, c->lock);
+		if (c->todo.empty()) break;
+
+		Frame *frame = c->todo.front();
+		c->todo.pop_front();
+		SDL_mutexV(c->lock);
+
+		c->writeFrame(frame, buffer);
+
+		SDL_mutexP(c->lock);
+		c->freeFrames.push_back(frame);
+		c->inFlight--;
+		SDL_CondBroadcast(c->frame_done);
+	}
+	SDL_mutexV(c->lock);
+
+	return 0;
+}
+
+// Converts on the calling thread, buffer is reused between frames
+void FrameCapture::writeFrame(Frame *frame, vector<unsigned char> &buffer)
+{
+	const unsigned int w = width, h = height;
+
+	if (frame->pixels.empty()) {
+		if (format == FORMAT_Y4M || format == FORMAT_PIPE) {
+			buffer.clear();
+			writeStream(frame, buffer);
+		}
+		return;
+	}
+
+	const unsigned char *src = &frame->pixels[0];
+
+	if (format == FORMAT_PNG || format == FORMAT_BMP) {
+		// Top row first RGB
+		buffer.resize(w*h*3);
+		for (unsigned int y=0; y<h; y++) {
+			const unsigned char *in = src + (h-1-y)*w*4;
+			unsigned char *out = &buffer[y*w*3];
+			for (unsigned int x=0; x<w; x++, in+=4, out+=3) {
+				out[0] = in[2];
+				out[1] = in[1];
+				out[2] = in[0];
+			}
+		}
+
+		char number[16];
+		snprintf(number, sizeof(number), "%06lu", frame->number);
+		const string filename = path + number + (format == FORMAT_PNG ? ".png" : ".bmp");
+		try {
+			Magick::Image image;
+			image.read(w, h, "RGB", Magick::CharPixel, &buffer[0]);
+			image.write(filename);
+		} catch (exception &e) {
+			cerr << "Frame capture: unable to write " << filename << ": " << e.what() << endl;
+		}
+		return;
+	}
+
+	if (format == FORMAT_PIPE) {
+		// Top row first BGRA
+		buffer.resize(w*h*4);
+		for (unsigned int y=0; y<h; y++) memcpy(&buffer[y*w*4], src + (h-1-y)*w*4, w*4);
+		writeStream(frame, buffer);
+		return;
+	}
+
+	// Y4M: full resolution luma, chroma averaged over 2x2 pixels
+	const unsigned int cw = (w+1)/2, ch = (h+1)/2;
+	buffer.resize(6 + w*h + 2*cw*ch);
+	memcpy(&buffer[0], "FRAME\n", 6);
+	unsigned char *Y = &buffer[6];
+	unsigned char *U = Y + w*h;
+	unsigned char *V = U + cw*ch;
+
+	for (unsigned int y=0; y<h; y++) {
+		const unsigned char *in = src + (h-1-y)*w*4;
+		for (unsigned int x=0; x<w; x++, in+=4)
+			*Y++ = (19595*in[2] + 38470*in[1] + 7471*in[0] + 32768) >> 16;
+	}
+
+	for (unsigned int cy=0; cy<ch; cy++) {
+		const unsigned int y0 = h-1-2*cy, y1 = 2*cy+1 < h ? y0-1 : y0;
+		for (unsigned int cx=0; cx<cw; cx++) {
+			const unsigned int x0 = 2*cx, x1 = x0+1 < w ? x0+1 : x0;
+			const unsigned char *p[4] = { src + (y0*w+x0)*4, src + (y0*w+x1)*4, src + (y1*w+x0)*4, src + (y1*w+x1)*4 };
+			int r = 0, g = 0, b = 0;
+			for (int i=0; i<4; i++) {
+				r += p[i][2];
+				g += p[i][1];
+				b += p[i][0];
+			}
+			// Sums of 4 samples, hence the >> 18
+			*U++ = (-11059*r - 21709*g + 32768*b + (128<<18) + (1<<17)) >> 18;
+			*V++ = (32768*r - 27439*g - 5329*b + (128<<18) + (1<<17)) >> 18;
+		}
+	}
+
+	writeStream(frame, buffer);
+}
+
+void FrameCapture::writeStream(const Frame *frame, const vector<unsigned char> &data)
+{
+	SDL_mutexP(stream_lock);
+	while (frame->number != nextStreamFrame) SDL_CondWait(stream_turn, stream_lock);
+
+	if (!streamError && !data.empty() && fwrite(&data[0], 1, data.size(), stream) != data.size()) {
+		cerr << "Frame capture: error writing to " << path << endl;
+		streamError = true;
+	}
+
+	nextStreamFrame++;
+	SDL_CondBroadcast(stream_turn);
+	SDL_mutexV(stream_lock);
+}
@@ -0,0 +1,130 @@
+/*
+ * Nightshade (TM) astronomy simulation and visualization
+ *
+ * Copyright (C) 2012 Digitalis Education Solutions, Inc.
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 3
+ * of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place - Suite 330, Boston, MA  02111-1307, USA.
+ *
+ * Nightshade is a trademark of Digitalis Education Solutions, Inc.
+ * See the TRADEMARKS file for trademark usage requirements.
+ *
+ */
+
+
+// Records the rendered frames without stalling the GL thread. Frames are read
+// back asynchronously into a ring of pixel buffer objects, queued and encoded
+// by a pool of writer threads as PNG/BMP images, a Y4M stream, or raw BGRA
+// piped to an external encoder. capture() blocks when the queue is full so
+// recording runs as fast as the writers drain it.
+
+#ifndef _FRAME_CAPTURE_H_
+#define _FRAME_CAPTURE_H_
+
+#include <cstdio>
+#include <deque>
+#include <string>
+#include <vector>
+
+#include "nightshade.h"
+#include "SDL_thread.h"
+
+class FrameCapture
+{
+public:
+	enum FORMAT {
+		FORMAT_PNG,     // one image per frame
+		FORMAT_BMP,
+		FORMAT_Y4M,     // single YUV 4:2:0 stream
+		FORMAT_PIPE     // raw BGRA frames, top row first, on the standard input of a command
+	};
+
+	// nb_threads writers (<0 for one less than the number of processors, 0 to
+	// encode on the GL thread), at most queue_size frames waiting to be written
+	FrameCapture(int nb_threads, unsigned int queue_size);
+	virtual ~FrameCapture();
+
+	// "png", "bmp", "y4m" or "pipe", png if unknown
+	static FORMAT formatFromString(const std::string& s);
+
+	// Start recording frames of w by h pixels. For image formats path is the
+	// prefix of the file names, for y4m the stream file, for pipe the command
+	// to run where %w, %h and %f are replaced by the width, height and rate.
+	bool start(FORMAT format, const std::string& path, unsigned int w, unsigned int h, float fps);
+
+	// Write the frames still in flight and close the output
+	void stop(void);
+
+	// The window is now w by h pixels, stops a recording of another size
+	void resize(unsigned int w, unsigned int h);
+
+	bool isCapturing(void) const {
+		return capturing;
+	}
+
+	// Read back the frame just drawn
+	void capture(void);
+
+	unsigned long getFrameCount(void) const {
+		return frameCount;
+	}
+
+private:
+	enum { NB_PBO = 3 };
+
+	struct Frame {
+		unsigned long number;
+		std::vector<unsigned char> pixels;   // BGRA, bottom row first as read by GL
+	};
+
+	static int writerThread(void *data);
+	Frame *getFreeFrame(void);
+	void queueFrame(Frame *frame);
+	void readPBO(int index);
+	void writeFrame(Frame *frame, std::vector<unsigned char> &buffer);
+	void writeStream(const Frame *frame, const std::vector<unsigned char> &data);
+
+	FORMAT format;
+	std::string path;
+	unsigned int width, height;
+	float fps;
+	bool capturing;
+	unsigned long frameCount;
+
+	int nbThreads;
+	unsigned int queueSize;
+	std::vector<SDL_Thread*> writers;
+	std::deque<Frame*> todo;
+	std::vector<Frame*> freeFrames;
+	unsigned int inFlight;               // frames queued or being written
+	bool quit;
+	SDL_mutex *lock;
+	SDL_cond *work_available;
+	SDL_cond *frame_done;
+
+	// Stream formats are written in frame order
+	FILE *stream;
+	unsigned long nextStreamFrame;
+	bool streamError;
+	SDL_mutex *stream_lock;
+	SDL_cond *stream_turn;
+
+	bool usePBO;
+	GLuint pbo[NB_PBO];
+	unsigned long pboFrame[NB_PBO];
+	int nextPBO;
+	int pendingPBO;
+};
+
+#endif // _FRAME_CAPTURE_H_
@@ -0,0 +1,375 @@
+/*
+ * Nightshade (TM) astronomy simulation and visualization
+ *
+ * Copyright (C) 2012 Digitalis Education Solutions, Inc.
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 3
+ * of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place - Suite 330, Boston, MA  02111-1307, USA.
+ *
+ * Nightshade is a trademark of Digitalis Education Solutions, Inc.
+ * See the TRADEMARKS file for trademark usage requirements.
+ *
+ */
+
+
+#include <cstdio>
+#include <cstring>
+#include <iomanip>
+#include <iostream>
+#include <sstream>
+
+#ifndef WIN32
+#include <sys/time.h>
+#endif
+
+#include "frame_profiler.h"
+#include "shared_data.h"
+
+// GL_EXT_timer_query / GL_ARB_timer_query, not in our GLee version
+#ifndef GL_TIME_ELAPSED_EXT
+#define GL_TIME_ELAPSED_EXT 0x88BF
+#endif
+
+using namespace std;
+
+// Only stages without nested stages can hold a GL timer query
+static const struct {
+	const char *name;
+	bool glTimer;
+} stageInfo[PROFILE_NB_STAGES] = {
+	{ "update", false },
+	{ "update_navigation", false },
+	{ "update_solarsystem", false },
+	{ "update_faders", false },
+	{ "update_atmosphere", false },
+	{ "draw", false },
+	{ "milky_way", true },
+	{ "nebulae", true },
+	{ "constellations", true },
+	{ "stars", true },
+	{ "grids", true },
+	{ "planets", true },
+	{ "meteors", true },
+	{ "atmosphere", true },
+	{ "landscape", true },
+	{ "cardinals", true },
+	{ "images", true },
+	{ "ui", true }
+};
+
+static const char *counterNames[PROFILE_NB_COUNTERS] = {
+	"orbit_points",
+	"glyph_atlas_kb",
+	"glyph_atlas_hit_rate"
+};
+
+// Frames between two updates of the shared memory state
+#define PROFILE_PUBLISH_INTERVAL 8
+
+FrameProfiler::FrameProfiler() : enabled(false), glTimers(false), frameCount(0), parity(0), activeQuery(-1),
+	queriesCreated(false)
+{
+	memset(queries, 0, sizeof(queries));
+	memset(queryIssued, 0, sizeof(queryIssued));
+	reset();
+}
+
+FrameProfiler::~FrameProfiler()
+{
+	stopCSV();
+	if (queriesCreated) glDeleteQueries(PROFILE_NB_STAGES*2, &queries[0][0]);
+}
+
+void FrameProfiler::setEnabled(bool b)
+{
+	if (b == enabled) return;
+	enabled = b;
+	if (enabled) reset();
+	publish();
+}
+
+void FrameProfiler::setFlagGLTimers(bool b)
+{
+	if (!b) {
+		if (activeQuery >= 0) glEndQuery(GL_TIME_ELAPSED_EXT);
+		activeQuery = -1;
+		memset(queryIssued, 0, sizeof(queryIssued));
+		glTimers = false;
+		return;
+	}
+
+	if (!queriesCreated) {
+		const char *ext = (const char *)glGetString(GL_EXTENSIONS);
+		if (!GLEE_VERSION_1_5 || !ext || (!strstr(ext, "GL_EXT_timer_query") && !strstr(ext, "GL_ARB_timer_query"))) {
+			cerr << "Frame profiler: GL timer queries are not supported, timing CPU only" << endl;
+			return;
+		}
+		glGenQueries(PROFILE_NB_STAGES*2, &queries[0][0]);
+		queriesCreated = true;
+	}
+	glTimers = true;
+}
+
+double FrameProfiler::getTime(void)
+{
+#ifdef WIN32
+	static LARGE_INTEGER frequency;
+	if (!frequency.QuadPart) QueryPerformanceFrequency(&frequency);
+	LARGE_INTEGER count;
+	QueryPerformanceCounter(&count);
+	return count.QuadPart*1000./frequency.QuadPart;
+#else
+	struct timeval tv;
+	gettimeofday(&tv, NULL);
+	return tv.tv_sec*1000. + tv.tv_usec/1000.;
+#endif
+}
+
+void FrameProfiler::begin(PROFILE_STAGE stage)
+{
+	if (!enabled) return;
+
+	startTime[stage] = getTime();
+
+	// GL_TIME_ELAPSED queries can't be nested, time each leaf stage once per frame
+	if (glTimers && stageInfo[stage].glTimer && activeQuery < 0 && !queryIssued[stage][parity]) {
+		glBeginQuery(GL_TIME_ELAPSED_EXT, queries[stage][parity]);
+		queryIssued[stage][parity] = true;
+		activeQuery = stage;
+	}
+}
+
+void FrameProfiler::end(PROFILE_STAGE stage)
+{
+	if (!enabled) return;
+
+	frameTime[stage] += getTime() - startTime[stage];
+
+	if (activeQuery == stage) {
+		glEndQuery(GL_TIME_ELAPSED_EXT);
+		activeQuery = -1;
+	}
+}
+
+int FrameProfiler::getBin(float ms)
+{
+	if (ms < 0.125f) return 0;
+	int bin = 1;
+	float limit = 0.25f;
+	while (bin < NB_BINS-1 && ms >= limit) {
+		limit *= 2;
+		bin++;
+	}
+	return bin;
+}
+
+// The queries of a frame are read at the end of the next one so the
+// pipeline is not stalled; GPU times lag CPU times by one frame.
+void FrameProfiler::collectQueries(int p)
+{
+	for (int s=0; s<PROFILE_NB_STAGES; s++) {
+		gpuFrameTime[s] = -1.f;
+		if (!queryIssued[s][p]) continue;
+		queryIssued[s][p] = false;
+
+		GLuint available = 0;
+		glGetQueryObjectuiv(queries[s][p], GL_QUERY_RESULT_AVAILABLE, &available);
+		if (!available) continue;
+
+		GLuint ns = 0;
+		glGetQueryObjectuiv(queries[s][p], GL_QUERY_RESULT, &ns);
+		gpuFrameTime[s] = ns/1000000.f;
+	}
+}
+
+void FrameProfiler::pushSample(int stage, float cpu, float gpu)
+{
+	if (nbSamples == WINDOW) histogram[stage][getBin(cpuSamples[stage][nextSample])]--;
+	cpuSamples[stage][nextSample] = cpu;
+	gpuSamples[stage][nextSample] = gpu;
+	histogram[stage][getBin(cpu)]++;
+}
+
+void FrameProfiler::endFrame(void)
+{
+	if (!enabled) return;
+
+	if (glTimers) collectQueries(parity^1);
+
+	for (int s=0; s<PROFILE_NB_STAGES; s++) pushSample(s, frameTime[s], gpuFrameTime[s]);
+	for (int c=0; c<PROFILE_NB_COUNTERS; c++) counterSamples[c][nextSample] = counterValue[c];
+	nextSample = (nextSample+1) % WINDOW;
+	if (nbSamples < WINDOW) nbSamples++;
+
+	if (csv.is_open()) {
+		csv << frameCount;
+		for (int s=0; s<PROFILE_NB_STAGES; s++) csv << ',' << frameTime[s];
+		for (int s=0; s<PROFILE_NB_STAGES; s++)
+			if (stageInfo[s].glTimer) csv << ',' << gpuFrameTime[s];
+		for (int c=0; c<PROFILE_NB_COUNTERS; c++) csv << ',' << counterValue[c];
+		csv << '\n';
+	}
+
+	for (int s=0; s<PROFILE_NB_STAGES; s++) {
+		frameTime[s] = 0.f;
+		gpuFrameTime[s] = -1.f;
+	}
+	parity ^= 1;
+	frameCount++;
+
+	if (frameCount % PROFILE_PUBLISH_INTERVAL == 0) publish();
+}
+
+void FrameProfiler::reset(void)
+{
+	memset(cpuSamples, 0, sizeof(cpuSamples));
+	memset(gpuSamples, 0, sizeof(gpuSamples));
+	memset(histogram, 0, sizeof(histogram));
+	memset(counterValue, 0, sizeof(counterValue));
+	memset(counterSamples, 0, sizeof(counterSamples));
+	memset(startTime, 0, sizeof(startTime));
+	for (int s=0; s<PROFILE_NB_STAGES; s++) {
+		frameTime[s] = 0.f;
+		gpuFrameTime[s] = -1.f;
+	}
+	nbSamples = 0;
+	nextSample = 0;
+}
+
+bool FrameProfiler::startCSV(const string& filename)
+{
+	stopCSV();
+	csv.open(filename.c_str());
+	if (!csv.is_open()) {
+		cerr << "Frame profiler: unable to open " << filename << endl;
+		return false;
+	}
+
+	csv << "frame";
+	for (int s=0; s<PROFILE_NB_STAGES; s++) csv << ',' << stageInfo[s].name;
+	for (int s=0; s<PROFILE_NB_STAGES; s++)
+		if (stageInfo[s].glTimer) csv << ",gpu_" << stageInfo[s].name;
+	for (int c=0; c<PROFILE_NB_COUNTERS; c++) csv << ',' << counterNames[c];
+	csv << '\n';
+	return true;
+}
+
+void FrameProfiler::stopCSV(void)
+{
+	if (csv.is_open()) csv.close();
+}
+
+const char* FrameProfiler::getStageName(PROFILE_STAGE stage)
+{
+	return stageInfo[stage].name;
+}
+
+const char* FrameProfiler::getCounterName(PROFILE_COUNTER counter)
+{
+	return counterNames[counter];
+}
+
+float FrameProfiler::getMean(PROFILE_STAGE stage) const
+{
+	if (!nbSamples) return 0.f;
+	float sum = 0.f;
+	for (int i=0; i<nbSamples; i++) sum += cpuSamples[stage][i];
+	return sum/nbSamples;
+}
+
+float FrameProfiler::getMax(PROFILE_STAGE stage) const
+{
+	float max = 0.f;
+	for (int i=0; i<nbSamples; i++)
+		if (cpuSamples[stage][i] > max) max = cpuSamples[stage][i];
+	return max;
+}
+
+float FrameProfiler::getGPUMean(PROFILE_STAGE stage) const
+{
+	float sum = 0.f;
+	int n = 0;
+	for (int i=0; i<nbSamples; i++) {
+		if (gpuSamples[stage][i] < 0) continue;
+		sum += gpuSamples[stage][i];
+		n++;
+	}
+	return n ? sum/n : -1.f;
+}
+
+float FrameProfiler::getCounterMean(PROFILE_COUNTER counter) const
+{
+	if (!nbSamples) return 0.f;
+	float sum = 0.f;
+	for (int i=0; i<nbSamples; i++) sum += counterSamples[counter][i];
+	return sum/nbSamples;
+}
+
+float FrameProfiler::getCounterMax(PROFILE_COUNTER counter) const
+{
+	float max = 0.f;
+	for (int i=0; i<nbSamples; i++)
+		if (counterSamples[counter][i] > max) max = counterSamples[counter][i];
+	return max;
+}
+
+string FrameProfiler::getReport(void) const
+{
+	ostringstream os;
+	os << "Frame profile over the last " << nbSamples << " frames (ms)" << endl;
+	os << setw(20) << left << "stage" << right << setw(8) << "mean" << setw(8) << "max" << setw(8) << "gpu"
+	   << "   histogram <0.125 .. >=32" << endl;
+	os << fixed << setprecision(3);
+
+	for (int s=0; s<PROFILE_NB_STAGES; s++) {
+		PROFILE_STAGE stage = (PROFILE_STAGE)s;
+		os << setw(20) << left << stageInfo[s].name << right << setw(8) << getMean(stage) << setw(8) << getMax(stage);
+		float gpu = getGPUMean(stage);
+		if (gpu < 0) os << setw(8) << "-";
+		else os << setw(8) << gpu;
+		os << "  ";
+		for (int b=0; b<NB_BINS; b++) os << ' ' << histogram[s][b];
+		os << endl;
+	}
+
+	os << endl << setw(20) << left << "counter" << right << setw(12) << "mean" << setw(12) << "max" << endl;
+	for (int c=0; c<PROFILE_NB_COUNTERS; c++) {
+		PROFILE_COUNTER counter = (PROFILE_COUNTER)c;
+		os << setw(20) << left << counterNames[c] << right << setw(12) << getCounterMean(counter)
+		   << setw(12) << getCounterMax(counter) << endl;
+	}
+	return os.str();
+}
+
+void FrameProfiler::publish(void) const
+{
+	ProfileState state;
+	state.m_state.enabled = enabled;
+	state.m_state.nb_stages = PROFILE_NB_STAGES;
+	for (int s=0; s<PROFILE_NB_STAGES && s<ProfileState::MAX_STAGES; s++) {
+		PROFILE_STAGE stage = (PROFILE_STAGE)s;
+		strncpy(state.m_state.stage_names[s], stageInfo[s].name, ProfileState::NAME_LEN-1);
+		state.m_state.cpu_mean[s] = getMean(stage);
+		state.m_state.cpu_max[s] = getMax(stage);
+		state.m_state.gpu_mean[s] = getGPUMean(stage);
+	}
+	state.m_state.nb_counters = PROFILE_NB_COUNTERS;
+	for (int c=0; c<PROFILE_NB_COUNTERS && c<ProfileState::MAX_COUNTERS; c++) {
+		PROFILE_COUNTER counter = (PROFILE_COUNTER)c;
+		strncpy(state.m_state.counter_names[c], counterNames[c], ProfileState::NAME_LEN-1);
+		state.m_state.counter_mean[c] = getCounterMean(counter);
+		state.m_state.counter_max[c] = getCounterMax(counter);
+	}
+	SharedData::Instance()->Profile(state);
+}
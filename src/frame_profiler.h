@@ -0,0 +1,173 @@
+/*
+ * Nightshade (TM) astronomy simulation and visualization
+ *
+ * Copyright (C) 2012 Digitalis Education Solutions, Inc.
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 3
+ * of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place - Suite 330, Boston, MA  02111-1307, USA.
+ *
+ * Nightshade is a trademark of Digitalis Education Solutions, Inc.
+ * See the TRADEMARKS file for trademark usage requirements.
+ *
+ */
+
+
+// Scoped CPU timers, with optional GL timer queries, around the stages of
+// Core::update and Core::draw. Each stage keeps a rolling window of frame
+// times and its histogram.
+
+#ifndef _FRAME_PROFILER_H_
+#define _FRAME_PROFILER_H_
+
+#include <fstream>
+#include <string>
+
+#include "nightshade.h"
+
+enum PROFILE_STAGE {
+	PROFILE_UPDATE,
+	PROFILE_UPDATE_NAVIGATION,
+	PROFILE_UPDATE_SOLARSYSTEM,
+	PROFILE_UPDATE_FADERS,
+	PROFILE_UPDATE_ATMOSPHERE,
+	PROFILE_DRAW,
+	PROFILE_MILKY_WAY,
+	PROFILE_NEBULAE,
+	PROFILE_CONSTELLATIONS,
+	PROFILE_STARS,
+	PROFILE_GRIDS,
+	PROFILE_PLANETS,
+	PROFILE_METEORS,
+	PROFILE_ATMOSPHERE,
+	PROFILE_LANDSCAPE,
+	PROFILE_CARDINALS,
+	PROFILE_IMAGES,
+	PROFILE_UI,
+	PROFILE_NB_STAGES
+};
+
+// Per frame quantities reported next to the stage times
+enum PROFILE_COUNTER {
+	PROFILE_ORBIT_POINTS,
+	PROFILE_ATLAS_MEMORY,
+	PROFILE_ATLAS_HIT_RATE,
+	PROFILE_NB_COUNTERS
+};
+
+class FrameProfiler
+{
+public:
+	// Frames kept per stage
+	enum { WINDOW = 128 };
+	// Histogram bins: below 0.125 ms, then doubling up to 32 ms and above
+	enum { NB_BINS = 10 };
+
+	FrameProfiler();
+	virtual ~FrameProfiler();
+
+	void setEnabled(bool b);
+	bool isEnabled(void) const {
+		return enabled;
+	}
+
+	// Also time the draw stages on the GPU, needs EXT_timer_query or ARB_timer_query
+	void setFlagGLTimers(bool b);
+	bool getFlagGLTimers(void) const {
+		return glTimers;
+	}
+
+	void begin(PROFILE_STAGE stage);
+	void end(PROFILE_STAGE stage);
+
+	// Value of a counter for the current frame
+	void setCounter(PROFILE_COUNTER counter, float value) {
+		counterValue[counter] = value;
+	}
+
+	// Store the times of the frame, called once after drawing
+	void endFrame(void);
+
+	void reset(void);
+
+	// Write one line per frame with the time of each stage
+	bool startCSV(const std::string& filename);
+	void stopCSV(void);
+
+	static const char* getStageName(PROFILE_STAGE stage);
+	static const char* getCounterName(PROFILE_COUNTER counter);
+
+	// Statistics over the window, in ms
+	float getMean(PROFILE_STAGE stage) const;
+	float getMax(PROFILE_STAGE stage) const;
+	// -1 if the stage has no GPU time
+	float getGPUMean(PROFILE_STAGE stage) const;
+	const unsigned int* getHistogram(PROFILE_STAGE stage) const {
+		return histogram[stage];
+	}
+	float getCounterMean(PROFILE_COUNTER counter) const;
+	float getCounterMax(PROFILE_COUNTER counter) const;
+
+	// Human readable table of the statistics
+	std::string getReport(void) const;
+
+	// Wall clock in ms
+	static double getTime(void);
+
+private:
+	static int getBin(float ms);
+	void pushSample(int stage, float cpu, float gpu);
+	void collectQueries(int parity);
+	void publish(void) const;
+
+	bool enabled;
+	bool glTimers;
+	double startTime[PROFILE_NB_STAGES];
+	float frameTime[PROFILE_NB_STAGES];      // accumulated during the current frame
+
+	float cpuSamples[PROFILE_NB_STAGES][WINDOW];
+	float gpuSamples[PROFILE_NB_STAGES][WINDOW];
+	unsigned int histogram[PROFILE_NB_STAGES][NB_BINS];
+	float counterValue[PROFILE_NB_COUNTERS];
+	float counterSamples[PROFILE_NB_COUNTERS][WINDOW];
+	int nbSamples;
+	int nextSample;
+	unsigned long frameCount;
+
+	GLuint queries[PROFILE_NB_STAGES][2];  // one set per frame parity, read a frame later
+	bool queryIssued[PROFILE_NB_STAGES][2];
+	float gpuFrameTime[PROFILE_NB_STAGES];
+	int parity;
+	int activeQuery;                       // stage of the running query or -1
+	bool queriesCreated;
+
+	std::ofstream csv;
+};
+
+// Times a block of code, does nothing when the profiler is disabled
+class ProfileScope
+{
+public:
+	ProfileScope(FrameProfiler *_profiler, PROFILE_STAGE _stage) : profiler(_profiler), stage(_stage) {
+		profiler->begin(stage);
+	}
+	~ProfileScope() {
+		profiler->end(stage);
+	}
+
+private:
+	FrameProfiler *profiler;
+	PROFILE_STAGE stage;
+};
+
+#endif // _FRAME_PROFILER_H_
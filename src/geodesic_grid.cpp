@@ -91,7 +91,7 @@ static const TopLevelTriangle icosahedron_triangles[20] =
         {{ 8, 9, 5}}  //  8
     };
 
-GeodesicGrid::GeodesicGrid(const int lev) : max_level(lev<0?0:lev), lastMaxSearchlevel(-1)
+GeodesicGrid::GeodesicGrid(const int lev) : max_level(lev<0?0:lev), searchCount(0)
 {
 	if (max_level > 0)
 	{
@@ -115,7 +115,13 @@ GeodesicGrid::GeodesicGrid(const int lev) : max_level(lev<0?0:lev), lastMaxSearc
 	{
 		triangles = 0;
 	}
-	cacheSearchResult = new GeodesicSearchResult(*this);
+	for (int i=0;i<SEARCH_CACHE_SIZE;i++)
+	{
+		searchCache[i].result = new GeodesicSearchResult(*this);
+		searchCache[i].level = -1;
+		searchCache[i].margin = 0.;
+		searchCache[i].lastUse = 0;
+	}
 }
 
 GeodesicGrid::~GeodesicGrid(void)
@@ -125,8 +131,11 @@ GeodesicGrid::~GeodesicGrid(void)
 		for (int i=max_level-1;i>=0;i--) delete[] triangles[i];
 		delete[] triangles;
 	}
-	delete cacheSearchResult;
-	cacheSearchResult = NULL;
+	for (int i=0;i<SEARCH_CACHE_SIZE;i++)
+	{
+		delete searchCache[i].result;
+		searchCache[i].result = NULL;
+	}
 }
 
 void GeodesicGrid::getTriangleCorners(int lev,int index,
@@ -323,7 +332,7 @@ int GeodesicGrid::searchZone(const Vec3d &v,int search_level) const
 
 void GeodesicGrid::searchZones(const StelGeom::ConvexS& convex,
                                int **inside_list,int **border_list,
-                               int max_search_level) const
+                               int max_search_level,int nb_inner) const
 {
 	if (max_search_level < 0) max_search_level = 0;
 	else if (max_search_level > max_level) max_search_level = max_level;
@@ -354,7 +363,7 @@ void GeodesicGrid::searchZones(const StelGeom::ConvexS& convex,
 		            corner_inside[icosahedron_triangles[i].corners[0]],
 		            corner_inside[icosahedron_triangles[i].corners[1]],
 		            corner_inside[icosahedron_triangles[i].corners[2]],
-		            inside_list,border_list,max_search_level);
+		            inside_list,border_list,max_search_level,nb_inner);
 	}
 #if defined __STRICT_ANSI__ || !defined __GNUC__
 	delete[] halfs_used;
@@ -370,7 +379,8 @@ void GeodesicGrid::searchZones(int lev,int index,
                                const bool *corner1_inside,
                                const bool *corner2_inside,
                                int **inside_list,int **border_list,
-                               const int max_search_level) const
+                               const int max_search_level,
+                               const int nb_inner) const
 {
 #if defined __STRICT_ANSI__ || !defined __GNUC__
 	int *halfs_used = new int[half_spaces_used];
@@ -381,7 +391,7 @@ void GeodesicGrid::searchZones(int lev,int index,
 	for (int h=0;h<half_spaces_used;h++)
 	{
 		const int i = index_of_used_half_spaces[h];
-		if (!corner0_inside[i] && !corner1_inside[i] && !corner2_inside[i])
+		if (i >= nb_inner && !corner0_inside[i] && !corner1_inside[i] && !corner2_inside[i])
 		{
 			// totally outside this HalfSpace
 			return;
@@ -433,19 +443,19 @@ void GeodesicGrid::searchZones(int lev,int index,
 			searchZones(lev,index+0,
 			            convex,halfs_used,halfs_used_count,
 			            corner0_inside,edge2_inside,edge1_inside,
-			            inside_list,border_list,max_search_level);
+			            inside_list,border_list,max_search_level,nb_inner);
 			searchZones(lev,index+1,
 			            convex,halfs_used,halfs_used_count,
 			            edge2_inside,corner1_inside,edge0_inside,
-			            inside_list,border_list,max_search_level);
+			            inside_list,border_list,max_search_level,nb_inner);
 			searchZones(lev,index+2,
 			            convex,halfs_used,halfs_used_count,
 			            edge1_inside,edge0_inside,corner2_inside,
-			            inside_list,border_list,max_search_level);
+			            inside_list,border_list,max_search_level,nb_inner);
 			searchZones(lev,index+3,
 			            convex,halfs_used,halfs_used_count,
 			            edge0_inside,edge1_inside,edge2_inside,
-			            inside_list,border_list,max_search_level);
+			            inside_list,border_list,max_search_level,nb_inner);
 #if defined __STRICT_ANSI__ || !defined __GNUC__
 			delete[] edge0_inside;
 			delete[] edge1_inside;
@@ -458,21 +468,81 @@ void GeodesicGrid::searchZones(int lev,int index,
 #endif
 }
 
+/*************************************************************************
+ Angular radius of a half space, whose normal needs not be normalized
+*************************************************************************/
+static double aperture(const StelGeom::HalfSpace& h)
+{
+	const double d = h.d / h.n.length();
+	return acos(d < -1. ? -1. : (d > 1. ? 1. : d));
+}
+
 /*************************************************************************
  Return a search result matching the given spatial region
 *************************************************************************/
 const GeodesicSearchResult* GeodesicGrid::search(const StelGeom::ConvexS& convex, int maxSearchLevel) const
 {
-	// Try to use the cached version
-	if (maxSearchLevel==lastMaxSearchlevel && convex==lastSearchRegion)
+	searchCount++;
+
+	// Try to use a cached version, else replace the least recently used one
+	CachedSearch *oldest = &searchCache[0];
+	for (int i=0;i<SEARCH_CACHE_SIZE;i++)
 	{
-		return cacheSearchResult;
+		CachedSearch &c = searchCache[i];
+		if (covers(c, convex, maxSearchLevel))
+		{
+			c.lastUse = searchCount;
+			return c.result;
+		}
+		if (c.lastUse < oldest->lastUse) oldest = &c;
+	}
+
+	// Narrowed half spaces first, they only decide which zones are inside,
+	// then each half space widened by the angular size of a zone
+	const double margin = zoneAngularSize(maxSearchLevel);
+	const int n = convex.size();
+	StelGeom::ConvexS bounds(2*n);
+	for (int i=0;i<n;i++)
+	{
+		const double l = convex[i].n.length();
+		const double a = aperture(convex[i]);
+		bounds[i].n = bounds[n+i].n = convex[i].n;
+		bounds[i].d = ((a <= margin) ? 1. : cos(a - margin)) * l;
+		bounds[n+i].d = ((a + margin >= M_PI) ? -1. : cos(a + margin)) * l;
+	}
+
+	oldest->region = convex;
+	oldest->level = maxSearchLevel;
+	oldest->margin = margin;
+	oldest->lastUse = searchCount;
+	oldest->result->search(bounds, maxSearchLevel, n);
+	return oldest->result;
+}
+
+/*************************************************************************
+ Whether a cached search fits the given region: each half space, turned
+ by some angle, must still fit in the widened cached one and contain the
+ narrowed one.
+*************************************************************************/
+bool GeodesicGrid::covers(const CachedSearch& c, const StelGeom::ConvexS& convex, int maxSearchLevel)
+{
+	if (c.level != maxSearchLevel || c.region.size() != convex.size()) return false;
+
+	for (unsigned int i=0;i<convex.size();i++)
+	{
+		const StelGeom::HalfSpace &h = convex[i];
+		const StelGeom::HalfSpace &ch = c.region[i];
+		if (h == ch) continue;
+
+		double cosa = h.n.dot(ch.n) / (h.n.length()*ch.n.length());
+		if (cosa > 1.) cosa = 1.;
+		if (cosa < -1.) cosa = -1.;
+		const double turn = acos(cosa);
+		if (aperture(h) + turn > aperture(ch) + c.margin) return false;
+		const double inner = aperture(ch) - c.margin;
+		if ((inner > 0. ? inner : 0.) + turn > aperture(h)) return false;
 	}
-	// Else recompute it and update cache parameters
-	lastMaxSearchlevel = maxSearchLevel;
-	lastSearchRegion = convex;
-	cacheSearchResult->search(convex, maxSearchLevel);
-	return cacheSearchResult;
+	return true;
 }
 	
 
@@ -510,14 +580,14 @@ GeodesicSearchResult::~GeodesicSearchResult(void)
 }
 
 void GeodesicSearchResult::search(const StelGeom::ConvexS& convex,
-                                  int max_search_level)
+                                  int max_search_level, int nb_inner)
 {
 	for (int i=grid.getMaxLevel();i>=0;i--)
 	{
 		inside[i] = zones[i];
 		border[i] = zones[i]+GeodesicGrid::nrOfZones(i);
 	}
-	grid.searchZones(convex,inside,border,max_search_level);
+	grid.searchZones(convex,inside,border,max_search_level,nb_inner);
 }
 
 void GeodesicSearchInsideIterator::reset(void)
@@ -58,6 +58,11 @@ public:
 	{return (20<<(level<<1));} // 20*4^level
 	
 	int getNrOfZones(void) const {return nrOfZones(max_level);}
+
+	//! Angular size of the zones of a level, i.e. of an icosahedron edge
+	//! (1.1071 rad) divided by 2^level
+	static double zoneAngularSize(int level)
+	{return 1.1071487177940904 / (1<<level);}
 	
 	//! Return the position of the 3 corners for the triangle at the given level and index
 	void getTriangleCorners(int lev, int index, Vec3d& c0, Vec3d& c1, Vec3d& c2) const;
@@ -94,11 +99,18 @@ public:
 	//! in inside[l1] for some l1 < l.
 	//! In order to restrict search depth set max_search_level < max_level,
 	//! for full search depth set max_search_level = max_level,
+	//! The first nb_inner half spaces only decide which zones are inside,
+	//! zones partly outside of them are border zones and are not excluded.
 	void searchZones(const StelGeom::ConvexS& convex,
-	                 int **inside,int **border,int max_search_level) const;
+	                 int **inside,int **border,int max_search_level,
+	                 int nb_inner = 0) const;
 
 	//! Return a search result matching the given spatial region
-	//! The result is cached, meaning that it is very fast to search the same region consecutively
+	//! The last few results are cached, meaning that it is very fast to search the same regions consecutively.
+	//! Each search covers the region widened by one zone of max_search_level, so the result may hold zones
+	//! just outside of it, and is reused as long as the region moves or rotates by less than that.
+	//! Only the zones inside the region narrowed by the same margin are inside zones, the others are
+	//! border zones, so inside zones are inside every region the result is reused for.
 	//! @return a GeodesicSearchResult instance which must be used with GeodesicSearchBorderIterator and GeodesicSearchInsideIterator
 	const GeodesicSearchResult* search(const StelGeom::ConvexS& convex, int max_search_level) const;
 	
@@ -127,7 +139,8 @@ private:
 	                 const bool *corner0_inside,
 	                 const bool *corner1_inside,
 	                 const bool *corner2_inside,
-	                 int **inside,int **border,int max_search_level) const;
+	                 int **inside,int **border,int max_search_level,
+	                 int nb_inner) const;
 
 	const int max_level;
 	struct Triangle
@@ -138,10 +151,19 @@ private:
 	// 20*(4^0+4^1+...+4^n)=20*(4*(4^n)-1)/3 triangles total
 	// 2+10*4^n corners
 	
-	//! A cached search result used to avoid doing twice the same search
-	mutable GeodesicSearchResult* cacheSearchResult;
-	mutable int lastMaxSearchlevel;
-	mutable StelGeom::ConvexS lastSearchRegion;
+	//! Cached search results used to avoid doing twice the same search,
+	//! the viewport and the mouse pick regions each keep their own
+	enum { SEARCH_CACHE_SIZE = 4 };
+	struct CachedSearch {
+		GeodesicSearchResult* result;
+		StelGeom::ConvexS region;	// region searched for, before widening
+		int level;					// -1 while unused
+		double margin;				// widening in radian
+		unsigned long lastUse;
+	};
+	static bool covers(const CachedSearch& c, const StelGeom::ConvexS& convex, int max_search_level);
+	mutable CachedSearch searchCache[SEARCH_CACHE_SIZE];
+	mutable unsigned long searchCount;
 };
 
 class GeodesicSearchResult
@@ -155,7 +177,7 @@ private:
 	friend class GeodesicSearchBorderIterator;
 	friend class GeodesicGrid;
 	
-	void search(const StelGeom::ConvexS& convex, int max_search_level);
+	void search(const StelGeom::ConvexS& convex, int max_search_level, int nb_inner = 0);
 	
 	const GeodesicGrid &grid;
 	int **const zones;
@@ -40,6 +40,7 @@
 
 #include "zone_array.h"
 #include "string_array.h"
+#include "name_index.h"
 
 #include <string>
 #include <list>
@@ -271,6 +272,12 @@ HipStarMgr::HipStarMgr(void) :
   }
   max_geodesic_grid_level = -1;
   last_max_search_level = -1;
+  grid = NULL;
+  loader_thread = NULL;
+  loader_lock = SDL_CreateMutex();
+  loader_quit = false;
+  flagStarBatching = true;
+  twinkleSeed = 1;
 }
 
 
@@ -284,6 +291,18 @@ HipStarMgr::~HipStarMgr(void) {
 		SharedData::Instance()->DB()->commit();
 	}
 
+  if (loader_thread) {
+    SDL_mutexP(loader_lock);
+    loader_quit = true;
+    SDL_mutexV(loader_lock);
+    SDL_WaitThread(loader_thread, NULL);
+    for (unsigned int i=0;i<loaded_zone_arrays.size();i++) {
+      delete loaded_zone_arrays[i];
+    }
+    loaded_zone_arrays.clear();
+  }
+  SDL_DestroyMutex(loader_lock);
+
   ZoneArrayMap::iterator it(zone_arrays.end());
   while (it!=zone_arrays.begin()) {
     --it;
@@ -296,6 +315,7 @@ HipStarMgr::~HipStarMgr(void) {
 }
 
 bool HipStarMgr::flagSciNames = true;
+bool HipStarMgr::starLabelsDirty = true;
 double HipStarMgr::current_JDay = 2451545.0;  // Default to J2000 so that constellation art shows up in correct positions at init
 map<int,string> HipStarMgr::common_names_map;
 map<int,string> HipStarMgr::common_names_map_i18n;
@@ -330,6 +350,7 @@ void HipStarMgr::init(float font_size, const string& font_name, LoadingBar& lb,
 }
 
 void HipStarMgr::setGrid(GeodesicGrid* geodesic_grid) {
+  grid = geodesic_grid;
   geodesic_grid->visitTriangles(max_geodesic_grid_level,initTriangleFunc,this);
   for (ZoneArrayMap::const_iterator it(zone_arrays.begin());
        it!=zone_arrays.end();it++) {
@@ -358,6 +379,8 @@ void HipStarMgr::load_data(const InitParser &baseConf, LoadingBar& lb)
 
 	InitParser conf;
 	conf.load(AppSettings::Instance()->getDataRoot() + "/stars/default/stars.ini");
+
+	const bool background = baseConf.get_boolean("stars","flag_background_loading",true);
 				         
 	for (int i=0; i<100; i++)
 	{
@@ -365,25 +388,44 @@ void HipStarMgr::load_data(const InitParser &baseConf, LoadingBar& lb)
 		sprintf(key_name,"cat_file_name_%02d",i);
 		const string cat_file_name = conf.get_str("stars",key_name,"").c_str();
 		if (!cat_file_name.empty()) {
+			// The grid depth must be known now, even for the catalogues
+			// loaded later
+			int type, level;
+			if (!ZoneArray::readHeader(cat_file_name, type, level))
+			{
+				cerr << cat_file_name << ": can't read catalogue header" << endl;
+				continue;
+			}
+			if (max_geodesic_grid_level < level)
+			{
+				max_geodesic_grid_level = level;
+			}
+
+			// Hipparcos catalogues (type 0) are needed at once for the
+			// constellations and the HP index, the others can wait
+			if (background && type != 0)
+			{
+				background_cat_files.push_back(cat_file_name);
+				continue;
+			}
+
 			lb.SetMessage(_("Loading catalog ") + cat_file_name);
-			ZoneArray *const z = ZoneArray::create(*this,cat_file_name,lb);
-			if (z)
+			ZoneArray *const z = ZoneArray::create(*this,cat_file_name,&lb);
+			if (z) addZoneArray(z, cat_file_name);
+		}
+	}
+
+	if (!background_cat_files.empty())
+	{
+		loader_thread = SDL_CreateThread(&HipStarMgr::loaderThread, this);
+		if (!loader_thread)
+		{
+			cerr << "Can't create star catalogue loading thread, loading now" << endl;
+			for (unsigned int i=0; i<background_cat_files.size(); i++)
 			{
-				if (max_geodesic_grid_level < z->level)
-				{
-					max_geodesic_grid_level = z->level;
-				}
-				ZoneArray *&pos(zone_arrays[z->level]);
-				if (pos)
-				{
-					cerr << cat_file_name << ", " << z->level
-						 << ": duplicate level" << endl;
-					delete z;
-				}
-				else
-				{
-					pos = z;
-				}
+				lb.SetMessage(_("Loading catalog ") + background_cat_files[i]);
+				ZoneArray *const z = ZoneArray::create(*this,background_cat_files[i],&lb);
+				if (z) addZoneArray(z, background_cat_files[i]);
 			}
 		}
 	}
@@ -440,12 +482,91 @@ void HipStarMgr::load_data(const InitParser &baseConf, LoadingBar& lb)
 		}
 	}
 
-	last_max_search_level = max_geodesic_grid_level;
+	last_max_search_level = zone_arrays.empty() ? -1 : zone_arrays.rbegin()->first;
 	cout << "finished, max_geodesic_level: " << max_geodesic_grid_level << endl;
 }
 
+bool HipStarMgr::addZoneArray(ZoneArray *z, const string &cat_file_name)
+{
+	ZoneArray *&pos(zone_arrays[z->level]);
+	if (pos)
+	{
+		cerr << cat_file_name << ", " << z->level
+			 << ": duplicate level" << endl;
+		delete z;
+		return false;
+	}
+	pos = z;
+	return true;
+}
+
+int HipStarMgr::loaderThread(void *data)
+{
+	HipStarMgr *mgr = (HipStarMgr*)data;
+
+	for (unsigned int i=0; i<mgr->background_cat_files.size(); i++)
+	{
+		SDL_mutexP(mgr->loader_lock);
+		const bool quit = mgr->loader_quit;
+		SDL_mutexV(mgr->loader_lock);
+		if (quit) break;
+
+		ZoneArray *const z = ZoneArray::create(*mgr,mgr->background_cat_files[i],NULL);
+		if (!z) continue;
+
+		SDL_mutexP(mgr->loader_lock);
+		mgr->loaded_zone_arrays.push_back(z);
+		SDL_mutexV(mgr->loader_lock);
+	}
+	return 0;
+}
+
+void HipStarMgr::initZoneArrayTriangleFunc(int lev, int index,
+                                           const Vec3d &c0,
+                                           const Vec3d &c1,
+                                           const Vec3d &c2,
+                                           void *context)
+{
+	ZoneArray *const z = reinterpret_cast<ZoneArray*>(context);
+	if (lev == z->level) z->initTriangle(index, c0, c1, c2);
+}
+
+// The new levels are only added here, in the main thread, so that drawing
+// and searching never see a partly loaded catalogue
+void HipStarMgr::addLoadedZoneArrays(void)
+{
+	if (!loader_thread || !grid) return;
+
+	vector<ZoneArray*> loaded;
+	SDL_mutexP(loader_lock);
+	loaded.swap(loaded_zone_arrays);
+	SDL_mutexV(loader_lock);
+
+	for (unsigned int i=0; i<loaded.size(); i++)
+	{
+		ZoneArray *const z = loaded[i];
+		if (!addZoneArray(z, "background catalogue")) continue;
+
+		grid->visitTriangles(z->level, initZoneArrayTriangleFunc, z);
+		z->scaleAxis();
+		z->updateHipIndex(hip_index);
+		starLabelsDirty = true;
+		if (last_max_search_level < z->level) last_max_search_level = z->level;
+		cout << "Star catalogue level " << z->level << " available" << endl;
+	}
+}
+
+void HipStarMgr::update(double deltaTime) {
+  names_fader.update((int)(deltaTime*1000));
+  starsFader.update((int)(deltaTime*1000));
+
+  // also while the stars are hidden, so that searches see the new levels
+  addLoadedZoneArrays();
+}
+
 // Load common names from file 
 int HipStarMgr::load_common_names(const string& commonNameFile) {
+  starLabelsDirty = true;
   common_names_map.clear();
   common_names_map_i18n.clear();
   common_names_index.clear();
@@ -524,6 +645,7 @@ int HipStarMgr::load_common_names(const string& commonNameFile) {
 // Load scientific names from file 
 void HipStarMgr::load_sci_names(const string& sciNameFile)
 {
+  starLabelsDirty = true;
   sci_names_map_i18n.clear();
   sci_names_index_i18n.clear();
 
@@ -588,25 +710,117 @@ int HipStarMgr::drawStar(const Projector *prj,const Vec3d &XY,
     // see Procyon.
   glBlendFunc(GL_ONE, GL_ONE);
 
-  float mag = 2.f*rc_mag[0];
-
   if (flagPointStar) {
     //! Draw the star rendered as GLpoint. This may be faster but it is not so nice
     prj->drawPoint2d(XY[0], XY[1]);
   } else {
-    float mag = 2.f*rc_mag[0];
-	
-	// Roll off star size limit as fov decreases to match planet halo scale
-    RangeMap<float> rmap(180, 1, -starSizeLimit, -(starSizeLimit + objectSizeLimit)); 
-    float rolloff = -rmap.Map(prj->get_fov());
-    if( mag > rolloff )
-    	mag = rolloff;
+    prj->drawSprite2dMode(XY[0], XY[1], computeStarSize(prj, rc_mag));
+  }
+  return 0;
+}
+
+float HipStarMgr::computeStarSize(const Projector *prj,
+                                  const float rc_mag[2]) const {
+  float mag = 2.f*rc_mag[0];
+
+  // Roll off star size limit as fov decreases to match planet halo scale
+  RangeMap<float> rmap(180, 1, -starSizeLimit, -(starSizeLimit + objectSizeLimit));
+  float rolloff = -rmap.Map(prj->get_fov());
+  if( mag > rolloff )
+    mag = rolloff;
+  return mag;
+}
+
+// Keep each batch small enough to stay in the driver's fast path
+#define STAR_BATCH_MAX_VERTICES (4*8192)
+
+int HipStarMgr::batchStar(const Projector *prj,const Vec3d &XY,
+                          const float rc_mag[2],
+                          const Vec3f &color) const {
+  if (rc_mag[0]<=0.f || rc_mag[1]<=0.f) return -1;
 
-    prj->drawSprite2dMode(XY[0], XY[1], mag);
+  // Same twinkle as drawStar, from a cheap LCG instead of rand()
+  twinkleSeed = twinkleSeed*1664525u + 1013904223u;
+  const float twinkle = 1.f - twinkle_amount*(twinkleSeed>>8)*(1.f/16777216.f);
+  const Vec3f c(color*rc_mag[1]*twinkle);
+
+  StarBatchVertex v;
+  v.color[0] = c[0];
+  v.color[1] = c[1];
+  v.color[2] = c[2];
+  v.pos[2] = 0.f;
+
+  if (flagPointStar) {
+    v.tex[0] = v.tex[1] = 0.f;
+    v.pos[0] = XY[0];
+    v.pos[1] = XY[1];
+    starBatch.push_back(v);
+  } else {
+    const float radius = computeStarSize(prj, rc_mag)*0.5f;
+    static const float corners[4][2] = {{0,0},{1,0},{1,1},{0,1}};
+    for (int i=0;i<4;i++) {
+      v.tex[0] = corners[i][0];
+      v.tex[1] = corners[i][1];
+      v.pos[0] = XY[0] + (2.f*corners[i][0]-1.f)*radius;
+      v.pos[1] = XY[1] + (2.f*corners[i][1]-1.f)*radius;
+      starBatch.push_back(v);
+    }
   }
+
+  if (starBatch.size() >= STAR_BATCH_MAX_VERTICES) flushStarBatch();
   return 0;
 }
 
+void HipStarMgr::batchStarName(const Vec3d &XY, const Vec4f &color,
+                               int label) const {
+  StarBatchName n;
+  n.pos = XY;
+  n.color = color;
+  n.label = label;
+  starNameBatch.push_back(n);
+}
+
+void HipStarMgr::flushStarBatch(void) const {
+  if (starBatch.empty()) return;
+
+  glBlendFunc(GL_ONE, GL_ONE);
+  glInterleavedArrays(GL_T2F_C3F_V3F, 0, &starBatch[0]);
+  if (flagPointStar) {
+    glDisable(GL_TEXTURE_2D);
+    glPointSize(0.1);
+    glDrawArrays(GL_POINTS, 0, starBatch.size());
+    glEnable(GL_TEXTURE_2D);
+  } else {
+    starTexture->bind();
+    glDrawArrays(GL_QUADS, 0, starBatch.size());
+  }
+  glDisableClientState(GL_TEXTURE_COORD_ARRAY);
+  glDisableClientState(GL_COLOR_ARRAY);
+  glDisableClientState(GL_VERTEX_ARRAY);
+
+  starBatch.clear();
+}
+
+void HipStarMgr::drawStarNameBatch(const Projector *prj) const {
+  starFont->beginBatch();
+  for (vector<StarBatchName>::const_iterator it(starNameBatch.begin());
+       it!=starNameBatch.end();it++) {
+    glColor4fv(it->color);
+    prj->drawText(starFont,it->pos[0],it->pos[1], starLabels[it->label], 0, 4, 4, false);
+  }
+  starFont->endBatch();
+  starNameBatch.clear();
+}
+
+void HipStarMgr::updateStarLabels(void) {
+  starLabels.clear();
+  for (ZoneArrayMap::const_iterator it(zone_arrays.begin());
+       it!=zone_arrays.end();it++) {
+    it->second->updateLabels(starLabels);
+  }
+  starLabelsDirty = false;
+}
+
 int HipStarMgr::getMaxSearchLevel(const ToneReproductor *eye,
                                const Projector *prj) const {
   int rval = -1;
@@ -707,6 +921,8 @@ double HipStarMgr::draw(Core* core, ToneReproductor* eye, Projector* prj)
     // projecting all stars just to draw disembodied labels
     if(!starsFader.getInterstate()) return 0.;
 
+    if (starLabelsDirty) updateStarLabels();
+
     prj->set_orthographic_projection();
 	int max_search_level = getMaxSearchLevel(eye, prj);
 	const GeodesicSearchResult* geodesic_search_result = core->getGeodesicGrid()->search(prj->unprojectViewport(),max_search_level);
@@ -778,6 +994,11 @@ double HipStarMgr::draw(Core* core, ToneReproductor* eye, Projector* prj)
     }
     exit_loop:
 
+    if (flagStarBatching) {
+      flushStarBatch();
+      drawStarNameBatch(prj);
+    }
+
     prj->reset_perspective_projection();
     return 0.;
 }
@@ -869,6 +1090,7 @@ vector<ObjectBaseP > HipStarMgr::searchAround(const Vec3d& vv,
 //! Update i18 names from english names according to passed translator.
 //! The translation is done using gettext with translated strings defined in translations.h
 void HipStarMgr::updateI18n(Translator& trans) {
+  starLabelsDirty = true;
   common_names_map_i18n.clear();
   common_names_index_i18n.clear();
   for (map<int,string>::iterator it(common_names_map.begin());
@@ -1077,6 +1299,24 @@ vector<string> HipStarMgr::listMatchingObjectsI18n(
   return result;
 }
 
+void HipStarMgr::addNamesToIndex(NameIndex& index) const {
+  for (map<int,string>::const_iterator it(common_names_map_i18n.begin());
+       it!=common_names_map_i18n.end();it++) {
+    ObjectBaseP star = searchHP(it->first);
+    const float rank = star ? star->get_mag(0) : 99.f;
+    index.add(it->second, it->second, ObjectRecord::OBJECT_STAR, it->first, rank);
+    map<int,string>::const_iterator en(common_names_map.find(it->first));
+    if (en!=common_names_map.end())
+      index.add(en->second, it->second, ObjectRecord::OBJECT_STAR, it->first, rank);
+  }
+  for (map<int,string>::const_iterator it(sci_names_map_i18n.begin());
+       it!=sci_names_map_i18n.end();it++) {
+    ObjectBaseP star = searchHP(it->first);
+    const float rank = star ? star->get_mag(0) : 99.f;
+    index.add(it->second, it->second, ObjectRecord::OBJECT_STAR, it->first, rank);
+  }
+}
+
 //! Define font file name and size to use for star names display
 void HipStarMgr::setFont(float font_size, const string& font_name)
 {
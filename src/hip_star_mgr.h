@@ -27,6 +27,7 @@
 #include <fstream>
 #include <cstdlib>
 #include <cstdio>
+#include "SDL_thread.h"
 #include "fader.h"
 #include "core.h"
 #include "object_type.h"
@@ -95,7 +96,7 @@ public:
 	
 	//! Update any time-dependent features.
 	//! Includes fading in and out stars and labels when they are turned on and off.
-	virtual void update(double deltaTime) {names_fader.update((int)(deltaTime*1000)); starsFader.update((int)(deltaTime*1000));}
+	virtual void update(double deltaTime);
 	
 	//! Translate text.
 	virtual void updateI18n(Translator& trans);
@@ -122,6 +123,9 @@ public:
 	//! @param maxNbItem the maximum number of returned object names
 	//! @return a vector of matching object name by order of relevance, or an empty vector if nothing match
 	virtual vector<string> listMatchingObjectsI18n(const string& objPrefix, unsigned int maxNbItem=5) const;
+
+	//! Add the common and scientific star names to the search index
+	void addNamesToIndex(NameIndex& index) const;
 	
 	///////////////////////////////////////////////////////////////////////////
 	// Properties setters and getters
@@ -219,6 +223,12 @@ public:
 	}
 	//! Get flag for displaying Star as GLpoints (faster on some hardware but not so nice).
 	bool getFlagPointStar(void) const {return flagPointStar;}
+
+	//! Set flag for submitting the stars of a frame as vertex array batches
+	//! instead of one immediate mode sprite per star.
+	void setFlagStarBatching(bool b) {flagStarBatching=b;}
+	//! Get flag for submitting the stars of a frame as vertex array batches.
+	bool getFlagStarBatching(void) const {return flagStarBatching;}
 	
 	//! Set maximum magnitude at which stars names are displayed.
 	void setMaxMagName(float b) {
@@ -332,12 +342,24 @@ public:
 	void setFont(float font_size, const string& font_name);
 	
 	//! Show scientific or catalog names on stars without common names.
-	static void setFlagSciNames(bool f) {flagSciNames = f;}
+	static void setFlagSciNames(bool f) {flagSciNames = f; starLabelsDirty = true;}
 	static bool getFlagSciNames(void) {return flagSciNames;}
 	
 	//! Draw a star of specified position, magnitude and color.
 	int drawStar(const Projector *prj, const Vec3d &XY,
 			const float rc_mag[2], const Vec3f &color) const;
+
+	//! Append a star of specified position, magnitude and color to the
+	//! current frame batch. Same return value as drawStar.
+	int batchStar(const Projector *prj, const Vec3d &XY,
+			const float rc_mag[2], const Vec3f &color) const;
+
+	//! Queue a star label, drawn once all the batched stars are flushed.
+	//! @param label index of the label text, see getStarLabel
+	void batchStarName(const Vec3d &XY, const Vec4f &color, int label) const;
+
+	//! Get the text of a label of the per zone star label tables.
+	const string &getStarLabel(int label) const {return starLabels[label];}
 	
 	//! Get the (translated) common name for a star with a specified 
 	//! Hipparcos catalogue number.
@@ -353,7 +375,30 @@ public:
 	static string convertToComponentIds(int index);
 private:
 	//! Load all the stars from the files.
+	//! Catalogues other than the Hipparcos ones may be left to a background
+	//! thread, see addLoadedZoneArrays.
 	void load_data(const InitParser &conf, LoadingBar& lb);
+
+	//! Add a loaded catalogue to zone_arrays, false if its level is already there.
+	bool addZoneArray(BigStarCatalogExtension::ZoneArray *z, const string &cat_file_name);
+
+	//! Make the catalogues finished by the loader thread drawable.
+	void addLoadedZoneArrays(void);
+
+	static int loaderThread(void *data);
+
+	//! Compute the on screen sprite size of a star from its rc_mag.
+	float computeStarSize(const Projector *prj, const float rc_mag[2]) const;
+
+	//! Submit all batched stars in a single draw call and clear the batch.
+	void flushStarBatch(void) const;
+
+	//! Draw the labels queued by batchStarName.
+	void drawStarNameBatch(const Projector *prj) const;
+
+	//! Rebuild the label pool and the label tables of the zone arrays
+	//! after names, language or the scientific names flag changed.
+	void updateStarLabels(void);
 	
 	LinearFader names_fader;
 	LinearFader starsFader;
@@ -368,7 +413,23 @@ private:
 	bool flagStarTwinkle;
 	float twinkleAmount;
 	bool flagPointStar;
+	bool flagStarBatching;
 	bool gravityLabel;
+
+	// Interleaved layout matching GL_T2F_C3F_V3F
+	struct StarBatchVertex {
+		float tex[2];
+		float color[3];
+		float pos[3];
+	};
+	struct StarBatchName {
+		Vec3d pos;
+		Vec4f color;
+		int label;
+	};
+	mutable vector<StarBatchVertex> starBatch;
+	mutable vector<StarBatchName> starNameBatch;
+	mutable unsigned int twinkleSeed;
 	
 	s_texture* starTexture; // star texture
 	
@@ -389,6 +450,22 @@ private:
 			const Vec3d &c0,
 			const Vec3d &c1,
 			const Vec3d &c2);
+
+	// Same for a single zone array, added after setGrid
+	static void initZoneArrayTriangleFunc(int lev, int index,
+				const Vec3d &c0,
+				const Vec3d &c1,
+				const Vec3d &c2,
+				void *context);
+
+	GeodesicGrid *grid;
+
+	// Background loading of the catalogues
+	vector<string> background_cat_files;	// loaded in this order by the thread
+	vector<BigStarCatalogExtension::ZoneArray*> loaded_zone_arrays;	// waiting for addLoadedZoneArrays
+	SDL_Thread *loader_thread;
+	SDL_mutex *loader_lock;
+	bool loader_quit;
 	
 	BigStarCatalogExtension::HipIndexStruct *hip_index; // array of hiparcos stars
 	
@@ -439,6 +516,8 @@ private:
 	double fontSize;
 	s_font* starFont;
 	static bool flagSciNames;
+	static bool starLabelsDirty;
+	vector<string> starLabels;	// labels of the named stars, in zone array order
 	Vec3f label_color, circle_color;
 	float twinkle_amount;
 	
@@ -184,6 +184,26 @@ string StarWrapper1::getShortInfoString(const Navigator *nav) const
 }
 
 
+Vec3d StarWrapperSoa::getObsJ2000Pos(const Navigator*) const {
+  const double d2000 = 2451545.0;
+  return a->getJ2000Pos(zone,i,
+                        (M_PI/180)*(0.0001/3600)
+                         * ((HipStarMgr::getCurrentJDay()-d2000)/365.25)
+                         / a->star_position_scale);
+}
+
+Vec3f StarWrapperSoa::get_RGB(void) const {
+  return HipStarMgr::color_table[a->getBV(i)];
+}
+
+float StarWrapperSoa::get_mag(const Navigator *nav) const {
+  return 0.001f*a->mag_min + a->getMag(i)*(0.001f*a->mag_range)/a->mag_steps;
+}
+
+float StarWrapperSoa::getBV(void) const {
+  return IndexToBV(a->getBV(i));
+}
+
 ObjectBaseP Star1::createStelObject(const SpecialZoneArray<Star1> *a,
                                     const SpecialZoneData<Star1> *z) const {
   return ObjectBaseP(new StarWrapper1(a,z,this));
@@ -29,6 +29,7 @@ namespace BigStarCatalogExtension {
 
 template <class Star> struct SpecialZoneArray;
 template <class Star> struct SpecialZoneData;
+class SoaZoneArray;
 
 
 // A Star (Star1,Star2,Star3,...) cannot be a StelObject. The additional
@@ -123,6 +124,27 @@ public:
                const Star3 *s) : StarWrapper<Star3>(a,z,s) {}
 };
 
+// A star of a structure-of-arrays catalogue, which has no Star struct
+// to point to.
+class StarWrapperSoa : public StarWrapperBase {
+public:
+  StarWrapperSoa(const SoaZoneArray *a,int zone,unsigned int i)
+    : a(a),zone(zone),i(i) {}
+protected:
+  Vec3d getObsJ2000Pos(const Navigator*) const;
+  Vec3d get_earth_equ_pos(const Navigator *nav) const
+    {return nav->j2000_to_earth_equ(getObsJ2000Pos(nav));}
+  Vec3f get_RGB(void) const;
+  float get_mag(const Navigator *nav) const;
+  float getSelectPriority(const Navigator *nav) const {return get_mag(nav);}
+  float getBV(void) const;
+  string getNameI18n(void) const {return "";}
+private:
+  const SoaZoneArray *const a;
+  const int zone;
+  const unsigned int i;
+};
+
 } // namespace BigStarCatalogExtension
 
 #endif
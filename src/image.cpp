@@ -46,7 +46,7 @@ Image::Image( string filename, string name, IMAGE_POSITIONING pos_type, bool mip
 	// other than through set_alpha method -- could allow alpha load option from command
 
 // add mipmap support 20090501
-	image_tex = new s_texture(1, filename, TEX_LOAD_TYPE_PNG_ALPHA, mipmap);  // what if it doesn't load?
+	image_tex = new s_texture(1, filename, TEX_LOAD_TYPE_PNG_ALPHA, mipmap, true);  // what if it doesn't load?
 	//  image_tex = new s_texture(1, filename, TEX_LOAD_TYPE_PNG_BLEND3);  // black = transparent
 
 	int img_w, img_h;
@@ -0,0 +1,446 @@
+/*
+ * Nightshade (TM) astronomy simulation and visualization
+ *
+ * Copyright (C) 2012 Digitalis Education Solutions, Inc.
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 3
+ * of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place - Suite 330, Boston, MA  02111-1307, USA.
+ *
+ * Nightshade is a trademark of Digitalis Education Solutions, Inc.
+ * See the TRADEMARKS file for trademark usage requirements.
+ *
+ */
+
+
+#include <algorithm>
+#include <cmath>
+#include <functional>
+#include <ostream>
+#include <vector>
+
+#include "kepler.h"
+#include "frame_profiler.h"
+#include "simd_math.h"
+#include "solve.h"
+
+using namespace std;
+
+// The iteration schemes, in the order EllipticalOrbit tests the eccentricity
+enum KeplerScheme {
+	KEPLER_CIRCULAR,
+	KEPLER_LOW,          // ecc < 0.2, 5 steps of the standard iteration
+	KEPLER_MEDIUM,       // ecc < 0.95, 6 steps of Meeus' iteration
+	KEPLER_HIGH,         // ecc < 1, 8 Laguerre-Conway steps
+	KEPLER_PARABOLIC,
+	KEPLER_HYPERBOLIC,   // 30 Laguerre-Conway steps
+	KEPLER_SCHEMES
+};
+
+static inline int Scheme(double ecc)
+{
+	if (ecc == 0.0) return KEPLER_CIRCULAR;
+	if (ecc < 0.2) return KEPLER_LOW;
+	if (ecc < 0.95) return KEPLER_MEDIUM;
+	if (ecc < 1.0) return KEPLER_HIGH;
+	if (ecc == 1.0) return KEPLER_PARABOLIC;
+	return KEPLER_HYPERBOLIC;
+}
+
+// Laguerre-Conway starting value for the hyperbolic equation. The equation
+// is odd in M, so negative anomalies are solved as positive ones.
+static inline double HyperbolicStart(double ecc, double M)
+{
+	return log(2 * fabs(M) / ecc + 1.85);
+}
+
+static inline double sign(double x)
+{
+	if (x < 0.)
+		return -1.;
+	else if (x > 0.)
+		return 1.;
+	else
+		return 0.;
+}
+
+
+// Reference implementation ----------------------------------------------
+
+// Standard iteration for solving Kepler's Equation
+struct SolveKeplerFunc1 : public unary_function<double, double> {
+	double ecc;
+	double M;
+
+	SolveKeplerFunc1(double _ecc, double _M) : ecc(_ecc), M(_M) {};
+
+	double operator()(double x) const {
+		return M + ecc * sin(x);
+	}
+};
+
+
+// Faster converging iteration for Kepler's Equation; more efficient
+// than above for orbits with eccentricities greater than 0.3.  This
+// is from Jean Meeus's _Astronomical Algorithms_ (2nd ed), p. 199
+struct SolveKeplerFunc2 : public unary_function<double, double> {
+	double ecc;
+	double M;
+
+	SolveKeplerFunc2(double _ecc, double _M) : ecc(_ecc), M(_M) {};
+
+	double operator()(double x) const {
+		return x + (M + ecc * sin(x) - x) / (1 - ecc * cos(x));
+	}
+};
+
+struct SolveKeplerLaguerreConway : public unary_function<double, double> {
+	double ecc;
+	double M;
+
+	SolveKeplerLaguerreConway(double _ecc, double _M) : ecc(_ecc), M(_M) {};
+
+	double operator()(double x) const {
+		double s = ecc * sin(x);
+		double c = ecc * cos(x);
+		double f = x - s - M;
+		double f1 = 1 - c;
+		double f2 = s;
+		x += -5 * f / (f1 + sign(f1) * sqrt(fabs(16 * f1 * f1 - 20 * f * f2)));
+
+		return x;
+	}
+};
+
+struct SolveKeplerLaguerreConwayHyp : public unary_function<double, double> {
+	double ecc;
+	double M;
+
+	SolveKeplerLaguerreConwayHyp(double _ecc, double _M) : ecc(_ecc), M(_M) {};
+
+	double operator()(double x) const {
+		double s = ecc * sinh(x);
+		double c = ecc * cosh(x);
+		double f = s - x - M;
+		double f1 = c - 1;
+		double f2 = s;
+		x += -5 * f / (f1 + sign(f1) * sqrt(fabs(16 * f1 * f1 - 20 * f * f2)));
+
+		return x;
+	}
+};
+
+typedef pair<double, double> Solution;
+
+double SolveKeplerEquationReference(double eccentricity, double M)
+{
+	switch (Scheme(eccentricity)) {
+	case KEPLER_CIRCULAR:
+		return M;
+	case KEPLER_LOW: {
+		// Low eccentricity, so use the standard iteration technique
+		Solution sol = solve_iteration_fixed(SolveKeplerFunc1(eccentricity, M), M, 5);
+		return sol.first;
+	}
+	case KEPLER_MEDIUM: {
+		// Higher eccentricity elliptical orbit; use a more complex but
+		// much faster converging iteration.
+		Solution sol = solve_iteration_fixed(SolveKeplerFunc2(eccentricity, M), M, 6);
+		return sol.first;
+	}
+	case KEPLER_HIGH: {
+		// Extremely stable Laguerre-Conway method for solving Kepler's
+		// equation.  Only use this for high-eccentricity orbits, as it
+		// requires more calcuation.
+		double E = M + 0.85 * eccentricity * sign(sin(M));
+		Solution sol = solve_iteration_fixed(SolveKeplerLaguerreConway(eccentricity, M), E, 8);
+		return sol.first;
+	}
+	case KEPLER_PARABOLIC:
+		return M;
+	default: {
+		// Laguerre-Conway method for hyperbolic (ecc > 1) orbits.
+		double E = HyperbolicStart(eccentricity, M);
+		Solution sol = solve_iteration_fixed(SolveKeplerLaguerreConwayHyp(eccentricity, fabs(M)), E, 30);
+		return M < 0 ? -sol.first : sol.first;
+	}
+	}
+}
+
+
+// Batch solver ----------------------------------------------------------
+
+#ifdef HAVE_SIMD_DOUBLE
+
+using namespace SimdMath;
+typedef SimdD S;
+
+// Each kernel solves one vector of lanes with the steps of its scheme
+
+static S::V KernelIdentity(S::V ecc, S::V M)
+{
+	return M;
+}
+
+static S::V KernelLow(S::V ecc, S::V M)
+{
+	S::V x = M, s, c;
+	for (int i=0; i<5; i++) {
+		SimdMath::sincos(x, s, c);
+		x = madd(ecc, s, M);
+	}
+	return x;
+}
+
+static S::V KernelMedium(S::V ecc, S::V M)
+{
+	const S::V one = S::set1(1.0);
+	S::V x = M, s, c;
+	for (int i=0; i<6; i++) {
+		SimdMath::sincos(x, s, c);
+		x = S::add(x, S::div(S::sub(madd(ecc, s, M), x), S::sub(one, S::mul(ecc, c))));
+	}
+	return x;
+}
+
+static inline S::V Sign(S::V x)
+{
+	return S::select(S::gt(x, S::zero()), S::set1(1.0),
+	                 S::select(S::lt(x, S::zero()), S::set1(-1.0), S::zero()));
+}
+
+// x += -5 f / (f1 + sign(f1) sqrt(|16 f1^2 - 20 f f2|))
+static inline S::V LaguerreConwayStep(S::V x, S::V f, S::V f1, S::V f2)
+{
+	const S::V d = S::sub(S::mul(S::mul(S::set1(16.0), f1), f1), S::mul(S::mul(S::set1(20.0), f), f2));
+	const S::V den = madd(Sign(f1), S::sqrt(abs(d)), f1);
+	return S::add(x, S::div(S::mul(S::set1(-5.0), f), den));
+}
+
+static S::V KernelHigh(S::V ecc, S::V M)
+{
+	S::V s, c;
+	SimdMath::sincos(M, s, c);
+	S::V x = madd(S::mul(S::set1(0.85), ecc), Sign(s), M);
+	for (int i=0; i<8; i++) {
+		SimdMath::sincos(x, s, c);
+		s = S::mul(ecc, s);
+		c = S::mul(ecc, c);
+		const S::V f = S::sub(S::sub(x, s), M);
+		x = LaguerreConwayStep(x, f, S::sub(S::set1(1.0), c), s);
+	}
+	return x;
+}
+
+static S::V KernelHyperbolic(S::V ecc, S::V M)
+{
+	const S::V sign = S::and_(M, S::set1(-0.0));
+	const S::V m = abs(M);
+
+	// the starting value is computed with libm, lane by lane
+	double e_lanes[S::width], m_lanes[S::width];
+	S::store(e_lanes, ecc);
+	S::store(m_lanes, m);
+	for (int k=0; k<S::width; k++) m_lanes[k] = HyperbolicStart(e_lanes[k], m_lanes[k]);
+	S::V x = S::load(m_lanes);
+
+	const S::V half = S::set1(0.5);
+	for (int i=0; i<30; i++) {
+		const S::V ex = SimdMath::exp(x);
+		const S::V emx = S::div(S::set1(1.0), ex);
+		const S::V s = S::mul(ecc, S::mul(half, S::sub(ex, emx)));
+		const S::V c = S::mul(ecc, S::mul(half, S::add(ex, emx)));
+		const S::V f = S::sub(S::sub(s, x), m);
+		x = LaguerreConwayStep(x, f, S::sub(c, S::set1(1.0)), s);
+	}
+	return S::xor_(x, sign);
+}
+
+typedef S::V (*KeplerKernel)(S::V ecc, S::V M);
+
+static const KeplerKernel kernels[KEPLER_SCHEMES] = {
+	KernelIdentity, KernelLow, KernelMedium, KernelHigh, KernelIdentity, KernelHyperbolic
+};
+
+// Solve count elements of one scheme; a constant eccentricity is passed
+// as a single value with ecc_step 0
+static void SolveScheme(int scheme, const double *ecc, int ecc_step,
+                        const double *M, double *E, unsigned int count)
+{
+	const KeplerKernel kernel = kernels[scheme];
+	unsigned int j = 0;
+	for (; j + S::width <= count; j += S::width) {
+		const S::V e = ecc_step ? S::load(ecc + j) : S::set1(*ecc);
+		S::store(E + j, kernel(e, S::load(M + j)));
+	}
+	if (j < count) {
+		// the last vector is padded with copies of the last element
+		double e_pad[S::width], M_pad[S::width], E_pad[S::width];
+		for (unsigned int k=0; k<S::width; k++) {
+			const unsigned int src = min(j + k, count - 1);
+			e_pad[k] = ecc[src*ecc_step];
+			M_pad[k] = M[src];
+		}
+		S::store(E_pad, kernel(S::load(e_pad), S::load(M_pad)));
+		for (unsigned int k=0; j+k<count; k++) E[j+k] = E_pad[k];
+	}
+}
+
+void SolveKeplerEquationBatch(double ecc, const double *M, double *E, unsigned int count)
+{
+	SolveScheme(Scheme(ecc), &ecc, 0, M, E, count);
+}
+
+void SolveKeplerEquationBatch(const double *ecc, const double *M, double *E, unsigned int count)
+{
+	// Elements are gathered by scheme a chunk at a time
+	const unsigned int CHUNK = 256;
+	unsigned char scheme[CHUNK];
+	unsigned int index[CHUNK];
+	double ecc_g[CHUNK], M_g[CHUNK], E_g[CHUNK];
+
+	for (unsigned int first=0; first<count; first+=CHUNK) {
+		const unsigned int n = min(CHUNK, count - first);
+		unsigned int present = 0;
+		for (unsigned int k=0; k<n; k++) {
+			scheme[k] = Scheme(ecc[first+k]);
+			present |= 1 << scheme[k];
+		}
+
+		for (int s=0; s<KEPLER_SCHEMES; s++) {
+			if (!(present & (1 << s))) continue;
+			unsigned int g = 0;
+			for (unsigned int k=0; k<n; k++) {
+				if (scheme[k] != s) continue;
+				index[g] = first + k;
+				ecc_g[g] = ecc[first+k];
+				M_g[g] = M[first+k];
+				g++;
+			}
+			SolveScheme(s, ecc_g, 1, M_g, E_g, g);
+			for (unsigned int k=0; k<g; k++) E[index[k]] = E_g[k];
+		}
+	}
+}
+
+#else
+
+void SolveKeplerEquationBatch(double ecc, const double *M, double *E, unsigned int count)
+{
+	for (unsigned int k=0; k<count; k++) E[k] = SolveKeplerEquationReference(ecc, M[k]);
+}
+
+void SolveKeplerEquationBatch(const double *ecc, const double *M, double *E, unsigned int count)
+{
+	for (unsigned int k=0; k<count; k++) E[k] = SolveKeplerEquationReference(ecc[k], M[k]);
+}
+
+#endif // HAVE_SIMD_DOUBLE
+
+double SolveKeplerEquation(double ecc, double M)
+{
+	double E;
+	SolveKeplerEquationBatch(ecc, &M, &E, 1);
+	return E;
+}
+
+
+// Benchmark -------------------------------------------------------------
+
+// Largest |E - E_reference| / max(1, |E_reference|) accepted by the check
+#define KEPLER_CHECK_TOLERANCE 1e-12
+
+bool BenchmarkKeplerSolver(unsigned int count, int repeat, ostream &os)
+{
+	static const char *scheme_names[KEPLER_SCHEMES] = {
+		"circular", "e < 0.2", "e < 0.95", "e < 1", "parabolic", "e > 1"
+	};
+
+	// Fixed pseudo random elements so runs compare: mostly asteroid-like
+	// eccentricities, a few near parabolic and hyperbolic ones
+	vector<double> ecc(count), M(count), E_ref(count), E_batch(count), E_scalar(count);
+	unsigned int seed = 12345;
+	for (unsigned int k=0; k<count; k++) {
+		seed = seed*1103515245 + 12345;
+		const double u = (seed >> 8) / 16777216.0;
+		seed = seed*1103515245 + 12345;
+		const double v = (seed >> 8) / 16777216.0;
+		switch (k % 20) {
+		case 0:
+			ecc[k] = 0.95 + 0.05*u;
+			break;
+		case 1:
+			ecc[k] = 1.0 + 2.0*u;
+			break;
+		default:
+			ecc[k] = (k % 2) ? 0.2*u : 0.2 + 0.75*u;
+			break;
+		}
+		M[k] = (v - 0.5) * 40.0;
+	}
+
+	double t = FrameProfiler::getTime();
+	for (int r=0; r<repeat; r++)
+		for (unsigned int k=0; k<count; k++) E_ref[k] = SolveKeplerEquationReference(ecc[k], M[k]);
+	const double reference = FrameProfiler::getTime() - t;
+
+	t = FrameProfiler::getTime();
+	for (int r=0; r<repeat; r++)
+		for (unsigned int k=0; k<count; k++) E_scalar[k] = SolveKeplerEquation(ecc[k], M[k]);
+	const double scalar = FrameProfiler::getTime() - t;
+
+	t = FrameProfiler::getTime();
+	for (int r=0; r<repeat; r++) SolveKeplerEquationBatch(&ecc[0], &M[0], &E_batch[0], count);
+	const double batch = FrameProfiler::getTime() - t;
+
+	// orbit line sampling: one eccentricity per call
+	vector<double> E_one(count);
+	t = FrameProfiler::getTime();
+	for (int r=0; r<repeat; r++) SolveKeplerEquationBatch(0.5, &M[0], &E_one[0], count);
+	const double batch_one = FrameProfiler::getTime() - t;
+
+	double max_diff[KEPLER_SCHEMES], max_residual[KEPLER_SCHEMES];
+	unsigned int nb[KEPLER_SCHEMES];
+	for (int s=0; s<KEPLER_SCHEMES; s++) max_diff[s] = max_residual[s] = nb[s] = 0;
+	unsigned int mismatches = 0, inaccurate = 0;
+	for (unsigned int k=0; k<count; k++) {
+		const int s = Scheme(ecc[k]);
+		nb[s]++;
+		max_diff[s] = max(max_diff[s], fabs(E_batch[k] - E_ref[k]));
+		if (fabs(E_batch[k] - E_ref[k]) > KEPLER_CHECK_TOLERANCE * max(1.0, fabs(E_ref[k]))) inaccurate++;
+		const double residual = (ecc[k] < 1.0)
+		                        ? E_batch[k] - ecc[k]*sin(E_batch[k]) - M[k]
+		                        : ecc[k]*sinh(E_batch[k]) - E_batch[k] - M[k];
+		max_residual[s] = max(max_residual[s], fabs(residual));
+		if (E_batch[k] != E_scalar[k]) mismatches++;
+	}
+	for (unsigned int k=0; k<count; k++)
+		if (E_one[k] != SolveKeplerEquation(0.5, M[k])) mismatches++;
+
+	const double solves = (double)count * repeat;
+	os << "Kepler solver, " << solves << " solves" << endl
+	   << "  reference:   " << reference*1.e6/solves << " ns/solve" << endl
+	   << "  scalar:      " << scalar*1.e6/solves << " ns/solve" << endl
+	   << "  batch:       " << batch*1.e6/solves << " ns/solve" << endl
+	   << "  batch e=0.5: " << batch_one*1.e6/solves << " ns/solve" << endl
+	   << "  batch and scalar results differing: " << mismatches << endl;
+	for (int s=0; s<KEPLER_SCHEMES; s++) {
+		if (nb[s] == 0) continue;
+		os << "  " << scheme_names[s] << ": " << nb[s] << " elements, max |E - E_reference| "
+		   << max_diff[s] << ", max residual " << max_residual[s] << endl;
+	}
+	const bool passed = !mismatches && !inaccurate;
+	os << "  " << inaccurate << " results off the reference by more than " << KEPLER_CHECK_TOLERANCE
+	   << (passed ? " OK" : " FAIL") << endl;
+	return passed;
+}
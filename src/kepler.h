@@ -0,0 +1,57 @@
+/*
+ * Nightshade (TM) astronomy simulation and visualization
+ *
+ * Copyright (C) 2012 Digitalis Education Solutions, Inc.
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 3
+ * of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place - Suite 330, Boston, MA  02111-1307, USA.
+ *
+ * Nightshade is a trademark of Digitalis Education Solutions, Inc.
+ * See the TRADEMARKS file for trademark usage requirements.
+ *
+ */
+
+
+// Kepler's equation solved for arrays of mean anomalies. Each eccentricity
+// selects one of the iteration schemes EllipticalOrbit has always used,
+// with its fixed number of steps; elements are grouped by scheme and
+// iterated in SIMD lanes where available. A lane never depends on its
+// neighbours, so a result is the same whatever batch it was solved in.
+
+#ifndef _KEPLER_H_
+#define _KEPLER_H_
+
+#include <ostream>
+
+// Eccentric anomaly (hyperbolic anomaly when ecc > 1) for the mean anomaly M.
+// Parabolic orbits (ecc == 1) return M, see ParabolicOrbitPlanePosition.
+double SolveKeplerEquation(double ecc, double M);
+
+// E[k] = SolveKeplerEquation(ecc, M[k]) for count mean anomalies of one orbit
+void SolveKeplerEquationBatch(double ecc, const double *M, double *E, unsigned int count);
+
+// E[k] = SolveKeplerEquation(ecc[k], M[k]); E may be the same array as M
+void SolveKeplerEquationBatch(const double *ecc, const double *M, double *E, unsigned int count);
+
+// The scalar implementation with the libm functions that preceded the batch
+// solver, kept to check it against
+double SolveKeplerEquationReference(double ecc, double M);
+
+// Accuracy of the batch solver against the reference on count random
+// elements, and the throughput of both, written to os.
+// Returns false when a result is off the reference by more than
+// KEPLER_CHECK_TOLERANCE or when batch and scalar results differ.
+bool BenchmarkKeplerSolver(unsigned int count, int repeat, std::ostream &os);
+
+#endif // _KEPLER_H_
@@ -200,7 +200,7 @@ void LandscapeOldStyle::load(const string& landscape_file, const string& section
 	char tmp[255];
 	for (int i=0; i<nb_side_texs; ++i) {
 		sprintf(tmp,"tex%d",i);
-		side_texs[i] = new s_texture(pd.get_str(section_name, tmp),TEX_LOAD_TYPE_PNG_ALPHA,false);
+		side_texs[i] = new s_texture(false, pd.get_str(section_name, tmp),TEX_LOAD_TYPE_PNG_ALPHA,false,true);
 	}
 
 	// Init sides parameters
@@ -223,7 +223,7 @@ void LandscapeOldStyle::load(const string& landscape_file, const string& section
 
 	nb_decor_repeat = pd.get_int(section_name, "nb_decor_repeat", 1);
 
-	ground_tex = new s_texture(pd.get_str(section_name, "groundtex"),TEX_LOAD_TYPE_PNG_SOLID,false);
+	ground_tex = new s_texture(false, pd.get_str(section_name, "groundtex"),TEX_LOAD_TYPE_PNG_SOLID,false,true);
 	s = pd.get_str(section_name, "ground");
 	sscanf(s.c_str(),"groundtex:%f:%f:%f:%f",&a,&b,&c,&d);
 	ground_tex_coord.tex = ground_tex;
@@ -232,7 +232,7 @@ void LandscapeOldStyle::load(const string& landscape_file, const string& section
 	ground_tex_coord.tex_coords[2] = c;
 	ground_tex_coord.tex_coords[3] = d;
 
-	fog_tex = new s_texture(pd.get_str(section_name, "fogtex"),TEX_LOAD_TYPE_PNG_SOLID_REPEAT,false);
+	fog_tex = new s_texture(false, pd.get_str(section_name, "fogtex"),TEX_LOAD_TYPE_PNG_SOLID_REPEAT,false,true);
 	s = pd.get_str(section_name, "fog");
 	sscanf(s.c_str(),"fogtex:%f:%f:%f:%f",&a,&b,&c,&d);
 	fog_tex_coord.tex = fog_tex;
@@ -266,7 +266,7 @@ void LandscapeOldStyle::create(bool _fullpath, stringHash_t param)
 	for (int i=0; i<nb_side_texs; ++i) {
 
 		sprintf(tmp,"tex%d",i);
-		side_texs[i] = new s_texture(_fullpath, param["path"] + param[tmp],TEX_LOAD_TYPE_PNG_ALPHA, false);
+		side_texs[i] = new s_texture(_fullpath, param["path"] + param[tmp],TEX_LOAD_TYPE_PNG_ALPHA, false, true);
 
 	}
 
@@ -290,7 +290,7 @@ void LandscapeOldStyle::create(bool _fullpath, stringHash_t param)
 
 	nb_decor_repeat = str_to_int(param["nb_decor_repeat"], 1);
 
-	ground_tex = new s_texture(_fullpath, param["path"] + param["groundtex"],TEX_LOAD_TYPE_PNG_SOLID, false);
+	ground_tex = new s_texture(_fullpath, param["path"] + param["groundtex"],TEX_LOAD_TYPE_PNG_SOLID, false, true);
 	s = param["ground"];
 	sscanf(s.c_str(),"groundtex:%f:%f:%f:%f",&a,&b,&c,&d);
 	ground_tex_coord.tex = ground_tex;
@@ -299,7 +299,7 @@ void LandscapeOldStyle::create(bool _fullpath, stringHash_t param)
 	ground_tex_coord.tex_coords[2] = c;
 	ground_tex_coord.tex_coords[3] = d;
 
-	fog_tex = new s_texture(_fullpath, param["path"] + param["fogtex"],TEX_LOAD_TYPE_PNG_SOLID_REPEAT, false);
+	fog_tex = new s_texture(_fullpath, param["path"] + param["fogtex"],TEX_LOAD_TYPE_PNG_SOLID_REPEAT, false, true);
 	s = param["fog"];
 	sscanf(s.c_str(),"fogtex:%f:%f:%f:%f",&a,&b,&c,&d);
 	fog_tex_coord.tex = fog_tex;
@@ -452,9 +452,9 @@ void LandscapeFisheye::create(const string _name, bool _fullpath, const string _
 	//	cout << _name << " " << _fullpath << " " << _maptex << " " << _texturefov << "\n";
 	valid_landscape = 1;  // assume ok...
 	name = _name;
-	map_tex = new s_texture(_fullpath,_maptex,TEX_LOAD_TYPE_PNG_ALPHA,_mipmap);
+	map_tex = new s_texture(_fullpath,_maptex,TEX_LOAD_TYPE_PNG_ALPHA,_mipmap,true);
 
-	if (_maptex_night != "") map_tex_night = new s_texture(_fullpath,_maptex_night,TEX_LOAD_TYPE_PNG_ALPHA,_mipmap);
+	if (_maptex_night != "") map_tex_night = new s_texture(_fullpath,_maptex_night,TEX_LOAD_TYPE_PNG_ALPHA,_mipmap,true);
 
 	tex_fov = _texturefov*M_PI/180.;
 	rotate_z = _rotate_z*M_PI/180.;
@@ -534,8 +534,8 @@ void LandscapeSpherical::create(const string _name, bool _fullpath, const string
 	//	cout << _name << " " << _fullpath << " " << _maptex << " " << _texturefov << "\n";
 	valid_landscape = 1;  // assume ok...
 	name = _name;
-	map_tex = new s_texture(_fullpath,_maptex,TEX_LOAD_TYPE_PNG_ALPHA,_mipmap);
-	if (_maptex_night != "") map_tex_night = new s_texture(_fullpath,_maptex_night,TEX_LOAD_TYPE_PNG_ALPHA,_mipmap);
+	map_tex = new s_texture(_fullpath,_maptex,TEX_LOAD_TYPE_PNG_ALPHA,_mipmap,true);
+	if (_maptex_night != "") map_tex_night = new s_texture(_fullpath,_maptex_night,TEX_LOAD_TYPE_PNG_ALPHA,_mipmap,true);
 	base_altitude = ((_base_altitude >= -90 && _base_altitude <= 90) ? _base_altitude : -90);
 	top_altitude = ((_top_altitude >= -90 && _top_altitude <= 90) ? _top_altitude : 90);
 	rotate_z = _rotate_z*M_PI/180.;
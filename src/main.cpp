@@ -53,6 +53,17 @@ string DATA_ROOT;	// Data Root Directory
 
 static bool firstRun = false;
 
+// Benchmark mode, see usage()
+static bool benchMode = false;
+static bool benchCheck = false;
+static string benchScript;
+static string benchFrameDir;
+static string benchCSV;
+static unsigned int benchFrames = 0;
+static int benchTimestep = 40;
+static Uint16 benchW = 1024;
+static Uint16 benchH = 768;
+
 // Print a beautiful console logo !!
 void drawIntro(void)
 {
@@ -67,29 +78,76 @@ void drawIntro(void)
 void usage(char **argv)
 {
 	cout << _("Usage: %s [OPTION] ...\n -v, --version          Output version information and exit.\n -h, --help             Display this help and exit.\n");
+	cout << _("\nBenchmark options (also implied when run as nightshade-bench SCRIPT):\n"
+	          " --bench SCRIPT         Play SCRIPT without a window and report frame times.\n"
+	          " --check                Check the optimized code paths against the reference\n"
+	          "                        ones, exit with status 1 if one fails.\n"
+	          " --frames N             Stop after N frames instead of at the end of the script.\n"
+	          " --size WxH             Rendering resolution, 1024x768 by default.\n"
+	          " --timestep MS          Simulated time per frame, 40 ms by default.\n"
+	          " --dump-frames DIR      Save every frame as a PNG image in DIR.\n"
+	          " --csv FILE             Save the time of each stage of each frame in FILE.\n");
 }
 
-
+static void bad_command_line(void)
+{
+	cout << _("%s: Bad command line argument(s)\n");
+	cout << _("Try `%s --help' for more information.\n");
+	exit(1);
+}
 
 // Check command line arguments
 void check_command_line(int argc, char **argv)
 {
-	if (argc == 2) {
-		if (!(strcmp(argv[1],"--version") && strcmp(argv[1],"-v"))) {
+	string exeName = argv[0];
+	string::size_type pos = exeName.find_last_of("/\\");
+	if (pos != string::npos) exeName = exeName.substr(pos+1);
+	if (exeName.find(string(APP_LOWER_NAME) + "-bench") == 0) benchMode = true;
+
+	bool benchOption = false;
+	for (int i=1; i<argc; i++) {
+		string arg = argv[i];
+		bool hasValue = i+1 < argc;
+
+		if (arg == "--version" || arg == "-v") {
 			cout << APP_NAME << endl;
 			exit(0);
-		}
-		if (!(strcmp(argv[1],"--help") && strcmp(argv[1],"-h"))) {
+		} else if (arg == "--help" || arg == "-h") {
 			usage(argv);
 			exit(0);
+		} else if (arg == "--bench" && hasValue) {
+			benchMode = true;
+			benchScript = argv[++i];
+		} else if (arg == "--check") {
+			benchMode = true;
+			benchCheck = true;
+		} else if (arg == "--frames" && hasValue) {
+			benchFrames = str_to_int(argv[++i]);
+			benchOption = true;
+		} else if (arg == "--size" && hasValue) {
+			int w, h;
+			if (sscanf(argv[++i], "%dx%d", &w, &h) != 2 || w <= 0 || h <= 0) bad_command_line();
+			benchW = w;
+			benchH = h;
+			benchOption = true;
+		} else if (arg == "--timestep" && hasValue) {
+			benchTimestep = str_to_int(argv[++i]);
+			if (benchTimestep <= 0) bad_command_line();
+			benchOption = true;
+		} else if (arg == "--dump-frames" && hasValue) {
+			benchFrameDir = argv[++i];
+			benchOption = true;
+		} else if (arg == "--csv" && hasValue) {
+			benchCSV = argv[++i];
+			benchOption = true;
+		} else if (benchMode && benchScript.empty() && arg[0] != '-') {
+			benchScript = arg;
+		} else {
+			bad_command_line();
 		}
 	}
 
-	if (argc > 1) {
-		cout << _("%s: Bad command line argument(s)\n");
-		cout << _("Try `%s --help' for more information.\n");
-		exit(1);
-	}
+	if ((benchMode && benchScript.empty() && !benchCheck) || (benchOption && !benchMode)) bad_command_line();
 }
 
 
@@ -247,13 +305,16 @@ int main(int argc, char **argv)
 	ini->loadAppSettings( &conf );
 	
 	SDLFacade* sdl = new SDLFacade();
-	sdl->initSDL();
+	sdl->initSDL(benchMode);
 
 	Uint16 curW, curH;
 	bool fullscreen;
 
+	if( benchMode ) {
+		sdl->createOffscreenSurface(benchW, benchH);
+	}
 	// Always force windowed mode and current resolution on digitarium systems.
-	if( ini->Digitarium() ) {
+	else if( ini->Digitarium() ) {
 		sdl->getCurrentRes( &curW, &curH );
 		fullscreen = false;
 	}
@@ -272,9 +333,11 @@ int main(int argc, char **argv)
 	}
 
 	// Trystan: SDL surface 'must' be created prior to any OpenGL calls or will crash on OSX
-	sdl->createSurface(curW, curH, conf.get_int("video:bbp_mode"), fullscreen, DATA_ROOT + "/data/icon.bmp");
+	if( !benchMode )
+		sdl->createSurface(curW, curH, conf.get_int("video:bbp_mode"), fullscreen, DATA_ROOT + "/data/icon.bmp");
 
 	App* app = new App( sdl );
+	app->setBenchMode(benchMode);
 
 	// Register custom suspend and term signal handers
 	ISignals* signalObj = ISignals::Create(app);
@@ -285,12 +348,21 @@ int main(int argc, char **argv)
 
 	app->init();
 
-	app->startMainLoop();
+	int status = 0;
+	if( benchCheck && !app->runChecks() )
+		status = 1;
+
+	if( benchMode ) {
+		if( !benchScript.empty() )
+			app->runBenchmark(benchScript, benchFrames, benchTimestep, benchFrameDir, benchCSV);
+	}
+	else
+		app->startMainLoop();
 
 	// Clean memory
 	delete app;
 	delete sdl;
 	delete signalObj;
-	return 0;
+	return status;
 }
 
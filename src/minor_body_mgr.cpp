@@ -0,0 +1,615 @@
+/*
+ * Nightshade (TM) astronomy simulation and visualization
+ *
+ * Copyright (C) 2012 Digitalis Education Solutions, Inc.
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 3
+ * of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place - Suite 330, Boston, MA  02111-1307, USA.
+ *
+ * Nightshade is a trademark of Digitalis Education Solutions, Inc.
+ * See the TRADEMARKS file for trademark usage requirements.
+ *
+ */
+
+#include <algorithm>
+#include <cmath>
+#include <cstdio>
+#include <cctype>
+#include <cstdlib>
+#include <fstream>
+#include <iostream>
+#include <sys/stat.h>
+
+#ifndef WIN32
+#include <unistd.h>
+#endif
+
+#include "minor_body_mgr.h"
+#include "loadingbar.h"
+#include "navigator.h"
+#include "orbit.h"
+#include "translator.h"
+#include "utility.h"
+
+using namespace std;
+
+// Gaussian gravitational constant, radians per day
+#define GAUSS_K 0.01720209895
+
+#define CACHE_MAGIC 0x4d425301
+#define CACHE_VERSION 1
+
+MinorBodyMgr::MinorBodyMgr(int nb_threads) :
+	generation(0), busy(0), quit(false), date(0), flag_show(true), max_mag(12.f)
+{
+	lock = SDL_CreateMutex();
+	work_available = SDL_CreateCond();
+	work_finished = SDL_CreateCond();
+
+	if (nb_threads < 0) {
+#ifndef WIN32
+		nb_threads = sysconf(_SC_NPROCESSORS_ONLN) - 1;
+#else
+		nb_threads = 1;
+#endif
+		if (nb_threads < 0) nb_threads = 0;
+	}
+
+	for (int t=0; t<nb_threads; t++) {
+		Worker *w = new Worker;
+		w->mgr = this;
+		w->first = w->count = 0;
+		w->done_generation = generation;
+		w->thread = SDL_CreateThread(&MinorBodyMgr::workerThread, w);
+		if (!w->thread) {
+			cerr << "Can't create minor body thread, " << t << " available" << endl;
+			delete w;
+			break;
+		}
+		workers.push_back(w);
+	}
+}
+
+MinorBodyMgr::~MinorBodyMgr()
+{
+	SDL_mutexP(lock);
+	quit = true;
+	SDL_CondBroadcast(work_available);
+	SDL_mutexV(lock);
+
+	for (vector<Worker*>::iterator iter = workers.begin(); iter != workers.end(); ++iter) {
+		SDL_WaitThread((*iter)->thread, NULL);
+		delete *iter;
+	}
+	workers.clear();
+
+	SDL_DestroyCond(work_finished);
+	SDL_DestroyCond(work_available);
+	SDL_DestroyMutex(lock);
+}
+
+int MinorBodyMgr::workerThread(void *data)
+{
+	Worker *w = (Worker*)data;
+	MinorBodyMgr *m = w->mgr;
+
+	SDL_mutexP(m->lock);
+	for (;;) {
+		while (!m->quit && m->generation == w->done_generation) SDL_CondWait(m->work_available, m->lock);
+		if (m->quit) break;
+		w->done_generation = m->generation;
+		SDL_mutexV(m->lock);
+
+		m->compute(w->first, w->count);
+
+		SDL_mutexP(m->lock);
+		if (--m->busy == 0) SDL_CondSignal(m->work_finished);
+	}
+	SDL_mutexV(m->lock);
+
+	return 0;
+}
+
+void MinorBodyMgr::computePositions(double _date, const Vec3d& _obs_pos)
+{
+	const unsigned int nb = size();
+	if (nb == 0 || (_date == date && _obs_pos == obs_pos && x.size() == nb)) return;
+	date = _date;
+	obs_pos = _obs_pos;
+	x.resize(nb);
+	y.resize(nb);
+	z.resize(nb);
+	mag.resize(nb);
+
+	// the calling thread takes the last share
+	const unsigned int share = nb / (workers.size()+1);
+	if (workers.empty() || share == 0) {
+		compute(0, nb);
+		return;
+	}
+
+	SDL_mutexP(lock);
+	for (unsigned int t=0; t<workers.size(); t++) {
+		workers[t]->first = t*share;
+		workers[t]->count = share;
+	}
+	busy = workers.size();
+	generation++;
+	SDL_CondBroadcast(work_available);
+	SDL_mutexV(lock);
+
+	const unsigned int first = workers.size()*share;
+	compute(first, nb-first);
+
+	SDL_mutexP(lock);
+	while (busy > 0) SDL_CondWait(work_finished, lock);
+	SDL_mutexV(lock);
+}
+
+// Same math as EllipticalOrbit::positionAtTime and CometOrbit::positionAtTime
+// for bodies orbiting the Sun, followed by the magnitude
+void MinorBodyMgr::compute(unsigned int first, unsigned int count)
+{
+	const double ox = obs_pos[0], oy = obs_pos[1], oz = obs_pos[2];
+
+	// eccentric anomalies a chunk at a time with the batch solver
+	const unsigned int CHUNK = 256;
+	double anomaly[CHUNK];
+	for (unsigned int j=first; j<first+count; j++) {
+		const unsigned int k = (j-first) % CHUNK;
+		if (k == 0) {
+			const unsigned int nb = min(CHUNK, first+count-j);
+			for (unsigned int l=0; l<nb; l++) anomaly[l] = M0[j+l] + n[j+l]*(date - epoch[j+l]);
+			SolveKeplerEquationBatch(&e[j], anomaly, anomaly, nb);
+		}
+
+		const double t = date - epoch[j];
+		double u, v;
+		if (e[j] == 1.0) {
+			ParabolicOrbitPlanePosition(q[j], n[j], t, u, v);
+		} else {
+			const double E = anomaly[k];
+			if (e[j] < 1.0) {
+				u = a[j] * (cos(E) - e[j]);
+				v = b[j] * sin(E);
+			} else {
+				u = -a[j] * (e[j] - cosh(E));
+				v = -b[j] * sinh(E);
+			}
+		}
+		const double hx = u*px[j] + v*qx[j];
+		const double hy = u*py[j] + v*qy[j];
+		const double hz = u*pz[j] + v*qz[j];
+		x[j] = hx;
+		y[j] = hy;
+		z[j] = hz;
+
+		const double dx = hx-ox, dy = hy-oy, dz = hz-oz;
+		const double r = sqrt(hx*hx + hy*hy + hz*hz);
+		const double delta = sqrt(dx*dx + dy*dy + dz*dz);
+		if (comet[j]) {
+			mag[j] = H[j] + 5*log10(delta) + 2.5*G[j]*log10(r);
+		} else {
+			// H, G system
+			double cos_alpha = (hx*dx + hy*dy + hz*dz)/(r*delta);
+			if (cos_alpha > 1.0) cos_alpha = 1.0;
+			else if (cos_alpha < -1.0) cos_alpha = -1.0;
+			const double tan_half = sqrt((1.0-cos_alpha)/(1.0+cos_alpha+1e-12));
+			const double phi1 = exp(-3.33*pow(tan_half, 0.63));
+			const double phi2 = exp(-1.87*pow(tan_half, 1.22));
+			mag[j] = H[j] + 5*log10(r*delta)
+			         - 2.5*log10((1-G[j])*phi1 + G[j]*phi2 + 1e-30);
+		}
+	}
+}
+
+void MinorBodyMgr::draw(const Projector *prj, const Navigator *nav)
+{
+	drawn.clear();
+	if (!flag_show || x.empty()) return;
+
+	for (unsigned int j=0; j<x.size(); j++) {
+		if (mag[j] <= max_mag) drawn.push_back(j);
+	}
+	if (drawn.empty()) return;
+
+	projection_batch.resize(drawn.size());
+	for (unsigned int k=0; k<drawn.size(); k++) {
+		const unsigned int j = drawn[k];
+		projection_batch.x[k] = x[j];
+		projection_batch.y[k] = y[j];
+		projection_batch.z[k] = z[j];
+	}
+	prj->project_helio_batch(projection_batch);
+	prj->check_in_viewport_batch(projection_batch);
+
+	vertices.clear();
+	unsigned int kept = 0;
+	for (unsigned int k=0; k<drawn.size(); k++) {
+		if (!projection_batch.visible[k]) continue;
+		const float m = mag[drawn[k]];
+		float brightness = 0.3f + 0.7f*(max_mag - m)/4.f;
+		if (brightness > 1.f) brightness = 1.f;
+		vertices.push_back(projection_batch.win_x[k]);
+		vertices.push_back(projection_batch.win_y[k]);
+		vertices.push_back(1.f);
+		vertices.push_back(0.95f);
+		vertices.push_back(0.85f);
+		vertices.push_back(brightness);
+		drawn[kept++] = drawn[k];
+	}
+	drawn.resize(kept);
+	if (vertices.empty()) return;
+
+	prj->set_orthographic_projection();
+	glDisable(GL_TEXTURE_2D);
+	glEnable(GL_BLEND);
+	glBlendFunc(GL_SRC_ALPHA, GL_ONE);
+	glPointSize(2.f);
+	glEnableClientState(GL_VERTEX_ARRAY);
+	glEnableClientState(GL_COLOR_ARRAY);
+	glVertexPointer(2, GL_FLOAT, 6*sizeof(float), &vertices[0]);
+	glColorPointer(4, GL_FLOAT, 6*sizeof(float), &vertices[2]);
+	glDrawArrays(GL_POINTS, 0, vertices.size()/6);
+	glDisableClientState(GL_COLOR_ARRAY);
+	glDisableClientState(GL_VERTEX_ARRAY);
+	glPointSize(1.f);
+	glEnable(GL_TEXTURE_2D);
+	prj->reset_perspective_projection();
+}
+
+int MinorBodyMgr::search(Vec3d v, double lim_fov, const Navigator *nav) const
+{
+	v.normalize();
+	double cos_best = cos(lim_fov*M_PI/180.);
+	int best = -1;
+	for (vector<unsigned int>::const_iterator iter = drawn.begin(); iter != drawn.end(); ++iter) {
+		Vec3d equ_pos = nav->helio_to_earth_equ(Vec3d(x[*iter], y[*iter], z[*iter]));
+		equ_pos.normalize();
+		const double c = equ_pos*v;
+		if (c >= cos_best) {
+			cos_best = c;
+			best = *iter;
+		}
+	}
+	return best;
+}
+
+double MinorBodyMgr::getInclination(unsigned int j) const
+{
+	return i[j]*180./M_PI;
+}
+
+double MinorBodyMgr::getAscendingNode(unsigned int j) const
+{
+	return node[j]*180./M_PI;
+}
+
+double MinorBodyMgr::getArgOfPericenter(unsigned int j) const
+{
+	return peri[j]*180./M_PI;
+}
+
+double MinorBodyMgr::getTimeAtPericenter(unsigned int j) const
+{
+	return epoch[j] - M0[j]/n[j];
+}
+
+double MinorBodyMgr::getPeriod(unsigned int j) const
+{
+	return 2.0*M_PI/n[j];
+}
+
+void MinorBodyMgr::addBody(const string& name, double _q, double _e, double _i, double _node,
+                           double _peri, double _M0, double _n, double _epoch,
+                           double _H, double _G, bool _comet)
+{
+	names.push_back(name);
+	q.push_back(_q);
+	e.push_back(_e);
+	i.push_back(_i);
+	node.push_back(_node);
+	peri.push_back(_peri);
+	M0.push_back(_M0);
+	n.push_back(_n);
+	epoch.push_back(_epoch);
+	H.push_back(_H);
+	G.push_back(_G);
+	comet.push_back(_comet ? 1 : 0);
+}
+
+// Derived arrays of the bodies from first on
+void MinorBodyMgr::prepare(unsigned int first)
+{
+	const unsigned int nb = size();
+	px.resize(nb); py.resize(nb); pz.resize(nb);
+	qx.resize(nb); qy.resize(nb); qz.resize(nb);
+	a.resize(nb); b.resize(nb);
+	for (unsigned int j=first; j<nb; j++) {
+		// Rz(node) * Rx(i) * Rz(peri) applied to the orbit plane axes
+		const double co = cos(peri[j]), so = sin(peri[j]);
+		const double cOm = cos(node[j]), sOm = sin(node[j]);
+		const double ci = cos(i[j]), si = sin(i[j]);
+		px[j] = co*cOm - so*sOm*ci;
+		py[j] = co*sOm + so*cOm*ci;
+		pz[j] = so*si;
+		qx[j] = -so*cOm - co*sOm*ci;
+		qy[j] = -so*sOm + co*cOm*ci;
+		qz[j] = co*si;
+		if (e[j] == 1.0) {
+			a[j] = b[j] = 0.0;
+		} else {
+			a[j] = q[j]/(1.0-e[j]);
+			b[j] = a[j]*sqrt(fabs(1.0-e[j]*e[j]));
+		}
+	}
+	x.clear();  // positions need a recompute
+}
+
+// Columns first to last (1 based, inclusive) of line as a number
+static bool Field(const string& line, unsigned int first, unsigned int last, double &value)
+{
+	if (line.size() < last) return false;
+	const string s = line.substr(first-1, last-first+1);
+	char *end;
+	value = strtod(s.c_str(), &end);
+	if (end == s.c_str()) return false;
+	while (*end == ' ') end++;
+	return *end == 0;
+}
+
+static string Trim(const string& s)
+{
+	const size_t b = s.find_first_not_of(' ');
+	if (b == string::npos) return "";
+	return s.substr(b, s.find_last_not_of(" \r\n") - b + 1);
+}
+
+// Gregorian calendar date to JD, after Meeus
+static double JulianDay(int year, int month, double day)
+{
+	if (month <= 2) {
+		year--;
+		month += 12;
+	}
+	const int A = year/100;
+	const int B = 2 - A + A/4;
+	return floor(365.25*(year+4716)) + floor(30.6001*(month+1)) + day + B - 1524.5;
+}
+
+// MPC packed dates: K107N is 2010 July 23
+static bool UnpackDate(const string& p, double &jd)
+{
+	if (p.size() != 5 || p[0] < 'A' || p[0] > 'Z') return false;
+	const int century = p[0] - 'A' + 10;
+	const int year = century*100 + atoi(p.substr(1,2).c_str());
+	const int month = isdigit(p[3]) ? p[3]-'0' : p[3]-'A'+10;
+	const int day = isdigit(p[4]) ? p[4]-'0' : p[4]-'A'+10;
+	jd = JulianDay(year, month, day);
+	return true;
+}
+
+bool MinorBodyMgr::loadAsteroids(const string& file_name, LoadingBar& lb)
+{
+	const unsigned int first = size();
+	if (readCache(file_name)) {
+		prepare(first);
+		cout << "Loaded " << size()-first << " asteroids from cache" << endl;
+		return true;
+	}
+
+	ifstream in(file_name.c_str());
+	if (!in) {
+		cerr << "Can't open asteroid file " << file_name << endl;
+		return false;
+	}
+	lb.SetMessage(_("Loading asteroids..."));
+	lb.Draw(0);
+
+	string line;
+	while (getline(in, line)) {
+		double h, g, M, w, Om, incl, ecc, mm, sma;
+		double ep;
+		if (!Field(line, 27, 35, M) || !Field(line, 38, 46, w) ||
+		        !Field(line, 49, 57, Om) || !Field(line, 60, 68, incl) ||
+		        !Field(line, 71, 79, ecc) || !Field(line, 81, 91, mm) ||
+		        !Field(line, 93, 103, sma) || !UnpackDate(line.substr(20,5), ep))
+			continue;  // header or incomplete elements
+		if (!Field(line, 9, 13, h)) h = 99;
+		if (!Field(line, 15, 19, g)) g = 0.15;
+		string name = (line.size() >= 175) ? Trim(line.substr(166, 28)) : "";
+		if (name.empty()) name = Trim(line.substr(0, 7));
+		addBody(name, sma*(1.0-ecc), ecc, incl*M_PI/180., Om*M_PI/180., w*M_PI/180.,
+		        M*M_PI/180., mm*M_PI/180., ep, h, g, false);
+		if ((size()-first) % 50000 == 0) lb.Draw(0.5f);
+	}
+	lb.Draw(1);
+
+	cout << "Loaded " << size()-first << " asteroids" << endl;
+	writeCache(file_name, first);
+	prepare(first);
+	return size() > first;
+}
+
+bool MinorBodyMgr::loadComets(const string& file_name, LoadingBar& lb)
+{
+	const unsigned int first = size();
+	if (readCache(file_name)) {
+		prepare(first);
+		cout << "Loaded " << size()-first << " comets from cache" << endl;
+		return true;
+	}
+
+	ifstream in(file_name.c_str());
+	if (!in) {
+		cerr << "Can't open comet file " << file_name << endl;
+		return false;
+	}
+	lb.SetMessage(_("Loading comets..."));
+	lb.Draw(0);
+
+	string line;
+	while (getline(in, line)) {
+		double year, month, day, qq, ecc, w, Om, incl, h, k;
+		if (!Field(line, 15, 18, year) || !Field(line, 20, 21, month) ||
+		        !Field(line, 23, 29, day) || !Field(line, 31, 39, qq) ||
+		        !Field(line, 42, 49, ecc) || !Field(line, 52, 59, w) ||
+		        !Field(line, 62, 69, Om) || !Field(line, 72, 79, incl))
+			continue;
+		if (!Field(line, 92, 95, h)) h = 99;
+		if (!Field(line, 97, 100, k)) k = 4;
+		string name = (line.size() > 102) ? Trim(line.substr(102, 56)) : "";
+		if (name.empty()) name = Trim(line.substr(0, 12));
+
+		// mean motion as SolarSystem::addBody derives it for comet_orbit
+		double mm;
+		if (ecc == 1.0) {
+			mm = GAUSS_K * (1.5/qq) * sqrt(0.5/qq);
+		} else {
+			const double sma = fabs(qq/(1.0-ecc));
+			mm = GAUSS_K / (sma*sqrt(sma));
+		}
+		const double T = JulianDay((int)year, (int)month, day);
+		addBody(name, qq, ecc, incl*M_PI/180., Om*M_PI/180., w*M_PI/180.,
+		        0.0, mm, T, h, k, true);
+	}
+	lb.Draw(1);
+
+	cout << "Loaded " << size()-first << " comets" << endl;
+	writeCache(file_name, first);
+	prepare(first);
+	return size() > first;
+}
+
+// The cache holds the elements of one source file, valid while its size
+// and modification time are unchanged
+struct MinorBodyCacheHeader {
+	unsigned int magic;
+	unsigned int version;
+	unsigned int count;
+	unsigned int names_size;
+	double source_size;
+	double source_mtime;
+};
+
+static bool SourceStamp(const string& file_name, double &size, double &mtime)
+{
+	struct stat st;
+	if (stat(file_name.c_str(), &st) != 0) return false;
+	size = st.st_size;
+	mtime = st.st_mtime;
+	return true;
+}
+
+template <class T>
+static bool ReadArray(FILE *f, vector<T>& v, unsigned int count)
+{
+	const unsigned int old_size = v.size();
+	v.resize(old_size + count);
+	return fread(&v[old_size], sizeof(T), count, f) == count;
+}
+
+template <class T>
+static void WriteArray(FILE *f, const vector<T>& v, unsigned int first)
+{
+	fwrite(&v[first], sizeof(T), v.size()-first, f);
+}
+
+// Named after the element file, e.g. MPCORB.DAT.cache
+string MinorBodyMgr::cacheName(const string& file_name) const
+{
+	const string::size_type slash = file_name.find_last_of("/\\");
+	return cache_dir + (slash == string::npos ? file_name : file_name.substr(slash+1)) + ".cache";
+}
+
+bool MinorBodyMgr::readCache(const string& file_name)
+{
+	if (cache_dir.empty()) return false;
+
+	MinorBodyCacheHeader h;
+	double src_size, src_mtime;
+	if (!SourceStamp(file_name, src_size, src_mtime)) return false;
+
+	FILE *f = fopen(cacheName(file_name).c_str(), "rb");
+	if (!f) return false;
+	if (fread(&h, sizeof(h), 1, f) != 1 || h.magic != CACHE_MAGIC || h.version != CACHE_VERSION ||
+	        h.source_size != src_size || h.source_mtime != src_mtime || h.count == 0) {
+		fclose(f);
+		return false;
+	}
+
+	const unsigned int first = size();
+	vector<char> name_data(h.names_size);
+	bool ok = fread(&name_data[0], 1, h.names_size, f) == h.names_size &&
+	          ReadArray(f, q, h.count) && ReadArray(f, e, h.count) &&
+	          ReadArray(f, i, h.count) && ReadArray(f, node, h.count) &&
+	          ReadArray(f, peri, h.count) && ReadArray(f, M0, h.count) &&
+	          ReadArray(f, n, h.count) && ReadArray(f, epoch, h.count) &&
+	          ReadArray(f, H, h.count) && ReadArray(f, G, h.count) &&
+	          ReadArray(f, comet, h.count);
+	fclose(f);
+
+	// names are stored one after the other, 0 terminated
+	const char *p = &name_data[0];
+	for (unsigned int j=0; ok && j<h.count; j++) {
+		if (p >= &name_data[0] + h.names_size) ok = false;
+		else {
+			names.push_back(p);
+			p += names.back().size() + 1;
+		}
+	}
+
+	if (!ok) {
+		cerr << "Bad minor body cache " << cacheName(file_name) << endl;
+		names.resize(first);
+		q.resize(first); e.resize(first); i.resize(first); node.resize(first);
+		peri.resize(first); M0.resize(first); n.resize(first); epoch.resize(first);
+		H.resize(first); G.resize(first); comet.resize(first);
+	}
+	return ok;
+}
+
+void MinorBodyMgr::writeCache(const string& file_name, unsigned int first) const
+{
+	if (size() == first || cache_dir.empty()) return;
+
+	MinorBodyCacheHeader h;
+	if (!SourceStamp(file_name, h.source_size, h.source_mtime)) return;
+	h.magic = CACHE_MAGIC;
+	h.version = CACHE_VERSION;
+	h.count = size() - first;
+	h.names_size = 0;
+	for (unsigned int j=first; j<size(); j++) h.names_size += names[j].size() + 1;
+
+	const string cache_name = cacheName(file_name);
+	FILE *f = fopen(cache_name.c_str(), "wb");
+	if (!f) {
+		cerr << "Can't write minor body cache " << cache_name << endl;
+		return;
+	}
+	fwrite(&h, sizeof(h), 1, f);
+	for (unsigned int j=first; j<size(); j++) fwrite(names[j].c_str(), 1, names[j].size()+1, f);
+	WriteArray(f, q, first);
+	WriteArray(f, e, first);
+	WriteArray(f, i, first);
+	WriteArray(f, node, first);
+	WriteArray(f, peri, first);
+	WriteArray(f, M0, first);
+	WriteArray(f, n, first);
+	WriteArray(f, epoch, first);
+	WriteArray(f, H, first);
+	WriteArray(f, G, first);
+	WriteArray(f, comet, first);
+	if (fclose(f) != 0) remove(cache_name.c_str());
+}
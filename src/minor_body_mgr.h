@@ -0,0 +1,193 @@
+/*
+ * Nightshade (TM) astronomy simulation and visualization
+ *
+ * Copyright (C) 2012 Digitalis Education Solutions, Inc.
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 3
+ * of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place - Suite 330, Boston, MA  02111-1307, USA.
+ *
+ * Nightshade is a trademark of Digitalis Education Solutions, Inc.
+ * See the TRADEMARKS file for trademark usage requirements.
+ *
+ */
+
+// Asteroids and comets in bulk, too many to be Planets. Their orbital
+// elements are kept as structure of arrays and propagated on a pool of
+// worker threads with the same math as EllipticalOrbit and CometOrbit.
+// They are drawn as points; SolarSystem turns the one the user picks into
+// a full Planet (see SolarSystem::promoteMinorBody).
+
+#ifndef _MINOR_BODY_MGR_H_
+#define _MINOR_BODY_MGR_H_
+
+#include <string>
+#include <vector>
+
+#include "SDL_thread.h"
+#include "projector.h"
+#include "vecmath.h"
+
+class LoadingBar;
+class Navigator;
+
+class MinorBodyMgr
+{
+public:
+	// nb_threads < 0 selects one thread less than the number of processors,
+	// 0 propagates on the calling thread only
+	MinorBodyMgr(int nb_threads);
+	virtual ~MinorBodyMgr();
+
+	// Directory of the element caches, e.g. the user directory, since
+	// the element files may be read only. Empty disables the caches.
+	void setCacheDir(const std::string& dir) {
+		cache_dir = dir;
+	}
+
+	// Read an MPCORB.DAT style asteroid file. A binary cache of the
+	// elements is written in the cache directory and used while the file
+	// is unchanged.
+	bool loadAsteroids(const std::string& file_name, LoadingBar& lb);
+
+	// Read an MPC CometEls.txt style comet file, cached the same way
+	bool loadComets(const std::string& file_name, LoadingBar& lb);
+
+	unsigned int size(void) const {
+		return names.size();
+	}
+
+	// Propagate all bodies to date and compute their magnitudes as seen from obs_pos
+	// Nothing is done if neither has moved since the previous call
+	void computePositions(double date, const Vec3d& obs_pos);
+
+	// Draw the bodies brighter than the magnitude limit as points
+	void draw(const Projector *prj, const Navigator *nav);
+
+	// Index of the drawn body closest to the earth equatorial direction v within
+	// lim_fov degrees, -1 if none
+	int search(Vec3d v, double lim_fov, const Navigator *nav) const;
+
+	void setFlagShow(bool b) {
+		flag_show = b;
+	}
+	bool getFlagShow(void) const {
+		return flag_show;
+	}
+	void setMaxMag(float m) {
+		max_mag = m;
+	}
+	float getMaxMag(void) const {
+		return max_mag;
+	}
+
+	// Elements of body i in the units of ssystem.ini
+	const std::string& getName(unsigned int i) const {
+		return names[i];
+	}
+	bool isComet(unsigned int i) const {
+		return comet[i] != 0;
+	}
+	double getPericenterDistance(unsigned int i) const {
+		return q[i];
+	}
+	double getEccentricity(unsigned int i) const {
+		return e[i];
+	}
+	double getInclination(unsigned int i) const;        // degrees
+	double getAscendingNode(unsigned int i) const;      // degrees
+	double getArgOfPericenter(unsigned int i) const;    // degrees
+	double getTimeAtPericenter(unsigned int i) const;   // JD
+	double getPeriod(unsigned int i) const;             // days, 2 pi / mean motion
+	double getAbsoluteMagnitude(unsigned int i) const {
+		return H[i];
+	}
+	double getSlope(unsigned int i) const {
+		return G[i];
+	}
+
+	// Position and magnitude of body i from the last computePositions
+	Vec3d getHelioPos(unsigned int i) const {
+		return Vec3d(x[i], y[i], z[i]);
+	}
+	float getMag(unsigned int i) const {
+		return mag[i];
+	}
+
+private:
+	std::string cache_dir;
+
+	// Elements, one entry per body
+	std::vector<std::string> names;
+	std::vector<double> q;          // pericenter distance (AU)
+	std::vector<double> e;
+	std::vector<double> i;          // radians
+	std::vector<double> node;       // radians
+	std::vector<double> peri;       // argument of pericenter, radians
+	std::vector<double> M0;         // mean anomaly at epoch, radians
+	std::vector<double> n;          // mean motion, radians per day
+	std::vector<double> epoch;      // JD
+	std::vector<double> H;          // absolute magnitude
+	std::vector<double> G;          // slope parameter
+	std::vector<unsigned char> comet;
+
+	// Derived from the elements by prepare(): the orbit plane axes
+	// in VSOP87 coordinates, and a, b as EllipticalOrbit::positionAtE uses them
+	std::vector<double> px, py, pz;
+	std::vector<double> qx, qy, qz;
+	std::vector<double> a, b;
+
+	// Results of computePositions
+	std::vector<double> x, y, z;    // heliocentric ecliptic (VSOP87), AU
+	std::vector<float> mag;
+
+	void addBody(const std::string& name, double q, double e, double i, double node,
+	             double peri, double M0, double n, double epoch, double H, double G, bool comet);
+	void prepare(unsigned int first);
+	void compute(unsigned int first, unsigned int count);
+
+	std::string cacheName(const std::string& file_name) const;
+	bool readCache(const std::string& file_name);
+	void writeCache(const std::string& file_name, unsigned int first) const;
+
+	// Fork-join pool: each worker propagates its share of the bodies
+	struct Worker {
+		MinorBodyMgr *mgr;
+		SDL_Thread *thread;
+		unsigned int first;
+		unsigned int count;
+		unsigned int done_generation;   // set before the thread starts, which may be after work was posted
+	};
+	static int workerThread(void *data);
+
+	std::vector<Worker*> workers;
+	SDL_mutex *lock;
+	SDL_cond *work_available;
+	SDL_cond *work_finished;
+	unsigned int generation;        // incremented for every frame of work
+	unsigned int busy;              // workers still computing
+	bool quit;
+
+	double date;                    // of the last computePositions
+	Vec3d obs_pos;
+
+	bool flag_show;
+	float max_mag;
+
+	// Drawn bodies of the last frame, for search
+	std::vector<unsigned int> drawn;
+	ProjectionBatch projection_batch;
+	std::vector<float> vertices;    // x, y, r, g, b, a per point
+};
+
+#endif // _MINOR_BODY_MGR_H_
@@ -0,0 +1,234 @@
+/*
+ * Nightshade (TM) astronomy simulation and visualization
+ *
+ * Copyright (C) 2012 Digitalis Education Solutions, Inc.
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 3
+ * of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place - Suite 330, Boston, MA  02111-1307, USA.
+ *
+ * Nightshade is a trademark of Digitalis Education Solutions, Inc.
+ * See the TRADEMARKS file for trademark usage requirements.
+ *
+ */
+
+
+#include <algorithm>
+
+#include "name_index.h"
+
+using namespace std;
+
+// Base letters of U+00C0 to U+00FF, 0 where the character is kept
+static const char latin1Fold[] =
+	"AAAAAAACEEEEIIIIDNOOOOO\0OUUUUYTS"
+	"AAAAAAACEEEEIIIIDNOOOOO\0OUUUUYTY";
+
+// Base letters of U+0100 to U+017F
+static const char latinExtAFold[] =
+	"AAAAAACCCCCCCCDDDDEEEEEEEEEEGGGGGGGGHHHHIIIIIIIIIIIIJJKKKLLLLLLLLLL"
+	"NNNNNNNNNOOOOOOOORRRRRRSSSSSSSSTTTTTTUUUUUUUUUUUUWWYYYZZZZZZS";
+
+struct NameIndex::RankOrder {
+	RankOrder(const vector<Entry>& e) : entries(e) {}
+	bool operator()(int a, int b) const {
+		if (entries[a].rank != entries[b].rank) return entries[a].rank < entries[b].rank;
+		return entries[a].display < entries[b].display;
+	}
+	const vector<Entry>& entries;
+};
+
+NameIndex::NameIndex()
+{
+	root = new Node;
+}
+
+NameIndex::~NameIndex()
+{
+	deleteNode(root);
+}
+
+void NameIndex::deleteNode(Node *n)
+{
+	for (unsigned int i=0; i<n->children.size(); ++i) deleteNode(n->children[i]);
+	delete n;
+}
+
+void NameIndex::clear(void)
+{
+	deleteNode(root);
+	root = new Node;
+	entries.clear();
+}
+
+string NameIndex::fold(const string& s)
+{
+	string r;
+	r.reserve(s.size());
+
+	for (string::size_type i=0; i<s.size(); ++i) {
+		unsigned char c = s[i];
+		if (c < 0x80) {
+			r += (char)toupper(c);
+			continue;
+		}
+		// Two byte UTF-8 sequences for U+00C0 to U+017F
+		if (c >= 0xC3 && c <= 0xC5 && i+1 < s.size() && ((unsigned char)s[i+1] & 0xC0) == 0x80) {
+			unsigned int code = ((c & 0x1F) << 6) | ((unsigned char)s[i+1] & 0x3F);
+			char base = 0;
+			if (code >= 0xC0 && code < 0x100) base = latin1Fold[code - 0xC0];
+			else if (code >= 0x100 && code < 0x180) base = latinExtAFold[code - 0x100];
+			if (base) {
+				r += base;
+				++i;
+				continue;
+			}
+		}
+		r += (char)c;
+	}
+	return r;
+}
+
+void NameIndex::add(const string& name, const string& display,
+                    ObjectRecord::OBJECT_TYPE type, int id, float rank)
+{
+	const string key = fold(name);
+	if (key.empty()) return;
+
+	Entry e;
+	e.display = display;
+	e.type = type;
+	e.id = id;
+	e.rank = rank;
+	entries.push_back(e);
+
+	Node *n = root;
+	string::size_type pos = 0;
+
+	while (pos < key.size()) {
+		Node *child = NULL;
+		for (unsigned int i=0; i<n->children.size(); ++i) {
+			if (n->children[i]->label[0] == key[pos]) {
+				child = n->children[i];
+				break;
+			}
+		}
+
+		if (!child) {
+			child = new Node;
+			child->label = key.substr(pos);
+			n->children.push_back(child);
+			n = child;
+			break;
+		}
+
+		string::size_type l = 0;
+		while (l < child->label.size() && pos+l < key.size() && child->label[l] == key[pos+l]) ++l;
+
+		if (l < child->label.size()) {
+			// Split the edge where the key leaves it
+			Node *mid = new Node;
+			mid->label = child->label.substr(0, l);
+			child->label.erase(0, l);
+			mid->children.push_back(child);
+			for (unsigned int i=0; i<n->children.size(); ++i) {
+				if (n->children[i] == child) n->children[i] = mid;
+			}
+			child = mid;
+		}
+		n = child;
+		pos += l;
+	}
+
+	n->entries.push_back(entries.size()-1);
+}
+
+// Sort by rank and keep the first name of each object, at most max of them
+void NameIndex::rankUnique(vector<int>& list, unsigned int max) const
+{
+	sort(list.begin(), list.end(), RankOrder(entries));
+
+	vector<int> kept;
+	for (unsigned int i=0; i<list.size() && kept.size()<max; ++i) {
+		const Entry &e = entries[list[i]];
+		bool seen = false;
+		for (unsigned int j=0; j<kept.size() && !seen; ++j) {
+			seen = entries[kept[j]].type == e.type && entries[kept[j]].id == e.id;
+		}
+		if (!seen) kept.push_back(list[i]);
+	}
+	list.swap(kept);
+}
+
+void NameIndex::finalizeNode(Node *n)
+{
+	vector<int> candidates(n->entries);
+	for (unsigned int i=0; i<n->children.size(); ++i) {
+		finalizeNode(n->children[i]);
+		candidates.insert(candidates.end(), n->children[i]->best.begin(), n->children[i]->best.end());
+	}
+	rankUnique(candidates, TOP_K);
+	n->best.swap(candidates);
+}
+
+void NameIndex::finalize(void)
+{
+	finalizeNode(root);
+}
+
+void NameIndex::collect(const Node *n, vector<int>& out) const
+{
+	out.insert(out.end(), n->entries.begin(), n->entries.end());
+	for (unsigned int i=0; i<n->children.size(); ++i) collect(n->children[i], out);
+}
+
+vector<string> NameIndex::find(const string& prefix, unsigned int maxNbItem) const
+{
+	vector<string> result;
+	if (maxNbItem == 0) return result;
+
+	const string key = fold(prefix);
+	const Node *n = root;
+	string::size_type pos = 0;
+
+	while (pos < key.size()) {
+		const Node *child = NULL;
+		for (unsigned int i=0; i<n->children.size(); ++i) {
+			if (n->children[i]->label[0] == key[pos]) {
+				child = n->children[i];
+				break;
+			}
+		}
+		if (!child) return result;
+
+		string::size_type l = 0;
+		while (l < child->label.size() && pos+l < key.size() && child->label[l] == key[pos+l]) ++l;
+
+		// The prefix may end inside the edge, but must not leave it
+		if (l < child->label.size() && pos+l < key.size()) return result;
+		n = child;
+		pos += l;
+	}
+
+	vector<int> found;
+	if (maxNbItem <= TOP_K) {
+		found = n->best;
+	} else {
+		collect(n, found);
+		rankUnique(found, maxNbItem);
+	}
+
+	for (unsigned int i=0; i<found.size() && i<maxNbItem; ++i)
+		result.push_back(entries[found[i]].display);
+	return result;
+}
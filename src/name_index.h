@@ -0,0 +1,95 @@
+/*
+ * Nightshade (TM) astronomy simulation and visualization
+ *
+ * Copyright (C) 2012 Digitalis Education Solutions, Inc.
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 3
+ * of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place - Suite 330, Boston, MA  02111-1307, USA.
+ *
+ * Nightshade is a trademark of Digitalis Education Solutions, Inc.
+ * See the TRADEMARKS file for trademark usage requirements.
+ *
+ */
+
+
+// Compressed prefix trie of object names shared by the managers, used for
+// search autocompletion. Names are folded to upper case without diacritics
+// and each node keeps its best ranked objects so that short queries don't
+// have to visit the subtree.
+
+#ifndef _NAME_INDEX_H_
+#define _NAME_INDEX_H_
+
+#include <string>
+#include <vector>
+
+#include "../nscontrol/src/nshade_state.h"
+
+class NameIndex
+{
+public:
+	// Objects kept in each node for the common small queries
+	enum { TOP_K = 16 };
+
+	NameIndex();
+	virtual ~NameIndex();
+
+	void clear(void);
+
+	//! Add a name of an object. Queries matching name return display,
+	//! objects are told apart by type and id, a lower rank comes first.
+	void add(const std::string& name, const std::string& display,
+	         ObjectRecord::OBJECT_TYPE type, int id, float rank);
+
+	//! Compute the best objects of each node, call once all names are added
+	void finalize(void);
+
+	//! Display names of at most maxNbItem distinct objects having a name
+	//! starting with prefix, best ranked first
+	std::vector<std::string> find(const std::string& prefix, unsigned int maxNbItem) const;
+
+	unsigned int size(void) const {
+		return entries.size();
+	}
+
+	//! Upper case, Latin-1 and Latin Extended-A letters lose their accents
+	static std::string fold(const std::string& s);
+
+private:
+	struct Entry {
+		std::string display;
+		ObjectRecord::OBJECT_TYPE type;
+		int id;
+		float rank;
+	};
+
+	struct Node {
+		std::string label;			// folded edge label from the parent
+		std::vector<Node*> children;
+		std::vector<int> entries;	// names ending here
+		std::vector<int> best;		// best TOP_K objects of the subtree
+	};
+
+	struct RankOrder;
+
+	void deleteNode(Node *n);
+	void finalizeNode(Node *n);
+	void collect(const Node *n, std::vector<int>& out) const;
+	void rankUnique(std::vector<int>& list, unsigned int max) const;
+
+	Node *root;
+	std::vector<Entry> entries;
+};
+
+#endif // _NAME_INDEX_H_
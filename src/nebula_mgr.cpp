@@ -36,9 +36,14 @@
 #include "navigator.h"
 #include "translator.h"
 #include "loadingbar.h"
+#include "name_index.h"
+#include "geodesic_grid.h"
 
 #define RADIUS_NEB 1.
 
+// Grid level at which the nebulae are sorted, ~7.9 degree zones
+#define NEB_GRID_LEVEL 3
+
 void NebulaMgr::setLabelColor(const Vec3f& c)
 {
 	Nebula::label_color = c;
@@ -83,9 +88,8 @@ bool NebulaMgr::getFlagBright(void) const
 }
 
 
-NebulaMgr::NebulaMgr(void) : displayNoTexture(false)
+NebulaMgr::NebulaMgr(void) : geodesicGrid(NULL), zoneLevel(0), nebZones(NULL), displayNoTexture(false)
 {
-	nebZones = new vector<Nebula*>[nebGrid.getNbPoints()];
 }
 
 NebulaMgr::~NebulaMgr()
@@ -104,6 +108,107 @@ NebulaMgr::~NebulaMgr()
 	delete[] nebZones;
 }
 
+// Sort the nebulae in the zones of the grid
+void NebulaMgr::setGrid(const GeodesicGrid* grid)
+{
+	geodesicGrid = grid;
+	zoneLevel = MY_MIN(NEB_GRID_LEVEL, grid->getMaxLevel());
+
+	delete[] nebZones;
+	nebZones = new vector<ZoneEntry>[GeodesicGrid::nrOfZones(zoneLevel)];
+	largeNebulae.clear();
+
+	vector<Nebula *>::const_iterator iter;
+	for (iter=neb_array.begin(); iter!=neb_array.end(); ++iter) {
+		insertInZone(*iter);
+	}
+}
+
+// Nebulae larger than a zone may be visible from zones out of the searched
+// region, so they are kept aside and always checked
+void NebulaMgr::insertInZone(Nebula *n)
+{
+	// nebulae loaded before the grid is set are sorted by setGrid
+	if (!nebZones) return;
+
+	ZoneEntry e;
+	e.pos = n->XYZ;
+	e.pos.normalize();
+	e.neb = n;
+
+	if (n->m_angular_size > GeodesicGrid::zoneAngularSize(zoneLevel)) {
+		largeNebulae.push_back(e);
+	} else {
+		const Vec3d v(e.pos[0], e.pos[1], e.pos[2]);
+		nebZones[geodesicGrid->searchZone(v, zoneLevel)].push_back(e);
+	}
+}
+
+void NebulaMgr::eraseFromZone(Nebula *n)
+{
+	if (!nebZones) return;
+
+	vector<ZoneEntry> *zone = &largeNebulae;
+	if (n->m_angular_size <= GeodesicGrid::zoneAngularSize(zoneLevel)) {
+		Vec3d v(n->XYZ[0], n->XYZ[1], n->XYZ[2]);
+		v.normalize();
+		zone = &nebZones[geodesicGrid->searchZone(v, zoneLevel)];
+	}
+
+	vector<ZoneEntry>::iterator iter;
+	for (iter = zone->begin(); iter != zone->end(); ++iter) {
+		if (iter->neb == n) {
+			zone->erase(iter);
+			return;
+		}
+	}
+}
+
+// Search the zones around v, like HipStarMgr::searchAround does for the stars
+const GeodesicSearchResult* NebulaMgr::searchRegion(const Vec3d& v, double lim_fov) const
+{
+	// whole sky
+	if (lim_fov >= 45.) return geodesicGrid->search(StelGeom::ConvexS(), zoneLevel);
+
+	// square around v containing the lim_fov circle
+	int i = (fabs(v[0]) < fabs(v[1])) ? 0 : 1;
+	if (fabs(v[2]) < fabs(v[i])) i = 2;
+	Vec3d h0(0.0,0.0,0.0);
+	h0[i] = 1.0;
+	Vec3d h1 = h0 ^ v;
+	h1.normalize();
+	h0 = h1 ^ v;
+	h0.normalize();
+
+	const double f = 1.4142136 * tan(lim_fov * M_PI/180.0);
+	h0 *= f;
+	h1 *= f;
+	Vec3d e0 = v + h0;
+	Vec3d e1 = v + h1;
+	Vec3d e2 = v - h0;
+	Vec3d e3 = v - h1;
+	e0.normalize();
+	e1.normalize();
+	e2.normalize();
+	e3.normalize();
+	return geodesicGrid->search(e0, e1, e2, e3, zoneLevel);
+}
+
+// List the zones of a search result, large nebulae first
+void NebulaMgr::collectZones(const GeodesicSearchResult* region, vector<const vector<ZoneEntry>*>& zones) const
+{
+	zones.clear();
+	zones.push_back(&largeNebulae);
+
+	int zone;
+	for (GeodesicSearchInsideIterator it(*region, zoneLevel); (zone = it.next()) >= 0;) {
+		zones.push_back(&nebZones[zone]);
+	}
+	for (GeodesicSearchBorderIterator it(*region, zoneLevel); (zone = it.next()) >= 0;) {
+		zones.push_back(&nebZones[zone]);
+	}
+}
+
 // read from stream
 bool NebulaMgr::read(float font_size, const string& font_name, const string& catNGC, const string& catNGCNames, const string& catTextures, LoadingBar& lb)
 {
@@ -155,7 +260,7 @@ bool NebulaMgr::loadNebula(double ra, double de, double magnitude, double angula
 	} else {
 		
 		neb_array.push_back(e);
-		nebZones[nebGrid.GetNearest(e->XYZ)].push_back(e);
+		insertInZone(e);
 
 //		cerr << "Nebula created: " << e->englishName << endl;
 		return true;
@@ -169,7 +274,6 @@ string NebulaMgr::removeNebula(const string& name, bool showOriginal=true)
 	string uname = name;
 	transform(uname.begin(), uname.end(), uname.begin(), ::toupper);
 	vector <Nebula*>::iterator iter;
-	vector <Nebula*>::iterator iter2;
 
 	for (iter = neb_array.begin(); iter != neb_array.end(); ++iter) {
 		string testName = (*iter)->getEnglishName();
@@ -185,16 +289,7 @@ string NebulaMgr::removeNebula(const string& name, bool showOriginal=true)
 			}
 
 			// erase from locator grid
-			int zone = nebGrid.GetNearest((*iter)->XYZ);
-
-			for (iter2 = nebZones[zone].begin(); iter2!=nebZones[zone].end(); ++iter2) {
-				if(*iter2 == *iter) {
-//					cerr << "Deleting nebula from zone " << zone << " with name " << (*iter2)->englishName << endl;
-					
-					nebZones[zone].erase(iter2);
-					break;
-				}
-			}
+			eraseFromZone(*iter);
 
 			// Delete nebula
 			delete *iter;
@@ -214,7 +309,6 @@ string NebulaMgr::removeSupplementalNebulae()
 {
 
 	vector<Nebula *>::iterator iter;
-	vector<Nebula *>::iterator iter2;
 
 	for (iter=neb_array.begin(); iter!=neb_array.end(); iter++) {
 
@@ -223,15 +317,7 @@ string NebulaMgr::removeSupplementalNebulae()
 		} else {
 
 			// erase from locator grid
-			int zone = nebGrid.GetNearest((*iter)->XYZ);
-
-			for (iter2 = nebZones[zone].begin(); iter2!=nebZones[zone].end(); ++iter2) {
-				if(*iter2 == *iter) {
-					//					cerr << "Deleting nebula from zone " << zone << " with name " << (*iter2)->englishName << endl;
-					nebZones[zone].erase(iter2);
-					break;
-				}
-			}
+			eraseFromZone(*iter);
 
 			// Delete nebula
 			delete *iter;
@@ -259,35 +345,29 @@ void NebulaMgr::draw(Projector* prj, const Navigator * nav, ToneReproductor* eye
 	// if (draw_mode == DM_NORMAL) glBlendFunc(GL_ONE, GL_ONE);
 	// else glBlendFunc(GL_SRC_ALPHA, GL_ONE_MINUS_SRC_ALPHA); // charting
 
-	Vec3f pXYZ;
-
-// 	vector<Nebula *>::iterator iter;
-// 	for(iter=neb_array.begin();iter!=neb_array.end();iter++)
-
-	// Find the star zones which are in the screen
-	int nbZones=0;
-	// FOV is currently measured vertically, so need to adjust for wide screens
-	// TODO: projector should probably use largest measurement itself
-	float max_fov = MY_MAX( prj->get_fov(), prj->get_fov()*prj->getViewportWidth()/prj->getViewportHeight());
-	nbZones = nebGrid.Intersect(nav->get_prec_equ_vision(), max_fov*M_PI/180.f*1.2f);
-	static int * zoneList = nebGrid.getResult();
+	// Find the zones which are in the screen
+	static vector<const vector<ZoneEntry>*> zones;
+	collectZones(geodesicGrid->search(prj->unprojectViewport(), zoneLevel), zones);
 
 	prj->set_orthographic_projection();	// set 2D coordinate
 
-	// Print all the stars of all the selected zones
-	static vector<Nebula *>::iterator end;
-	static vector<Nebula *>::iterator iter;
+	// Print all the nebulae of all the selected zones
+	vector<ZoneEntry>::const_iterator end;
+	vector<ZoneEntry>::const_iterator iter;
 	Nebula* n;
 
 	// speed up the computation of n->get_on_screen_size(prj, nav)>5:
 	const float size_limit = 5.0 * (M_PI/180.0)
 	                         * (prj->get_fov()/prj->getViewportHeight());
 
-	for (int i=0; i<nbZones; ++i) {
-		end = nebZones[zoneList[i]].end();
-		for (iter = nebZones[zoneList[i]].begin(); iter!=end; ++iter) {
+	// names are drawn together after the nebulae
+	Nebula::nebula_font->beginBatch();
+
+	for (unsigned int i=0; i<zones.size(); ++i) {
+		end = zones[i]->end();
+		for (iter = zones[i]->begin(); iter!=end; ++iter) {
 
-			n = *iter;
+			n = iter->neb;
 
 			if (!displayNoTexture && !n->hasTex()) continue;
 
@@ -317,6 +397,7 @@ void NebulaMgr::draw(Projector* prj, const Navigator * nav, ToneReproductor* eye
 			}
 		}
 	}
+	Nebula::nebula_font->endBatch();
 	prj->reset_perspective_projection();
 }
 
@@ -385,17 +466,24 @@ Nebula *NebulaMgr::searchNebula(const string& name, bool search_hidden=false)
 Object NebulaMgr::search(Vec3f Pos)
 {
 	Pos.normalize();
-	vector<Nebula *>::iterator iter;
 	Nebula * plusProche=NULL;
 	float anglePlusProche=0.;
-	for (iter=neb_array.begin(); iter!=neb_array.end(); iter++) {
-		if((*iter)->m_hidden==true) continue;
-		if ((*iter)->XYZ[0]*Pos[0]+(*iter)->XYZ[1]*Pos[1]+(*iter)->XYZ[2]*Pos[2]>anglePlusProche) {
-			anglePlusProche=(*iter)->XYZ[0]*Pos[0]+(*iter)->XYZ[1]*Pos[1]+(*iter)->XYZ[2]*Pos[2];
-			plusProche=(*iter);
+
+	vector<const vector<ZoneEntry>*> zones;
+	collectZones(searchRegion(Vec3d(Pos[0], Pos[1], Pos[2]), acos(0.999)*180./M_PI), zones);
+
+	vector<ZoneEntry>::const_iterator iter;
+	for (unsigned int i=0; i<zones.size(); ++i) {
+		for (iter=zones[i]->begin(); iter!=zones[i]->end(); ++iter) {
+			if(iter->neb->m_hidden==true) continue;
+			const float cosAngle = iter->pos[0]*Pos[0]+iter->pos[1]*Pos[1]+iter->pos[2]*Pos[2];
+			if (cosAngle>anglePlusProche) {
+				anglePlusProche=cosAngle;
+				plusProche=iter->neb;
+			}
 		}
 	}
-	if (anglePlusProche>RADIUS_NEB*0.999) {
+	if (anglePlusProche>0.999) {
 		return plusProche;
 	} else return NULL;
 }
@@ -406,19 +494,20 @@ vector<Object> NebulaMgr::search_around(Vec3d v, double lim_fov) const
 	vector<Object> result;
 	v.normalize();
 	double cos_lim_fov = cos(lim_fov * M_PI/180.);
-	static Vec3d equPos;
 
-	vector<Nebula*>::const_iterator iter = neb_array.begin();
-	while (iter != neb_array.end()) {
-		equPos = (*iter)->XYZ;
-		equPos.normalize();
-		if (equPos[0]*v[0] + equPos[1]*v[1] + equPos[2]*v[2]>=cos_lim_fov) {
+	vector<const vector<ZoneEntry>*> zones;
+	collectZones(searchRegion(v, lim_fov), zones);
 
-			// NOTE: non-labeled nebulas are not returned!
-			// Otherwise cursor select gets invisible nebulas - Rob
-			if ((*iter)->getNameI18n() != "" && (*iter)->m_hidden==false) result.push_back(*iter);
+	vector<ZoneEntry>::const_iterator iter;
+	for (unsigned int i=0; i<zones.size(); ++i) {
+		for (iter=zones[i]->begin(); iter!=zones[i]->end(); ++iter) {
+			if (iter->pos[0]*v[0] + iter->pos[1]*v[1] + iter->pos[2]*v[2]>=cos_lim_fov) {
+
+				// NOTE: non-labeled nebulas are not returned!
+				// Otherwise cursor select gets invisible nebulas - Rob
+				if (iter->neb->getNameI18n() != "" && iter->neb->m_hidden==false) result.push_back(iter->neb);
+			}
 		}
-		iter++;
 	}
 	return result;
 }
@@ -500,7 +589,7 @@ bool NebulaMgr::loadNGC(const string& catNGC, LoadingBar& lb)
 			data_drop++;
 		} else {
 			neb_array.push_back(e);
-			nebZones[nebGrid.GetNearest(e->XYZ)].push_back(e);
+			insertInZone(e);
 		}
 		i++;
 	}
@@ -622,7 +711,7 @@ bool NebulaMgr::loadTextures(const string& fileName, LoadingBar& lb)
 			} else {
 
 				neb_array.push_back(e);
-				nebZones[nebGrid.GetNearest(e->XYZ)].push_back(e);
+				insertInZone(e);
 			}
 		}
 
@@ -747,3 +836,26 @@ vector<string> NebulaMgr::listMatchingObjectsI18n(const string& objPrefix, unsig
 	return result;
 }
 
+void NebulaMgr::addNamesToIndex(NameIndex& index) const
+{
+	for (unsigned int i=0; i<neb_array.size(); ++i) {
+		const Nebula *n = neb_array[i];
+		if (n->m_hidden) continue;
+
+		if (n->M_nb) {
+			const string nb = Utility::intToString(n->M_nb);
+			index.add("M" + nb, "M" + nb, ObjectRecord::OBJECT_NEBULA, i, n->mag);
+			index.add("M " + nb, "M " + nb, ObjectRecord::OBJECT_NEBULA, i, n->mag);
+		}
+		if (n->NGC_nb) {
+			const string nb = Utility::intToString(n->NGC_nb);
+			index.add("NGC" + nb, "NGC" + nb, ObjectRecord::OBJECT_NEBULA, i, n->mag);
+			index.add("NGC " + nb, "NGC " + nb, ObjectRecord::OBJECT_NEBULA, i, n->mag);
+		}
+		if (!n->nameI18.empty()) {
+			index.add(n->nameI18, n->nameI18, ObjectRecord::OBJECT_NEBULA, i, n->mag);
+			index.add(n->englishName, n->nameI18, ObjectRecord::OBJECT_NEBULA, i, n->mag);
+		}
+	}
+}
+
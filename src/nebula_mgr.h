@@ -29,7 +29,6 @@
 #include <vector>
 #include "object.h"
 #include "fader.h"
-#include "grid.h"
 #include "shared_data.h"
 
 using namespace std;
@@ -38,6 +37,9 @@ class Nebula;
 class LoadingBar;
 class Translator;
 class ToneReproductor;
+class NameIndex;
+class GeodesicGrid;
+class GeodesicSearchResult;
 
 class NebulaMgr
 {
@@ -59,6 +61,9 @@ public:
 	// remove all user added nebula
 	string removeSupplementalNebulae();
 
+	//! Sort the nebulae in the zones of the geodesic grid shared with the stars
+	void setGrid(const GeodesicGrid* grid);
+
 	// Draw all the Nebulas
 	void draw(Projector *prj, const Navigator *nav, ToneReproductor *eye, double sky_brightness);
 	void update(int delta_time) {
@@ -140,6 +145,9 @@ public:
 	//! @return a vector of matching object name by order of relevance, or an empty vector if nothing match
 	vector<string> listMatchingObjectsI18n(const string& objPrefix, unsigned int maxNbItem=5) const;
 
+	//! Add the names and catalog numbers of visible nebulae to the search index
+	void addNamesToIndex(NameIndex& index) const;
+
 	//! Return the matching Nebula object's pointer if exists or NULL
 	//! @param nameI18n The case sensistive nebula name or NGC M catalog name : format can be M31, M 31, NGC31 NGC 31
 	Object searchByNameI18n(const string& nameI18n) const;
@@ -157,8 +165,21 @@ private:
 	LinearFader hintsFader;
 	LinearFader flagShow;
 
-	vector<Nebula*>* nebZones;		// array of nebula vector with the grid id as array rank
-	Grid nebGrid;					// Grid for opimisation
+	// Zone entry, with the unit position vector kept next to the nebula
+	struct ZoneEntry {
+		Vec3f pos;
+		Nebula *neb;
+	};
+
+	void insertInZone(Nebula *n);
+	void eraseFromZone(Nebula *n);
+	const GeodesicSearchResult* searchRegion(const Vec3d& v, double lim_fov) const;
+	void collectZones(const GeodesicSearchResult* region, vector<const vector<ZoneEntry>*>& zones) const;
+
+	const GeodesicGrid* geodesicGrid;
+	int zoneLevel;					// grid level of nebZones
+	vector<ZoneEntry>* nebZones;	// array of nebula vector with the zone number as array rank
+	vector<ZoneEntry> largeNebulae;	// nebulae larger than a zone, checked whatever the region
 
 	float maxMagHints;				// Define maximum magnitude at which nebulae hints are displayed
 	bool displayNoTexture;			// Define if nebulas without textures are to be displayed
@@ -15,6 +15,7 @@
 #include "solve.h"
 #include "orbit.h"
 #include "stellplanet.h"
+#include "ephemeris_cache.h"
 #include "nightshade.h"
 #include "vecmath.h"
 
@@ -51,6 +52,11 @@ void InitPar(double q,double n,double dt,double &a1,double &a2)
 	return 0;
 }
 
+void ParabolicOrbitPlanePosition(double q, double n, double dt, double &x, double &y)
+{
+	InitPar(q, n, dt, x, y);
+}
+
 void Init3D(double i,double Omega,double o,double a1,double a2,
             double &x1,double &x2,double &x3)
 {
@@ -210,6 +216,23 @@ void EllipticalOrbit::positionAtTimevInVSOP87Coordinates(double JD0, double JD,
 
 
 
+void EllipticalOrbit::fastPositionsAtTimesvInVSOP87CoordinatesCtx(double JD0, const double *JD, double *v,
+        int count, EphemerisContext *ctx) const
+{
+	// mean anomalies first, in v, then overwritten by the positions
+	const double meanMotion = 2.0 * M_PI / period;
+	for (int d=0; d<count; d++) v[d] = meanAnomalyAtEpoch + (JD[d] - epoch) * meanMotion;
+	SolveKeplerEquationBatch(eccentricity, v, v, count);
+
+	for (int d=count-1; d>=0; d--) {
+		const Vec3d pos = positionAtE(v[d]);
+		double *p = v + 3*d;
+		p[0] = rotate_to_vsop87[0]*pos[0] + rotate_to_vsop87[1]*pos[1] + rotate_to_vsop87[2]*pos[2];
+		p[1] = rotate_to_vsop87[3]*pos[0] + rotate_to_vsop87[4]*pos[1] + rotate_to_vsop87[5]*pos[2];
+		p[2] = rotate_to_vsop87[6]*pos[0] + rotate_to_vsop87[7]*pos[1] + rotate_to_vsop87[8]*pos[2];
+	}
+}
+
 Vec3d EllipticalOrbit::positionAtE(double E) const
 {
 	double x, y;
@@ -236,116 +259,9 @@ Vec3d EllipticalOrbit::positionAtE(double E) const
 
 }
 
-// Standard iteration for solving Kepler's Equation
-struct SolveKeplerFunc1 : public unary_function<double, double> {
-	double ecc;
-	double M;
-
-	SolveKeplerFunc1(double _ecc, double _M) : ecc(_ecc), M(_M) {};
-
-	double operator()(double x) const {
-		return M + ecc * sin(x);
-	}
-};
-
-
-// Faster converging iteration for Kepler's Equation; more efficient
-// than above for orbits with eccentricities greater than 0.3.  This
-// is from Jean Meeus's _Astronomical Algorithms_ (2nd ed), p. 199
-struct SolveKeplerFunc2 : public unary_function<double, double> {
-	double ecc;
-	double M;
-
-	SolveKeplerFunc2(double _ecc, double _M) : ecc(_ecc), M(_M) {};
-
-	double operator()(double x) const {
-		return x + (M + ecc * sin(x) - x) / (1 - ecc * cos(x));
-	}
-};
-
-double sign(double x)
-{
-	if (x < 0.)
-		return -1.;
-	else if (x > 0.)
-		return 1.;
-	else
-		return 0.;
-}
-
-struct SolveKeplerLaguerreConway : public unary_function<double, double> {
-	double ecc;
-	double M;
-
-	SolveKeplerLaguerreConway(double _ecc, double _M) : ecc(_ecc), M(_M) {};
-
-	double operator()(double x) const {
-		double s = ecc * sin(x);
-		double c = ecc * cos(x);
-		double f = x - s - M;
-		double f1 = 1 - c;
-		double f2 = s;
-		x += -5 * f / (f1 + sign(f1) * sqrt(abs(16 * f1 * f1 - 20 * f * f2)));
-
-		return x;
-	}
-};
-
-struct SolveKeplerLaguerreConwayHyp : public unary_function<double, double> {
-	double ecc;
-	double M;
-
-	SolveKeplerLaguerreConwayHyp(double _ecc, double _M) : ecc(_ecc), M(_M) {};
-
-	double operator()(double x) const {
-		double s = ecc * sinh(x);
-		double c = ecc * cosh(x);
-		double f = s - x - M;
-		double f1 = c - 1;
-		double f2 = s;
-		x += -5 * f / (f1 + sign(f1) * sqrt(abs(16 * f1 * f1 - 20 * f * f2)));
-
-		return x;
-	}
-};
-
-typedef pair<double, double> Solution;
-
-
 double EllipticalOrbit::eccentricAnomaly(double M) const
 {
-	if (eccentricity == 0.0) {
-		// Circular orbit
-		return M;
-	} else if (eccentricity < 0.2) {
-		// Low eccentricity, so use the standard iteration technique
-		Solution sol = solve_iteration_fixed(SolveKeplerFunc1(eccentricity, M), M, 5);
-		return sol.first;
-	} else if (eccentricity < 0.95) {
-		// Higher eccentricity elliptical orbit; use a more complex but
-		// much faster converging iteration.
-		Solution sol = solve_iteration_fixed(SolveKeplerFunc2(eccentricity, M), M, 6);
-		// Debugging
-		// printf("ecc: %f, error: %f mas\n",
-		//        eccentricity, radToDeg(sol.second) * 3600000);
-		return sol.first;
-	} else if (eccentricity < 1.0) {
-		// Extremely stable Laguerre-Conway method for solving Kepler's
-		// equation.  Only use this for high-eccentricity orbits, as it
-		// requires more calcuation.
-		double E = M + 0.85 * eccentricity * sign(sin(M));
-		Solution sol = solve_iteration_fixed(SolveKeplerLaguerreConway(eccentricity, M), E, 8);
-		return sol.first;
-	} else if (eccentricity == 1.0) {
-		// Nearly parabolic orbit; very common for comets
-		// TODO: handle this
-		return M;
-	} else {
-		// Laguerre-Conway method for hyperbolic (ecc > 1) orbits.
-		double E = log(2 * M / eccentricity + 1.85);
-		Solution sol = solve_iteration_fixed(SolveKeplerLaguerreConwayHyp(eccentricity, M), E, 30);
-		return sol.first;
-	}
+	return SolveKeplerEquation(eccentricity, M);
 }
 
 
@@ -461,136 +377,212 @@ static EllipticalOrbit* StateVectorToOrbit(const Vec3d& position,  // km
 //! A Special Orbit uses special ephemeris algorithms
 
 SpecialOrbit::SpecialOrbit(std::string ephemerisName) :
+	name(ephemerisName), cache(NULL), cacheIndex(-1),
 	stable(true), m_UseParentPrecession(true)
 {
 
 	positionFunction = NULL;
 	osculatingFunction = NULL;
+	positionFunctionCtx = NULL;
+	osculatingFunctionCtx = NULL;
 
 
-	if (ephemerisName=="sun_special")
+	if (ephemerisName=="sun_special") {
 		positionFunction = &get_sun_helio_coordsv;
+		positionFunctionCtx = &get_sun_helio_coordsv_ctx;
+	}
 
 	if (ephemerisName=="mercury_special") {
 		positionFunction = &get_mercury_helio_coordsv;
+		positionFunctionCtx = &get_mercury_helio_coordsv_ctx;
 		osculatingFunction = &get_mercury_helio_osculating_coords;
+		osculatingFunctionCtx = &get_mercury_helio_osculating_coords_ctx;
 	}
 
 	if (ephemerisName=="venus_special") {
 		positionFunction = &get_venus_helio_coordsv;
+		positionFunctionCtx = &get_venus_helio_coordsv_ctx;
 		osculatingFunction = &get_venus_helio_osculating_coords;
+		osculatingFunctionCtx = &get_venus_helio_osculating_coords_ctx;
 	}
 
 	if (ephemerisName=="earth_special") {
 		positionFunction = &get_earth_helio_coordsv;
+		positionFunctionCtx = &get_earth_helio_coordsv_ctx;
 		osculatingFunction = &get_earth_helio_osculating_coords;
+		osculatingFunctionCtx = &get_earth_helio_osculating_coords_ctx;
 		stable = false;
 	}
 
 	// Earth-Moon Barycenter
 	if (ephemerisName=="emb_special") {
 		positionFunction = &get_emb_helio_coordsv;
+		positionFunctionCtx = &get_emb_helio_coordsv_ctx;
 		osculatingFunction = &get_emb_helio_osculating_coords;
+		osculatingFunctionCtx = &get_emb_helio_osculating_coords_ctx;
 	}
 
 	if (ephemerisName=="lunar_special") {
 		positionFunction = &get_lunar_parent_coordsv;
+		positionFunctionCtx = &get_lunar_parent_coordsv_ctx;
 		m_UseParentPrecession = false;
 	}
 
 	if (ephemerisName=="mars_special") {
 		positionFunction = &get_mars_helio_coordsv;
+		positionFunctionCtx = &get_mars_helio_coordsv_ctx;
 		osculatingFunction = &get_mars_helio_osculating_coords;
+		osculatingFunctionCtx = &get_mars_helio_osculating_coords_ctx;
 	}
 
-	if (ephemerisName=="phobos_special")
+	if (ephemerisName=="phobos_special") {
 		positionFunction = &get_phobos_parent_coordsv;
+		positionFunctionCtx = &get_phobos_parent_coordsv_ctx;
+	}
 
-	if (ephemerisName=="deimos_special")
+	if (ephemerisName=="deimos_special") {
 		positionFunction = &get_deimos_parent_coordsv;
+		positionFunctionCtx = &get_deimos_parent_coordsv_ctx;
+	}
 
 	if (ephemerisName=="jupiter_special") {
 		positionFunction = &get_jupiter_helio_coordsv;
+		positionFunctionCtx = &get_jupiter_helio_coordsv_ctx;
 		osculatingFunction = &get_jupiter_helio_osculating_coords;
+		osculatingFunctionCtx = &get_jupiter_helio_osculating_coords_ctx;
 	}
 
-	if (ephemerisName=="europa_special")
+	if (ephemerisName=="europa_special") {
 		positionFunction = &get_europa_parent_coordsv;
+		positionFunctionCtx = &get_europa_parent_coordsv_ctx;
+	}
 
-	if (ephemerisName=="calisto_special")
+	if (ephemerisName=="calisto_special") {
 		positionFunction = &get_callisto_parent_coordsv;
+		positionFunctionCtx = &get_callisto_parent_coordsv_ctx;
+	}
 
-	if (ephemerisName=="io_special")
+	if (ephemerisName=="io_special") {
 		positionFunction = &get_io_parent_coordsv;
+		positionFunctionCtx = &get_io_parent_coordsv_ctx;
+	}
 
-	if (ephemerisName=="ganymede_special")
+	if (ephemerisName=="ganymede_special") {
 		positionFunction = &get_ganymede_parent_coordsv;
+		positionFunctionCtx = &get_ganymede_parent_coordsv_ctx;
+	}
 
 	if (ephemerisName=="saturn_special") {
 		positionFunction = &get_saturn_helio_coordsv;
+		positionFunctionCtx = &get_saturn_helio_coordsv_ctx;
 		osculatingFunction = &get_saturn_helio_osculating_coords;
+		osculatingFunctionCtx = &get_saturn_helio_osculating_coords_ctx;
 		stable = false;
 	}
 
-	if (ephemerisName=="mimas_special")
+	if (ephemerisName=="mimas_special") {
 		positionFunction = &get_mimas_parent_coordsv;
+		positionFunctionCtx = &get_mimas_parent_coordsv_ctx;
+	}
 
-	if (ephemerisName=="enceladus_special")
+	if (ephemerisName=="enceladus_special") {
 		positionFunction = &get_enceladus_parent_coordsv;
+		positionFunctionCtx = &get_enceladus_parent_coordsv_ctx;
+	}
 
-	if (ephemerisName=="tethys_special")
+	if (ephemerisName=="tethys_special") {
 		positionFunction = &get_tethys_parent_coordsv;
+		positionFunctionCtx = &get_tethys_parent_coordsv_ctx;
+	}
 
-	if (ephemerisName=="dione_special")
+	if (ephemerisName=="dione_special") {
 		positionFunction = &get_dione_parent_coordsv;
+		positionFunctionCtx = &get_dione_parent_coordsv_ctx;
+	}
 
-	if (ephemerisName=="rhea_special")
+	if (ephemerisName=="rhea_special") {
 		positionFunction = &get_rhea_parent_coordsv;
+		positionFunctionCtx = &get_rhea_parent_coordsv_ctx;
+	}
 
-	if (ephemerisName=="titan_special")
+	if (ephemerisName=="titan_special") {
 		positionFunction = &get_titan_parent_coordsv;
+		positionFunctionCtx = &get_titan_parent_coordsv_ctx;
+	}
 
-	if (ephemerisName=="iapetus_special")
+	if (ephemerisName=="iapetus_special") {
 		positionFunction = &get_iapetus_parent_coordsv;
+		positionFunctionCtx = &get_iapetus_parent_coordsv_ctx;
+	}
 
-	if (ephemerisName=="hyperion_special")
+	if (ephemerisName=="hyperion_special") {
 		positionFunction = &get_hyperion_parent_coordsv;
+		positionFunctionCtx = &get_hyperion_parent_coordsv_ctx;
+	}
 
 	if (ephemerisName=="uranus_special") {
 		positionFunction = &get_uranus_helio_coordsv;
+		positionFunctionCtx = &get_uranus_helio_coordsv_ctx;
 		osculatingFunction = &get_uranus_helio_osculating_coords;
+		osculatingFunctionCtx = &get_uranus_helio_osculating_coords_ctx;
 		stable = false;
 	}
 
-	if (ephemerisName=="miranda_special")
+	if (ephemerisName=="miranda_special") {
 		positionFunction = &get_miranda_parent_coordsv;
+		positionFunctionCtx = &get_miranda_parent_coordsv_ctx;
+	}
 
-	if (ephemerisName=="ariel_special")
+	if (ephemerisName=="ariel_special") {
 		positionFunction = &get_ariel_parent_coordsv;
+		positionFunctionCtx = &get_ariel_parent_coordsv_ctx;
+	}
 
-	if (ephemerisName=="umbriel_special")
+	if (ephemerisName=="umbriel_special") {
 		positionFunction = &get_umbriel_parent_coordsv;
+		positionFunctionCtx = &get_umbriel_parent_coordsv_ctx;
+	}
 
-	if (ephemerisName=="titania_special")
+	if (ephemerisName=="titania_special") {
 		positionFunction = &get_titania_parent_coordsv;
+		positionFunctionCtx = &get_titania_parent_coordsv_ctx;
+	}
 
-	if (ephemerisName=="oberon_special")
+	if (ephemerisName=="oberon_special") {
 		positionFunction = &get_oberon_parent_coordsv;
+		positionFunctionCtx = &get_oberon_parent_coordsv_ctx;
+	}
 
 	if (ephemerisName=="neptune_special") {
 		positionFunction = &get_neptune_helio_coordsv;
+		positionFunctionCtx = &get_neptune_helio_coordsv_ctx;
 		osculatingFunction = &get_neptune_helio_osculating_coords;
+		osculatingFunctionCtx = &get_neptune_helio_osculating_coords_ctx;
 		stable = false;
 	}
 
-	if (ephemerisName=="pluto_special")
+	if (ephemerisName=="pluto_special") {
 		positionFunction = &get_pluto_helio_coordsv;
+		positionFunctionCtx = &get_pluto_helio_coordsv_ctx;
+	}
 
 	// \todo better error checking
 
 }
 
 
+void SpecialOrbit::setEphemerisCache(const EphemerisCache *c)
+{
+	cacheIndex = c ? c->findBody(name) : -1;
+	cache = (cacheIndex >= 0) ? c : NULL;
+}
+
+// The cache holds true positions only, osculating orbits are always computed
+inline bool SpecialOrbit::cachedPosition(double JD0, double JD, double *v) const
+{
+	return cache && JD0 == JD && cache->position(cacheIndex, JD, v);
+}
+
 // Compute position for a specified Julian date and return coordinates
 // given in "dynamical equinox and ecliptic J2000"
 // which is the reference frame for VSOP87
@@ -598,10 +590,19 @@ SpecialOrbit::SpecialOrbit(std::string ephemerisName) :
 // parent_rot_obliquity and parent_rot_ascendingnode must be supplied.
 void SpecialOrbit::positionAtTimevInVSOP87Coordinates(double JD0, double JD, double* v) const
 {
+	if (cachedPosition(JD0, JD, v)) return;
 	if(osculatingFunction) (*osculatingFunction)(JD0, JD, v);
 	else positionFunction(JD, v);
 }
 
+void SpecialOrbit::positionAtTimevInVSOP87CoordinatesCtx(double JD0, double JD, double* v,
+        EphemerisContext *ctx) const
+{
+	if (cachedPosition(JD0, JD, v)) return;
+	if(osculatingFunctionCtx) (*osculatingFunctionCtx)(ctx, JD0, JD, v);
+	else positionFunctionCtx(ctx, JD, v);
+}
+
 
 MixedOrbit::MixedOrbit(Orbit* orbit, double period, double t0, double t1, double mass,
                        double _parent_rot_obliquity,
@@ -705,6 +706,17 @@ void MixedOrbit::positionAtTimevInVSOP87Coordinates(double JD0, double JD, doubl
         afterApprox->positionAtTimevInVSOP87Coordinates(JD0, JD, v);
 }
 
+void MixedOrbit::positionAtTimevInVSOP87CoordinatesCtx(double JD0, double JD, double *v,
+        EphemerisContext *ctx) const
+{
+    if (JD < begin) 
+        beforeApprox->positionAtTimevInVSOP87CoordinatesCtx(JD0, JD, v, ctx);
+    else if (JD < end)
+        primary->positionAtTimevInVSOP87CoordinatesCtx(JD0, JD, v, ctx);
+    else
+        afterApprox->positionAtTimevInVSOP87CoordinatesCtx(JD0, JD, v, ctx);
+}
+
 bool MixedOrbit::isStable(double jd) const 
 { 
     if (jd < begin)
@@ -754,11 +766,31 @@ void BinaryOrbit::positionAtTimevInVSOP87Coordinates(double JD0, double JD, doub
 	v[2] -= ratio * posSecondary[2];
 }
 
+void BinaryOrbit::positionAtTimevInVSOP87CoordinatesCtx(double JD0, double JD, double *v,
+        EphemerisContext *ctx) const
+{
+	Vec3d posSecondary(0.0, 0.0, 0.0);
+
+	barycenter->positionAtTimevInVSOP87CoordinatesCtx(JD0, JD, v, ctx);
+
+	if(secondary) secondary->positionAtTimevInVSOP87CoordinatesCtx(JD0, JD, posSecondary, ctx);
+
+	v[0] -= ratio * posSecondary[0];
+	v[1] -= ratio * posSecondary[1];
+	v[2] -= ratio * posSecondary[2];
+}
+
 void BinaryOrbit::fastPositionAtTimevInVSOP87Coordinates(double JD0, double JD, double *v) const
 {
 	barycenter->positionAtTimevInVSOP87Coordinates(JD0, JD, v);
 }
 
+void BinaryOrbit::fastPositionAtTimevInVSOP87CoordinatesCtx(double JD0, double JD, double *v,
+        EphemerisContext *ctx) const
+{
+	barycenter->positionAtTimevInVSOP87CoordinatesCtx(JD0, JD, v, ctx);
+}
+
 
 bool BinaryOrbit::isStable(double jd) const 
 { 
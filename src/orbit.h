@@ -11,14 +11,25 @@
 #define _ORBIT_H_
 
 #include "vecmath.h"
+#include "kepler.h"
 #include <string>
 
 // The callback type for the external position computation function
 typedef void (PositionFunctionType)(double jd,double xyz[3]);
 typedef void (OsculatingFunctionType)(double jd0,double jd,double xyz[3]);
 
+// Reentrant versions, see planetsephems/stellplanet.h
+struct EphemerisContext;
+class EphemerisCache;
+typedef void (PositionFunctionCtxType)(EphemerisContext *ctx,double jd,double xyz[3]);
+typedef void (OsculatingFunctionCtxType)(EphemerisContext *ctx,double jd0,double jd,double xyz[3]);
+
 class OrbitSampleProc;
 
+// Position in the orbit plane of a parabolic orbit dt days after perihelion,
+// as computed by CometOrbit
+void ParabolicOrbitPlanePosition(double q, double n, double dt, double &x, double &y);
+
 class Orbit
 {
 public:
@@ -38,8 +49,30 @@ public:
 		positionAtTimevInVSOP87Coordinates(JD, JD, v);
 	}
 
+	// Thread safe versions of the above: any ephemeris cache used lives in ctx
+	// Orbits computed analytically have no cache and need not override these
+	virtual void positionAtTimevInVSOP87CoordinatesCtx(double JD0, double JD, double *v,
+	        EphemerisContext *ctx) const {
+		positionAtTimevInVSOP87Coordinates(JD0, JD, v);
+	}
+	virtual void fastPositionAtTimevInVSOP87CoordinatesCtx(double JD0, double JD, double *v,
+	        EphemerisContext *ctx) const {
+		positionAtTimevInVSOP87CoordinatesCtx(JD, JD, v, ctx);
+	}
+
+	// fastPositionAtTimevInVSOP87CoordinatesCtx for count dates, 3 doubles per date in v
+	// Orbits with a batch algorithm override this, by default each date is computed in turn
+	virtual void fastPositionsAtTimesvInVSOP87CoordinatesCtx(double JD0, const double *JD, double *v,
+	        int count, EphemerisContext *ctx) const {
+		for (int d=0; d<count; d++) fastPositionAtTimevInVSOP87CoordinatesCtx(JD0, JD[d], v + 3*d, ctx);
+	}
+
 	virtual OsculatingFunctionType * getOsculatingFunction() const { return NULL; };
 
+	// Use the precomputed positions of cache where it has them, NULL to stop.
+	// Only orbits from special ephemerides are ever cached.
+	virtual void setEphemerisCache(const EphemerisCache *cache) {}
+
     virtual double getBoundingRadius() const { return 0; }
 
 	// Is this orbit stable (exactly the same path over time)
@@ -78,6 +111,10 @@ public:
 	// parent_rot_obliquity and parent_rot_ascendingnode must be supplied.
 	virtual void positionAtTimevInVSOP87Coordinates(double JD0, double JD, double *v) const;
 
+	// Solves Kepler's equation for all the dates at once
+	virtual void fastPositionsAtTimesvInVSOP87CoordinatesCtx(double JD0, const double *JD, double *v,
+	        int count, EphemerisContext *ctx) const;
+
 	// Original one
 	Vec3d positionAtTime(double) const;
 	double getPeriod() const;
@@ -157,6 +194,8 @@ public:
 	// In order to rotate to VSOP87
 	// parent_rot_obliquity and parent_rot_ascendingnode must be supplied.
 	virtual void positionAtTimevInVSOP87Coordinates(double JD0, double JD, double *v) const;
+	virtual void positionAtTimevInVSOP87CoordinatesCtx(double JD0, double JD, double *v,
+	        EphemerisContext *ctx) const;
 
 	virtual OsculatingFunctionType * getOsculatingFunction() const { 
 		return osculatingFunction;
@@ -170,10 +209,20 @@ public:
 	// Do the body coordinates precess with the parent?
 	virtual bool useParentPrecession(double) const { return m_UseParentPrecession; }
 
+	// Positions (JD0 == JD) inside the cache range come from the cache
+	virtual void setEphemerisCache(const EphemerisCache *cache);
+
 
 private:
+	bool cachedPosition(double JD0, double JD, double *v) const;
+
+	std::string name;
+	const EphemerisCache *cache;
+	int cacheIndex;
 	PositionFunctionType *positionFunction;
 	OsculatingFunctionType *osculatingFunction;
+	PositionFunctionCtxType *positionFunctionCtx;
+	OsculatingFunctionCtxType *osculatingFunctionCtx;
 	bool stable;  // does not osculate noticeably for performance caching orbit visualization
 	bool m_UseParentPrecession;
 };
@@ -197,12 +246,18 @@ class MixedOrbit : public Orbit
     virtual ~MixedOrbit();
 
 	virtual void positionAtTimevInVSOP87Coordinates(double JD0, double JD, double *v) const;
+	virtual void positionAtTimevInVSOP87CoordinatesCtx(double JD0, double JD, double *v,
+	        EphemerisContext *ctx) const;
 
 	virtual bool isStable(double jd) const;
 
 	// Do the body coordinates precess with the parent?
 	virtual bool useParentPrecession(double jd) const;
 
+	virtual void setEphemerisCache(const EphemerisCache *cache) {
+		primary->setEphemerisCache(cache);
+	}
+
  private:
     Orbit* primary;
     Orbit* afterApprox;
@@ -233,9 +288,13 @@ class BinaryOrbit : public Orbit
     virtual ~BinaryOrbit();
 
 	virtual void positionAtTimevInVSOP87Coordinates(double JD0, double JD, double *v) const;
+	virtual void positionAtTimevInVSOP87CoordinatesCtx(double JD0, double JD, double *v,
+	        EphemerisContext *ctx) const;
 
 	// If possible, do faster (and less accurate) calculation for orbits
 	virtual void fastPositionAtTimevInVSOP87Coordinates(double JD0, double JD, double *v) const;
+	virtual void fastPositionAtTimevInVSOP87CoordinatesCtx(double JD0, double JD, double *v,
+	        EphemerisContext *ctx) const;
 
 	virtual bool isStable(double jd) const;
 
@@ -246,6 +305,11 @@ class BinaryOrbit : public Orbit
 
 	virtual void setSecondaryOrbit(Orbit *second) { secondary = second; }
 
+	// The secondary gets the cache from its own planet
+	virtual void setEphemerisCache(const EphemerisCache *cache) {
+		barycenter->setEphemerisCache(cache);
+	}
+
  private:
     Orbit* barycenter;
     Orbit* secondary;
@@ -0,0 +1,191 @@
+/*
+ * Nightshade (TM) astronomy simulation and visualization
+ *
+ * Copyright (C) 2012 Digitalis Education Solutions, Inc.
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 3
+ * of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place - Suite 330, Boston, MA  02111-1307, USA.
+ *
+ * Nightshade is a trademark of Digitalis Education Solutions, Inc.
+ * See the TRADEMARKS file for trademark usage requirements.
+ *
+ */
+
+
+#include <algorithm>
+#include <iostream>
+
+#ifndef WIN32
+#include <unistd.h>
+#endif
+
+#include "orbit_sampler.h"
+#include "planet.h"
+
+OrbitSampler::OrbitSampler(int nb_threads) :
+	quit(false), points_computed(0), points_last_frame(0), pending_jobs(0)
+{
+	InitEphemerisContext(&local_ctx);
+
+	lock = SDL_CreateMutex();
+	work_available = SDL_CreateCond();
+	job_finished = SDL_CreateCond();
+
+	if (nb_threads < 0) {
+#ifndef WIN32
+		nb_threads = sysconf(_SC_NPROCESSORS_ONLN) - 1;
+#else
+		nb_threads = 1;
+#endif
+		if (nb_threads < 1) nb_threads = 1;
+	}
+
+	for (int i=0; i<nb_threads; i++) {
+		Worker *w = new Worker;
+		w->sampler = this;
+		InitEphemerisContext(&w->ctx);
+		w->thread = SDL_CreateThread(&OrbitSampler::workerThread, w);
+		if (!w->thread) {
+			cerr << "Can't create orbit sampling thread, " << i << " available" << endl;
+			delete w;
+			break;
+		}
+		workers.push_back(w);
+	}
+}
+
+OrbitSampler::~OrbitSampler()
+{
+	SDL_mutexP(lock);
+	quit = true;
+	SDL_CondBroadcast(work_available);
+	SDL_mutexV(lock);
+
+	for (std::vector<Worker*>::iterator iter = workers.begin(); iter != workers.end(); ++iter) {
+		SDL_WaitThread((*iter)->thread, NULL);
+		delete *iter;
+	}
+	workers.clear();
+
+	SDL_DestroyCond(job_finished);
+	SDL_DestroyCond(work_available);
+	SDL_DestroyMutex(lock);
+}
+
+void OrbitSampler::compute(const OrbitSampleJob& job, EphemerisContext *ctx)
+{
+	// date increments between points will not be completely constant though
+	double dates[ORBIT_SEGMENTS];
+	for (int d=0; d<job.count; d++)
+		dates[d] = job.base_date + (job.first+d-ORBIT_SEGMENTS/2)*job.date_increment;
+
+	if (job.osculating) {
+		for (int d=0; d<job.count; d++)
+			job.orbit->positionAtTimevInVSOP87CoordinatesCtx(job.jd0, dates[d], job.points + 3*(job.first+d), ctx);
+	} else {
+		job.orbit->fastPositionsAtTimesvInVSOP87CoordinatesCtx(job.jd0, dates, job.points + 3*job.first, job.count, ctx);
+	}
+}
+
+void OrbitSampler::queue(const OrbitSampleJob& job)
+{
+	if (!isThreaded()) {
+		compute(job, &local_ctx);
+		points_computed += job.count;
+		job.planet->finishOrbitSample();
+		return;
+	}
+
+	SDL_mutexP(lock);
+	todo.push_back(job);
+	pending_jobs++;
+	SDL_CondSignal(work_available);
+	SDL_mutexV(lock);
+}
+
+void OrbitSampler::collect(void)
+{
+	std::vector<OrbitSampleJob> finished;
+
+	SDL_mutexP(lock);
+	finished.swap(done);
+	pending_jobs -= finished.size();
+	points_last_frame = points_computed;
+	points_computed = 0;
+	SDL_mutexV(lock);
+
+	for (std::vector<OrbitSampleJob>::iterator iter = finished.begin(); iter != finished.end(); ++iter) {
+		iter->planet->finishOrbitSample();
+	}
+}
+
+void OrbitSampler::flush(void)
+{
+	SDL_mutexP(lock);
+	while (!todo.empty() || !running.empty()) {
+		SDL_CondWait(job_finished, lock);
+	}
+	SDL_mutexV(lock);
+
+	collect();
+}
+
+void OrbitSampler::cancel(const Planet *planet)
+{
+	SDL_mutexP(lock);
+	while (std::find(running.begin(), running.end(), planet) != running.end()) {
+		SDL_CondWait(job_finished, lock);
+	}
+	for (std::deque<OrbitSampleJob>::iterator iter = todo.begin(); iter != todo.end(); ) {
+		if (iter->planet == planet) {
+			iter = todo.erase(iter);
+			pending_jobs--;
+		} else ++iter;
+	}
+	for (std::vector<OrbitSampleJob>::iterator iter = done.begin(); iter != done.end(); ) {
+		if (iter->planet == planet) {
+			iter = done.erase(iter);
+			pending_jobs--;
+		} else ++iter;
+	}
+	SDL_mutexV(lock);
+}
+
+int OrbitSampler::workerThread(void *data)
+{
+	Worker *w = (Worker*)data;
+	OrbitSampler *s = w->sampler;
+
+	SDL_mutexP(s->lock);
+	for (;;) {
+		while (!s->quit && s->todo.empty()) SDL_CondWait(s->work_available, s->lock);
+		if (s->quit) break;
+
+		const OrbitSampleJob job = s->todo.front();
+		s->todo.pop_front();
+		s->running.push_back(job.planet);
+		SDL_mutexV(s->lock);
+
+		compute(job, &w->ctx);
+
+		SDL_mutexP(s->lock);
+		s->running.erase(std::find(s->running.begin(), s->running.end(), job.planet));
+		s->done.push_back(job);
+		s->points_computed += job.count;
+		SDL_CondBroadcast(s->job_finished);
+	}
+	SDL_mutexV(s->lock);
+
+	return 0;
+}
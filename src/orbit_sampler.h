@@ -0,0 +1,115 @@
+/*
+ * Nightshade (TM) astronomy simulation and visualization
+ *
+ * Copyright (C) 2012 Digitalis Education Solutions, Inc.
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 3
+ * of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place - Suite 330, Boston, MA  02111-1307, USA.
+ *
+ * Nightshade is a trademark of Digitalis Education Solutions, Inc.
+ * See the TRADEMARKS file for trademark usage requirements.
+ *
+ */
+
+// Computes orbit line points for the planets on a pool of worker threads.
+// Each planet has at most one job in flight; its results land in the
+// planet's back buffer and are swapped in by collect() on the main thread,
+// so drawing never waits for a refresh.
+
+#ifndef _ORBIT_SAMPLER_H_
+#define _ORBIT_SAMPLER_H_
+
+#include <deque>
+#include <vector>
+
+#include "SDL_thread.h"
+#include "stellplanet.h"
+
+class Orbit;
+class Planet;
+
+struct OrbitSampleJob {
+	Planet *planet;
+	const Orbit *orbit;
+	bool osculating;        // use the osculating orbit of epoch jd0
+	double jd0;
+	double base_date;       // point d is computed at base_date + (d-ORBIT_SEGMENTS/2)*date_increment
+	double date_increment;
+	int first;              // range of points to compute
+	int count;
+	double *points;         // 3 doubles per point, ORBIT_SEGMENTS points
+};
+
+class OrbitSampler
+{
+public:
+	// nb_threads < 0 selects one thread less than the number of processors,
+	// 0 computes the points synchronously in queue()
+	OrbitSampler(int nb_threads);
+	virtual ~OrbitSampler();
+
+	bool isThreaded(void) const {
+		return !workers.empty();
+	}
+	unsigned int getNbThreads(void) const {
+		return workers.size();
+	}
+
+	void queue(const OrbitSampleJob& job);
+
+	// Hand finished jobs back to their planets, called once per frame from the main thread
+	void collect(void);
+
+	// Wait for all jobs then hand them back
+	void flush(void);
+
+	// Drop the job of a planet about to be deleted, waiting for it if already running
+	void cancel(const Planet *planet);
+
+	// Number of orbit points computed during the previous frame
+	unsigned int getPointsLastFrame(void) const {
+		return points_last_frame;
+	}
+	// Number of jobs queued or running
+	unsigned int getPendingJobs(void) const {
+		return pending_jobs;
+	}
+
+private:
+	struct Worker {
+		OrbitSampler *sampler;
+		SDL_Thread *thread;
+		EphemerisContext ctx;
+	};
+
+	static int workerThread(void *data);
+	static void compute(const OrbitSampleJob& job, EphemerisContext *ctx);
+
+	std::vector<Worker*> workers;
+	std::deque<OrbitSampleJob> todo;
+	std::vector<OrbitSampleJob> done;
+	std::vector<const Planet*> running;
+
+	SDL_mutex *lock;
+	SDL_cond *work_available;
+	SDL_cond *job_finished;
+	bool quit;
+
+	EphemerisContext local_ctx;  // for synchronous operation
+	unsigned int points_computed;
+	unsigned int points_last_frame;
+	unsigned int pending_jobs;
+};
+
+#endif // _ORBIT_SAMPLER_H_
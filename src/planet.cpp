@@ -40,12 +40,18 @@
 #include <nshade_state.h>
 
 s_font* Planet::planet_name_font = NULL;
+OrbitSampler* Planet::orbit_sampler = NULL;
 float Planet::object_scale = 1.f;
 float Planet::object_size_limit = 9;
 Vec3f Planet::label_color = Vec3f(.4,.4,.8);
 Vec3f Planet::planet_orbit_color = Vec3f(1,.6,1);
 Vec3f Planet::satellite_orbit_color = Vec3f(.6,0,.6);
 Vec3f Planet::trail_color = Vec3f(1,.7,.7);
+#ifdef LSS
+int Planet::max_trail = 1460;	// 4 years trails
+#else
+int Planet::max_trail = 60;	// 60 day trails
+#endif
 LinearFader Planet::flagShow;
 LinearFader Planet::flagClouds;
 s_texture *Planet::defaultTexMap = NULL;
@@ -104,6 +110,8 @@ Planet::Planet(Planet *parent,
 		if (parent->getEnglishName() != "Sun") is_satellite = 1; // quicker lookup
 	}
 	ecliptic_pos = light_ecliptic_pos = Vec3d(0.,0.,0.);
+	orbitPoint = orbitPointBuffer[0];
+	orbit_sampling = false;
 	rot_local_to_parent = Mat4d::identity();
 	rot_local_to_parent_unprecessed = Mat4d::identity();
 	mat_local_to_parent = Mat4d::identity();
@@ -180,15 +188,9 @@ Planet::Planet(Planet *parent,
 	DeltaTrail = 1;
 	// small increment like 0.125 would allow observation of latitude related wobble of moon
 	// if decide to show moon trail
+	MaxTrail = max_trail;
 
-#ifdef LSS
-// 4 years trails
-	MaxTrail = 1460;
-#else
-// 60 day trails
-	MaxTrail = 60;
-#endif
-
+	trail.setCapacity(MaxTrail);
 	last_trailJD = 0; // for now
 	trail_on = 0;
 	first_point = 1;
@@ -226,6 +228,7 @@ Planet::~Planet()
 	tex_cloud = NULL;
 	if (tex_norm_cloud) delete tex_norm_cloud;
 	tex_norm_cloud = NULL;
+	if (orbit_sampling && orbit_sampler) orbit_sampler->cancel(this);
 	if(orbit) delete orbit;
 	orbit = NULL;
 
@@ -407,79 +410,15 @@ void Planet::compute_position(const double date)
 
 	if(!orbit || visibility == NONEXISTANT) return;
 
-	// Large performance advantage from avoiding object overhead
-	OsculatingFunctionType *oscFunc = orbit->getOsculatingFunction();
+	// Always through the orbit, which may take the position from the ephemeris cache
 
 	// for performance only update orbit points if visible
 	if (orbit_fader.getInterstate()*visibilityFader.getInterstate()>0.000001 
 		&& delta_orbitJD > 0 
-		&& (fabs(last_orbitJD-date)>delta_orbitJD || !orbit_cached)) {
-
-		// calculate orbit first (for line drawing)
-		double date_increment = re.sidereal_period/ORBIT_SEGMENTS;
-		double calc_date;
-		//	  int delta_points = (int)(0.5 + (date - last_orbitJD)/date_increment);
-		int delta_points;
-
-		if ( date > last_orbitJD ) {
-			delta_points = (int)(0.5 + (date - last_orbitJD)/date_increment);
-		} else {
-			delta_points = (int)(-0.5 + (date - last_orbitJD)/date_increment);
-		}
-		double new_date = last_orbitJD + delta_points*date_increment;
+		&& (fabs(last_orbitJD-date)>delta_orbitJD || !orbit_cached)
+		&& !orbit_sampling && orbit_sampler) {
 
-		//	  printf( "Updating orbit coordinates for %s (delta %f) (%d points)\n", name.c_str(), delta_orbitJD, delta_points);
-		//cout << englishName << ": " << delta_points << "  " << orbit_cached << endl;
-
-		if ( delta_points > 0 && delta_points < ORBIT_SEGMENTS && orbit_cached) {
-
-			for ( int d=0; d<ORBIT_SEGMENTS; d++ ) {
-				if (d + delta_points >= ORBIT_SEGMENTS ) {
-					// calculate new points
-					calc_date = new_date + (d-ORBIT_SEGMENTS/2)*date_increment;
-					// date increments between points will not be completely constant though
-
-					if(oscFunc) (*oscFunc)(date,calc_date,orbitPoint[d]);
-					else orbit->fastPositionAtTimevInVSOP87Coordinates(date,calc_date,orbitPoint[d]);
-				} else {
-					orbitPoint[d] = orbitPoint[d+delta_points];
-				}
-			}
-
-			last_orbitJD = new_date;
-
-		} else if ( delta_points < 0 && abs(delta_points) < ORBIT_SEGMENTS  && orbit_cached) {
-
-			for ( int d=ORBIT_SEGMENTS-1; d>=0; d-- ) {
-				if (d + delta_points < 0 ) {
-					// calculate new points
-					calc_date = new_date + (d-ORBIT_SEGMENTS/2)*date_increment;
-
-					if(oscFunc) (*oscFunc)(date,calc_date,orbitPoint[d]);
-					else orbit->fastPositionAtTimevInVSOP87Coordinates(date,calc_date,orbitPoint[d]);
-				} else {
-					orbitPoint[d] = orbitPoint[d+delta_points];
-				}
-			}
-
-			last_orbitJD = new_date;
-
-		} else if ( delta_points || !orbit_cached) {
-
-			// update all points (less efficient)
-			for ( int d=0; d<ORBIT_SEGMENTS; d++ ) {
-				calc_date = date + (d-ORBIT_SEGMENTS/2)*date_increment;
-
-				if(oscFunc) (*oscFunc)(date,calc_date,orbitPoint[d]);
-				else orbit->fastPositionAtTimevInVSOP87Coordinates(date,calc_date,orbitPoint[d]);
-			}
-
-			last_orbitJD = date;
-
-			// \todo remove this for efficiency?  Can cause rendering issues near body though
-			// If orbit is largely constant through time cache it
-			if (orbit->isStable(date)) orbit_cached = 1;
-		}
+		queueOrbitSample(date);
 	}
 
 
@@ -498,8 +437,7 @@ void Planet::compute_position(const double date)
 			interpolationDirection = sign;
 			double nextDate = lastJD + sign * deltaJD;
 			
-			if(oscFunc) (*oscFunc)(nextDate,nextDate,next_pos);
-			else orbit->positionAtTimevInVSOP87Coordinates(nextDate, nextDate, next_pos);
+			orbit->positionAtTimevInVSOP87Coordinates(nextDate, nextDate, next_pos);
 		}
 		
 		ecliptic_pos = (1-delta/deltaJD)*last_pos + (delta/deltaJD)*next_pos;
@@ -508,14 +446,84 @@ void Planet::compute_position(const double date)
 		interpolating = false;
 		
 		// calculate actual Planet position
-		if(oscFunc) (*oscFunc)(date,date,ecliptic_pos);
-		else orbit->positionAtTimevInVSOP87Coordinates(date,date,ecliptic_pos);
+		orbit->positionAtTimevInVSOP87Coordinates(date,date,ecliptic_pos);
 		last_pos = ecliptic_pos;
 		lastJD = date;
 	}
 
 }
 
+// Calculate orbit points (for line drawing) into the back buffer
+// Only the points not already in the front buffer are computed
+void Planet::queueOrbitSample(const double date)
+{
+	Vec3d *back = (orbitPoint == orbitPointBuffer[0]) ? orbitPointBuffer[1] : orbitPointBuffer[0];
+	double date_increment = re.sidereal_period/ORBIT_SEGMENTS;
+	int delta_points;
+
+	if ( date > last_orbitJD ) {
+		delta_points = (int)(0.5 + (date - last_orbitJD)/date_increment);
+	} else {
+		delta_points = (int)(-0.5 + (date - last_orbitJD)/date_increment);
+	}
+	double new_date = last_orbitJD + delta_points*date_increment;
+
+	OrbitSampleJob job;
+	job.planet = this;
+	job.orbit = orbit;
+	job.osculating = (orbit->getOsculatingFunction() != NULL);
+	job.jd0 = date;
+	job.date_increment = date_increment;
+	job.points = back[0];
+
+	if ( delta_points > 0 && delta_points < ORBIT_SEGMENTS && orbit_cached) {
+
+		for ( int d=0; d<ORBIT_SEGMENTS-delta_points; d++ ) {
+			back[d] = orbitPoint[d+delta_points];
+		}
+		job.base_date = new_date;
+		job.first = ORBIT_SEGMENTS-delta_points;
+		job.count = delta_points;
+		sample_orbitJD = new_date;
+		sample_orbit_cached = orbit_cached;
+
+	} else if ( delta_points < 0 && abs(delta_points) < ORBIT_SEGMENTS  && orbit_cached) {
+
+		for ( int d=-delta_points; d<ORBIT_SEGMENTS; d++ ) {
+			back[d] = orbitPoint[d+delta_points];
+		}
+		job.base_date = new_date;
+		job.first = 0;
+		job.count = -delta_points;
+		sample_orbitJD = new_date;
+		sample_orbit_cached = orbit_cached;
+
+	} else if ( delta_points || !orbit_cached) {
+
+		// update all points (less efficient)
+		job.base_date = date;
+		job.first = 0;
+		job.count = ORBIT_SEGMENTS;
+		sample_orbitJD = date;
+
+		// \todo remove this for efficiency?  Can cause rendering issues near body though
+		// If orbit is largely constant through time cache it
+		sample_orbit_cached = orbit_cached || orbit->isStable(date);
+
+	} else return;
+
+	orbit_sampling = true;
+	orbit_sampler->queue(job);
+}
+
+void Planet::finishOrbitSample(void)
+{
+	orbitPoint = (orbitPoint == orbitPointBuffer[0]) ? orbitPointBuffer[1] : orbitPointBuffer[0];
+	last_orbitJD = sample_orbitJD;
+	orbit_cached = sample_orbit_cached;
+	orbit_sampling = false;
+}
+
 // Compute the transformation matrix from the local Planet coordinate to the parent Planet coordinate
 void Planet::compute_trans_matrix(double jd)
 {
@@ -1759,73 +1767,79 @@ void Planet::draw_trail(const Navigator * nav, const Projector* prj)
 
 	//  if(!re.sidereal_period) return;   // limits to planets
 
-	Vec3d onscreen1;
-	Vec3d onscreen2;
+	// Point 0 is the current Planet position, then the trail from newest to oldest
+	static ProjectionBatch batch;
+	const unsigned int n = trail.size();
+	batch.resize(n+1);
+	batch.set(0, get_earth_equ_pos(nav));
+	for (unsigned int i=0; i<n; i++) batch.set(i+1, trail[i].point);
+	prj->project_earth_equ_batch(batch);
 
-	prj->set_orthographic_projection();    // 2D coordinate
-
-	glBlendFunc(GL_SRC_ALPHA, GL_ONE_MINUS_SRC_ALPHA);
-
-	glEnable(GL_BLEND);
-	glDisable(GL_LIGHTING);
-	glDisable(GL_TEXTURE_2D);
-
-	list<TrailPoint>::iterator iter;
-	list<TrailPoint>::iterator begin = trail.begin();
-	begin++;
-
-	float segment = 0;
-
-	//	glColor3fv(trail_color*fade);
-
-	// 	cout << trail.size() << " " << MaxTrail << endl;
-
-	bool line_on = 0;
+	// final segment to finish at current Planet position is kept if either end is on screen
+	const bool projected = batch.visible[0] && batch.visible[1];
+	prj->check_in_viewport_batch(batch);
+	const bool final_segment = !first_point && projected && (batch.visible[0] || batch.visible[1]);
 
 	// TODO: take out viewport checks so doesn't flicker on/off when zoomed in?
 
-	// draw final segment to finish at current Planet position
-	if ( !first_point && prj->project_earth_equ_line_check( (*trail.begin()).point, onscreen2, get_earth_equ_pos(nav), onscreen1) ) {
+	// Build line strips broken where points are off screen
+	static vector<float> vertices;
+	static vector<float> colors;
+	static vector<int> strips;		// first vertex and vertex count of each strip
+	vertices.clear();
+	colors.clear();
+	strips.clear();
+
+	int strip_start = -1;
+	const Vec3f color = trail_color*fade;
+
+	if (final_segment) {
+		strip_start = 0;
+		vertices.push_back(batch.win_x[0]);
+		vertices.push_back(batch.win_y[0]);
+		colors.insert(colors.end(), (const float*)color, (const float*)color + 3);
+		vertices.push_back(batch.win_x[1]);
+		vertices.push_back(batch.win_y[1]);
+		colors.insert(colors.end(), (const float*)color, (const float*)color + 3);
+	}
 
-		if (!line_on) {
-			glBegin(GL_LINE_STRIP);
-			line_on = 1;
+	for (unsigned int segment=1; segment<n; segment++) {
+		if (batch.visible[segment+1]) {
+			if (strip_start < 0) strip_start = vertices.size()/2;
+			const Vec3f c = color * (1 - .9*segment/n);
+			vertices.push_back(batch.win_x[segment+1]);
+			vertices.push_back(batch.win_y[segment+1]);
+			colors.insert(colors.end(), (const float*)c, (const float*)c + 3);
+		} else if (strip_start >= 0) {
+			strips.push_back(strip_start);
+			strips.push_back(vertices.size()/2 - strip_start);
+			strip_start = -1;
 		}
-
-		glColor3fv(trail_color*fade);
-		glVertex3d(onscreen1[0], onscreen1[1], 0);
-
-		//    glColor3fv(trail_color*fade* (1 - .9*segment/MaxTrail) );
-		glColor3fv(trail_color*fade* (1 - .9*segment/trail.size()) );
-		glVertex3d(onscreen2[0], onscreen2[1], 0);
+	}
+	if (strip_start >= 0) {
+		strips.push_back(strip_start);
+		strips.push_back(vertices.size()/2 - strip_start);
 	}
 
-	if (trail.size() > 1) {
-
-		for (iter=begin; iter != trail.end(); iter++) {
-
-			segment++;
+	if (strips.empty()) return;
 
-			if ( prj->project_earth_equ_check( (*iter).point, onscreen1 )) {
-				if (!line_on) {
-					glBegin(GL_LINE_STRIP);
-					line_on = 1;
-				}
-
-				//	glColor3fv(trail_color*fade* (1 - .9*segment/MaxTrail));
-				glColor3fv(trail_color*fade* (1 - .9*segment/trail.size()));
+	prj->set_orthographic_projection();    // 2D coordinate
 
-				glVertex3d(onscreen1[0], onscreen1[1], 0);
+	glBlendFunc(GL_SRC_ALPHA, GL_ONE_MINUS_SRC_ALPHA);
 
-			} else {
-				line_on = 0;
-				glEnd();
-			}
+	glEnable(GL_BLEND);
+	glDisable(GL_LIGHTING);
+	glDisable(GL_TEXTURE_2D);
 
-		}
+	glEnableClientState(GL_VERTEX_ARRAY);
+	glEnableClientState(GL_COLOR_ARRAY);
+	glVertexPointer(2, GL_FLOAT, 0, &vertices[0]);
+	glColorPointer(3, GL_FLOAT, 0, &colors[0]);
+	for (unsigned int i=0; i<strips.size(); i+=2) {
+		glDrawArrays(GL_LINE_STRIP, strips[i], strips[i+1]);
 	}
-
-	if (line_on) glEnd();
+	glDisableClientState(GL_COLOR_ARRAY);
+	glDisableClientState(GL_VERTEX_ARRAY);
 
 	prj->reset_perspective_projection();		// Restore the other coordinate
 
@@ -1956,23 +1970,14 @@ void Planet::update_trail(const Navigator* nav)
 		tp.date = date;
 		trail.push_front( tp );
 
-		//      if( trail.size() > (unsigned int)MaxTrail ) {
-		if ( trail.size() > (unsigned int)MaxTrail ) {
-			trail.pop_back();
-		}
+		// the trail holds MaxTrail points, the oldest one is dropped when full
 	}
 
 	// because sampling depends on speed and frame rate, need to clear out
-	// points if trail gets longer than desired
-
-	list<TrailPoint>::iterator iter;
-	list<TrailPoint>::iterator end = trail.end();
-
-	for ( iter=trail.begin(); iter != end; iter++) {
-		if ( fabs((*iter).date - date)/DeltaTrail > MaxTrail ) {
-			trail.erase(iter, end);
-			break;
-		}
+	// points if trail gets longer than desired. Points are added in date
+	// order so the oldest ones expire first.
+	while (!trail.empty() && fabs(trail.back().date - date)/DeltaTrail > MaxTrail) {
+		trail.pop_back();
 	}
 }
 
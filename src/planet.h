@@ -38,8 +38,10 @@
 #include "translator.h"
 #include "shared_data.h"
 #include "orbit.h"
+#include "orbit_sampler.h"
 
 #include <list>
+#include <vector>
 #include <string>
 
 
@@ -55,6 +57,56 @@ struct TrailPoint {
 	double date;
 };
 
+//! Fixed capacity ring of trail points, index 0 being the newest point.
+//! Adding a point to a full trail drops the oldest one.
+class TrailBuffer
+{
+public:
+	TrailBuffer() : head(0), count(0) {}
+
+	//! Set the maximum number of points, clearing the trail
+	void setCapacity(unsigned int n) {
+		points.resize(n);
+		clear();
+	}
+	unsigned int size(void) const {
+		return count;
+	}
+	bool empty(void) const {
+		return count == 0;
+	}
+	void clear(void) {
+		head = 0;
+		count = 0;
+	}
+
+	void push_front(const TrailPoint& p) {
+		if (points.empty()) return;
+		head = (head == 0) ? points.size() - 1 : head - 1;
+		points[head] = p;
+		if (count < points.size()) count++;
+	}
+	void pop_back(void) {
+		count--;
+	}
+
+	const TrailPoint& operator[](unsigned int i) const {
+		i += head;
+		return points[(i < points.size()) ? i : i - points.size()];
+	}
+	const TrailPoint& front(void) const {
+		return points[head];
+	}
+	const TrailPoint& back(void) const {
+		return (*this)[count-1];
+	}
+
+private:
+	vector<TrailPoint> points;
+	unsigned int head;		// index of the newest point
+	unsigned int count;
+};
+
 
 
 // Class used to store orbital elements
@@ -184,6 +236,9 @@ public:
 	void computePositionWithoutOrbits(double date);
 	void compute_position(double date);
 
+	// Swap in the orbit points computed by the orbit sampler
+	void finishOrbitSample(void);
+
 	// Compute the transformation matrix from the local Planet coordinate to the parent Planet coordinate
 	void compute_trans_matrix(double date);
 
@@ -276,6 +331,10 @@ public:
 		planet_name_font = f;
 	}
 
+	static void setOrbitSampler(OrbitSampler* s) {
+		orbit_sampler = s;
+	}
+
 	static void setScale(float s) {
 		object_scale = s;
 	}
@@ -329,6 +388,13 @@ public:
 	static void set_trail_color(const Vec3f& c) {
 		trail_color = c;
 	}
+	//! Number of trail points kept by the bodies created afterwards
+	static void setMaxTrail(int n) {
+		if (n > 0) max_trail = n;
+	}
+	static int getMaxTrail(void) {
+		return max_trail;
+	}
 	static const Vec3f& getTrailColor() {
 		return trail_color;
 	}
@@ -468,6 +534,9 @@ protected:
 	static Vec3d calculateSplinePoint(double, Vec3d &v0, Vec3d &v1, Vec3d &v2, Vec3d &v3);
 
 	static void drawSpline2d(const Projector *prj, const Mat4d &mat, int segments, Vec3d &v0, Vec3d &v1, Vec3d &v2, Vec3d &v3);
+
+	// Queue the computation of the orbit points needed at date
+	void queueOrbitSample(double date);
 	static void drawSpline3d(const Projector *prj, const Mat4d &mat, int segments, Vec3d &v0, Vec3d &v1, Vec3d &v2, Vec3d &v3);
 
 	string englishName; // english planet name
@@ -477,7 +546,8 @@ protected:
 	RotationElements re;			// Rotation param
 	double radius;					// Planet radius in UA
 	double one_minus_oblateness;    // (polar radius)/(equatorial radius)
-	Vec3d orbitPoint[ORBIT_SEGMENTS];    // store heliocentric coordinates for drawing the orbit
+	Vec3d orbitPointBuffer[2][ORBIT_SEGMENTS];
+	Vec3d *orbitPoint;    // store heliocentric coordinates for drawing the orbit, points in orbitPointBuffer
 	Vec3d ecliptic_pos; 			// Position in UA in the rectangular ecliptic coordinate system
 	Vec3d light_ecliptic_pos; 			// position before light travel time correction (when correction enabled)
 	// centered on the parent Planet
@@ -526,6 +596,9 @@ protected:
 	double deltaJD;
 	double delta_orbitJD;
 	bool orbit_cached;       // whether orbit calculations are cached for drawing orbit yet
+	bool orbit_sampling;     // whether orbit points are being computed in the back buffer
+	double sample_orbitJD;   // values of last_orbitJD and orbit_cached once the sampling is done
+	bool sample_orbit_cached;
 
 	Orbit *orbit;            // orbit object for this body
 
@@ -535,18 +608,20 @@ protected:
 	list<Planet *> satellites;		// satellites of the Planet
 
 	static s_font* planet_name_font;// Font for names
+	static OrbitSampler* orbit_sampler;
 	static float object_scale;
 	static float object_size_limit;  // in pixels
 	static Vec3f label_color;
 	static Vec3f planet_orbit_color;
 	static Vec3f satellite_orbit_color;
 	static Vec3f trail_color;
+	static int max_trail;
 
 // to override global colors
 	// use if [3] is >0
 	Vec4f local_orbit_color;
 
-	list<TrailPoint>trail;
+	TrailBuffer trail;
 	bool trail_on;  // accumulate trail data if true
 	double DeltaTrail;
 	int MaxTrail;
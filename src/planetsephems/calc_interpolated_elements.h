@@ -51,3 +51,20 @@ The user must always supply the same delta_t
 for one set of (*t0,*t1,*t2,e0,e1,e2),
 and of course the same dim and calc_func.
 */
+
+extern
+void CalcInterpolatedElementsData(double t,double elem[],
+                                  int dim,
+                                  void (*calc_func)(double t,double elem[],
+                                                    void *data),
+                                  void *data,
+                                  double delta_t,
+                                  double *t0,double e0[],
+                                  double *t1,double e1[],
+                                  double *t2,double e2[]);
+
+/*
+Same as CalcInterpolatedElements, but data is passed through to calc_func.
+This allows calc_func to depend on parameters other than t
+without resorting to static variables.
+*/
@@ -43,6 +43,7 @@ the original Fortran code:
 
 ****************************************************************/
 
+#include "elp82b.h"
 #include "calc_interpolated_elements.h"
 
 #include <math.h>
@@ -162731,13 +162732,14 @@ void GetElp82bSphericalCoor(const double t,double r[3]) {
 
 }
 
-  /* ugly static variable for caching: */
-static double t_0 = -1e100;
-static double t_1 = -1e100;
-static double t_2 = -1e100;
-static double r_0[3];
-static double r_1[3];
-static double r_2[3];
+  /* cache used by the non reentrant GetElp82bCoor */
+static struct Elp82bContext elp82b_default_context
+  = ELP82B_CONTEXT_INITIALIZER;
+
+void InitElp82bContext(struct Elp82bContext *ctx) {
+  const struct Elp82bContext init = ELP82B_CONTEXT_INITIALIZER;
+  *ctx = init;
+}
 
 #define DELTA_T (1.0/(24.0*36525.0))
 
@@ -162754,10 +162756,17 @@ static const double q4 = -1.371808e-12;
 static const double q5 = -3.20334e-15;
 
 void GetElp82bCoor(const double jd,double xyz[3]) {
+  GetElp82bCoorCtx(&elp82b_default_context,jd,xyz);
+}
+
+void GetElp82bCoorCtx(struct Elp82bContext *ctx,
+                      const double jd,double xyz[3]) {
   const double t = (jd - 2451545.0) / 36525.0;
   double r[3];
   CalcInterpolatedElements(t,r,3,&GetElp82bSphericalCoor,DELTA_T,
-                           &t_0,r_0,&t_1,r_1,&t_2,r_2);
+                           &ctx->t_0,ctx->r_0,
+                           &ctx->t_1,ctx->r_1,
+                           &ctx->t_2,ctx->r_2);
   {
 
 	  /* For testing without precession	   
@@ -51,6 +51,28 @@ the original Fortran code:
 extern "C" {
 #endif
 
+struct Elp82bContext {
+  double t_0,t_1,t_2;
+  double r_0[3];
+  double r_1[3];
+  double r_2[3];
+};
+  /* Interpolation cache for GetElp82bCoorCtx.
+     Every thread computing positions must use its own context.
+     A context must be initialized with InitElp82bContext
+     (or ELP82B_CONTEXT_INITIALIZER) before use.
+  */
+
+#define ELP82B_CONTEXT_INITIALIZER \
+  {-1e100,-1e100,-1e100,{0.0},{0.0},{0.0}}
+
+void InitElp82bContext(struct Elp82bContext *ctx);
+
+void GetElp82bCoorCtx(struct Elp82bContext *ctx,double jd,double xyz[3]);
+  /* Same as GetElp82bCoor, using the cache in ctx instead of the
+     default one. GetElp82bCoor is not reentrant.
+  */
+
 void GetElp82bCoor(double jd,double xyz[3]);
 
   /* Return the rectangular coordinates of the earths moon
@@ -59,6 +59,27 @@ extern "C" {
 #define GUST86_TITANIA   3
 #define GUST86_OBERON    4
 
+#define GUST86_DIM (5*6)
+
+struct Gust86Context {
+  double t_0,t_1,t_2;
+  double elem_0[GUST86_DIM];
+  double elem_1[GUST86_DIM];
+  double elem_2[GUST86_DIM];
+  double jd0;
+  double elem[GUST86_DIM];
+};
+  /* Interpolation cache for the functions below.
+     Every thread computing positions must use its own context.
+     A context must be initialized with InitGust86Context
+     (or GUST86_CONTEXT_INITIALIZER) before use.
+  */
+
+#define GUST86_CONTEXT_INITIALIZER \
+  {-1e100,-1e100,-1e100,{0.0},{0.0},{0.0},-1e100,{0.0}}
+
+void InitGust86Context(struct Gust86Context *ctx);
+
 void GetGust86Coor(double jd,int body,double *xyz);
   /* Return the rectangular coordinates of the given satellite
      and the given julian date jd expressed in dynamical time (TAI+32.184s).
@@ -92,6 +113,14 @@ void GetGust86OsculatingCoor(double jd0,double jd,int body,double *xyz);
   /* The oculating orbit of epoch jd0, evatuated at jd, is returned.
   */
 
+void GetGust86CoorCtx(struct Gust86Context *ctx,
+                      double jd,int body,double *xyz);
+void GetGust86OsculatingCoorCtx(struct Gust86Context *ctx,
+                                double jd0,double jd,int body,double *xyz);
+  /* Same as above, using the cache in ctx instead of the default one.
+     GetGust86Coor and GetGust86OsculatingCoor are not reentrant.
+  */
+
 #ifdef __cplusplus
 }
 #endif
@@ -979,42 +979,49 @@ const double L1toVsop87[9] = {
 };
 
 
-static double t_0[4] = {-1e100,-1e100,-1e100,-1e100};
-static double t_1[4] = {-1e100,-1e100,-1e100,-1e100};
-static double t_2[4] = {-1e100,-1e100,-1e100,-1e100};
-static double l1_elem_0[4*6];
-static double l1_elem_1[4*6];
-static double l1_elem_2[4*6];
-
 /* 1 day: */
 #define DELTA_T 1.0
 
-static double l1_jd0[4] = {-1e100,-1e100,-1e100,-1e100};
-static double l1_elem[4*6];
+  /* cache used by the non reentrant functions */
+static struct L1Context l1_default_context = L1_CONTEXT_INITIALIZER;
+
+void InitL1Context(struct L1Context *ctx) {
+  const struct L1Context init = L1_CONTEXT_INITIALIZER;
+  *ctx = init;
+}
 
-static int ugly_static_parameter_body = -1;
-static void CalcUglyStaticL1Elem(double t,double elem[6]) {
-  CalcL1Elem(t,ugly_static_parameter_body,elem);
+static void CalcBodyL1Elem(double t,double elem[6],void *body) {
+  CalcL1Elem(t,*(const int*)body,elem);
 }
 
 void GetL1Coor(double jd,int body,double *xyz) {
-  GetL1OsculatingCoor(jd,jd,body,xyz);
+  GetL1OsculatingCoorCtx(&l1_default_context,jd,jd,body,xyz);
 }
 
 void GetL1OsculatingCoor(const double jd0,const double jd,
                          const int body,double *xyz) {
+  GetL1OsculatingCoorCtx(&l1_default_context,jd0,jd,body,xyz);
+}
+
+void GetL1CoorCtx(struct L1Context *ctx,double jd,int body,double *xyz) {
+  GetL1OsculatingCoorCtx(ctx,jd,jd,body,xyz);
+}
+
+void GetL1OsculatingCoorCtx(struct L1Context *ctx,
+                            const double jd0,const double jd,
+                            const int body,double *xyz) {
   double x[3];
-  if (jd0 != l1_jd0[body]) {
+  if (jd0 != ctx->jd0[body]) {
     const double t0 = jd0 - 2433282.5;
-    l1_jd0[body] = jd0;
-    ugly_static_parameter_body = body;
-    CalcInterpolatedElements(t0,l1_elem+(body*6),6,
-                             &CalcUglyStaticL1Elem,DELTA_T,
-                             t_0+body,l1_elem_0+(body*6),
-                             t_1+body,l1_elem_1+(body*6),
-                             t_2+body,l1_elem_2+(body*6));
+    int b = body;
+    ctx->jd0[body] = jd0;
+    CalcInterpolatedElementsData(t0,ctx->elem+(body*6),6,
+                                 &CalcBodyL1Elem,&b,DELTA_T,
+                                 ctx->t_0+body,ctx->elem_0+(body*6),
+                                 ctx->t_1+body,ctx->elem_1+(body*6),
+                                 ctx->t_2+body,ctx->elem_2+(body*6));
   }
-  EllipticToRectangularA(l1_bodies[body].mu,l1_elem+(body*6),jd-jd0,x);
+  EllipticToRectangularA(l1_bodies[body].mu,ctx->elem+(body*6),jd-jd0,x);
   xyz[0] = L1toVsop87[0]*x[0]+L1toVsop87[1]*x[1]+L1toVsop87[2]*x[2];
   xyz[1] = L1toVsop87[3]*x[0]+L1toVsop87[4]*x[1]+L1toVsop87[5]*x[2];
   xyz[2] = L1toVsop87[6]*x[0]+L1toVsop87[7]*x[1]+L1toVsop87[8]*x[2];
@@ -56,6 +56,30 @@ extern "C" {
 #define L1_GANYMEDE      2
 #define L1_CALLISTO      3
 
+struct L1Context {
+  double t_0[4],t_1[4],t_2[4];
+  double elem_0[4*6];
+  double elem_1[4*6];
+  double elem_2[4*6];
+  double jd0[4];
+  double elem[4*6];
+};
+  /* Interpolation cache for the functions below.
+     Every thread computing positions must use its own context.
+     A context must be initialized with InitL1Context
+     (or L1_CONTEXT_INITIALIZER) before use.
+  */
+
+#define L1_CONTEXT_INITIALIZER \
+  {{-1e100,-1e100,-1e100,-1e100}, \
+   {-1e100,-1e100,-1e100,-1e100}, \
+   {-1e100,-1e100,-1e100,-1e100}, \
+   {0.0},{0.0},{0.0}, \
+   {-1e100,-1e100,-1e100,-1e100}, \
+   {0.0}}
+
+void InitL1Context(struct L1Context *ctx);
+
 void GetL1Coor(double jd,int body,double *xyz);
   /* Return the rectangular coordinates of the given satellite
      and the given julian date jd expressed in dynamical time (TAI+32.184s).
@@ -68,6 +92,13 @@ void GetL1OsculatingCoor(double jd0,double jd,int body,double *xyz);
   /* The oculating orbit of epoch jd0, evatuated at jd, is returned.
   */
 
+void GetL1CoorCtx(struct L1Context *ctx,double jd,int body,double *xyz);
+void GetL1OsculatingCoorCtx(struct L1Context *ctx,
+                            double jd0,double jd,int body,double *xyz);
+  /* Same as above, using the cache in ctx instead of the default one.
+     GetL1Coor and GetL1OsculatingCoor are not reentrant.
+  */
+
 
 #ifdef __cplusplus
 }
@@ -408,54 +408,62 @@ void GenerateMarsSatToVSOP87(double t,double mars_sat_to_vsop87[9]) {
   }
 }
 
-static double t_0 = -1e100;
-static double t_1 = -1e100;
-static double t_2 = -1e100;
-static double marssat_elem_0[2*6];
-static double marssat_elem_1[2*6];
-static double marssat_elem_2[2*6];
-
 /* 1 day: */
 #define DELTA_T 1.0
 
-static double marssat_jd0 = -1e100;
-static double marssat_elem[2*6];
-
 static void CalcAllMarsSatElem(double t,double elem[12]) {
   CalcMarsSatElem(t,0,elem+(0*6));
   CalcMarsSatElem(t,1,elem+(1*6));
 }
 
-static double mars_sat_to_vsop87[9];
+  /* cache used by the non reentrant functions */
+static struct MarsSatContext marssat_default_context
+  = MARS_SAT_CONTEXT_INITIALIZER;
+
+void InitMarsSatContext(struct MarsSatContext *ctx) {
+  const struct MarsSatContext init = MARS_SAT_CONTEXT_INITIALIZER;
+  *ctx = init;
+}
 
 void GetMarsSatCoor(double jd,int body,double *xyz) {
-  GetMarsSatOsculatingCoor(jd,jd,body,xyz);
+  GetMarsSatOsculatingCoorCtx(&marssat_default_context,jd,jd,body,xyz);
 }
 
 void GetMarsSatOsculatingCoor(const double jd0,const double jd,
                               const int body,double *xyz) {
+  GetMarsSatOsculatingCoorCtx(&marssat_default_context,jd0,jd,body,xyz);
+}
+
+void GetMarsSatCoorCtx(struct MarsSatContext *ctx,
+                       double jd,int body,double *xyz) {
+  GetMarsSatOsculatingCoorCtx(ctx,jd,jd,body,xyz);
+}
+
+void GetMarsSatOsculatingCoorCtx(struct MarsSatContext *ctx,
+                                 const double jd0,const double jd,
+                                 const int body,double *xyz) {
   double x[3];
-  if (jd0 != marssat_jd0) {
+  if (jd0 != ctx->jd0) {
     const double t0 = jd0 - 2451545.0 + 6491.5;
-    marssat_jd0 = jd0;
-    CalcInterpolatedElements(t0,marssat_elem,12,
+    ctx->jd0 = jd0;
+    CalcInterpolatedElements(t0,ctx->elem,12,
                              &CalcAllMarsSatElem,DELTA_T,
-                             &t_0,marssat_elem_0,
-                             &t_1,marssat_elem_1,
-                             &t_2,marssat_elem_2);
-    GenerateMarsSatToVSOP87(t0,mars_sat_to_vsop87);
+                             &ctx->t_0,ctx->elem_0,
+                             &ctx->t_1,ctx->elem_1,
+                             &ctx->t_2,ctx->elem_2);
+    GenerateMarsSatToVSOP87(t0,ctx->to_vsop87);
   }
-  EllipticToRectangularA(mars_sat_bodies[body].mu,marssat_elem+(body*6),
+  EllipticToRectangularA(mars_sat_bodies[body].mu,ctx->elem+(body*6),
                          jd-jd0,x);
-  xyz[0] = mars_sat_to_vsop87[0]*x[0]
-         + mars_sat_to_vsop87[1]*x[1]
-         + mars_sat_to_vsop87[2]*x[2];
-  xyz[1] = mars_sat_to_vsop87[3]*x[0]
-         + mars_sat_to_vsop87[4]*x[1]
-         + mars_sat_to_vsop87[5]*x[2];
-  xyz[2] = mars_sat_to_vsop87[6]*x[0]
-         + mars_sat_to_vsop87[7]*x[1]
-         + mars_sat_to_vsop87[8]*x[2];
+  xyz[0] = ctx->to_vsop87[0]*x[0]
+         + ctx->to_vsop87[1]*x[1]
+         + ctx->to_vsop87[2]*x[2];
+  xyz[1] = ctx->to_vsop87[3]*x[0]
+         + ctx->to_vsop87[4]*x[1]
+         + ctx->to_vsop87[5]*x[2];
+  xyz[2] = ctx->to_vsop87[6]*x[0]
+         + ctx->to_vsop87[7]*x[1]
+         + ctx->to_vsop87[8]*x[2];
 /*
   printf("%d %18.9lf %15.12lf %15.12lf %15.12lf\n",
          body,jd,xyz[0],xyz[1],xyz[2]);
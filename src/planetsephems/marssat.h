@@ -58,6 +58,26 @@ extern "C" {
 #define MARS_SAT_PHOBOS 0
 #define MARS_SAT_DEIMOS 1
 
+struct MarsSatContext {
+  double t_0,t_1,t_2;
+  double elem_0[2*6];
+  double elem_1[2*6];
+  double elem_2[2*6];
+  double jd0;
+  double elem[2*6];
+  double to_vsop87[9];
+};
+  /* Interpolation cache for the functions below.
+     Every thread computing positions must use its own context.
+     A context must be initialized with InitMarsSatContext
+     (or MARS_SAT_CONTEXT_INITIALIZER) before use.
+  */
+
+#define MARS_SAT_CONTEXT_INITIALIZER \
+  {-1e100,-1e100,-1e100,{0.0},{0.0},{0.0},-1e100,{0.0},{0.0}}
+
+void InitMarsSatContext(struct MarsSatContext *ctx);
+
 void GetMarsSatCoor(double jd,int body,double *xyz);
   /* Return the rectangular coordinates of the given satellite
      and the given julian date jd expressed in dynamical time (TAI+32.184s).
@@ -70,6 +90,14 @@ void GetMarsSatOsculatingCoor(double jd0,double jd,int body,double *xyz);
   /* The oculating orbit of epoch jd0, evatuated at jd, is returned.
   */
 
+void GetMarsSatCoorCtx(struct MarsSatContext *ctx,
+                       double jd,int body,double *xyz);
+void GetMarsSatOsculatingCoorCtx(struct MarsSatContext *ctx,
+                                 double jd0,double jd,int body,double *xyz);
+  /* Same as above, using the cache in ctx instead of the default one.
+     GetMarsSatCoor and GetMarsSatOsculatingCoor are not reentrant.
+  */
+
 #ifdef __cplusplus
 }
 #endif
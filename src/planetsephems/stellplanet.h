@@ -20,6 +20,13 @@ Foundation, Inc., 59 Temple Place - Suite 330, Boston, MA 02111-1307, USA.
 #ifndef _STELLPLANET_H_
 #define _STELLPLANET_H_
 
+#include "vsop87.h"
+#include "elp82b.h"
+#include "marssat.h"
+#include "l1.h"
+#include "tass17.h"
+#include "gust86.h"
+
 #ifdef __cplusplus
 extern "C" {
 #endif
@@ -73,6 +80,70 @@ void get_umbriel_parent_coordsv(double jd,double xyz[3]);
 void get_titania_parent_coordsv(double jd,double xyz[3]);
 void get_oberon_parent_coordsv(double jd,double xyz[3]);
 
+/* Reentrant versions of the functions above.
+   Each thread computing positions must own an EphemerisContext,
+   initialized with InitEphemerisContext. The functions without
+   context share a default one and must only be used by one thread. */
+
+struct EphemerisContext {
+  struct Vsop87Context vsop87;
+  struct Elp82bContext elp82b;
+  struct MarsSatContext marssat;
+  struct L1Context l1;
+  struct Tass17Context tass17;
+  struct Gust86Context gust86;
+};
+
+void InitEphemerisContext(struct EphemerisContext *ctx);
+
+void get_sun_helio_coordsv_ctx(struct EphemerisContext *ctx,double jd,double xyz[3]);
+
+void get_mercury_helio_coordsv_ctx(struct EphemerisContext *ctx,double jd,double xyz[3]);
+void get_venus_helio_coordsv_ctx(struct EphemerisContext *ctx,double jd,double xyz[3]);
+void get_emb_helio_coordsv_ctx(struct EphemerisContext *ctx,double jd,double xyz[3]);
+void get_earth_helio_coordsv_ctx(struct EphemerisContext *ctx,double jd,double xyz[3]);
+void get_mars_helio_coordsv_ctx(struct EphemerisContext *ctx,double jd,double xyz[3]);
+void get_jupiter_helio_coordsv_ctx(struct EphemerisContext *ctx,double jd,double xyz[3]);
+void get_saturn_helio_coordsv_ctx(struct EphemerisContext *ctx,double jd,double xyz[3]);
+void get_uranus_helio_coordsv_ctx(struct EphemerisContext *ctx,double jd,double xyz[3]);
+void get_neptune_helio_coordsv_ctx(struct EphemerisContext *ctx,double jd,double xyz[3]);
+void get_pluto_helio_coordsv_ctx(struct EphemerisContext *ctx,double jd,double xyz[3]);
+
+void get_mercury_helio_osculating_coords_ctx(struct EphemerisContext *ctx,double jd0,double jd,double xyz[3]);
+void get_venus_helio_osculating_coords_ctx(struct EphemerisContext *ctx,double jd0,double jd,double xyz[3]);
+void get_emb_helio_osculating_coords_ctx(struct EphemerisContext *ctx,double jd0,double jd,double xyz[3]);
+void get_earth_helio_osculating_coords_ctx(struct EphemerisContext *ctx,double jd0,double jd,double xyz[3]);
+void get_mars_helio_osculating_coords_ctx(struct EphemerisContext *ctx,double jd0,double jd,double xyz[3]);
+void get_jupiter_helio_osculating_coords_ctx(struct EphemerisContext *ctx,double jd0,double jd,double xyz[3]);
+void get_saturn_helio_osculating_coords_ctx(struct EphemerisContext *ctx,double jd0,double jd,double xyz[3]);
+void get_uranus_helio_osculating_coords_ctx(struct EphemerisContext *ctx,double jd0,double jd,double xyz[3]);
+void get_neptune_helio_osculating_coords_ctx(struct EphemerisContext *ctx,double jd0,double jd,double xyz[3]);
+
+void get_lunar_parent_coordsv_ctx(struct EphemerisContext *ctx,double jd,double xyz[3]);
+
+void get_phobos_parent_coordsv_ctx(struct EphemerisContext *ctx,double jd,double xyz[3]);
+void get_deimos_parent_coordsv_ctx(struct EphemerisContext *ctx,double jd,double xyz[3]);
+
+void get_io_parent_coordsv_ctx(struct EphemerisContext *ctx,double jd,double xyz[3]);
+void get_europa_parent_coordsv_ctx(struct EphemerisContext *ctx,double jd,double xyz[3]);
+void get_ganymede_parent_coordsv_ctx(struct EphemerisContext *ctx,double jd,double xyz[3]);
+void get_callisto_parent_coordsv_ctx(struct EphemerisContext *ctx,double jd,double xyz[3]);
+
+void get_mimas_parent_coordsv_ctx(struct EphemerisContext *ctx,double jd,double xyz[3]);
+void get_enceladus_parent_coordsv_ctx(struct EphemerisContext *ctx,double jd,double xyz[3]);
+void get_tethys_parent_coordsv_ctx(struct EphemerisContext *ctx,double jd,double xyz[3]);
+void get_dione_parent_coordsv_ctx(struct EphemerisContext *ctx,double jd,double xyz[3]);
+void get_rhea_parent_coordsv_ctx(struct EphemerisContext *ctx,double jd,double xyz[3]);
+void get_titan_parent_coordsv_ctx(struct EphemerisContext *ctx,double jd,double xyz[3]);
+void get_hyperion_parent_coordsv_ctx(struct EphemerisContext *ctx,double jd,double xyz[3]);
+void get_iapetus_parent_coordsv_ctx(struct EphemerisContext *ctx,double jd,double xyz[3]);
+
+void get_miranda_parent_coordsv_ctx(struct EphemerisContext *ctx,double jd,double xyz[3]);
+void get_ariel_parent_coordsv_ctx(struct EphemerisContext *ctx,double jd,double xyz[3]);
+void get_umbriel_parent_coordsv_ctx(struct EphemerisContext *ctx,double jd,double xyz[3]);
+void get_titania_parent_coordsv_ctx(struct EphemerisContext *ctx,double jd,double xyz[3]);
+void get_oberon_parent_coordsv_ctx(struct EphemerisContext *ctx,double jd,double xyz[3]);
+
 #ifdef __cplusplus
 };
 #endif
@@ -66,9 +66,38 @@ extern "C" {
 #define TASS17_HYPERION  7
 #define TASS17_IAPETUS   6
 
+#define TASS17_DIM (8*6)
+
+struct Tass17Context {
+  double t_0,t_1,t_2;
+  double elem_0[TASS17_DIM];
+  double elem_1[TASS17_DIM];
+  double elem_2[TASS17_DIM];
+  double jd0;
+  double elem[TASS17_DIM];
+};
+  /* Interpolation cache for the functions below.
+     Every thread computing positions must use its own context.
+     A context must be initialized with InitTass17Context
+     (or TASS17_CONTEXT_INITIALIZER) before use.
+  */
+
+#define TASS17_CONTEXT_INITIALIZER \
+  {-1e100,-1e100,-1e100,{0.0},{0.0},{0.0},-1e100,{0.0}}
+
+void InitTass17Context(struct Tass17Context *ctx);
+
 void GetTass17Coor(double jd,int body,double *xyz);
 void GetTass17OsculatingCoor(double jd0,double jd,int body,double *xyz);
 
+void GetTass17CoorCtx(struct Tass17Context *ctx,
+                      double jd,int body,double *xyz);
+void GetTass17OsculatingCoorCtx(struct Tass17Context *ctx,
+                                double jd0,double jd,int body,double *xyz);
+  /* Same as above, using the cache in ctx instead of the default one.
+     GetTass17Coor and GetTass17OsculatingCoor are not reentrant.
+  */
+
 #ifdef __cplusplus
 }
 #endif
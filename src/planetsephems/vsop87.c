@@ -137317,35 +137317,44 @@ void CalcVsop87Elem(const double t,double elem[8*6]) {
 */
 }
 
-  /* dirty caching in static variables */
-#define VSOP87_DIM (8*6)
-static double t_0 = -1e100;
-static double t_1 = -1e100;
-static double t_2 = -1e100;
-static double vsop87_elem_0[VSOP87_DIM];
-static double vsop87_elem_1[VSOP87_DIM];
-static double vsop87_elem_2[VSOP87_DIM];
 /* 10 days: */
 #define DELTA_T (10.0/365250.0)
 
-static double vsop87_jd0 = -1e100;
-static double vsop87_elem[VSOP87_DIM];
+  /* cache used by the non reentrant functions */
+static struct Vsop87Context vsop87_default_context
+  = VSOP87_CONTEXT_INITIALIZER;
+
+void InitVsop87Context(struct Vsop87Context *ctx) {
+  const struct Vsop87Context init = VSOP87_CONTEXT_INITIALIZER;
+  *ctx = init;
+}
 
 void GetVsop87Coor(double jd,int body,double *xyz) {
-  GetVsop87OsculatingCoor(jd,jd,body,xyz);
+  GetVsop87OsculatingCoorCtx(&vsop87_default_context,jd,jd,body,xyz);
 }
 
 void GetVsop87OsculatingCoor(const double jd0,const double jd,
                              const int body,double *xyz) {
-  if (jd0 != vsop87_jd0) {
+  GetVsop87OsculatingCoorCtx(&vsop87_default_context,jd0,jd,body,xyz);
+}
+
+void GetVsop87CoorCtx(struct Vsop87Context *ctx,
+                      double jd,int body,double *xyz) {
+  GetVsop87OsculatingCoorCtx(ctx,jd,jd,body,xyz);
+}
+
+void GetVsop87OsculatingCoorCtx(struct Vsop87Context *ctx,
+                                const double jd0,const double jd,
+                                const int body,double *xyz) {
+  if (jd0 != ctx->jd0) {
     const double t0 = (jd0 - 2451545.0) / 365250.0;
-    vsop87_jd0 = jd0;
-    CalcInterpolatedElements(t0,vsop87_elem,
+    ctx->jd0 = jd0;
+    CalcInterpolatedElements(t0,ctx->elem,
                              VSOP87_DIM,
                              &CalcVsop87Elem,DELTA_T,
-                             &t_0,vsop87_elem_0,
-                             &t_1,vsop87_elem_1,
-                             &t_2,vsop87_elem_2);
+                             &ctx->t_0,ctx->elem_0,
+                             &ctx->t_1,ctx->elem_1,
+                             &ctx->t_2,ctx->elem_2);
   }
-  EllipticToRectangularA(vsop87_mu[body],vsop87_elem+(body*6),jd-jd0,xyz);
+  EllipticToRectangularA(vsop87_mu[body],ctx->elem+(body*6),jd-jd0,xyz);
 }
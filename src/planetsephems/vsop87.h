@@ -60,6 +60,27 @@ extern "C" {
 #define VSOP87_URANUS   6
 #define VSOP87_NEPTUNE  7
 
+#define VSOP87_DIM (8*6)
+
+struct Vsop87Context {
+  double t_0,t_1,t_2;
+  double elem_0[VSOP87_DIM];
+  double elem_1[VSOP87_DIM];
+  double elem_2[VSOP87_DIM];
+  double jd0;
+  double elem[VSOP87_DIM];
+};
+  /* Interpolation cache for the functions below.
+     Every thread computing positions must use its own context.
+     A context must be initialized with InitVsop87Context
+     (or VSOP87_CONTEXT_INITIALIZER) before use.
+  */
+
+#define VSOP87_CONTEXT_INITIALIZER \
+  {-1e100,-1e100,-1e100,{0.0},{0.0},{0.0},-1e100,{0.0}}
+
+void InitVsop87Context(struct Vsop87Context *ctx);
+
 void GetVsop87Coor(double jd,int body,double *xyz);
   /* Return the rectangular coordinates of the given planet
      and the given julian date jd expressed in dynamical time (TAI+32.184s).
@@ -72,6 +93,14 @@ void GetVsop87OsculatingCoor(double jd0,double jd,int body,double *xyz);
   /* The oculating orbit of epoch jd0, evatuated at jd, is returned.
   */
 
+void GetVsop87CoorCtx(struct Vsop87Context *ctx,
+                      double jd,int body,double *xyz);
+void GetVsop87OsculatingCoorCtx(struct Vsop87Context *ctx,
+                                double jd0,double jd,int body,double *xyz);
+  /* Same as above, using the cache in ctx instead of the default one.
+     GetVsop87Coor and GetVsop87OsculatingCoor are not reentrant.
+  */
+
 #ifdef __cplusplus
 }
 #endif
@@ -26,6 +26,7 @@
 #include <iostream>
 #include <cstdio>
 #include "projector.h"
+#include "frame_profiler.h"
 #include "fisheye_projector.h"
 #include "stereographic_projector.h"
 #include "spheric_mirror_projector.h"
@@ -583,6 +584,82 @@ bool Projector::check_in_viewport(const Vec3d& pos) const
 	         pos[0]>vec_viewport[0] && pos[0]<(vec_viewport[0] + vec_viewport[2]));
 }
 
+void Projector::check_in_viewport_batch(ProjectionBatch& b) const
+{
+	const double x0 = vec_viewport[0], x1 = vec_viewport[0] + vec_viewport[2];
+	const double y0 = vec_viewport[1], y1 = vec_viewport[1] + vec_viewport[3];
+	for (unsigned int i=0; i<b.size(); i++) {
+		b.visible[i] = b.visible[i] &&
+		               b.win_y[i]>y0 && b.win_y[i]<y1 &&
+		               b.win_x[i]>x0 && b.win_x[i]<x1;
+	}
+}
+
+// Scalar fallback, projectors with a vectorized kernel override this
+void Projector::project_custom_batch(const double *x, const double *y, const double *z,
+                                     unsigned int count,
+                                     double *win_x, double *win_y, double *win_z,
+                                     unsigned char *visible, const Mat4d& mat) const
+{
+	Vec3d win;
+	for (unsigned int i=0; i<count; i++) {
+		visible[i] = project_custom(Vec3d(x[i], y[i], z[i]), win, mat);
+		win_x[i] = win[0];
+		win_y[i] = win[1];
+		win_z[i] = win[2];
+	}
+}
+
+// Largest difference in pixels accepted between the scalar and batch projection
+#define PROJECTION_CHECK_TOLERANCE 1e-6
+
+bool Projector::compareBatchProjection(unsigned int count, int repeat, ostream &os) const
+{
+	// Fixed pseudo random directions so runs compare
+	ProjectionBatch b;
+	b.resize(count);
+	unsigned int seed = 12345;
+	for (unsigned int i=0; i<count; i++) {
+		seed = seed*1103515245 + 12345;
+		const double u = (seed >> 8) / 16777216.0;
+		seed = seed*1103515245 + 12345;
+		const double v = (seed >> 8) / 16777216.0;
+		const double z = 2.*u - 1.;
+		const double r = sqrt(1. - z*z);
+		b.set(i, Vec3d(r*cos(2.*M_PI*v), r*sin(2.*M_PI*v), z));
+	}
+
+	vector<Vec3d> win(count);
+	vector<unsigned char> visible(count);
+	double t = FrameProfiler::getTime();
+	for (int r=0; r<repeat; r++)
+		for (unsigned int i=0; i<count; i++)
+			visible[i] = project_custom(Vec3d(b.x[i], b.y[i], b.z[i]), win[i], mat_j2000_to_eye);
+	const double scalar = FrameProfiler::getTime() - t;
+
+	t = FrameProfiler::getTime();
+	for (int r=0; r<repeat; r++) project_j2000_batch(b);
+	const double batch = FrameProfiler::getTime() - t;
+
+	double max_err = 0.;
+	unsigned int mismatches = 0;
+	for (unsigned int i=0; i<count; i++) {
+		if ((visible[i] != 0) != (b.visible[i] != 0)) mismatches++;
+		if (!visible[i]) continue;
+		max_err = MY_MAX(max_err, fabs(win[i][0] - b.win_x[i]));
+		max_err = MY_MAX(max_err, fabs(win[i][1] - b.win_y[i]));
+	}
+
+	const double points = (double)count * repeat;
+	const bool passed = !mismatches && max_err <= PROJECTION_CHECK_TOLERANCE;
+	os << "Projection (" << typeToString(getType()) << "), " << points << " points" << endl
+	   << "  scalar: " << scalar*1.e6/points << " ns/point" << endl
+	   << "  batch:  " << batch*1.e6/points << " ns/point" << endl
+	   << "  max difference " << max_err << " px, " << mismatches << " visibility mismatches"
+	   << (passed ? " OK" : " FAIL") << endl;
+	return passed;
+}
+
 // to support large object check
 bool Projector::check_in_mask(const Vec3d& pos, const int object_pixel_radius) const
 {
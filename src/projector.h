@@ -32,8 +32,41 @@
 #include "mapping.h"
 #include "sphere_geometry.h"
 
+#include <vector>
+
 class s_font;
 
+//! Structure of arrays scratch space for the batch projection functions.
+//! Fill x,y,z with set(), project, then read back win_* and visible.
+class ProjectionBatch
+{
+public:
+	void resize(unsigned int n) {
+		x.resize(n);
+		y.resize(n);
+		z.resize(n);
+		win_x.resize(n);
+		win_y.resize(n);
+		win_z.resize(n);
+		visible.resize(n);
+	}
+	unsigned int size(void) const {
+		return x.size();
+	}
+	void set(unsigned int i, const Vec3d& v) {
+		x[i] = v[0];
+		y[i] = v[1];
+		z[i] = v[2];
+	}
+	void getWin(unsigned int i, Vec3d& win) const {
+		win.set(win_x[i], win_y[i], win_z[i]);
+	}
+
+	std::vector<double> x, y, z;
+	std::vector<double> win_x, win_y, win_z;
+	std::vector<unsigned char> visible;
+};
+
 // Class which handle projection modes and projection matrix
 // Overide some function usually handled by glu
 class Projector
@@ -378,6 +411,46 @@ public:
 		return (project_custom(v, win, mat) && check_in_viewport(win));
 	}
 
+	// Batch version of project_custom for count points in structure of arrays form.
+	// visible[i] receives what project_custom would have returned for point i.
+	virtual void project_custom_batch(const double *x, const double *y, const double *z,
+	                                  unsigned int count,
+	                                  double *win_x, double *win_y, double *win_z,
+	                                  unsigned char *visible, const Mat4d& mat) const;
+
+	void project_custom_batch(ProjectionBatch& b, const Mat4d& mat) const {
+		if (b.size() == 0) return;
+		project_custom_batch(&b.x[0], &b.y[0], &b.z[0], b.size(),
+		                     &b.win_x[0], &b.win_y[0], &b.win_z[0], &b.visible[0], mat);
+	}
+
+	// Batch versions of the frame projection functions
+	void project_earth_equ_batch(ProjectionBatch& b) const {
+		project_custom_batch(b, mat_earth_equ_to_eye);
+	}
+	void project_j2000_batch(ProjectionBatch& b) const {
+		project_custom_batch(b, mat_j2000_to_eye);
+	}
+	void project_galactic_batch(ProjectionBatch& b) const {
+		project_custom_batch(b, mat_galactic_to_eye);
+	}
+	void project_helio_batch(ProjectionBatch& b) const {
+		project_custom_batch(b, mat_helio_to_eye);
+	}
+	void project_local_batch(ProjectionBatch& b) const {
+		project_custom_batch(b, mat_local_to_eye);
+	}
+
+	// Clear the visible flag of batch points outside the viewport,
+	// turning a batch projection into the equivalent of the _check functions
+	void check_in_viewport_batch(ProjectionBatch& b) const;
+
+	// Project count random directions with project_custom and with
+	// project_custom_batch, write the timings and the largest difference to os.
+	// Returns false when a point is off by more than PROJECTION_CHECK_TOLERANCE
+	// pixels or is visible in only one of the two.
+	bool compareBatchProjection(unsigned int count, int repeat, ostream &os) const;
+
 // for large objects
 	bool project_custom_check(const Vec3f& v, Vec3d& win, const Mat4d& mat, const int object_pixel_radius) const {
 		return (project_custom(v, win, mat) && check_in_mask(win, object_pixel_radius));
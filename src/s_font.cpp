@@ -26,8 +26,40 @@
 
 #include "SDL_Pango.h"
 
+bool s_font::flagGlyphAtlas = false;
+unsigned int s_font::atlasMemory = 0;
+unsigned long s_font::atlasHits = 0;
+unsigned long s_font::atlasMisses = 0;
+
+// 32 bit surface with the bytes in RGBA order whatever the endianness
+static SDL_Surface *createRGBASurface(int w, int h) {
+
+	Uint32 rmask, gmask, bmask, amask;
+
+	/* SDL interprets each pixel as a 32-bit number, so our masks must depend
+	   on the endianness (byte order) of the machine */
+#if SDL_BYTEORDER == SDL_BIG_ENDIAN
+	rmask = 0xff000000;
+	gmask = 0x00ff0000;
+	bmask = 0x0000ff00;
+	amask = 0x000000ff;
+#else
+	rmask = 0x000000ff;
+	gmask = 0x0000ff00;
+	bmask = 0x00ff0000;
+	amask = 0xff000000;
+#endif
+
+	return SDL_CreateRGBSurface(SDL_SWSURFACE, w, h, 32, rmask, gmask, bmask, amask);
+}
+
 s_font::s_font(float size_i, const string& ttfFileName) : lineHeightEstimate(0) {
 
+	atlasTexture = 0;
+	atlasSize = atlasCellW = atlasCellH = 0;
+	atlasCells = 0;
+	batchDepth = 0;
+
     context = SDLPango_CreateContext();
 
     SDLPango_SetDefaultColor((SDLPango_Context *)context, MATRIX_TRANSPARENT_BACK_WHITE_LETTER);
@@ -46,6 +78,11 @@ s_font::~s_font() {
 
 	clearCache();
 
+	if(atlasTexture) {
+		glDeleteTextures( 1, &atlasTexture);
+		atlasMemory -= atlasSize*atlasSize*4;
+	}
+
 	if(context) {   
 		SDLPango_FreeContext((SDLPango_Context *)context);
 	}
@@ -58,35 +95,24 @@ void s_font::print(float x, float y, const string& s, int upsidedown, int cache)
 
 	if(s == "") return;
 
+	if(flagGlyphAtlas && printAtlas(x, y, s, upsidedown, cache)) return;
+
 	renderedString_struct currentRender;
+	const renderedString_struct *cached = cache ? findCached(s) : NULL;
 
 	// If not cached, create texture
-	if( !cache || renderCache[s].textureW == 0 ) {
+	if( !cached ) {
 
 		currentRender = renderString(s);
 
 		if( cache ) {
-			renderCache[s] = currentRender;
-			/*
-.stringTexture = fontTexture;
-			renderCache[s].textureW = w;
-			renderCache[s].textureH = h;
-			renderCache[s].stringW = textw;
-			renderCache[s].stringH = texth;
-			*/
+			addCached(s, currentRender);
 			//cout << "Cached string: " << s << endl;
 		}
 	} else {
 
 		// read from cache
-		currentRender = renderCache[s];
-			/*
-.stringTexture;
-		w = renderCache[s].textureW;
-		h = renderCache[s].textureH;
-		textw = renderCache[s].stringW;
-		texth = renderCache[s].stringH;	
-			*/
+		currentRender = *cached;
 
 	}
 
@@ -131,13 +157,24 @@ void s_font::print(float x, float y, const string& s, int upsidedown, int cache)
 float s_font::getStrLen(const string& s, bool cache) {
 
 	if(s == "") return 0;
+
+	if(flagGlyphAtlas) {
+		std::vector<const atlasGlyph_struct*> glyphs;
+		if( layoutAtlas(s, glyphs) ) {
+			float len = 0;
+			for (unsigned int i=0; i<glyphs.size(); i++) len += glyphs[i]->width;
+			return len;
+		}
+	}
 	
-	if( renderCache[s].textureW != 0 ) return renderCache[s].stringW;
+	const renderedString_struct *cached = findCached(s);
+	if( cached ) return cached->stringW;
 
 	// otherwise calculate (and cache if desired)
 	if(cache) {
 		print(0, 0, s, 0, -1);
-		return renderCache[s].stringW;
+		cached = findCached(s);
+		return cached ? cached->stringW : 0;
 	} else {
 		string escapedString = escapeSpecialChars(s);
 		SDLPango_SetMarkup((SDLPango_Context *)context, (getFontMarkup() + escapedString + "</span>").c_str(), -1);
@@ -163,11 +200,38 @@ string s_font::getFontMarkup() const {
 
 }
 
+//! cached rendering of a string, NULL if not cached
+const renderedString_struct* s_font::findCached(const string& s) {
+	renderedStringHash_t::iterator iter = renderCache.find(s);
+	if( iter == renderCache.end() ) return NULL;
+
+	renderLRU.splice(renderLRU.begin(), renderLRU, iter->second.lru);
+	return &iter->second;
+}
+
+//! keep a rendering, deleting the least recently used one if the cache is full
+void s_font::addCached(const string& s, const renderedString_struct& rendering) {
+	if( rendering.textureW == 0 ) return;  // rendering failed, try again next time
+	clearCache(s);
+
+	if( renderCache.size() >= RENDER_CACHE_SIZE ) {
+		const string oldest = renderLRU.back();
+		clearCache(oldest);
+	}
+
+	renderLRU.push_front(s);
+	renderedString_struct &entry = renderCache[s];
+	entry = rendering;
+	entry.lru = renderLRU.begin();
+}
+
 //! remove cached texture for string
 void s_font::clearCache(const string& s) {
-	if( renderCache[s].textureW != 0 ) {	
-		glDeleteTextures( 1, &renderCache[s].stringTexture);
-		renderCache.erase(s);
+	renderedStringHash_t::iterator iter = renderCache.find(s);
+	if( iter != renderCache.end() ) {
+		glDeleteTextures( 1, &iter->second.stringTexture);
+		renderLRU.erase(iter->second.lru);
+		renderCache.erase(iter);
 	}
 
 }
@@ -182,6 +246,7 @@ void s_font::clearCache() {
 	}
 
 	renderCache.clear();
+	renderLRU.clear();
 }
 
 //! Render a string to a texture
@@ -201,24 +266,7 @@ renderedString_struct s_font::renderString(const string &s) const {
 	rendering.textureW = getNextPowerOf2((int)rendering.stringW); 
 	rendering.textureH = getNextPowerOf2((int)rendering.stringH); 
 
-	Uint32 rmask, gmask, bmask, amask;
-
-	/* SDL interprets each pixel as a 32-bit number, so our masks must depend
-	   on the endianness (byte order) of the machine */
-#if SDL_BYTEORDER == SDL_BIG_ENDIAN
-	rmask = 0xff000000;
-	gmask = 0x00ff0000;
-	bmask = 0x0000ff00;
-	amask = 0x000000ff;
-#else
-	rmask = 0x000000ff;
-	gmask = 0x0000ff00;
-	bmask = 0x00ff0000;
-	amask = 0xff000000;
-#endif
-	
-	SDL_Surface *surface = SDL_CreateRGBSurface(SDL_SWSURFACE, (int)rendering.textureW, (int)rendering.textureH,
-												32, rmask, gmask, bmask, amask);
+	SDL_Surface *surface = createRGBASurface((int)rendering.textureW, (int)rendering.textureH);
 	renderedString_struct nothing;
 	nothing.textureW = nothing.textureH = nothing.stringW = nothing.stringH = 0;
 	nothing.stringTexture = 0;
@@ -263,6 +311,272 @@ renderedString_struct s_font::renderString(const string &s) const {
 	return rendering;
 }
 
+// Decode a UTF-8 string into code points, fails on the strings the glyph
+// atlas can not lay out: markup, several lines, combining characters and
+// scripts that need shaping or bidirectional layout
+static bool atlasCodePoints(const string& s, std::vector<unsigned int>& codes) {
+
+	codes.clear();
+	unsigned int i = 0;
+	while (i < s.size()) {
+		const unsigned char c = s[i];
+		unsigned int code, extra;
+		if (c < 0x80) { code = c; extra = 0; }
+		else if ((c & 0xe0) == 0xc0) { code = c & 0x1f; extra = 1; }
+		else if ((c & 0xf0) == 0xe0) { code = c & 0x0f; extra = 2; }
+		else return false;  // outside the basic multilingual plane or invalid
+
+		if (i + extra >= s.size()) return false;
+		for (unsigned int k=1; k<=extra; k++) {
+			const unsigned char cc = s[i+k];
+			if ((cc & 0xc0) != 0x80) return false;
+			code = (code << 6) | (cc & 0x3f);
+		}
+		i += extra + 1;
+
+		if (code < 0x20 || code == '<') return false;
+		if (code >= 0x0300 && code < 0x0370) return false;  // combining diacritics
+		if (code >= 0x0590 && code < 0x1100) return false;  // hebrew, arabic, indic, thai...
+		if (code >= 0x1100 && code < 0x1200) return false;  // hangul jamo
+		if (code >= 0x1700 && code < 0x18b0) return false;  // philippine, khmer, mongolian
+		if (code >= 0x200b && code < 0x2010) return false;  // zero width and direction marks
+		if (code >= 0x202a && code < 0x202f) return false;
+		if (code >= 0xd800 && code < 0xe000) return false;
+		if (code >= 0xfb1d && code < 0xfe10) return false;  // presentation forms, variation selectors
+		if (code >= 0xfe20 && code < 0xfe30) return false;
+		if (code >= 0xfe70 && code < 0xff00) return false;
+
+		codes.push_back(code);
+	}
+	return true;
+}
+
+static string encodeUTF8(unsigned int code) {
+
+	string s;
+	if (code < 0x80) {
+		s += (char)code;
+	} else if (code < 0x800) {
+		s += (char)(0xc0 | (code >> 6));
+		s += (char)(0x80 | (code & 0x3f));
+	} else {
+		s += (char)(0xe0 | (code >> 12));
+		s += (char)(0x80 | ((code >> 6) & 0x3f));
+		s += (char)(0x80 | (code & 0x3f));
+	}
+	return s;
+}
+
+//! Create the atlas texture, sized for about 256 glyph cells
+bool s_font::createAtlas(void) {
+
+	if (atlasTexture) return true;
+	if (atlasSize < 0) return false;  // font too large, creation already failed
+
+	atlasCellH = (int)ceil(getLineHeight()) + 2;
+	atlasCellW = atlasCellH;
+
+	GLint maxSize = 0;
+	glGetIntegerv(GL_MAX_TEXTURE_SIZE, &maxSize);
+	atlasSize = getNextPowerOf2(atlasCellH*16);
+	if (atlasSize > 2048 || atlasSize > maxSize) {
+		atlasSize = -1;
+		return false;
+	}
+
+	const int perRow = atlasSize / atlasCellW;
+	atlasCells = perRow * (atlasSize / atlasCellH);
+	for (int c = atlasCells-1; c >= 0; c--) atlasFreeCells.push_back(c);
+
+	std::vector<GLubyte> blank(atlasSize*atlasSize*4, 0);
+	glGenTextures( 1, &atlasTexture);
+	glBindTexture( GL_TEXTURE_2D, atlasTexture);
+	glTexParameteri( GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR );
+	glTexParameteri( GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR );
+	glTexParameteri( GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE );
+	glTexParameteri( GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE );
+	glTexImage2D( GL_TEXTURE_2D, 0, GL_RGBA, atlasSize, atlasSize, 0, GL_RGBA, GL_UNSIGNED_BYTE, &blank[0] );
+
+	if (atlasTexture) atlasMemory += atlasSize*atlasSize*4;
+	return atlasTexture != 0;
+}
+
+//! Find a glyph in the atlas, rendering it with Pango in the least recently used cell if missing.
+//! Returns NULL if the glyph does not fit in a cell.
+const atlasGlyph_struct* s_font::getGlyph(unsigned int code) {
+
+	atlasGlyphHash_t::iterator iter = atlasGlyphs.find(code);
+	if (iter != atlasGlyphs.end()) {
+		atlasHits++;
+		atlasLRU.splice(atlasLRU.begin(), atlasLRU, iter->second.lru);
+		return &iter->second;
+	}
+	atlasMisses++;
+
+	SDLPango_SetMarkup((SDLPango_Context *)context, (getFontMarkup() + escapeSpecialChars(encodeUTF8(code)) + "</span>").c_str(), -1);
+	const int w = SDLPango_GetLayoutWidth((SDLPango_Context *)context);
+	const int h = SDLPango_GetLayoutHeight((SDLPango_Context *)context);
+	if (w > atlasCellW || h > atlasCellH) return NULL;
+
+	int cell;
+	if (atlasFreeCells.empty()) {
+		// queued quads may still use the cell about to be reused
+		flushAtlasBatch();
+		const unsigned int old = atlasLRU.back();
+		atlasLRU.pop_back();
+		cell = atlasGlyphs[old].cell;
+		atlasGlyphs.erase(old);
+	} else {
+		cell = atlasFreeCells.back();
+		atlasFreeCells.pop_back();
+	}
+
+	SDL_Surface *surface = createRGBASurface(atlasCellW, atlasCellH);
+	if (!surface) {
+		atlasFreeCells.push_back(cell);
+		return NULL;
+	}
+	SDLPango_Draw((SDLPango_Context *)context, surface, 0, 0);
+
+	const int perRow = atlasSize / atlasCellW;
+	glBindTexture( GL_TEXTURE_2D, atlasTexture);
+	glPixelStorei( GL_UNPACK_ALIGNMENT, 4 );
+	glTexSubImage2D( GL_TEXTURE_2D, 0, (cell % perRow)*atlasCellW, (cell / perRow)*atlasCellH,
+					 atlasCellW, atlasCellH, GL_RGBA, GL_UNSIGNED_BYTE, surface->pixels );
+	SDL_FreeSurface(surface);
+
+	atlasLRU.push_front(code);
+	atlasGlyph_struct &glyph = atlasGlyphs[code];
+	glyph.cell = cell;
+	glyph.width = w;
+	glyph.height = h;
+	glyph.lru = atlasLRU.begin();
+	return &glyph;
+}
+
+//! Get the atlas glyphs of a string, false if the string needs Pango
+bool s_font::layoutAtlas(const string& s, std::vector<const atlasGlyph_struct*>& glyphs) {
+
+	std::vector<unsigned int> codes;
+	if (!atlasCodePoints(s, codes) || !createAtlas()) return false;
+
+	// glyphs of the string must not evict each other
+	if (codes.size() > atlasCells) return false;
+
+	glyphs.resize(codes.size());
+	for (unsigned int i=0; i<codes.size(); i++) {
+		glyphs[i] = getGlyph(codes[i]);
+		if (!glyphs[i]) return false;
+	}
+	return true;
+}
+
+//! Queue the quads of a string, same placement as the string texture drawn by print
+bool s_font::printAtlas(float x, float y, const string& s, int upsidedown, int cache) {
+
+	std::vector<const atlasGlyph_struct*> glyphs;
+	if (!layoutAtlas(s, glyphs)) return false;
+
+	if (cache == -1) return true;  // glyphs are now in the atlas
+
+	float stringH = 0;
+	for (unsigned int i=0; i<glyphs.size(); i++) {
+		if (glyphs[i]->height > stringH) stringH = glyphs[i]->height;
+	}
+	const float textureH = getNextPowerOf2((int)stringH);
+
+	// Vertices are stored in clip coordinates so that the batch can be drawn
+	// after the caller changed its matrices
+	GLfloat proj[16], model[16], color[4], m[16];
+	glGetFloatv(GL_PROJECTION_MATRIX, proj);
+	glGetFloatv(GL_MODELVIEW_MATRIX, model);
+	glGetFloatv(GL_CURRENT_COLOR, color);
+	for (int c=0; c<4; c++) {
+		for (int r=0; r<4; r++) {
+			m[4*c+r] = proj[r]*model[4*c] + proj[4+r]*model[4*c+1] + proj[8+r]*model[4*c+2] + proj[12+r]*model[4*c+3];
+		}
+	}
+
+	y -= stringH;  // adjust for base of text in texture
+	const int perRow = atlasSize / atlasCellW;
+	float pen = x;
+
+	for (unsigned int i=0; i<glyphs.size(); i++) {
+		const atlasGlyph_struct *g = glyphs[i];
+		const float u0 = (float)((g->cell % perRow)*atlasCellW)/atlasSize;
+		const float v0 = (float)((g->cell / perRow)*atlasCellH)/atlasSize;
+		const float u1 = u0 + g->width/atlasSize;
+		const float v1 = v0 + g->height/atlasSize;
+
+		float y0, y1;
+		if (!upsidedown) {
+			y0 = y;
+			y1 = y + g->height;
+		} else {
+			y0 = y + textureH;
+			y1 = y + textureH - g->height;
+		}
+
+		const float quad[4][4] = { {u0, v0, pen, y0}, {u1, v0, pen+g->width, y0},
+			{u1, v1, pen+g->width, y1}, {u0, v1, pen, y1} };
+		for (int k=0; k<4; k++) {
+			atlasBatch.push_back(quad[k][0]);
+			atlasBatch.push_back(quad[k][1]);
+			atlasBatch.insert(atlasBatch.end(), color, color+4);
+			for (int r=0; r<4; r++) atlasBatch.push_back(m[r]*quad[k][2] + m[4+r]*quad[k][3] + m[12+r]);
+		}
+		pen += g->width;
+	}
+
+	if (!batchDepth) flushAtlasBatch();
+	return true;
+}
+
+void s_font::flushAtlasBatch(void) {
+
+	if (atlasBatch.empty()) return;
+
+	glPushAttrib(GL_ENABLE_BIT | GL_COLOR_BUFFER_BIT | GL_TEXTURE_BIT | GL_TRANSFORM_BIT);
+	glPushClientAttrib(GL_CLIENT_VERTEX_ARRAY_BIT);
+	glMatrixMode(GL_PROJECTION);
+	glPushMatrix();
+	glLoadIdentity();
+	glMatrixMode(GL_MODELVIEW);
+	glPushMatrix();
+	glLoadIdentity();
+
+	glEnable(GL_TEXTURE_2D);
+	glEnable(GL_BLEND);
+	glBlendFunc(GL_SRC_ALPHA, GL_ONE_MINUS_SRC_ALPHA);
+	glBindTexture(GL_TEXTURE_2D, atlasTexture);
+
+	const GLsizei stride = 10*sizeof(GLfloat);
+	glEnableClientState(GL_TEXTURE_COORD_ARRAY);
+	glEnableClientState(GL_COLOR_ARRAY);
+	glEnableClientState(GL_VERTEX_ARRAY);
+	glTexCoordPointer(2, GL_FLOAT, stride, &atlasBatch[0]);
+	glColorPointer(4, GL_FLOAT, stride, &atlasBatch[2]);
+	glVertexPointer(4, GL_FLOAT, stride, &atlasBatch[6]);
+	glDrawArrays(GL_QUADS, 0, atlasBatch.size()/10);
+
+	glMatrixMode(GL_PROJECTION);
+	glPopMatrix();
+	glMatrixMode(GL_MODELVIEW);
+	glPopMatrix();
+	glPopClientAttrib();
+	glPopAttrib();
+
+	atlasBatch.clear();
+}
+
+void s_font::beginBatch(void) {
+	batchDepth++;
+}
+
+void s_font::endBatch(void) {
+	if (batchDepth > 0 && --batchDepth == 0) flushAtlasBatch();
+}
+
 /* May be useful later, but not happy with alignment
 
 //! Draw text with baseline more or less parallel with horizon
@@ -457,11 +771,12 @@ void s_font::print_gravity(Projector * prj, float altitude, float azimuth, const
 	//cout << str << " : " << cache << endl;
 
 	// Get rendered texture
-	if(renderCache[str].textureW == 0) {
+	const renderedString_struct *cached = findCached(str);
+	if(!cached) {
 		rendering = renderString(str);
-		if(cache) renderCache[str] = rendering;
+		if(cache) addCached(str, rendering);
 	} else {
-		rendering = renderCache[str];
+		rendering = *cached;
 	}
 
 	float textureExtentH = rendering.stringH/rendering.textureH;
@@ -568,7 +883,8 @@ void s_font::print_gravity(Projector * prj, float altitude, float azimuth, const
 	
 	prj->reset_perspective_projection();
 
-	if(!cache) glDeleteTextures( 1, &rendering.stringTexture);
+	// a string cached by an earlier call stays cached
+	if(!cache && !cached) glDeleteTextures( 1, &rendering.stringTexture);
 
 	// TODO justification if needed
 
@@ -30,7 +30,9 @@
 # include <config.h>
 #endif
 
+#include <list>
 #include <map>
+#include <vector>
 #include "nightshade.h"
 
 #include "utility.h"
@@ -45,11 +47,21 @@ typedef struct {
 	float textureH; 	   // Height of texture in pixels
 	float stringW; 	       // Width of string portion in pixels
 	float stringH; 	       // Height of string portion in pixels
+	std::list<std::string>::iterator lru;  // Position in the least recently used list, when cached
 } renderedString_struct;
 
 typedef std::map< std::string, renderedString_struct > renderedStringHash_t;
 typedef renderedStringHash_t::const_iterator renderedStringHashIter_t;
 
+typedef struct {
+	int cell;              // Index of the atlas cell holding the glyph
+	float width;           // Layout width (advance) in pixels
+	float height;          // Layout height in pixels
+	std::list<unsigned int>::iterator lru;  // Position in the least recently used list
+} atlasGlyph_struct;
+
+typedef std::map< unsigned int, atlasGlyph_struct > atlasGlyphHash_t;
+
 class s_font
 {
 public:
@@ -72,9 +84,65 @@ public:
 
 	string escapeSpecialChars(const string &input) const;
 
+	//! Glyph atlas mode: simple strings are drawn from shaped glyphs cached in
+	//! one texture per font instead of a texture per string. Strings with
+	//! markup or complex scripts still go through Pango. Glyphs are placed by
+	//! their advance without pair kerning, so the mode is off by default.
+	static void setFlagGlyphAtlas(bool b) {
+		flagGlyphAtlas = b;
+	}
+	static bool getFlagGlyphAtlas(void) {
+		return flagGlyphAtlas;
+	}
+
+	//! Labels printed between beginBatch and endBatch are drawn with a single
+	//! draw call at endBatch (glyph atlas mode only)
+	void beginBatch(void);
+	void endBatch(void);
+
+	//! Memory used by the glyph atlas textures of all fonts in bytes, an atlas never grows
+	static unsigned int getAtlasMemory(void) {
+		return atlasMemory;
+	}
+	//! Glyph lookups of all fonts found in their atlas since the start
+	static unsigned long getAtlasHits(void) {
+		return atlasHits;
+	}
+	//! Glyph lookups of all fonts that had to render the glyph since the start
+	static unsigned long getAtlasMisses(void) {
+		return atlasMisses;
+	}
+
 protected:
 	
+	// Strings rendered with Pango kept as textures, the least recently used
+	// are deleted beyond RENDER_CACHE_SIZE
+	enum { RENDER_CACHE_SIZE = 512 };
+	const renderedString_struct* findCached(const string& s);
+	void addCached(const string& s, const renderedString_struct& rendering);
+
 	renderedStringHash_t renderCache;
+	std::list<std::string> renderLRU;  // Cached strings, most recently used first
+
+	// glyph atlas
+	bool createAtlas(void);
+	bool layoutAtlas(const string& s, std::vector<const atlasGlyph_struct*>& glyphs);
+	const atlasGlyph_struct* getGlyph(unsigned int code);
+	bool printAtlas(float x, float y, const string& s, int upsidedown, int cache);
+	void flushAtlasBatch(void);
+
+	static bool flagGlyphAtlas;
+	GLuint atlasTexture;
+	int atlasSize;           // Atlas texture width and height in pixels
+	int atlasCellW, atlasCellH;
+	unsigned int atlasCells;
+	atlasGlyphHash_t atlasGlyphs;
+	std::list<unsigned int> atlasLRU;  // Code points, most recently used first
+	std::vector<int> atlasFreeCells;
+	static unsigned int atlasMemory;
+	static unsigned long atlasHits, atlasMisses;
+	int batchDepth;
+	std::vector<GLfloat> atlasBatch;   // Texture coordinates, color and clip coordinates per vertex
 
 	// return Pango markup string for setting font
 	string getFontMarkup() const;
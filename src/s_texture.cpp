@@ -29,19 +29,20 @@
 #include <exception>
 
 #include "s_texture.h"
+#include "texture_loader.h"
 #include "nightshade.h"
 
 string s_texture::texDir = "./";
 
 s_texture::s_texture(const string& _textureName) : textureName(_textureName), texID(0),
-		loadType(PNG_BLEND1), loadType2(GL_CLAMP)
+		loadType(PNG_BLEND1), loadType2(GL_CLAMP), pending(false)
 {
 	load( texDir + textureName );
 }
 
 // when need to load images outside texture directory
 s_texture::s_texture(bool full_path, const string& _textureName, int _loadType) : textureName(_textureName),
-		texID(0), loadType(PNG_BLEND1), loadType2(GL_CLAMP_TO_EDGE)
+		texID(0), loadType(PNG_BLEND1), loadType2(GL_CLAMP_TO_EDGE), pending(false)
 {
 	switch (_loadType) {
 	case TEX_LOAD_TYPE_PNG_ALPHA :
@@ -70,7 +71,7 @@ s_texture::s_texture(bool full_path, const string& _textureName, int _loadType)
 }
 
 s_texture::s_texture(bool full_path, const string& _textureName, int _loadType, const bool mipmap) : textureName(_textureName),
-		texID(0), loadType(PNG_BLEND1), loadType2(GL_CLAMP_TO_EDGE)
+		texID(0), loadType(PNG_BLEND1), loadType2(GL_CLAMP_TO_EDGE), pending(false)
 {
 	switch (_loadType) {
 	case TEX_LOAD_TYPE_PNG_ALPHA :
@@ -97,6 +98,34 @@ s_texture::s_texture(bool full_path, const string& _textureName, int _loadType,
 	else load( texDir + textureName, mipmap );
 }
 
+s_texture::s_texture(bool full_path, const string& _textureName, int _loadType, const bool mipmap, const bool async) :
+		textureName(_textureName), texID(0), loadType(PNG_BLEND1), loadType2(GL_CLAMP_TO_EDGE), pending(false)
+{
+	switch (_loadType) {
+	case TEX_LOAD_TYPE_PNG_ALPHA :
+		loadType=PNG_ALPHA;
+		break;
+	case TEX_LOAD_TYPE_PNG_SOLID :
+		loadType=PNG_SOLID;
+		break;
+	case TEX_LOAD_TYPE_PNG_BLEND3:
+		loadType=PNG_BLEND3;
+		break;
+	case TEX_LOAD_TYPE_PNG_BLEND1:
+		loadType=PNG_BLEND1;
+		break;
+	case TEX_LOAD_TYPE_PNG_SOLID_REPEAT:
+		loadType=PNG_SOLID;
+		loadType2=GL_REPEAT;
+		break;
+	default :
+		loadType=PNG_BLEND3;
+	}
+	whole_path = full_path;
+	string fullName = full_path ? textureName : texDir + textureName;
+	if (async) loadAsync(fullName, mipmap);
+	else load(fullName, mipmap);
+}
 
 s_texture::s_texture(const s_texture &t)
 {
@@ -105,6 +134,7 @@ s_texture::s_texture(const s_texture &t)
 	loadType2 = t.loadType2;
 	whole_path = t.whole_path;
 	texID=0;
+	pending = false;
 	load(texDir + textureName);
 }
 
@@ -121,7 +151,7 @@ const s_texture &s_texture::operator=(const s_texture &t)
 }
 
 s_texture::s_texture(const string& _textureName, int _loadType, const bool mipmap) : textureName(_textureName),
-		texID(0), loadType(PNG_BLEND1), loadType2(GL_CLAMP_TO_EDGE)
+		texID(0), loadType(PNG_BLEND1), loadType2(GL_CLAMP_TO_EDGE), pending(false)
 {
 	switch (_loadType) {
 	case TEX_LOAD_TYPE_PNG_ALPHA :
@@ -148,7 +178,7 @@ s_texture::s_texture(const string& _textureName, int _loadType, const bool mipma
 }
 
 s_texture::s_texture(const string& _textureName, int _loadType) : textureName(_textureName),
-		texID(0), loadType(PNG_BLEND1), loadType2(GL_CLAMP_TO_EDGE)
+		texID(0), loadType(PNG_BLEND1), loadType2(GL_CLAMP_TO_EDGE), pending(false)
 {
 	switch (_loadType) {
 	case TEX_LOAD_TYPE_PNG_ALPHA :
@@ -327,8 +357,67 @@ int s_texture::load(string fullName, bool mipmap)
 	return (texID!=0);
 }
 
+// Only the image header is read here, the TextureLoader decodes the pixels
+// and finishLoad() replaces the placeholder.  Synchronous without loader threads.
+int s_texture::loadAsync(string fullName, bool mipmap)
+{
+	TextureLoader *loader = TextureLoader::Instance();
+	if (!loader->isThreaded()) return load(fullName, mipmap);
+
+	try {
+		Magick::Image image;
+		image.ping(fullName);
+		texWidth = image.columns();
+		texHeight = image.rows();
+	}
+	catch( std::exception &e ) {
+		cerr << "WARNING : failed loading texture file! " << e.what() << endl;
+		return 0;
+	}
+	TextureLoader::textureDimensions(loader->getMaxTextureSize(), texWidth, texHeight);
+
+	glGenTextures(1, &texID);
+	if( !texID ) return 0;
+
+	const GLubyte placeholder[4] = { 0, 0, 0, 0 };
+	glBindTexture(GL_TEXTURE_2D, texID);
+	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_NEAREST);
+	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, loadType2);
+	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, loadType2);
+	glTexImage2D(GL_TEXTURE_2D, 0, GL_RGBA, 1, 1, 0, GL_RGBA, GL_UNSIGNED_BYTE, placeholder);
+
+	pending = true;
+	loader->request(this, fullName, loadType, mipmap);
+	return 1;
+}
+
+void s_texture::finishLoad( const char* data, unsigned int w, unsigned int h, bool mipmap )
+{
+	pending = false;
+	if( !data ) {
+		// failed like a synchronous load, the loader already warned
+		glDeleteTextures(1, &texID);
+		texID = 0;
+		return;
+	}
+
+	glBindTexture(GL_TEXTURE_2D, texID);
+	if( mipmap ) {
+		glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR_MIPMAP_NEAREST);
+		gluBuild2DMipmaps(GL_TEXTURE_2D, GL_RGBA, w, h, GL_RGBA, GL_UNSIGNED_BYTE, data);
+	}
+	else {
+		glTexImage2D(GL_TEXTURE_2D, 0, GL_RGBA, w, h, 0, GL_RGBA, GL_UNSIGNED_BYTE, data);
+	}
+}
+
 void s_texture::unload()
 {
+	if (pending) {
+		TextureLoader::Instance()->cancel(this);
+		pending = false;
+	}
 	glDeleteTextures(1, &texID);	// Delete The Texture
 	texID = 0;
 }
@@ -344,6 +433,8 @@ int s_texture::reload()
 // Return the texture WIDTH in pixels
 int s_texture::getSize(void) const
 {
+	if (pending) return texWidth;
+
 	glBindTexture(GL_TEXTURE_2D, texID);
 	GLint w;
 	glGetTexLevelParameteriv(GL_TEXTURE_2D, 0, GL_TEXTURE_WIDTH, &w);
@@ -352,6 +443,12 @@ int s_texture::getSize(void) const
 
 void s_texture::getDimensions(int &width, int &height) const
 {
+	if (pending) {
+		width = texWidth;
+		height = texHeight;
+		return;
+	}
+
 	glBindTexture(GL_TEXTURE_2D, texID);
 
 	GLint w, h;
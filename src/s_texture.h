@@ -49,11 +49,15 @@ using namespace std;
 
 class s_texture
 {
+	friend class TextureLoader;
+
 public:
-	s_texture(){};
+	s_texture() : texID(0), pending(false) {};
 	s_texture(const string& _textureName);
 	s_texture(bool full_path, const string& _textureName, int _loadType);
 	s_texture(bool full_path, const string& _textureName, int _loadType, const bool mipmap);
+	// async: decode with the TextureLoader, a transparent texture is bound until the upload
+	s_texture(bool full_path, const string& _textureName, int _loadType, const bool mipmap, const bool async);
 	s_texture(const string& _textureName, int _loadType);
 	s_texture(const string& _textureName, int _loadType, const bool mipmap);
 	virtual ~s_texture();
@@ -61,12 +65,17 @@ public:
 	const s_texture &operator=(const s_texture &t);
 	int load(string fullName);
 	int load(string fullName, bool mipmap);
+	int loadAsync(string fullName, bool mipmap);
 	bool bind( void );
 	void unload();
 	int reload();
 	unsigned int getID(void) const {
 		return texID;
 	}
+	// Whether the texture is still being decoded by the TextureLoader
+	bool isPending(void) const {
+		return pending;
+	}
 	// Return the average texture luminance : 0 is black, 1 is white
 	float get_average_luminance(void) const;
 	int getSize(void) const;
@@ -76,9 +85,11 @@ public:
 	}
 
 private:
-	void blend( const int, char* const, const unsigned int );
+	static void blend( const int, char* const, const unsigned int );
 	bool ProxyLoad( unsigned int, unsigned int, GLint, GLint );
-	unsigned int roundToPow2( unsigned int );
+	static unsigned int roundToPow2( unsigned int );
+	// Called by the TextureLoader on the GL thread, data is NULL if decoding failed
+	void finishLoad( const char* data, unsigned int w, unsigned int h, bool mipmap );
 	double checkForGammaEnv( void );
 
 	string textureName;
@@ -86,6 +97,8 @@ private:
 	int loadType;
 	int loadType2;
 	bool whole_path;
+	bool pending;
+	unsigned int texWidth, texHeight;   // dimensions of the texture being decoded
 
 	static string texDir;
 };
@@ -28,21 +28,19 @@
 
 Script::Script()
 {
-	input_file = NULL;
+	current = 0;
 	path = "";
 }
 
 Script::~Script()
 {
-	if (input_file)
-		delete input_file;  // closes automatically
 }
 
 int Script::load(string script_file, string script_path)
 {
-	input_file = new ifstream(script_file.c_str());
+	ifstream input_file(script_file.c_str());
 
-	if (! input_file->is_open()) {
+	if (! input_file.is_open()) {
 		cout << "Unable to open script " << script_file << endl;
 		return 0;
 	}
@@ -50,28 +48,35 @@ int Script::load(string script_file, string script_path)
 
 	// TODO check first line of file for script identifier... ?
 
-	return 1;
-}
-
-int Script::next_command(string &command)
-{
-
 	string line;
+	commands.clear();
+	current = 0;
 
-	while (! input_file->eof() ) {
-		getline(*input_file,line);
+	while (getline(input_file, line)) {
 
 		if ( line[0] != '#' && line[0] != 0 && line[0] != '\r') {
 
-//			cout << "Line is: " << line << endl;
-
-			command = line;
-
-			return 1;
+			commands.push_back(BoundCommand());
+			AppCommandInterface::bind_command(line, commands.back());
 		}
 	}
 
-	return 0;
+	return 1;
+}
+
+int Script::next_command(string &command)
+{
+	const BoundCommand *cmd = next();
+	if (!cmd) return 0;
+
+	command = cmd->line;
+	return 1;
+}
+
+const BoundCommand *Script::next()
+{
+	if (current >= commands.size()) return NULL;
+	return &commands[current++];
 }
 
 
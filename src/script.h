@@ -24,6 +24,8 @@
  */
 
 // This class handles loading and playing a script of recorded commands
+// The whole file is read and bound when loaded, playback only walks the
+// list of commands
 
 
 #ifndef _SCRIPT_H_
@@ -32,8 +34,9 @@
 #include <iostream>
 #include <fstream>
 #include <string>
+#include <vector>
 #include "app_command_interface.h"
-
+#include "command_interface.h"
 
 class Script
 {
@@ -41,14 +44,16 @@ class Script
 public:
 	Script();
 	~Script();
-	int load(string script_file, string script_path);         // open a script file
-	int next_command(string &command);    // retreive next command to execute
+	int load(string script_file, string script_path);         // read and parse a script file
+	int next_command(string &command);    // retreive next command line to execute
+	const BoundCommand *next();           // next bound command, NULL at end of script
 	string get_path() {
 		return path;
 	};
 
 private:
-	ifstream * input_file;
+	vector<BoundCommand> commands;
+	unsigned int current;  // index of the next command
 	string path;
 
 };
@@ -34,6 +34,7 @@
 #include <set>
 #include "shared_data.h"
 #include "script_mgr.h"
+#include "texture_loader.h"
 #include "utility.h"
 
 
@@ -43,6 +44,9 @@ ScriptMgr::ScriptMgr(AppCommandInterface *command_interface, string _data_dir) :
 	DataDir = _data_dir;
 	recording = 0;
 	playing = 0;
+	wait_textures = false;
+	command_budget = 10;
+	play_count = 0;
 	record_elapsed_time = 0;
 	elapsed_playback_seconds = 0;
 	m_incCount = 0;
@@ -78,6 +82,7 @@ bool ScriptMgr::play_script(string script_file, string script_path)
 
 	//if (script) delete script;
 	script = new Script();
+	play_count++;
 
 	// if script is on mountable disk, mount that now
 	mount_directory( script_file );
@@ -92,6 +97,7 @@ bool ScriptMgr::play_script(string script_file, string script_path)
 		SharedData::Instance()->Script( state );
 
 		play_paused = 0;
+		wait_textures = false;
 		elapsed_time = wait_time = 0;
 		elapsed_playback_seconds = 0;
 
@@ -119,6 +125,9 @@ void ScriptMgr::cancel_script()
 	script = NULL;
 	// images loaded are deleted from stel_command_interface directly
 	playing = 0;
+
+	// prefetched images the script did not load are not needed anymore
+	TextureLoader::Instance()->dropPrefetched();
 	play_paused = 0;
 
 	ScriptState state;
@@ -289,8 +298,9 @@ void ScriptMgr::reset_timer()
 }
 
 
-// runs maximum of one command per update
-// note that waits can drift by up to 1/fps seconds
+// runs all commands that are due, up to the next wait, within command_budget ms
+// commands held back by the budget run on the next update; since the time
+// elapsed is carried over, later waits still end at the same script time
 void ScriptMgr::update(int delta_time)
 {
 
@@ -298,47 +308,46 @@ void ScriptMgr::update(int delta_time)
 
 	if (playing && !play_paused) {
 
+		if (wait_textures) {
+			if (!TextureLoader::Instance()->isIdle()) return;
+			wait_textures = false;
+		}
+
 		elapsed_time += delta_time;  // time elapsed since last command (should have been) executed
 
 		elapsed_playback_seconds += double(delta_time)/1000;
 
-		if (elapsed_time >= wait_time) {
-			// now time to run next command
+		const Uint32 start = SDL_GetTicks();
 
+		// a command can end, pause or replace the script, or wait for textures
+		while (playing && !play_paused && !wait_textures && elapsed_time >= wait_time) {
+			// now time to run next command
 
 			//      cout << "dt " << delta_time << " et: " << elapsed_time << endl;
 			elapsed_time -= wait_time;
-			string comd;
+			wait_time = 0;
 
-			unsigned long int wait;
-			if (script->next_command(comd)) {
-				commander->execute_command(comd, wait, 0);  // untrusted commands
-				wait_time = wait;
+			const unsigned int current = play_count;
+			const BoundCommand *next = script->next();
 
-			} else {
+			if (!next) {
 				// script done
 				// cout << "Script completed." << endl;
 				commander->execute_command("script action end");
+				break;
 			}
 
-			/* Still bugs to work out 200703
+			// a copy, the command may end the script and delete its commands
+			const BoundCommand cmd(*next);
+			unsigned long int wait;
+			commander->execute_command(cmd, wait, 0);  // untrusted commands
 
-			// * * * DIGITALIS 20070123 Perform all commands until next wait command
-			unsigned long int wait=0;
-			while(wait == 0 && script && script->next_command(comd)) {
-			commander->execute_command(comd, wait, 0);  // untrusted commands
-			// cout << comd << endl;
-			wait_time = wait;
-			}
+			// a script started by this command begins from its own start
+			if (play_count != current) continue;
 
-			if(wait == 0) {
-			// script done
-			// cout << "Script completed." << endl;
-			commander->execute_command("script action end");
-			}
-			// * * *
-			*/
+			wait_time = wait;
 
+			if (command_budget && SDL_GetTicks() - start >= command_budget) break;
 		}
 	}
 
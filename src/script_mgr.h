@@ -70,7 +70,13 @@ public:
 	};    // is a script being recorded?
 	bool is_faster( void );
 	void reset_timer();
+	void wait_for_textures() {
+		wait_textures = true;    // hold the next command until the texture loader is idle
+	}
 	void update(int delta_time);  // execute commands in running script
+	void set_command_budget(unsigned int ms) {
+		command_budget = ms;    // time per update spent running commands that are due, 0 for no limit
+	}
 	string get_script_list(string directory);  // get list of scripts in a directory
 	string get_script_path();
 	string get_record_filename() {
@@ -106,10 +112,13 @@ private:
 	double elapsed_playback_seconds;  // seconds since current script playback began (in script time)
 	unsigned long int elapsed_time;  // ms since last script command executed
 	unsigned long int wait_time;     // ms until next script command should be executed
+	bool wait_textures;              // waiting for textures to finish loading?
+	Uint32 command_budget;           // ms per update spent executing commands
 	unsigned long int record_elapsed_time;  // ms since last command recorded
 	bool recording;  // is a script being recorded?
 	bool playing;    // is a script playing?  (could be paused)
 	bool play_paused;// is script playback paused?
+	unsigned int play_count;  // incremented by each play_script
 	fstream rec_file;
 	string rec_filename;
 	string RemoveableScriptDirectory;
@@ -24,11 +24,26 @@
 #include "app.h"
 #include "sdl_facade.h"
 
+#ifdef HAVE_OSMESA
+#include <GL/osmesa.h>
+#endif
+
 using namespace s_gui;
 
 
+SDLFacade::SDLFacade() : Screen(NULL), Cursor(NULL), screenW(0), screenH(0), headless(false),
+	offscreenContext(NULL), offscreenBuffer(NULL) {
+}
+
 SDLFacade::~SDLFacade(){
-	SDL_FreeCursor(Cursor);
+#ifdef HAVE_OSMESA
+	if (offscreenContext) {
+		OSMesaDestroyContext((OSMesaContext)offscreenContext);
+		free(offscreenBuffer);
+		SDL_FreeSurface(Screen);
+	}
+#endif
+	if (Cursor) SDL_FreeCursor(Cursor);
 }
 
 
@@ -153,16 +168,58 @@ void SDLFacade::createSurface( Uint16 w, Uint16 h, int bppMode, bool fullScreen,
 	SDL_WM_SetCaption(APP_NAME, APP_NAME);
 	
 	// Set the window icon
-	SDL_Surface *icon = SDL_LoadBMP((iconFile).c_str());
-	SDL_WM_SetIcon(icon, NULL);
-	SDL_FreeSurface(icon);
+	if (!iconFile.empty()) {
+		SDL_Surface *icon = SDL_LoadBMP((iconFile).c_str());
+		SDL_WM_SetIcon(icon, NULL);
+		SDL_FreeSurface(icon);
+	}
 	
 	glClear(GL_COLOR_BUFFER_BIT);
 	SDL_GL_SwapBuffers();
 	glClear(GL_COLOR_BUFFER_BIT);
 }
 
-void SDLFacade::initSDL() {
+void SDLFacade::createOffscreenSurface( Uint16 w, Uint16 h ) {
+#ifdef HAVE_OSMESA
+	screenW = w;
+	screenH = h;
+
+	offscreenContext = OSMesaCreateContextExt(OSMESA_RGBA, 24, 8, 0, NULL);
+	if (!offscreenContext) {
+		fprintf(stderr, "Error: Couldn't create an OSMesa context\n");
+		exit(-1);
+	}
+
+	offscreenBuffer = malloc(w * h * 4);
+	if (!offscreenBuffer || !OSMesaMakeCurrent((OSMesaContext)offscreenContext, offscreenBuffer, GL_UNSIGNED_BYTE, w, h)) {
+		fprintf(stderr, "Error: Couldn't create a %dx%d offscreen buffer\n", w, h);
+		exit(-1);
+	}
+
+	// Not drawn into, only gives the frame size to screenshots
+	Screen = SDL_CreateRGBSurface(SDL_SWSURFACE, w, h, 32, 0, 0, 0, 0);
+
+	glClear(GL_COLOR_BUFFER_BIT);
+#else
+	printf("Warning: built without OSMesa, headless rendering uses a window\n");
+	createSurface(w, h, 0, false, "");
+#endif
+}
+
+void SDLFacade::swapBuffers() {
+	if (offscreenContext) glFinish();
+	else SDL_GL_SwapBuffers();
+}
+
+void SDLFacade::initSDL( bool _headless ) {
+
+	headless = _headless;
+
+#ifdef HAVE_OSMESA
+	// Rendering goes to an OSMesa buffer, SDL only provides events and timers
+	if (headless && !getenv("SDL_VIDEODRIVER"))
+		putenv((char *)"SDL_VIDEODRIVER=dummy");
+#endif
 
 #ifdef HAVE_SDL_MIXER_H
 
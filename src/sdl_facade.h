@@ -42,14 +42,27 @@ class SDLFacade {
 
 public:
 	static SDL_Cursor *create_cursor(const char *image[]);
+	SDLFacade();
 	virtual ~SDLFacade();
 
 	// Must be called prior to any other SDL methods
-	void initSDL( void );
+	// Headless runs don't need a display when OSMesa is available
+	void initSDL( bool headless = false );
 
 	// Creates the rendering target. Must be called prior to any OpenGL functions
 	void createSurface(Uint16 w, Uint16 h, int bbpMode, bool fullScreen, string iconFile);
 
+	// Creates an offscreen rendering target of the given size, for headless runs.
+	// Falls back to a window when built without OSMesa.
+	void createOffscreenSurface(Uint16 w, Uint16 h);
+
+	bool isHeadless(void) const {
+		return headless;
+	}
+
+	// Display the frame just drawn
+	void swapBuffers(void);
+
 	// Video mode queries
 	void getResolution( Uint16* const w, Uint16* const h ) const;
 	void getCurrentRes( Uint16* const w, Uint16* const h ) const;
@@ -64,4 +77,7 @@ private:
 	SDL_Cursor *Cursor;
 	Uint16 screenW;
 	Uint16 screenH;
+	bool headless;
+	void* offscreenContext;  // OSMesaContext
+	void* offscreenBuffer;
 };
@@ -145,7 +145,7 @@ void SharedDataC::SetCoveLightSystem( const std::string& str ) {
 
 void SharedDataC::DataPush( void ) {
 	if( m_sharedMem )
-		*(m_sharedMem->m_readState) = *(m_sharedMem->m_writeState);
+		m_sharedMem->m_readState->Publish( *m_sharedMem->m_writeState );
 }
 
 void SharedDataC::Observer( const ObserverState& obj ) {
@@ -178,6 +178,11 @@ void SharedDataC::Objects( const ObjectsState& obj ) {
 		m_sharedMem->m_writeState->Objects( obj );
 }
 
+void SharedDataC::Profile( const ProfileState& obj ) {
+	if( m_sharedMem )
+		m_sharedMem->m_writeState->Profile( obj );
+}
+
 void SharedDataC::Landscapes( const string& data ) {
 	if( m_sharedMem )
 		m_sharedMem->m_writeState->Landscapes( data );
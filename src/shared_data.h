@@ -40,6 +40,7 @@ public:
 	virtual void References( const ReferenceState& ) = 0;
 	virtual void Settings( const SettingsState& ) = 0;
 	virtual void Objects( const ObjectsState& ) = 0;
+	virtual void Profile( const ProfileState& ) = 0;
 	virtual void Landscapes( const std::string& ) = 0;
 	virtual void SkyLanguages( const std::string& ) = 0;
 	virtual void SetCoveLightSystem( const std::string& ) = 0;
@@ -65,6 +66,7 @@ public:
 	void References( const ReferenceState& );
 	void Settings( const SettingsState& );
 	void Objects( const ObjectsState& );
+	void Profile( const ProfileState& );
 	void Landscapes( const std::string& );
 	void SkyLanguages( const std::string& );
 	void SetCoveLightSystem( const std::string& );
@@ -96,6 +98,7 @@ public:
 	void References( const ReferenceState& ){/* NOOP */};
 	void Settings( const SettingsState& ){/* NOOP */};
 	void Objects( const ObjectsState& ){/* NOOP */};
+	void Profile( const ProfileState& ){/* NOOP */};
 	void Landscapes( const std::string& ){/* NOOP */}
 	void SkyLanguages( const std::string& ){/* NOOP */};
 	void CopyStaticData( void ){/* NOOP */};
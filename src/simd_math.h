@@ -0,0 +1,354 @@
+/*
+ * Nightshade (TM) astronomy simulation and visualization
+ *
+ * Copyright (C) 2012 Digitalis Education Solutions, Inc.
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 3
+ * of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place - Suite 330, Boston, MA  02111-1307, USA.
+ *
+ * Nightshade is a trademark of Digitalis Education Solutions, Inc.
+ * See the TRADEMARKS file for trademark usage requirements.
+ *
+ */
+
+// Thin wrappers over SSE2/AVX double precision lanes, used by the batch
+// kernels (projection, orbits, sky model). AVX is used when the compiler
+// targets it (e.g. -mavx), SSE2 otherwise. HAVE_SIMD_DOUBLE is left
+// undefined on other architectures and callers keep their scalar loops.
+
+#ifndef _SIMD_MATH_H_
+#define _SIMD_MATH_H_
+
+#include <cmath>
+
+#if defined(__AVX__)
+#include <immintrin.h>
+#define HAVE_SIMD_DOUBLE 1
+#elif defined(__SSE2__)
+#include <emmintrin.h>
+#define HAVE_SIMD_DOUBLE 1
+#endif
+
+#ifdef HAVE_SIMD_DOUBLE
+
+namespace SimdMath {
+
+#if defined(__AVX__)
+
+struct SimdD {
+	typedef __m256d V;
+	enum { width = 4 };
+
+	static V load(const double *p) { return _mm256_loadu_pd(p); }
+	static void store(double *p, V v) { _mm256_storeu_pd(p, v); }
+	static V set1(double d) { return _mm256_set1_pd(d); }
+	static V zero(void) { return _mm256_setzero_pd(); }
+
+	static V add(V a, V b) { return _mm256_add_pd(a, b); }
+	static V sub(V a, V b) { return _mm256_sub_pd(a, b); }
+	static V mul(V a, V b) { return _mm256_mul_pd(a, b); }
+	static V div(V a, V b) { return _mm256_div_pd(a, b); }
+	static V sqrt(V a) { return _mm256_sqrt_pd(a); }
+	static V min(V a, V b) { return _mm256_min_pd(a, b); }
+	static V max(V a, V b) { return _mm256_max_pd(a, b); }
+
+	static V eq(V a, V b) { return _mm256_cmp_pd(a, b, _CMP_EQ_OQ); }
+	static V lt(V a, V b) { return _mm256_cmp_pd(a, b, _CMP_LT_OQ); }
+	static V le(V a, V b) { return _mm256_cmp_pd(a, b, _CMP_LE_OQ); }
+	static V gt(V a, V b) { return _mm256_cmp_pd(a, b, _CMP_GT_OQ); }
+	static V and_(V a, V b) { return _mm256_and_pd(a, b); }
+	static V or_(V a, V b) { return _mm256_or_pd(a, b); }
+	static V xor_(V a, V b) { return _mm256_xor_pd(a, b); }
+	static V andnot(V a, V b) { return _mm256_andnot_pd(a, b); }
+
+	//! mask ? a : b
+	static V select(V mask, V a, V b) { return _mm256_blendv_pd(b, a, mask); }
+	//! One bit per lane, set where mask is true
+	static int movemask(V mask) { return _mm256_movemask_pd(mask); }
+
+	//! 2^n for integral n in [-1022, 1023]
+	static V pow2n(V n) {
+		const __m128i e = _mm_add_epi32(_mm256_cvtpd_epi32(n), _mm_set1_epi32(1023));
+		const __m128i lo = _mm_slli_epi64(_mm_unpacklo_epi32(e, _mm_setzero_si128()), 52);
+		const __m128i hi = _mm_slli_epi64(_mm_unpackhi_epi32(e, _mm_setzero_si128()), 52);
+		return _mm256_castsi256_pd(_mm256_insertf128_si256(_mm256_castsi128_si256(lo), hi, 1));
+	}
+
+	//! floor(log2(x)) for normal positive x
+	static V exponent(V x) {
+		const __m128i lo = _mm_srli_epi64(_mm256_castsi256_si128(_mm256_castpd_si256(x)), 52);
+		const __m128i hi = _mm_srli_epi64(_mm256_extractf128_si256(_mm256_castpd_si256(x), 1), 52);
+		const V e = _mm256_castsi256_pd(_mm256_insertf128_si256(_mm256_castsi128_si256(lo), hi, 1));
+		// 2^52 + e - (2^52 + 1023)
+		const V magic = _mm256_castsi256_pd(_mm256_set1_epi64x(0x4330000000000000LL));
+		return _mm256_sub_pd(_mm256_or_pd(e, magic), _mm256_set1_pd(4503599627371519.0));
+	}
+	//! x / 2^exponent(x), in [1, 2)
+	static V mantissa(V x) {
+		const V mask = _mm256_castsi256_pd(_mm256_set1_epi64x(0x000fffffffffffffLL));
+		return _mm256_or_pd(_mm256_and_pd(x, mask), _mm256_set1_pd(1.0));
+	}
+};
+
+#else
+
+struct SimdD {
+	typedef __m128d V;
+	enum { width = 2 };
+
+	static V load(const double *p) { return _mm_loadu_pd(p); }
+	static void store(double *p, V v) { _mm_storeu_pd(p, v); }
+	static V set1(double d) { return _mm_set1_pd(d); }
+	static V zero(void) { return _mm_setzero_pd(); }
+
+	static V add(V a, V b) { return _mm_add_pd(a, b); }
+	static V sub(V a, V b) { return _mm_sub_pd(a, b); }
+	static V mul(V a, V b) { return _mm_mul_pd(a, b); }
+	static V div(V a, V b) { return _mm_div_pd(a, b); }
+	static V sqrt(V a) { return _mm_sqrt_pd(a); }
+	static V min(V a, V b) { return _mm_min_pd(a, b); }
+	static V max(V a, V b) { return _mm_max_pd(a, b); }
+
+	static V eq(V a, V b) { return _mm_cmpeq_pd(a, b); }
+	static V lt(V a, V b) { return _mm_cmplt_pd(a, b); }
+	static V le(V a, V b) { return _mm_cmple_pd(a, b); }
+	static V gt(V a, V b) { return _mm_cmpgt_pd(a, b); }
+	static V and_(V a, V b) { return _mm_and_pd(a, b); }
+	static V or_(V a, V b) { return _mm_or_pd(a, b); }
+	static V xor_(V a, V b) { return _mm_xor_pd(a, b); }
+	static V andnot(V a, V b) { return _mm_andnot_pd(a, b); }
+
+	//! mask ? a : b
+	static V select(V mask, V a, V b) { return _mm_or_pd(_mm_and_pd(mask, a), _mm_andnot_pd(mask, b)); }
+	//! One bit per lane, set where mask is true
+	static int movemask(V mask) { return _mm_movemask_pd(mask); }
+
+	//! 2^n for integral n in [-1022, 1023]
+	static V pow2n(V n) {
+		const __m128i e = _mm_add_epi32(_mm_cvtpd_epi32(n), _mm_set1_epi32(1023));
+		return _mm_castsi128_pd(_mm_slli_epi64(_mm_unpacklo_epi32(e, _mm_setzero_si128()), 52));
+	}
+
+	//! floor(log2(x)) for normal positive x
+	static V exponent(V x) {
+		const V e = _mm_castsi128_pd(_mm_srli_epi64(_mm_castpd_si128(x), 52));
+		// 2^52 + e - (2^52 + 1023)
+		const V magic = _mm_castsi128_pd(_mm_set_epi32(0x43300000, 0, 0x43300000, 0));
+		return _mm_sub_pd(_mm_or_pd(e, magic), _mm_set1_pd(4503599627371519.0));
+	}
+	//! x / 2^exponent(x), in [1, 2)
+	static V mantissa(V x) {
+		const V mask = _mm_castsi128_pd(_mm_set_epi32(0x000fffff, 0xffffffff, 0x000fffff, 0xffffffff));
+		return _mm_or_pd(_mm_and_pd(x, mask), _mm_set1_pd(1.0));
+	}
+};
+
+#endif
+
+//! Absolute value
+inline SimdD::V abs(SimdD::V x)
+{
+	return SimdD::andnot(SimdD::set1(-0.0), x);
+}
+
+//! Multiply-add a*b+c
+inline SimdD::V madd(SimdD::V a, SimdD::V b, SimdD::V c)
+{
+	return SimdD::add(SimdD::mul(a, b), c);
+}
+
+//! Round to the nearest integer, for |x| < 2^51
+inline SimdD::V round(SimdD::V x)
+{
+	const SimdD::V magic = SimdD::set1(6755399441055744.0);   // 1.5 * 2^52
+	return SimdD::sub(SimdD::add(x, magic), magic);
+}
+
+//! Vectorized sin and cos, after the Cephes sin() and cos(): reduction to
+//! [-pi/4, pi/4] in three parts and the same polynomials. Accurate to about
+//! 1 ulp for |x| < 1e8, with slowly growing error beyond.
+inline void sincos(SimdD::V x, SimdD::V &s, SimdD::V &c)
+{
+	typedef SimdD S;
+	const S::V k = round(S::mul(x, S::set1(M_2_PI)));
+	S::V r = S::sub(x, S::mul(k, S::set1(1.57079625129699707031E0)));
+	r = S::sub(r, S::mul(k, S::set1(7.54978941586159635335E-8)));
+	r = S::sub(r, S::mul(k, S::set1(5.39030252995776476554E-15)));
+
+	// quadrant k mod 4; floor(k/4) == round(k/4 - 3/8) as k is integral
+	const S::V q = S::sub(k, S::mul(S::set1(4.0), round(S::sub(S::mul(k, S::set1(0.25)), S::set1(0.375)))));
+
+	const S::V z = S::mul(r, r);
+	S::V ps = S::set1(1.58962301576546568060E-10);
+	ps = madd(ps, z, S::set1(-2.50507477628578072866E-8));
+	ps = madd(ps, z, S::set1(2.75573136213857245213E-6));
+	ps = madd(ps, z, S::set1(-1.98412698295895385996E-4));
+	ps = madd(ps, z, S::set1(8.33333333332211858878E-3));
+	ps = madd(ps, z, S::set1(-1.66666666666666307295E-1));
+	const S::V sin_r = madd(S::mul(r, z), ps, r);
+
+	S::V pc = S::set1(-1.13585365213876817300E-11);
+	pc = madd(pc, z, S::set1(2.08757008419747316778E-9));
+	pc = madd(pc, z, S::set1(-2.75573141792967388112E-7));
+	pc = madd(pc, z, S::set1(2.48015872888517045348E-5));
+	pc = madd(pc, z, S::set1(-1.38888888888730564116E-3));
+	pc = madd(pc, z, S::set1(4.16666666666665929218E-2));
+	const S::V cos_r = madd(S::mul(z, z), pc, S::sub(S::set1(1.0), S::mul(S::set1(0.5), z)));
+
+	// quadrants 1 and 3 swap sin and cos, 2 and 3 negate sin, 1 and 2 negate cos
+	const S::V odd = S::or_(S::eq(q, S::set1(1.0)), S::eq(q, S::set1(3.0)));
+	const S::V sin_neg = S::and_(S::gt(q, S::set1(1.5)), S::set1(-0.0));
+	const S::V cos_neg = S::and_(S::and_(S::gt(q, S::set1(0.5)), S::lt(q, S::set1(2.5))), S::set1(-0.0));
+	s = S::xor_(S::select(odd, cos_r, sin_r), sin_neg);
+	c = S::xor_(S::select(odd, sin_r, cos_r), cos_neg);
+}
+
+//! Vectorized exp, after the Cephes exp() rational approximation.
+//! The argument is clamped to [-708, 709].
+inline SimdD::V exp(SimdD::V x)
+{
+	typedef SimdD S;
+	x = S::min(S::max(x, S::set1(-708.0)), S::set1(709.0));
+	const S::V n = round(S::mul(x, S::set1(1.4426950408889634073599)));   // log2(e)
+	x = S::sub(x, S::mul(n, S::set1(6.93145751953125E-1)));
+	x = S::sub(x, S::mul(n, S::set1(1.42860682030941723212E-6)));
+
+	const S::V xx = S::mul(x, x);
+	S::V p = S::set1(1.26177193074810590878E-4);
+	p = madd(p, xx, S::set1(3.02994407707441961300E-2));
+	p = madd(p, xx, S::set1(9.99999999999999999910E-1));
+	p = S::mul(p, x);
+	S::V q = S::set1(3.00198505138664455042E-6);
+	q = madd(q, xx, S::set1(2.52448340349684104192E-3));
+	q = madd(q, xx, S::set1(2.27265548208155028766E-1));
+	q = madd(q, xx, S::set1(2.00000000000000000009E0));
+	const S::V e = madd(S::set1(2.0), S::div(p, S::sub(q, p)), S::set1(1.0));
+
+	// 2^n in two steps so that n = 1023 + 1 does not overflow the exponent
+	const S::V n1 = round(S::mul(n, S::set1(0.5)));
+	return S::mul(S::mul(e, S::pow2n(n1)), S::pow2n(S::sub(n, n1)));
+}
+
+//! Vectorized atan, after the Cephes atan() range reduction and rational
+//! approximation. Maximum relative error is about 2e-16, i.e. the same as
+//! the libm function for practical purposes.
+inline SimdD::V atan(SimdD::V x)
+{
+	typedef SimdD S;
+	const S::V sign = S::and_(x, S::set1(-0.0));
+	S::V ax = abs(x);
+
+	// Reduce to |x| <= 0.66
+	const S::V big = S::gt(ax, S::set1(2.41421356237309504880));   // tan(3pi/8)
+	const S::V mid = S::andnot(big, S::gt(ax, S::set1(0.66)));
+	S::V y = S::select(big, S::set1(M_PI_2), S::select(mid, S::set1(M_PI_4), S::zero()));
+	const S::V more = S::select(big, S::set1(6.123233995736765886130E-17),
+	                            S::select(mid, S::set1(3.061616997868382943065E-17), S::zero()));
+	ax = S::select(big, S::div(S::set1(-1.0), ax),
+	               S::select(mid, S::div(S::sub(ax, S::set1(1.0)), S::add(ax, S::set1(1.0))), ax));
+
+	const S::V z = S::mul(ax, ax);
+	S::V p = S::set1(-8.750608600031904122785E-1);
+	p = madd(p, z, S::set1(-1.615753718733365076637E1));
+	p = madd(p, z, S::set1(-7.500855792314704667340E1));
+	p = madd(p, z, S::set1(-1.228866684490136173410E2));
+	p = madd(p, z, S::set1(-6.485021904942025371773E1));
+	S::V q = S::add(z, S::set1(2.485846490142306297962E1));
+	q = madd(q, z, S::set1(1.650270098316988542046E2));
+	q = madd(q, z, S::set1(4.328810604912902668951E2));
+	q = madd(q, z, S::set1(4.853903996359136964868E2));
+	q = madd(q, z, S::set1(1.945506571482613964425E2));
+
+	const S::V r = madd(ax, S::div(S::mul(z, p), q), ax);
+	y = S::add(y, S::add(r, more));
+	return S::or_(y, sign);
+}
+
+// The following are only as accurate as single precision results need,
+// for models computed in float such as the sky brightness.
+
+//! exp without division: Taylor polynomial of degree 7 on [-ln2/2, ln2/2],
+//! relative error below 3e-9. The argument is clamped to [-708, 709].
+inline SimdD::V exp_fast(SimdD::V x)
+{
+	typedef SimdD S;
+	x = S::min(S::max(x, S::set1(-708.0)), S::set1(709.0));
+	const S::V n = round(S::mul(x, S::set1(1.4426950408889634073599)));   // log2(e)
+	x = S::sub(x, S::mul(n, S::set1(6.93145751953125E-1)));
+	x = S::sub(x, S::mul(n, S::set1(1.42860682030941723212E-6)));
+
+	S::V p = S::set1(1.0/5040);
+	p = madd(p, x, S::set1(1.0/720));
+	p = madd(p, x, S::set1(1.0/120));
+	p = madd(p, x, S::set1(1.0/24));
+	p = madd(p, x, S::set1(1.0/6));
+	p = madd(p, x, S::set1(0.5));
+	p = madd(p, x, S::set1(1.0));
+	p = madd(p, x, S::set1(1.0));
+	return S::mul(p, S::pow2n(n));
+}
+
+//! 10^x with exp_fast
+inline SimdD::V exp10_fast(SimdD::V x)
+{
+	return exp_fast(SimdD::mul(x, SimdD::set1(2.30258509299404568402)));
+}
+
+//! Natural logarithm for normal positive x, from the series in
+//! s = (m-1)/(m+1) of the mantissa m in [sqrt(1/2), sqrt(2)): absolute
+//! error below 1e-9. 0 gives about -709.
+inline SimdD::V log_fast(SimdD::V x)
+{
+	typedef SimdD S;
+	const S::V one = S::set1(1.0);
+	S::V e = S::exponent(x);
+	S::V m = S::mantissa(x);
+	const S::V big = S::gt(m, S::set1(M_SQRT2));
+	m = S::select(big, S::mul(m, S::set1(0.5)), m);
+	e = S::add(e, S::and_(big, one));
+
+	const S::V s = S::div(S::sub(m, one), S::add(m, one));
+	const S::V z = S::mul(s, s);
+	S::V p = S::set1(1.0/9);
+	p = madd(p, z, S::set1(1.0/7));
+	p = madd(p, z, S::set1(1.0/5));
+	p = madd(p, z, S::set1(1.0/3));
+	p = madd(p, z, one);
+	return madd(e, S::set1(M_LN2), S::mul(S::add(s, s), p));
+}
+
+//! acos for x in [-1, 1], Abramowitz and Stegun 4.4.46: absolute error
+//! below 2e-8
+inline SimdD::V acos_fast(SimdD::V x)
+{
+	typedef SimdD S;
+	const S::V ax = abs(x);
+	S::V p = S::set1(-0.0012624911);
+	p = madd(p, ax, S::set1(0.0066700901));
+	p = madd(p, ax, S::set1(-0.0170881256));
+	p = madd(p, ax, S::set1(0.0308918810));
+	p = madd(p, ax, S::set1(-0.0501743046));
+	p = madd(p, ax, S::set1(0.0889789874));
+	p = madd(p, ax, S::set1(-0.2145988016));
+	p = madd(p, ax, S::set1(1.5707963050));
+	p = S::mul(p, S::sqrt(S::sub(S::set1(1.0), ax)));
+	// acos(-x) = pi - acos(x)
+	return S::select(S::lt(x, S::zero()), S::sub(S::set1(M_PI), p), p);
+}
+
+} // namespace SimdMath
+
+#endif // HAVE_SIMD_DOUBLE
+
+#endif // _SIMD_MATH_H_
@@ -27,6 +27,7 @@
 
 #include "skybright.h"
 #include "nightshade.h"
+#include "simd_math.h"
 
 Skybright::Skybright() : SN(1.f)
 {
@@ -92,13 +93,13 @@ void Skybright::set_sun_moon(float cos_dist_moon_zenith, float cos_dist_sun_zeni
 // Inputs : cos_dist_moon = cos(angular distance between moon and the position)
 //			cos_dist_sun  = cos(angular distance between sun  and the position)
 //			cos_dist_zenith = cos(angular distance between zenith and the position)
-float Skybright::get_luminance(float cos_dist_moon, float cos_dist_sun, float cos_dist_zenith)
+float Skybright::get_luminance(float cos_dist_moon, float cos_dist_sun, float cos_dist_zenith) const
 {
 
 	// catch rounding errors here or end up with white flashes in some cases
 	if (cos_dist_moon < -1.f ) cos_dist_moon = -1.f;
 	if (cos_dist_moon > 1.f ) cos_dist_moon = 1.f;
-	if (cos_dist_sun < -1.f ) cos_dist_moon = -1.f;
+	if (cos_dist_sun < -1.f ) cos_dist_sun = -1.f;
 	if (cos_dist_sun > 1.f ) cos_dist_sun = 1.f;
 	if (cos_dist_zenith < -1.f ) cos_dist_zenith = -1.f;
 	if (cos_dist_zenith > 1.f ) cos_dist_zenith = 1.f;
@@ -111,16 +112,16 @@ float Skybright::get_luminance(float cos_dist_moon, float cos_dist_sun, float co
 	float bKX = pow10(-0.4f * K * X);
 
 	// Dark night sky brightness
-	b_night = 0.4f+0.6f/sqrtf(0.04f + 0.96f * cos_dist_zenith*cos_dist_zenith);
+	float b_night = 0.4f+0.6f/sqrtf(0.04f + 0.96f * cos_dist_zenith*cos_dist_zenith);
 	b_night *= b_night_term * bKX;
 
 	// Moonlight brightness
 	float FM = 18886.28 / (dist_moon*dist_moon + 0.0007f) + pow10(6.15f - (dist_moon+0.001) * 1.43239f);
 	FM += 229086.77f * ( 1.06f + cos_dist_moon*cos_dist_moon );
-	b_moon = b_moon_term1 * (1.f - bKX) * (FM * C3 + 440000.f * (1.f - C3));
+	float b_moon = b_moon_term1 * (1.f - bKX) * (FM * C3 + 440000.f * (1.f - C3));
 
 	//Twilight brightness
-	b_twilight = pow10(b_twilight_term + 0.063661977f * acosf(cos_dist_zenith)/K) *
+	float b_twilight = pow10(b_twilight_term + 0.063661977f * acosf(cos_dist_zenith)/K) *
 	             (1.7453293f / dist_sun) * (1.f-bKX);
 
 	// Daylight brightness
@@ -135,9 +136,10 @@ float Skybright::get_luminance(float cos_dist_moon, float cos_dist_sun, float co
 #endif
 
 	FS += 229086.77f * ( 1.06f + cos_dist_sun*cos_dist_sun );
-	b_daylight = 9.289663e-12 * (1.f - bKX) * (FS * C4 + 440000.f * (1.f - C4));
+	float b_daylight = 9.289663e-12 * (1.f - bKX) * (FS * C4 + 440000.f * (1.f - C4));
 
 	// Total sky brightness
+	double b_total;
 	b_daylight>b_twilight ? b_total = b_night + b_twilight + b_moon : b_total = b_night + b_daylight + b_moon;
 
 	return (b_total<0.f) ? 0.f : b_total/1.11E-15 * 1E-5/M_PI; // cd/m^2
@@ -146,6 +148,84 @@ float Skybright::get_luminance(float cos_dist_moon, float cos_dist_sun, float co
 	//// In cd/m^2 : the 32393895 is empirical term because the
 	// lambert -> cd/m^2 formula seems to be wrong...
 }
+#ifdef HAVE_SIMD_DOUBLE
+
+// Same formulas as get_luminance, in double precision lanes
+void Skybright::get_luminance_lanes(const double *cos_dist_moon, const double *cos_dist_sun,
+                                    const double *cos_dist_zenith, double *luminance) const
+{
+	typedef SimdMath::SimdD S;
+	const S::V one = S::set1(1.0), minus_one = S::set1(-1.0);
+	const S::V cm = S::min(S::max(S::load(cos_dist_moon), minus_one), one);
+	const S::V cs = S::min(S::max(S::load(cos_dist_sun), minus_one), one);
+	const S::V cz = S::min(S::max(S::load(cos_dist_zenith), minus_one), one);
+
+	const S::V dist_moon = SimdMath::acos_fast(cm);
+	const S::V dist_sun = SimdMath::acos_fast(cs);
+
+	// Air mass
+	const S::V X = S::div(one, SimdMath::madd(S::set1(0.025), SimdMath::exp_fast(S::mul(S::set1(-11.0), cz)), cz));
+	const S::V bKX = SimdMath::exp10_fast(S::mul(S::set1(-0.4*K), X));
+	const S::V one_minus_bKX = S::sub(one, bKX);
+
+	// Dark night sky brightness
+	S::V b_night = S::add(S::set1(0.4), S::div(S::set1(0.6),
+	                      S::sqrt(SimdMath::madd(S::set1(0.96), S::mul(cz, cz), S::set1(0.04)))));
+	b_night = S::mul(b_night, S::mul(S::set1(b_night_term), bKX));
+
+	// Moonlight brightness
+	S::V FM = S::div(S::set1(18886.28), SimdMath::madd(dist_moon, dist_moon, S::set1(0.0007)));
+	FM = S::add(FM, SimdMath::exp10_fast(S::sub(S::set1(6.15), S::mul(S::add(dist_moon, S::set1(0.001)), S::set1(1.43239)))));
+	FM = SimdMath::madd(S::set1(229086.77), SimdMath::madd(cm, cm, S::set1(1.06)), FM);
+	const S::V b_moon = S::mul(S::mul(S::set1(b_moon_term1), one_minus_bKX),
+	                           SimdMath::madd(FM, S::set1(C3), S::set1(440000.0*(1.0-C3))));
+
+	// Twilight brightness
+	const S::V b_twilight = S::mul(S::mul(SimdMath::exp10_fast(SimdMath::madd(S::set1(0.063661977/K), SimdMath::acos_fast(cz),
+	                                      S::set1(b_twilight_term))), S::div(S::set1(1.7453293), dist_sun)), one_minus_bKX);
+
+	// Daylight brightness
+#ifdef LSS
+	S::V FS = S::div(S::set1(18886.28), S::add(dist_sun, S::set1(0.0007)));
+#else
+	S::V FS = S::div(S::set1(18886.28), SimdMath::madd(S::mul(dist_sun, dist_sun), S::set1(1.5), S::set1(0.0007)));
+#endif
+	FS = S::add(FS, SimdMath::exp10_fast(S::sub(S::set1(6.15), S::mul(S::add(dist_sun, S::set1(0.001)), S::set1(1.43239)))));
+	FS = SimdMath::madd(S::set1(229086.77), SimdMath::madd(cs, cs, S::set1(1.06)), FS);
+	const S::V b_daylight = S::mul(S::mul(S::set1(9.289663e-12), one_minus_bKX),
+	                               SimdMath::madd(FS, S::set1(C4), S::set1(440000.0*(1.0-C4))));
+
+	// Total sky brightness, in cd/m^2
+	const S::V b_total = S::add(S::add(b_night, b_moon), S::min(b_daylight, b_twilight));
+	S::store(luminance, S::mul(S::max(b_total, S::zero()), S::set1(1E-5/1.11E-15/M_PI)));
+}
+
+#endif
+
+void Skybright::get_luminances(const double *cos_dist_moon, const double *cos_dist_sun,
+                               const double *cos_dist_zenith, float *luminance, int n) const
+{
+#ifdef HAVE_SIMD_DOUBLE
+	const int W = SimdMath::SimdD::width;
+	double cm[W], cs[W], cz[W], lum[W];
+	for (int i=0; i<n; i+=W) {
+		// the last lanes of the tail repeat its last position
+		for (int k=0; k<W; k++) {
+			const int j = (i+k < n) ? i+k : n-1;
+			cm[k] = cos_dist_moon[j];
+			cs[k] = cos_dist_sun[j];
+			cz[k] = cos_dist_zenith[j];
+		}
+		get_luminance_lanes(cm, cs, cz, lum);
+		for (int k=0; k<W && i+k<n; k++) luminance[i+k] = lum[k];
+	}
+#else
+	for (int i=0; i<n; i++) {
+		luminance[i] = get_luminance(cos_dist_moon[i], cos_dist_sun[i], cos_dist_zenith[i]);
+	}
+#endif
+}
+
 /*
 250 REM  Visual limiting magnitude
 260 BL=B(3)/1.11E-15 : REM in nanolamberts*/
@@ -48,17 +48,20 @@ public:
 	// Inputs : cos_dist_moon = cos(angular distance between moon and the position)
 	//			cos_dist_sun  = cos(angular distance between sun  and the position)
 	//			cos_dist_zenith = cos(angular distance between zenith and the position)
-	float get_luminance(float cos_dist_moon, float cos_dist_sun, float cos_dist_zenith);
+	float get_luminance(float cos_dist_moon, float cos_dist_sun, float cos_dist_zenith) const;
+
+	// get_luminance for n positions, vectorized where the processor allows
+	void get_luminances(const double *cos_dist_moon, const double *cos_dist_sun,
+	                    const double *cos_dist_zenith, float *luminance, int n) const;
 
 private:
+	// get_luminances for SimdD::width positions
+	void get_luminance_lanes(const double *cos_dist_moon, const double *cos_dist_sun,
+	                         const double *cos_dist_zenith, double *luminance) const;
+
 	float air_mass_moon;	// Air mass for the Moon
 	float air_mass_sun;		// Air mass for the Sun
 
-	double b_total;			// Total brightness
-	float b_night;			// Dark night brightness
-	float b_twilight;		// Twilight brightness
-	float b_daylight;		// Daylight sky brightness
-	float b_moon;			// Moon brightness
 	float mag_moon;			// Moon magnitude
 
 	float RA;				// Something related with date
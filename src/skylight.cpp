@@ -31,6 +31,7 @@
 
 #include "fmath.h"
 #include "skylight.h"
+#include "simd_math.h"
 
 Skylight::Skylight() : thetas(0.f), T(0.f)
 {
@@ -205,6 +206,82 @@ void Skylight::get_xyY_valuev(skylight_struct2& p) const
 	}
 }
 
+#ifdef HAVE_SIMD_DOUBLE
+
+// Same formulas as get_xyY_valuev, in double precision lanes
+void Skylight::get_xyY_lanes(const double *pos_x, const double *pos_y, const double *pos_z,
+                             double *color_x, double *color_y, double *color_Y) const
+{
+	typedef SimdMath::SimdD S;
+	const S::V one = S::set1(1.0);
+	const S::V x = S::load(pos_x), y = S::load(pos_y), z = S::load(pos_z);
+
+	S::V cos_dist_sun = SimdMath::madd(S::set1(sun_pos[0]), x,
+	                    SimdMath::madd(S::set1(sun_pos[1]), y, S::mul(S::set1(sun_pos[2]), z)));
+	cos_dist_sun = S::min(S::max(cos_dist_sun, S::set1(-1.0)), one);
+	const S::V dist_sun = SimdMath::acos_fast(cos_dist_sun);
+	const S::V cos_dist_sun_q = S::mul(cos_dist_sun, cos_dist_sun);
+
+	// the exponentials of the zenith angle are 0 at and below the horizon
+	const S::V above = S::gt(z, S::zero());
+	const S::V one_over_cos_zenith_angle = S::div(one, S::select(above, z, one));
+	const S::V Fx = S::and_(above, SimdMath::exp_fast(S::mul(S::set1(Bx), one_over_cos_zenith_angle)));
+	const S::V Fy = S::and_(above, SimdMath::exp_fast(S::mul(S::set1(By), one_over_cos_zenith_angle)));
+	const S::V FY = S::and_(above, SimdMath::exp_fast(S::mul(S::set1(BY), one_over_cos_zenith_angle)));
+
+	S::V cx = S::mul(S::mul(S::set1(term_x), SimdMath::madd(S::set1(Ax), Fx, one)),
+	                 SimdMath::madd(S::set1(Cx), SimdMath::exp_fast(S::mul(S::set1(Dx), dist_sun)),
+	                                SimdMath::madd(S::set1(Ex), cos_dist_sun_q, one)));
+	S::V cy = S::mul(S::mul(S::set1(term_y), SimdMath::madd(S::set1(Ay), Fy, one)),
+	                 SimdMath::madd(S::set1(Cy), SimdMath::exp_fast(S::mul(S::set1(Dy), dist_sun)),
+	                                SimdMath::madd(S::set1(Ey), cos_dist_sun_q, one)));
+	S::V cY = S::mul(S::mul(S::set1(term_Y), SimdMath::madd(S::set1(AY), FY, one)),
+	                 SimdMath::madd(S::set1(CY), SimdMath::exp_fast(S::mul(S::set1(DY), dist_sun)),
+	                                SimdMath::madd(S::set1(EY), cos_dist_sun_q, one)));
+
+	const S::V negative = S::or_(S::lt(cY, S::zero()), S::or_(S::lt(cx, S::zero()), S::lt(cy, S::zero())));
+	S::store(color_x, S::select(negative, S::set1(0.25), cx));
+	S::store(color_y, S::select(negative, S::set1(0.25), cy));
+	S::store(color_Y, S::andnot(negative, cY));
+}
+
+#endif
+
+void Skylight::get_xyY_valuesv(const double *pos_x, const double *pos_y, const double *pos_z,
+                               float *color_x, float *color_y, float *color_Y, int n) const
+{
+#ifdef HAVE_SIMD_DOUBLE
+	const int W = SimdMath::SimdD::width;
+	double px[W], py[W], pz[W], cx[W], cy[W], cY[W];
+	for (int i=0; i<n; i+=W) {
+		// the last lanes of the tail repeat its last position
+		for (int k=0; k<W; k++) {
+			const int j = (i+k < n) ? i+k : n-1;
+			px[k] = pos_x[j];
+			py[k] = pos_y[j];
+			pz[k] = pos_z[j];
+		}
+		get_xyY_lanes(px, py, pz, cx, cy, cY);
+		for (int k=0; k<W && i+k<n; k++) {
+			color_x[i+k] = cx[k];
+			color_y[i+k] = cy[k];
+			color_Y[i+k] = cY[k];
+		}
+	}
+#else
+	skylight_struct2 p;
+	for (int i=0; i<n; i++) {
+		p.pos[0] = pos_x[i];
+		p.pos[1] = pos_y[i];
+		p.pos[2] = pos_z[i];
+		get_xyY_valuev(p);
+		color_x[i] = p.color[0];
+		color_y[i] = p.color[1];
+		color_Y[i] = p.color[2];
+	}
+#endif
+}
+
 /*
 void Skylight::get_xyY_valuev(skylight_struct2& p)
 {
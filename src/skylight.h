@@ -57,6 +57,11 @@ public:
 	void set_paramsv(const float * sun_pos, float turbidity);
 	void get_xyY_valuev(skylight_struct2& position) const;
 
+	// get_xyY_valuev for n positions given as arrays of their coordinates,
+	// vectorized where the processor allows
+	void get_xyY_valuesv(const double *pos_x, const double *pos_y, const double *pos_z,
+	                     float *color_x, float *color_y, float *color_Y, int n) const;
+
 private:
 	float thetas;			// angular distance between the zenith and the sun in radian
 	float T;				// Turbidity : i.e. sky "clarity"
@@ -84,6 +89,10 @@ private:
 
 	float sun_pos[3];
 
+	// get_xyY_valuesv for SimdD::width positions
+	void get_xyY_lanes(const double *pos_x, const double *pos_y, const double *pos_z,
+	                   double *color_x, double *color_y, double *color_Y) const;
+
 	// Compute CIE Y (luminance) for zenith in cd/m^2
 	inline void compute_zenith_luminance(void);
 	// Compute CIE x and y color components
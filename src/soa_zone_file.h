@@ -0,0 +1,106 @@
+/*
+ * Nightshade (TM) astronomy simulation and visualization
+ *
+ * Copyright (C) 2012 Digitalis Education Solutions, Inc.
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 3
+ * of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place - Suite 330, Boston, MA  02111-1307, USA.
+ *
+ * Nightshade is a trademark of Digitalis Education Solutions, Inc.
+ * See the TRADEMARKS file for trademark usage requirements.
+ *
+ */
+
+// Layout of the structure-of-arrays star catalogues written by
+// nightshade-convert-stars and mapped as they are by SoaZoneArray.
+//
+// The file is in the byte order of the machine that wrote it:
+//   SoaFileHeader                      64 bytes
+//   SoaZone[nr_of_zones]               padded to SOA_FILE_ALIGN
+//   Int32 x0[nr_of_slots]              padded to SOA_FILE_ALIGN
+//   Int32 x1[nr_of_slots]              padded to SOA_FILE_ALIGN
+//   Int16 dx0[nr_of_slots]             only with proper motions, padded
+//   Int16 dx1[nr_of_slots]             only with proper motions, padded
+//   unsigned char mag[nr_of_slots]     padded to SOA_FILE_ALIGN
+//   unsigned char b_v[nr_of_slots]     padded to SOA_FILE_ALIGN
+//
+// Each zone starts at a multiple of SOA_ZONE_ALIGN slots, so that its
+// coordinates are 64 byte aligned. The unused slots are zero.
+// The zone axes are stored already multiplied by star_position_scale,
+// which is itself already divided by the max_pos_val of the star type.
+
+#ifndef _SOA_ZONE_FILE_H_
+#define _SOA_ZONE_FILE_H_
+
+#include <cstddef>
+
+namespace BigStarCatalogExtension {
+
+#define FILE_MAGIC_SOA 0x835f040c
+#define FILE_MAGIC_SOA_OTHER_ENDIAN 0x0c045f83
+#define SOA_FILE_VERSION 1
+#define SOA_FILE_ALIGN 64
+#define SOA_ZONE_ALIGN 16
+
+struct SoaFileHeader {
+  unsigned int magic;
+  unsigned int type;         // 1 or 2, as in the legacy catalogues
+  unsigned int major;
+  unsigned int minor;
+  unsigned int level;
+  unsigned int mag_min;
+  unsigned int mag_range;
+  unsigned int mag_steps;
+  unsigned int nr_of_zones;
+  unsigned int nr_of_stars;
+  unsigned int nr_of_slots;  // nr_of_stars plus the zone padding
+  unsigned int proper_motion;
+  double star_position_scale;
+  double reserved;
+};
+
+struct SoaZone {
+  double center[3];
+  double axis0[3];           // already scaled
+  double axis1[3];           // already scaled
+  unsigned int first;        // first slot of the zone
+  unsigned int size;
+};
+
+static inline size_t SoaAlign(size_t offset) {
+  return (offset + (SOA_FILE_ALIGN-1)) & ~(size_t)(SOA_FILE_ALIGN-1);
+}
+
+  // Offsets of the arrays in the file
+struct SoaFileLayout {
+  SoaFileLayout(const SoaFileHeader &h) {
+    zones = SoaAlign(sizeof(SoaFileHeader));
+    x0 = SoaAlign(zones + h.nr_of_zones*sizeof(SoaZone));
+    x1 = SoaAlign(x0 + h.nr_of_slots*4);
+    dx0 = dx1 = SoaAlign(x1 + h.nr_of_slots*4);
+    if (h.proper_motion) {
+      dx1 = SoaAlign(dx0 + h.nr_of_slots*2);
+      mag = SoaAlign(dx1 + h.nr_of_slots*2);
+    } else {
+      mag = dx0;
+    }
+    b_v = SoaAlign(mag + h.nr_of_slots);
+    size = SoaAlign(b_v + h.nr_of_slots);
+  }
+  size_t zones,x0,x1,dx0,dx1,mag,b_v,size;
+};
+
+} // namespace BigStarCatalogExtension
+
+#endif // _SOA_ZONE_FILE_H_
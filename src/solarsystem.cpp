@@ -26,14 +26,20 @@
 using namespace std;
 
 #include <algorithm>
+#include <iomanip>
 #include <iostream>
+#include <sstream>
 #include <string>
 #include "solarsystem.h"
 #include "s_texture.h"
 #include "orbit.h"
+#include "orbit_sampler.h"
+#include "minor_body_mgr.h"
+#include "ephemeris_cache.h"
 #include "nightshade.h"
 #include "draw.h"
 #include "utility.h"
+#include "name_index.h"
 #include <boost/property_tree/ptree.hpp>
 #include <boost/property_tree/ini_parser.hpp>
 #include <boost/foreach.hpp>
@@ -41,9 +47,28 @@ using namespace std;
 
 SolarSystem::SolarSystem()
 	:sun(NULL),moon(NULL),earth(NULL),
-	 moonScale(1.), planet_name_font(NULL), tex_earth_shadow(NULL),
-	 flagOrbits(false),flag_light_travel_time(false),flagHints(false),flagTrails(false)
+	 moonScale(1.), planet_name_font(NULL), minor_bodies(NULL), last_date(J2000), ephemeris_cache(NULL),
+	 tex_earth_shadow(NULL),
+	 flagOrbits(false),flag_light_travel_time(false),flagHints(false),flagTrails(false),
+	 flagWaitOrbitSamples(false)
 {
+	orbit_sampler = new OrbitSampler(0);
+	Planet::setOrbitSampler(orbit_sampler);
+}
+
+// Number of threads computing orbit lines, see OrbitSampler
+void SolarSystem::setOrbitSamplingThreads(int nb_threads)
+{
+	// pending jobs are handed back before the planets lose their sampler
+	orbit_sampler->flush();
+	delete orbit_sampler;
+	orbit_sampler = new OrbitSampler(nb_threads);
+	Planet::setOrbitSampler(orbit_sampler);
+}
+
+unsigned int SolarSystem::getOrbitPointsLastFrame(void) const
+{
+	return orbit_sampler->getPointsLastFrame();
 }
 
 void SolarSystem::setFont(float font_size, const string& font_name)
@@ -70,6 +95,11 @@ SolarSystem::~SolarSystem()
 	moon = NULL;
 	earth = NULL;
 
+	Planet::setOrbitSampler(NULL);
+	delete orbit_sampler;
+	if (minor_bodies) delete minor_bodies;
+	if (ephemeris_cache) delete ephemeris_cache;
+
 	if (planet_name_font) delete planet_name_font;
 	if (tex_earth_shadow) delete tex_earth_shadow;
 }
@@ -478,6 +508,8 @@ string SolarSystem::addBody(stringHash_t & param, bool deletable)
 		p->setFlagOrbit(getFlagOrbits());
 	}
 
+	if (ephemeris_cache && p->getOrbit()) p->getOrbit()->setEphemerisCache(ephemeris_cache);
+
 	system_planets.push_back(p);
 
 	planetHash[englishName] = p;
@@ -593,6 +625,9 @@ string SolarSystem::removeSupplementalBodies(const Planet *home_planet)
 // The order is not important since the position is computed relatively to the mother body
 void SolarSystem::computePositions(double date,const Planet *home_planet)
 {
+	// swap in the orbit points finished since the last frame
+	if (!flagWaitOrbitSamples) orbit_sampler->collect();
+
 	if (flag_light_travel_time) {
 		for (vector<Planet*>::const_iterator iter(system_planets.begin());
 		        iter!=system_planets.end(); iter++) {
@@ -617,6 +652,12 @@ void SolarSystem::computePositions(double date,const Planet *home_planet)
 
 	computeTransMatrices(date, home_planet);
 
+	// swap in the orbit points queued for this date
+	if (flagWaitOrbitSamples) orbit_sampler->flush();
+
+	last_date = date;
+	if (minor_bodies && minor_bodies->getFlagShow() && getFlagPlanets())
+		minor_bodies->computePositions(date, home_planet->get_heliocentric_ecliptic_pos());
 }
 
 // Compute the transformation matrix for every elements of the solar system.
@@ -674,6 +715,9 @@ double SolarSystem::draw(Projector * prj, const Navigator * nav, const ToneRepro
 	glLightfv(GL_LIGHT0,GL_POSITION,Vec4f(0.f,0.f,0.f,1.f));
 	glEnable(GL_LIGHT0);
 
+	// Minor bodies are points behind the planet disks
+	if (minor_bodies) minor_bodies->draw(prj, nav);
+
 	// Compute each Planet distance to the observer
 	Vec3d obs_helio_pos = nav->get_observer_helio_pos();
 
@@ -878,6 +922,148 @@ double SolarSystem::draw(Projector * prj, const Navigator * nav, const ToneRepro
 	return maxSquaredDistance;
 }
 
+// Minor bodies are loaded after ssystem.ini so the Sun exists to be their parent
+void SolarSystem::loadMinorBodies(const string& asteroid_file, const string& comet_file,
+                                  const string& cache_dir, int nb_threads, LoadingBar& lb)
+{
+	if (minor_bodies) delete minor_bodies;
+	minor_bodies = new MinorBodyMgr(nb_threads);
+	minor_bodies->setCacheDir(cache_dir);
+
+	if (!asteroid_file.empty()) minor_bodies->loadAsteroids(asteroid_file, lb);
+	if (!comet_file.empty()) minor_bodies->loadComets(comet_file, lb);
+	cout << "Loaded " << minor_bodies->size() << " minor bodies" << endl;
+
+	if (minor_bodies->size() == 0) {
+		delete minor_bodies;
+		minor_bodies = NULL;
+	}
+}
+
+bool SolarSystem::loadEphemerisCache(const string& file_name)
+{
+	EphemerisCache *cache = new EphemerisCache();
+	if (!cache->load(file_name)) {
+		delete cache;
+		return false;
+	}
+
+	// orbit sampling threads may be reading the orbits
+	orbit_sampler->flush();
+	for (vector<Planet*>::iterator iter = system_planets.begin(); iter != system_planets.end(); ++iter) {
+		if ((*iter)->getOrbit()) (*iter)->getOrbit()->setEphemerisCache(cache);
+	}
+	if (ephemeris_cache) delete ephemeris_cache;
+	ephemeris_cache = cache;
+	return true;
+}
+
+void SolarSystem::setFlagMinorBodies(bool b)
+{
+	if (minor_bodies) minor_bodies->setFlagShow(b);
+}
+
+bool SolarSystem::getFlagMinorBodies(void) const
+{
+	return minor_bodies && minor_bodies->getFlagShow();
+}
+
+void SolarSystem::setMinorBodyMaxMag(float mag)
+{
+	if (minor_bodies) minor_bodies->setMaxMag(mag);
+}
+
+float SolarSystem::getMinorBodyMaxMag(void) const
+{
+	return minor_bodies ? minor_bodies->getMaxMag() : 0;
+}
+
+// Orbital elements need more digits than Utility::doubleToString keeps
+static string ElementString(double d)
+{
+	ostringstream oss;
+	oss << setprecision(17) << d;
+	return oss.str();
+}
+
+int SolarSystem::searchMinorBody(Vec3d v, double lim_fov, const Navigator * nav) const
+{
+	if (!getFlagMinorBodies() || !sun) return -1;
+	return minor_bodies->search(v, lim_fov, nav);
+}
+
+const string& SolarSystem::getMinorBodyName(int index) const
+{
+	return minor_bodies->getName(index);
+}
+
+Vec3d SolarSystem::getMinorBodyEarthEquPos(int index, const Navigator * nav) const
+{
+	return nav->helio_to_earth_equ(minor_bodies->getHelioPos(index));
+}
+
+float SolarSystem::getMinorBodyMag(int index) const
+{
+	return minor_bodies->getMag(index);
+}
+
+// Only one minor body is kept as a Planet at a time: the previous one is
+// removed when another is promoted, unless it is still selected.
+Planet* SolarSystem::promoteMinorBody(int index)
+{
+	if (!minor_bodies || !sun || index < 0) return NULL;
+
+	const string name = minor_bodies->getName(index);
+	Planet *p = searchByEnglishName(name);
+	if (p) return p;
+
+	if (!promoted_minor_body.empty()) {
+		Planet *previous = searchByEnglishName(promoted_minor_body);
+		if (previous && !(selected == Object(previous))) removeBody(promoted_minor_body);
+	}
+
+	stringHash_t param;
+	param["name"] = name;
+	param["parent"] = sun->getEnglishName();
+	param["coord_func"] = "comet_orbit";
+	param["orbit_pericenterdistance"] = ElementString(minor_bodies->getPericenterDistance(index));
+	param["orbit_eccentricity"] = ElementString(minor_bodies->getEccentricity(index));
+	param["orbit_inclination"] = ElementString(minor_bodies->getInclination(index));
+	param["orbit_ascendingnode"] = ElementString(minor_bodies->getAscendingNode(index));
+	param["orbit_argofpericenter"] = ElementString(minor_bodies->getArgOfPericenter(index));
+	param["orbit_timeatpericenter"] = ElementString(minor_bodies->getTimeAtPericenter(index));
+	param["orbit_period"] = ElementString(minor_bodies->getPeriod(index));
+	param["halo"] = "true";
+	param["lighting"] = "true";
+	param["color"] = "1.,.94,.9";
+	param["tex_map"] = "bodies/asteroid.png";
+	param["tex_halo"] = "planethalo.png";
+	if (minor_bodies->isComet(index)) {
+		param["radius"] = "5";
+		param["albedo"] = "0.04";
+		param["comet_absolute_magnitude"] = ElementString(minor_bodies->getAbsoluteMagnitude(index));
+		param["comet_magnitude_slope"] = ElementString(minor_bodies->getSlope(index));
+	} else {
+		// diameter from H for the albedo used
+		const double albedo = 0.15;
+		const double radius = 1329./sqrt(albedo)*pow(10., -0.2*minor_bodies->getAbsoluteMagnitude(index))/2.;
+		param["radius"] = ElementString(radius);
+		param["albedo"] = ElementString(albedo);
+	}
+
+	const string error = addBody(param, true);
+	if (!error.empty()) {
+		cout << error << endl;
+		return NULL;
+	}
+	promoted_minor_body = name;
+
+	p = searchByEnglishName(name);
+	p->compute_position(last_date);
+	p->compute_trans_matrix(last_date);
+	return p;
+}
+
 Planet* SolarSystem::searchByEnglishName(string planetEnglishName) const
 {
 	//printf("SolarSystem::searchByEnglishName(\"%s\"): start\n",
@@ -1324,3 +1510,13 @@ vector<string> SolarSystem::listMatchingObjectsI18n(const string& objPrefix, uns
 	}
 	return result;
 }
+
+void SolarSystem::addNamesToIndex(NameIndex& index, const Navigator *nav) const
+{
+	for (unsigned int i=0; i<system_planets.size(); ++i) {
+		const Planet *p = system_planets[i];
+		const float rank = p->get_mag(nav);
+		index.add(p->getNameI18n(), p->getNameI18n(), ObjectRecord::OBJECT_PLANET, i, rank);
+		index.add(p->getEnglishName(), p->getNameI18n(), ObjectRecord::OBJECT_PLANET, i, rank);
+	}
+}
@@ -47,6 +47,9 @@ using namespace std;
 typedef std::map< std::string, Planet * > planetHash_t;
 typedef planetHash_t::const_iterator planetHashIter_t;
 
+class NameIndex;
+class MinorBodyMgr;
+class EphemerisCache;
 
 class SolarSystem
 {
@@ -123,6 +126,16 @@ public:
 	// home_planet is needed for light travel time computation
 	void computePositions(double date,const Planet *home_planet);
 
+	// Number of threads computing orbit lines, <0 for automatic, 0 for none
+	void setOrbitSamplingThreads(int nb_threads);
+	// Number of orbit points computed during the previous frame
+	unsigned int getOrbitPointsLastFrame(void) const;
+	// Wait for the orbit lines queued by computePositions instead of
+	// drawing the previous ones until they are ready
+	void setFlagWaitOrbitSamples(bool b) {
+		flagWaitOrbitSamples = b;
+	}
+
 	// Compute the transformation matrix for every elements of the solar system.
 	// home_planet is needed for light travel time computation
 	void computeTransMatrices(double date,const Planet *home_planet);
@@ -138,6 +151,36 @@ public:
 	                             bool *default_last_item,
 	                             bool aboveHomePlanet ) const;
 
+	//! Load the asteroid (MPCORB.DAT) and comet (CometEls.txt) element files
+	//! of the minor body layer, an empty name skips that file. Their element
+	//! caches are kept in cache_dir.
+	void loadMinorBodies(const string& asteroid_file, const string& comet_file,
+	                     const string& cache_dir, int nb_threads, LoadingBar& lb);
+
+	//! Index of the drawn minor body nearest to v within lim_fov degrees, -1 if none
+	int searchMinorBody(Vec3d v, double lim_fov, const Navigator * nav) const;
+
+	//! Name, earth equatorial position and magnitude of a minor body found by searchMinorBody
+	const string& getMinorBodyName(int index) const;
+	Vec3d getMinorBodyEarthEquPos(int index, const Navigator * nav) const;
+	float getMinorBodyMag(int index) const;
+
+	//! Add a minor body found by searchMinorBody as a full Planet so it can be
+	//! selected, or return it if it already is one. Returns NULL on failure.
+	Planet* promoteMinorBody(int index);
+
+	//! Map a cache written by nightshade-ephemeris; bodies with special
+	//! ephemerides take their positions from it inside its date range
+	bool loadEphemerisCache(const string& file_name);
+
+	//! Activate/Deactivate minor body layer display
+	void setFlagMinorBodies(bool b);
+	bool getFlagMinorBodies(void) const;
+
+	//! Set/Get the faintest magnitude of the minor bodies drawn
+	void setMinorBodyMaxMag(float mag);
+	float getMinorBodyMaxMag(void) const;
+
 	//! Return the matching planet pointer if exists or NULL
 	Planet* searchByEnglishName(string planetEnglishName) const;
 
@@ -257,6 +300,9 @@ public:
 	//! Find and return the list of at most maxNbItem objects auto-completing the passed object I18n name
 	vector<string> listMatchingObjectsI18n(const string& objPrefix, unsigned int maxNbItem) const;
 
+	//! Add the body names to the search index, ranked by their current magnitude
+	void addNamesToIndex(NameIndex& index, const Navigator *nav) const;
+
 	//! Set selected planet by english name or "" to select none
 	void setSelected(const string& englishName) {
 		setSelected(searchByEnglishName(englishName));
@@ -293,6 +339,12 @@ private:
 	float moonScale;	// Moon scale value
 
 	s_font* planet_name_font;
+	OrbitSampler* orbit_sampler;
+
+	MinorBodyMgr* minor_bodies;
+	string promoted_minor_body;	// english name of the last minor body made a Planet
+	double last_date;		// of computePositions, to place promoted bodies
+	EphemerisCache* ephemeris_cache;
 	vector<Planet*> system_planets;		// Vector containing all the bodies of the system
 	bool near_lunar_eclipse(const Navigator * nav, Projector * prj);
 
@@ -313,6 +365,7 @@ private:
 	bool flag_light_travel_time;
 	bool flagHints;
 	bool flagTrails;
+	bool flagWaitOrbitSamples;
 
 	planetHash_t planetHash;  // holds list of current planet english names
 	// (with parent pointer) to enforce uniqueness
@@ -0,0 +1,339 @@
+/*
+ * Nightshade (TM) astronomy simulation and visualization
+ *
+ * Copyright (C) 2012 Digitalis Education Solutions, Inc.
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 3
+ * of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place - Suite 330, Boston, MA  02111-1307, USA.
+ *
+ * Nightshade is a trademark of Digitalis Education Solutions, Inc.
+ * See the TRADEMARKS file for trademark usage requirements.
+ *
+ */
+
+
+#include <algorithm>
+#include <iostream>
+#include <math.h>
+#include <Magick++.h>
+
+#ifndef WIN32
+#include <unistd.h>
+#endif
+
+#include "texture_loader.h"
+#include "s_texture.h"
+
+TextureLoader *TextureLoader::m_instance = NULL;
+
+TextureLoader* TextureLoader::Instance(void)
+{
+	if (!m_instance) m_instance = new TextureLoader();
+	return m_instance;
+}
+
+void TextureLoader::Destroy(void)
+{
+	delete m_instance;
+	m_instance = NULL;
+}
+
+TextureLoader::TextureLoader() : quit(false), max_texture_size(2048)
+{
+	lock = SDL_CreateMutex();
+	work_available = SDL_CreateCond();
+}
+
+TextureLoader::~TextureLoader()
+{
+	SDL_mutexP(lock);
+	quit = true;
+	SDL_CondBroadcast(work_available);
+	SDL_mutexV(lock);
+
+	for (std::vector<SDL_Thread*>::iterator iter = workers.begin(); iter != workers.end(); ++iter) {
+		SDL_WaitThread(*iter, NULL);
+	}
+	workers.clear();
+
+	for (std::deque<Job*>::iterator iter = todo.begin(); iter != todo.end(); ++iter) delete *iter;
+	for (std::deque<Job*>::iterator iter = ready.begin(); iter != ready.end(); ++iter) delete *iter;
+	todo.clear();
+	ready.clear();
+
+	SDL_DestroyCond(work_available);
+	SDL_DestroyMutex(lock);
+}
+
+void TextureLoader::setThreads(int nb_threads)
+{
+	if (isThreaded() || nb_threads == 0) return;
+
+	GLint max_size = 0;
+	glGetIntegerv(GL_MAX_TEXTURE_SIZE, &max_size);
+	if (max_size > 0) max_texture_size = max_size;
+
+	if (nb_threads < 0) {
+#ifndef WIN32
+		nb_threads = sysconf(_SC_NPROCESSORS_ONLN) - 1;
+#else
+		nb_threads = 1;
+#endif
+		if (nb_threads < 1) nb_threads = 1;
+	}
+
+	for (int i=0; i<nb_threads; i++) {
+		SDL_Thread *thread = SDL_CreateThread(&TextureLoader::workerThread, this);
+		if (!thread) {
+			cerr << "Can't create texture loading thread, " << i << " available" << endl;
+			break;
+		}
+		workers.push_back(thread);
+	}
+}
+
+// Same rounding as a Magick geometry without the aspect flag:
+// fit in the power of two box while keeping the aspect ratio
+void TextureLoader::textureDimensions(unsigned int max_size, unsigned int &w, unsigned int &h)
+{
+	if (!w || !h) return;
+
+	unsigned int box_w = s_texture::roundToPow2(w), box_h = s_texture::roundToPow2(h);
+	while ((box_w > max_size || box_h > max_size) && box_w >> 1 && box_h >> 1) {
+		box_w >>= 1;
+		box_h >>= 1;
+	}
+	if (box_w == w && box_h == h) return;
+
+	const double f = std::min((double)box_w/w, (double)box_h/h);
+	w = (unsigned int)floor(f*w + 0.5);
+	h = (unsigned int)floor(f*h + 0.5);
+}
+
+bool TextureLoader::decode(const std::string& fullName, int loadType, unsigned int max_size,
+                           std::vector<char> &pixels, unsigned int &width, unsigned int &height)
+{
+	try {
+		Magick::Image image(fullName);
+		image.flip();
+
+		width = image.columns();
+		height = image.rows();
+		textureDimensions(max_size, width, height);
+		if (width != image.columns() || height != image.rows()) {
+			Magick::Geometry sz( width, height );
+			sz.aspect(true);
+			image.scale( sz );
+		}
+
+		// Convert image to RGBA format in memory
+		Magick::Blob blob;
+		image.magick("RGBA");
+		image.write(&blob);
+
+		pixels.assign((const char*)blob.data(), (const char*)blob.data() + blob.length());
+		s_texture::blend( loadType, &pixels[0], pixels.size() );
+	}
+	catch( std::exception &e ) {
+		cerr << "WARNING : failed loading texture file! " << e.what() << endl;
+		return false;
+	}
+	return !pixels.empty();
+}
+
+int TextureLoader::workerThread(void *data)
+{
+	TextureLoader *l = (TextureLoader*)data;
+
+	SDL_mutexP(l->lock);
+	for (;;) {
+		while (!l->quit && l->todo.empty()) SDL_CondWait(l->work_available, l->lock);
+		if (l->quit) break;
+
+		Job *job = l->todo.front();
+		l->todo.pop_front();
+		l->decoding.push_back(job);
+		const unsigned int max_size = l->max_texture_size;
+		SDL_mutexV(l->lock);
+
+		job->ok = decode(job->fullName, job->loadType, max_size, job->pixels, job->width, job->height);
+
+		SDL_mutexP(l->lock);
+		l->decoding.erase(std::find(l->decoding.begin(), l->decoding.end(), job));
+		if (job->discard) {
+			delete job;
+		} else {
+			l->ready.push_back(job);
+		}
+	}
+	SDL_mutexV(l->lock);
+
+	return 0;
+}
+
+// Call with the lock held
+TextureLoader::Job *TextureLoader::findPrefetched(const std::string& fullName, int loadType)
+{
+	for (std::deque<Job*>::iterator iter = ready.begin(); iter != ready.end(); ++iter) {
+		if (!(*iter)->tex && (*iter)->loadType == loadType && (*iter)->fullName == fullName) return *iter;
+	}
+	for (std::vector<Job*>::iterator iter = decoding.begin(); iter != decoding.end(); ++iter) {
+		if (!(*iter)->tex && !(*iter)->discard && (*iter)->loadType == loadType && (*iter)->fullName == fullName) return *iter;
+	}
+	for (std::deque<Job*>::iterator iter = todo.begin(); iter != todo.end(); ++iter) {
+		if (!(*iter)->tex && (*iter)->loadType == loadType && (*iter)->fullName == fullName) return *iter;
+	}
+	return NULL;
+}
+
+void TextureLoader::request(s_texture *tex, const std::string& fullName, int loadType, bool mipmap)
+{
+	SDL_mutexP(lock);
+	Job *job = findPrefetched(fullName, loadType);
+	if (job) {
+		job->tex = tex;
+		job->mipmap = mipmap;
+	} else {
+		job = new Job;
+		job->tex = tex;
+		job->fullName = fullName;
+		job->loadType = loadType;
+		job->mipmap = mipmap;
+		job->discard = job->ok = false;
+		job->width = job->height = 0;
+		todo.push_back(job);
+		SDL_CondSignal(work_available);
+	}
+	SDL_mutexV(lock);
+}
+
+void TextureLoader::prefetch(const std::string& fullName, int loadType)
+{
+	if (!isThreaded()) return;
+
+	SDL_mutexP(lock);
+	if (!findPrefetched(fullName, loadType)) {
+		Job *job = new Job;
+		job->tex = NULL;
+		job->fullName = fullName;
+		job->loadType = loadType;
+		job->mipmap = false;
+		job->discard = job->ok = false;
+		job->width = job->height = 0;
+		todo.push_back(job);
+		SDL_CondSignal(work_available);
+		trimPrefetched(max_prefetched);
+	}
+	SDL_mutexV(lock);
+}
+
+// Call with the lock held. Drops the oldest unclaimed prefetches
+// until at most keep are left.
+void TextureLoader::trimPrefetched(unsigned int keep)
+{
+	unsigned int unclaimed = 0;
+	for (std::deque<Job*>::iterator iter = ready.begin(); iter != ready.end(); ++iter)
+		if (!(*iter)->tex) unclaimed++;
+	for (std::vector<Job*>::iterator iter = decoding.begin(); iter != decoding.end(); ++iter)
+		if (!(*iter)->tex && !(*iter)->discard) unclaimed++;
+	for (std::deque<Job*>::iterator iter = todo.begin(); iter != todo.end(); ++iter)
+		if (!(*iter)->tex) unclaimed++;
+
+	// decoded first, then the ones being decoded, then the queued ones
+	for (std::deque<Job*>::iterator iter = ready.begin(); unclaimed > keep && iter != ready.end(); ) {
+		if (!(*iter)->tex) {
+			delete *iter;
+			iter = ready.erase(iter);
+			unclaimed--;
+		} else ++iter;
+	}
+	for (std::vector<Job*>::iterator iter = decoding.begin(); unclaimed > keep && iter != decoding.end(); ++iter) {
+		if (!(*iter)->tex && !(*iter)->discard) {
+			(*iter)->discard = true;
+			unclaimed--;
+		}
+	}
+	for (std::deque<Job*>::iterator iter = todo.begin(); unclaimed > keep && iter != todo.end(); ) {
+		if (!(*iter)->tex) {
+			delete *iter;
+			iter = todo.erase(iter);
+			unclaimed--;
+		} else ++iter;
+	}
+}
+
+void TextureLoader::cancel(const s_texture *tex)
+{
+	SDL_mutexP(lock);
+	for (std::deque<Job*>::iterator iter = todo.begin(); iter != todo.end(); ) {
+		if ((*iter)->tex == tex) {
+			delete *iter;
+			iter = todo.erase(iter);
+		} else ++iter;
+	}
+	for (std::deque<Job*>::iterator iter = ready.begin(); iter != ready.end(); ) {
+		if ((*iter)->tex == tex) {
+			delete *iter;
+			iter = ready.erase(iter);
+		} else ++iter;
+	}
+	for (std::vector<Job*>::iterator iter = decoding.begin(); iter != decoding.end(); ++iter) {
+		if ((*iter)->tex == tex) {
+			(*iter)->tex = NULL;
+			(*iter)->discard = true;
+		}
+	}
+	SDL_mutexV(lock);
+}
+
+int TextureLoader::upload(unsigned int budget_ms)
+{
+	const Uint32 start = SDL_GetTicks();
+	int nb_uploaded = 0;
+
+	for (;;) {
+		Job *job = NULL;
+
+		SDL_mutexP(lock);
+		for (std::deque<Job*>::iterator iter = ready.begin(); iter != ready.end(); ++iter) {
+			if ((*iter)->tex) {
+				job = *iter;
+				ready.erase(iter);
+				break;
+			}
+		}
+		SDL_mutexV(lock);
+
+		if (!job) break;
+
+		job->tex->finishLoad(job->ok ? &job->pixels[0] : NULL, job->width, job->height, job->mipmap);
+		delete job;
+		nb_uploaded++;
+
+		if (budget_ms && SDL_GetTicks() - start >= budget_ms) break;
+	}
+
+	return nb_uploaded;
+}
+
+bool TextureLoader::isIdle(void)
+{
+	SDL_mutexP(lock);
+	bool idle = todo.empty() && decoding.empty();
+	for (std::deque<Job*>::iterator iter = ready.begin(); idle && iter != ready.end(); ++iter) {
+		if ((*iter)->tex) idle = false;
+	}
+	SDL_mutexV(lock);
+	return idle;
+}
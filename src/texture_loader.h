@@ -0,0 +1,126 @@
+/*
+ * Nightshade (TM) astronomy simulation and visualization
+ *
+ * Copyright (C) 2012 Digitalis Education Solutions, Inc.
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 3
+ * of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place - Suite 330, Boston, MA  02111-1307, USA.
+ *
+ * Nightshade is a trademark of Digitalis Education Solutions, Inc.
+ * See the TRADEMARKS file for trademark usage requirements.
+ *
+ */
+
+
+// Decodes texture images on a pool of worker threads. Decoding, power of
+// two resizing and blend conversion happen off the GL thread; the decoded
+// pixels are uploaded by upload() on the main thread under a time budget,
+// until then the s_texture shows a transparent placeholder.
+
+#ifndef _TEXTURE_LOADER_H_
+#define _TEXTURE_LOADER_H_
+
+#include <deque>
+#include <string>
+#include <vector>
+
+#include "SDL_thread.h"
+
+class s_texture;
+
+class TextureLoader
+{
+public:
+	static TextureLoader* Instance(void);
+	static void Destroy(void);
+
+	// Start the worker threads, <0 for one less than the number of processors.
+	// Must be called from the GL thread, only the first call has effect.
+	void setThreads(int nb_threads);
+	bool isThreaded(void) const {
+		return !workers.empty();
+	}
+
+	// Largest texture dimension accepted by the GL implementation
+	unsigned int getMaxTextureSize(void) const {
+		return max_texture_size;
+	}
+
+	// Queue the decoding of fullName for tex, loadType is the internal PNG_* type
+	void request(s_texture *tex, const std::string& fullName, int loadType, bool mipmap);
+
+	// Decode fullName ahead of time, a later request with the same file
+	// and load type uses the decoded pixels. Only the max_prefetched most
+	// recent prefetches not yet requested are kept.
+	void prefetch(const std::string& fullName, int loadType);
+
+	// Forget the prefetched images nobody requested, e.g. when a script ends
+	void dropPrefetched(void) {
+		SDL_mutexP(lock);
+		trimPrefetched(0);
+		SDL_mutexV(lock);
+	}
+
+	// Forget the request of a texture about to be unloaded
+	void cancel(const s_texture *tex);
+
+	// Upload decoded textures until budget_ms is spent (at least one, all
+	// of them if budget_ms is 0), returns the number of textures uploaded
+	int upload(unsigned int budget_ms);
+
+	// Whether all requested textures are decoded and uploaded
+	bool isIdle(void);
+
+	// Decode an image, scaled to power of two dimensions no larger than max_size
+	static bool decode(const std::string& fullName, int loadType, unsigned int max_size,
+	                   std::vector<char> &pixels, unsigned int &width, unsigned int &height);
+
+	// Final texture dimensions of an image of w by h pixels
+	static void textureDimensions(unsigned int max_size, unsigned int &w, unsigned int &h);
+
+private:
+	TextureLoader();
+	virtual ~TextureLoader();
+
+	struct Job {
+		s_texture *tex;         // NULL for prefetched images not requested yet
+		std::string fullName;
+		int loadType;
+		bool mipmap;
+		bool discard;           // cancelled while decoding
+		bool ok;
+		unsigned int width, height;
+		std::vector<char> pixels;
+	};
+
+	static int workerThread(void *data);
+	Job *findPrefetched(const std::string& fullName, int loadType);
+	void trimPrefetched(unsigned int keep);
+
+	static const unsigned int max_prefetched = 32;
+
+	static TextureLoader *m_instance;
+
+	std::vector<SDL_Thread*> workers;
+	std::deque<Job*> todo;
+	std::vector<Job*> decoding;
+	std::deque<Job*> ready;
+
+	SDL_mutex *lock;
+	SDL_cond *work_available;
+	bool quit;
+	unsigned int max_texture_size;
+};
+
+#endif // _TEXTURE_LOADER_H_
@@ -25,6 +25,7 @@
 #include <cmath>
 
 #include "tone_reproductor.h"
+#include "simd_math.h"
 
 // Set some values to prevent bugs in case of bad use
 ToneReproductor::ToneReproductor() : Lda(50.f), Lwa(40000.f), one_over_maxdL(1.f/100.f), one_over_gamma(1.f/2.3f)
@@ -77,7 +78,7 @@ void ToneReproductor::set_world_adaptation_luminance(float _Lwa)
 
 // Convert from xyY color system to RGB according to the adaptation
 // The Y component is in cd/m^2
-void ToneReproductor::xyY_to_RGB(float* color)
+void ToneReproductor::xyY_to_RGB(float* color) const
 {
 	// 1. Hue conversion
 	float log10Y = log10f(color[2]);
@@ -116,3 +117,86 @@ void ToneReproductor::xyY_to_RGB(float* color)
 	color[2] = 0.0134455f*X - 0.118373f*Y + 1.01527f  *Z;
 }
 
+
+#ifdef HAVE_SIMD_DOUBLE
+
+void ToneReproductor::xyY_to_RGB_lanes(const double *color_x, const double *color_y, const double *color_Y,
+                                       double *r, double *g, double *b) const
+{
+	typedef SimdMath::SimdD S;
+	const S::V one = S::set1(1.0);
+	S::V x = S::load(color_x), y = S::load(color_y), Y = S::load(color_Y);
+
+	// 1. Hue conversion, as xyY_to_RGB but with both branches computed
+	const S::V log10Y = S::mul(SimdMath::log_fast(Y), S::set1(1/M_LN10));
+	const S::V op = S::mul(S::add(log10Y, S::set1(2.0)), S::set1(1/2.6));
+	S::V s = S::mul(S::mul(op, op), SimdMath::madd(S::set1(-2.0), op, S::set1(3.0)));
+	s = S::and_(S::gt(log10Y, S::set1(-2.0)), s);
+	const S::V not_s = S::sub(one, s);
+
+	const S::V sx = SimdMath::madd(s, x, S::mul(not_s, S::set1(0.25)));
+	const S::V sy = SimdMath::madd(s, y, S::mul(not_s, S::set1(0.25)));
+	const S::V V = S::mul(Y, SimdMath::madd(S::set1(1.33),
+	                      S::add(S::add(one, S::div(sy, sx)), S::mul(sx, S::sub(S::sub(one, sx), sy))),
+	                      S::set1(-1.68)));
+	const S::V sY = SimdMath::madd(S::mul(S::set1(0.4468), not_s), V, S::mul(s, Y));
+
+	const S::V scotopic = S::lt(log10Y, S::set1(0.6));
+	x = S::select(scotopic, sx, x);
+	y = S::select(scotopic, sy, y);
+	Y = S::select(scotopic, sY, Y);
+
+	// 2. Adapt and scale to the RGB range, the two powers of xyY_to_RGB
+	// folded into one: (Y pi 1e-4)^(a/g) (term2/maxdL)^(1/g)
+	const S::V positive = S::gt(Y, S::zero());
+	Y = SimdMath::exp_fast(SimdMath::madd(SimdMath::log_fast(S::mul(Y, S::set1(M_PI*0.0001))),
+	                       S::set1(alpha_wa_over_alpha_da*one_over_gamma),
+	                       S::set1(one_over_gamma*log(term2*one_over_maxdL))));
+	Y = S::and_(positive, Y);
+
+	const S::V Y_over_y = S::div(Y, y);
+	const S::V X = S::mul(x, Y_over_y);
+	const S::V Z = S::mul(S::sub(S::sub(one, x), y), Y_over_y);
+
+	S::store(r, SimdMath::madd(S::set1(2.04148), X, SimdMath::madd(S::set1(-0.564977), Y, S::mul(S::set1(-0.344713), Z))));
+	S::store(g, SimdMath::madd(S::set1(-0.969258), X, SimdMath::madd(S::set1(1.87599), Y, S::mul(S::set1(0.0415557), Z))));
+	S::store(b, SimdMath::madd(S::set1(0.0134455), X, SimdMath::madd(S::set1(-0.118373), Y, S::mul(S::set1(1.01527), Z))));
+}
+
+#endif
+
+void ToneReproductor::xyY_to_RGBs(const float *color_x, const float *color_y, const float *color_Y,
+                                  float *rgb, int n) const
+{
+#ifdef HAVE_SIMD_DOUBLE
+	const int W = SimdMath::SimdD::width;
+	double cx[W], cy[W], cY[W], r[W], g[W], b[W];
+	for (int i=0; i<n; i+=W) {
+		// the last lanes of the tail repeat its last color
+		for (int k=0; k<W; k++) {
+			const int j = (i+k < n) ? i+k : n-1;
+			cx[k] = color_x[j];
+			cy[k] = color_y[j];
+			cY[k] = color_Y[j];
+		}
+		xyY_to_RGB_lanes(cx, cy, cY, r, g, b);
+		for (int k=0; k<W && i+k<n; k++) {
+			rgb[3*(i+k)] = r[k];
+			rgb[3*(i+k)+1] = g[k];
+			rgb[3*(i+k)+2] = b[k];
+		}
+	}
+#else
+	for (int i=0; i<n; i++) {
+		float *c = rgb + 3*i;
+		if (color_Y[i] > 0) {
+			c[0] = color_x[i];
+			c[1] = color_y[i];
+			c[2] = color_Y[i];
+			xyY_to_RGB(c);
+		} else {
+			c[0] = c[1] = c[2] = 0.f;
+		}
+	}
+#endif
+}
@@ -73,6 +73,9 @@ public:
 	// Indoor Lighting : 100    cd/m^2
 	// Sun Light       : 100000 cd/m^2
 	void set_world_adaptation_luminance(float world_adaptation_luminance);
+	float get_world_adaptation_luminance(void) const {
+		return Lwa;
+	}
 
 	// Set the maximum display luminance : default value = 100 cd/m^2
 	// This value is used to scale the RGB range
@@ -91,9 +94,18 @@ public:
 	}
 
 	// Convert from xyY color system to RGB
-	void xyY_to_RGB(float*);
+	void xyY_to_RGB(float*) const;
+
+	// xyY_to_RGB for n colors, the RGB triplets of which go to rgb (3n floats)
+	// Luminances of 0 and below give black
+	void xyY_to_RGBs(const float *color_x, const float *color_y, const float *color_Y,
+	                 float *rgb, int n) const;
 
 private:
+	// xyY_to_RGBs for SimdD::width colors
+	void xyY_to_RGB_lanes(const double *color_x, const double *color_y, const double *color_Y,
+	                      double *r, double *g, double *b) const;
+
 	float Lda;		// Display luminance adaptation (in cd/m^2)
 	float Lwa;		// World   luminance adaptation (in cd/m^2)
 	float one_over_maxdL;	// 1 / Display maximum luminance (in cd/m^2)
@@ -22,46 +22,17 @@
 #include "app.h"
 #include "geodesic_grid.h"
 #include "object_base.h"
+#include "hip_star_wrapper.h"
 
 
 namespace BigStarCatalogExtension {
 
-static const Vec3d north(0,0,1);
-
 void ZoneArray::initTriangle(int index,
                              const Vec3d &c0,
                              const Vec3d &c1,
                              const Vec3d &c2) {
-    // initialize center,axis0,axis1:
-  ZoneData &z(zones[index]);
-  z.center = c0+c1+c2;
-  z.center.normalize();
-  z.axis0 = north ^ z.center;
-  z.axis0.normalize();
-  z.axis1 = z.center ^ z.axis0;
-    // initialize star_position_scale:
-  double mu0,mu1,f,h;
-  mu0 = (c0-z.center)*z.axis0;
-  mu1 = (c0-z.center)*z.axis1;
-  f = 1.0/sqrt(1.0-mu0*mu0-mu1*mu1);
-  h = fabs(mu0)*f;
-  if (star_position_scale < h) star_position_scale = h;
-  h = fabs(mu1)*f;
-  if (star_position_scale < h) star_position_scale = h;
-  mu0 = (c1-z.center)*z.axis0;
-  mu1 = (c1-z.center)*z.axis1;
-  f = 1.0/sqrt(1.0-mu0*mu0-mu1*mu1);
-  h = fabs(mu0)*f;
-  if (star_position_scale < h) star_position_scale = h;
-  h = fabs(mu1)*f;
-  if (star_position_scale < h) star_position_scale = h;
-  mu0 = (c2-z.center)*z.axis0;
-  mu1 = (c2-z.center)*z.axis1;
-  f = 1.0/sqrt(1.0-mu0*mu0-mu1*mu1);
-  h = fabs(mu0)*f;
-  if (star_position_scale < h) star_position_scale = h;
-  h = fabs(mu1)*f;
-  if (star_position_scale < h) star_position_scale = h;
+    // initialize center,axis0,axis1 and star_position_scale:
+  InitZoneAxes(c0,c1,c2,zones[index],star_position_scale);
 }
 
 
@@ -82,20 +53,59 @@ int ReadInt(FILE *f,unsigned int &x) {
 #warning Star catalogue loading has only been tested with gcc
 #endif
 
-ZoneArray *ZoneArray::create(const HipStarMgr &hip_star_mgr,
-                             const string& extended_file_name,
-                             LoadingBar &lb) {
+  // Full path of a catalogue, whose name may be prefixed with "mmap:"
+static string CatalogFileName(const string &extended_file_name,
+                              bool &use_mmap) {
   string fname(extended_file_name);
-  bool use_mmap = false;
+  use_mmap = false;
   if (fname.find("mmap:") != string::npos) {
     fname = fname.substr(5);
     use_mmap = true;
   }
+  return AppSettings::Instance()->getDataRoot() + "/stars/default/" + fname;
+}
+
+bool ZoneArray::readHeader(const string &extended_file_name,
+                           int &type,int &level) {
+  bool use_mmap;
+  string fname;
   try {
-    fname = AppSettings::Instance()->getDataRoot() + "/stars/default/" + fname;
+    fname = CatalogFileName(extended_file_name,use_mmap);
+  } catch (std::exception &e) {
+    return false;
+  }
+  FILE *f = fopen(fname.c_str(),"rb");
+  if (f == 0) return false;
+  unsigned int magic,major,minor,t,l;
+  const bool ok = (ReadInt(f,magic) == 0 &&
+                   ReadInt(f,t) == 0 &&
+                   ReadInt(f,major) == 0 &&
+                   ReadInt(f,minor) == 0 &&
+                   ReadInt(f,l) == 0);
+  fclose(f);
+  if (!ok) return false;
+  if (magic == FILE_MAGIC_OTHER_ENDIAN) {
+    t = bswap_32(t);
+    l = bswap_32(l);
+  } else if (magic != FILE_MAGIC && magic != FILE_MAGIC_NATIVE &&
+             magic != FILE_MAGIC_SOA) {
+    return false;
+  }
+  type = t;
+  level = l;
+  return true;
+}
+
+ZoneArray *ZoneArray::create(const HipStarMgr &hip_star_mgr,
+                             const string& extended_file_name,
+                             LoadingBar *lb) {
+  bool use_mmap;
+  string fname;
+  try {
+    fname = CatalogFileName(extended_file_name,use_mmap);
   } catch (std::exception &e) {
     cout << "ZoneArray::create(" << extended_file_name << "): "
-            "warning while loading \"" << fname
+            "warning while loading \"" << extended_file_name
          << "\": " << e.what();
     return 0;
   }
@@ -115,8 +125,14 @@ ZoneArray *ZoneArray::create(const HipStarMgr &hip_star_mgr,
       ReadInt(f,mag_range) < 0 ||
       ReadInt(f,mag_steps) < 0) {
     printf("bad file\n");
+    fclose(f);
     return 0;
   }
+  if (magic == FILE_MAGIC_SOA || magic == FILE_MAGIC_SOA_OTHER_ENDIAN) {
+    ZoneArray *rval = createSoa(hip_star_mgr,f,lb);
+    fclose(f);
+    return rval;
+  }
   const bool byte_swap = (magic == FILE_MAGIC_OTHER_ENDIAN);
   if (byte_swap) {
       // ok, FILE_MAGIC_OTHER_ENDIAN, must swap
@@ -238,7 +254,7 @@ ZoneArray::ZoneArray(const HipStarMgr &hip_star_mgr,int level,
 }
 
 bool ZoneArray::readFileWithLoadingBar(FILE *f,void *data,size_t size,
-                                       LoadingBar &lb) {
+                                       LoadingBar *lb) {
   int parts = 256;
   size_t part_size = (size + (parts>>1)) / parts;
   if (part_size < 64*1024) {
@@ -246,7 +262,7 @@ bool ZoneArray::readFileWithLoadingBar(FILE *f,void *data,size_t size,
     parts = (size + (part_size>>1)) / part_size;
   }
   float i = 0.f;
-  lb.Draw(i / parts);
+  if (lb) lb->Draw(i / parts);
   i += 1.f;
   while (size > 0) {
     const size_t to_read = (part_size < size) ? part_size : size;
@@ -254,13 +270,268 @@ bool ZoneArray::readFileWithLoadingBar(FILE *f,void *data,size_t size,
     if (read_rc != to_read) return false;
     size -= read_rc;
     data = ((char*)data) + read_rc;
-    if( i / parts <= 1)
-    	lb.Draw(i / parts);
+    if( lb && i / parts <= 1)
+    	lb->Draw(i / parts);
     i += 1.f;
   }
   return true;
 }
 
+  // Structure-of-arrays catalogues are always mapped, whatever the
+  // "mmap:" prefix says.
+ZoneArray *ZoneArray::createSoa(const HipStarMgr &hip_star_mgr,
+                                FILE *f,LoadingBar *lb) {
+  SoaFileHeader header;
+  if (fseek(f,0,SEEK_SET) != 0 ||
+      1 != fread(&header,sizeof(SoaFileHeader),1,f)) {
+    printf("bad file\n");
+    return 0;
+  }
+  if (header.magic != FILE_MAGIC_SOA) {
+    printf("structure-of-arrays catalogue of the other byte order, "
+           "convert it again on this machine\n");
+    return 0;
+  }
+  printf("%u_%uv%u_%u soa; ",header.level,header.type,
+         header.major,header.minor);
+  if (header.major > SOA_FILE_VERSION) {
+    printf("unsupported version\n");
+    return 0;
+  }
+  if (header.nr_of_zones != (unsigned int)GeodesicGrid::nrOfZones(header.level) ||
+      header.nr_of_slots < header.nr_of_stars) {
+    printf("bad file\n");
+    return 0;
+  }
+  if (fseek(f,0,SEEK_END) != 0 ||
+      ftell(f) < (long)SoaFileLayout(header).size) {
+    printf("file too short\n");
+    return 0;
+  }
+  ZoneArray *rval = new SoaZoneArray(f,header,lb,hip_star_mgr);
+  if (rval->isInitialized()) {
+    printf("stars: %d\n",rval->getNrOfStars());
+  } else {
+    printf("initialization failed\n");
+    delete rval;
+    rval = 0;
+  }
+  return rval;
+}
+
+SoaZoneArray::SoaZoneArray(FILE *f,const SoaFileHeader &header,
+                           LoadingBar *lb,
+                           const HipStarMgr &hip_star_mgr)
+             :ZoneArray(hip_star_mgr,header.level,header.mag_min,
+                        header.mag_range,header.mag_steps),
+              data(0),read_buffer(0),data_size(0),
+#ifdef WIN32
+              mapping_handle(NULL),
+#endif
+              soa_zones(0),x0(0),x1(0),dx0(0),dx1(0),mag(0),b_v(0) {
+  if (lb) lb->Draw(0.f);
+  const SoaFileLayout layout(header);
+  data_size = layout.size;
+#ifndef WIN32
+  void *const m = mmap(0,data_size,PROT_READ,MAP_PRIVATE | MAP_NORESERVE,
+                       fileno(f),0);
+  if (m == MAP_FAILED) {
+    cerr << "ERROR: SoaZoneArray(" << level << ")::SoaZoneArray: mmap("
+         << fileno(f) << ',' << data_size << ") failed: "
+         << strerror(errno) << ", reading instead" << endl;
+  } else {
+    data = (char*)m;
+    if (!lb) {
+        // loading in the background: fault the pages in now
+        // rather than while drawing
+      const long page_size = sysconf(_SC_PAGE_SIZE);
+      volatile char sum = 0;
+      for (size_t i=0;i<data_size;i+=page_size) sum += data[i];
+    }
+  }
+#else
+  HANDLE file_handle = (void*)_get_osfhandle(_fileno(f));
+  if (file_handle != INVALID_HANDLE_VALUE) {
+    mapping_handle = CreateFileMapping(file_handle,NULL,PAGE_READONLY,
+                                       0,0,NULL);
+    if (mapping_handle != NULL) {
+      data = (char*)MapViewOfFile(mapping_handle,FILE_MAP_READ,0,0,data_size);
+      if (data == NULL) {
+        CloseHandle(mapping_handle);
+        mapping_handle = NULL;
+      }
+    }
+  }
+  if (data == NULL) {
+    cerr << "ERROR: SoaZoneArray(" << level << ")::SoaZoneArray: "
+            "mapping failed: " << GetLastError() << ", reading instead" << endl;
+  }
+#endif
+  if (data == 0) {
+      // the arrays rely on the alignment of the file
+    read_buffer = new char[data_size+SOA_FILE_ALIGN];
+    data = read_buffer + (SOA_FILE_ALIGN
+                          - ((size_t)read_buffer & (SOA_FILE_ALIGN-1)));
+    if (fseek(f,0,SEEK_SET) != 0 ||
+        !readFileWithLoadingBar(f,data,data_size,lb)) {
+      delete[] read_buffer;
+      read_buffer = 0;
+      data = 0;
+      nr_of_zones = 0;
+      return;
+    }
+  }
+  soa_zones = (const SoaZone*)(data + layout.zones);
+  x0 = (const Int32*)(data + layout.x0);
+  x1 = (const Int32*)(data + layout.x1);
+  if (header.proper_motion) {
+    dx0 = (const Int16*)(data + layout.dx0);
+    dx1 = (const Int16*)(data + layout.dx1);
+  }
+  mag = (const unsigned char*)(data + layout.mag);
+  b_v = (const unsigned char*)(data + layout.b_v);
+  star_position_scale = header.star_position_scale;
+  nr_of_stars = header.nr_of_stars;
+  if (nr_of_stars == 0) nr_of_zones = 0;
+  if (lb) lb->Draw(1.f);
+}
+
+SoaZoneArray::~SoaZoneArray(void) {
+  if (read_buffer) {
+    delete[] read_buffer;
+  } else if (data) {
+#ifndef WIN32
+    munmap(data,data_size);
+#else
+    UnmapViewOfFile(data);
+    CloseHandle(mapping_handle);
+#endif
+  }
+  data = 0;
+  nr_of_zones = 0;
+  nr_of_stars = 0;
+}
+
+Vec3d SoaZoneArray::getJ2000Pos(int zone,unsigned int i,
+                                double movement_factor) const {
+  const SoaZone &z(soa_zones[zone]);
+  double u = x0[i];
+  double v = x1[i];
+  if (dx0) {
+    u += movement_factor*dx0[i];
+    v += movement_factor*dx1[i];
+  }
+  Vec3d pos(z.center[0] + u*z.axis0[0] + v*z.axis1[0],
+            z.center[1] + u*z.axis0[1] + v*z.axis1[1],
+            z.center[2] + u*z.axis0[2] + v*z.axis1[2]);
+  pos.normalize();
+  return pos;
+}
+
+  // Write the positions of the first count stars of a zone into
+  // projection_batch. The loops only touch plain arrays so that the
+  // compiler can vectorize them.
+void SoaZoneArray::decodeZone(int index,unsigned int count,
+                              double movement_factor) const {
+  const SoaZone &z(soa_zones[index]);
+  const Int32 *const px0 = x0 + z.first;
+  const Int32 *const px1 = x1 + z.first;
+  double *const bx = &projection_batch.x[0];
+  double *const by = &projection_batch.y[0];
+  double *const bz = &projection_batch.z[0];
+  const double c0 = z.center[0], c1 = z.center[1], c2 = z.center[2];
+  const double a00 = z.axis0[0], a01 = z.axis0[1], a02 = z.axis0[2];
+  const double a10 = z.axis1[0], a11 = z.axis1[1], a12 = z.axis1[2];
+  if (dx0) {
+    const Int16 *const pdx0 = dx0 + z.first;
+    const Int16 *const pdx1 = dx1 + z.first;
+    for (unsigned int i=0;i<count;i++) {
+      const double u = px0[i] + movement_factor*pdx0[i];
+      const double v = px1[i] + movement_factor*pdx1[i];
+      bx[i] = c0 + u*a00 + v*a10;
+      by[i] = c1 + u*a01 + v*a11;
+      bz[i] = c2 + u*a02 + v*a12;
+    }
+  } else {
+    for (unsigned int i=0;i<count;i++) {
+      const double u = px0[i];
+      const double v = px1[i];
+      bx[i] = c0 + u*a00 + v*a10;
+      by[i] = c1 + u*a01 + v*a11;
+      bz[i] = c2 + u*a02 + v*a12;
+    }
+  }
+  for (unsigned int i=0;i<count;i++) {
+    const double r = 1.0/sqrt(bx[i]*bx[i] + by[i]*by[i] + bz[i]*bz[i]);
+    bx[i] *= r;
+    by[i] *= r;
+    bz[i] *= r;
+  }
+}
+
+void SoaZoneArray::draw(int index,bool is_inside,
+                        const float *rcmag_table,
+                        Projector *prj,
+                        unsigned int max_mag_star_name,
+                        float names_brightness,
+                        s_font *starFont,
+                        s_texture* starTexture) const {
+  const bool batching = hip_star_mgr.getFlagStarBatching();
+  if (!batching && hip_star_mgr.getFlagPointStar()) {
+    glDisable(GL_TEXTURE_2D);
+    glPointSize(0.1);
+  }
+  const SoaZone &z(soa_zones[index]);
+  const double d2000 = 2451545.0;
+  const double movement_factor = (M_PI/180)*(0.0001/3600)
+                           * ((HipStarMgr::getCurrentJDay()-d2000)/365.25)
+                           / star_position_scale;
+    // Stars are sorted by magnitude: only the ones before the first star
+    // too faint to be drawn need to be projected.
+  const unsigned char *const m = mag + z.first;
+  const unsigned char *const c = b_v + z.first;
+  unsigned int count = 0;
+  while (count < z.size && rcmag_table[2*m[count]] > 0.f
+                        && rcmag_table[2*m[count]+1] > 0.f) count++;
+  projection_batch.resize(count);
+  if (count > 0) decodeZone(index,count,movement_factor);
+  prj->project_j2000_batch(projection_batch);
+  if (!is_inside) prj->check_in_viewport_batch(projection_batch);
+  Vec3d xy;
+  for (unsigned int i=0;i<count;i++) {
+    if (projection_batch.visible[i]) {
+      projection_batch.getWin(i,xy);
+      if (batching) {
+        if (0 > hip_star_mgr.batchStar(prj,xy,rcmag_table + 2*m[i],
+                                       HipStarMgr::color_table[c[i]])) {
+          break;
+        }
+      } else if (0 > hip_star_mgr.drawStar(prj,xy,rcmag_table + 2*m[i],
+                                           HipStarMgr::color_table[c[i]])) {
+        break;
+      }
+    }
+  }
+  if (!batching && hip_star_mgr.getFlagPointStar()) {
+    glEnable(GL_TEXTURE_2D);
+  }
+}
+
+void SoaZoneArray::searchAround(int index,const Vec3d &v,
+                                double cos_lim_fov,
+                                vector<ObjectBaseP > &result) {
+  const double d2000 = 2451545.0;
+  const double movement_factor = (M_PI/180)*(0.0001/3600)
+                           * ((HipStarMgr::getCurrentJDay()-d2000)/365.25)
+                           / star_position_scale;
+  const SoaZone &z(soa_zones[index]);
+  for (unsigned int i=z.first;i<z.first+z.size;i++) {
+    if (getJ2000Pos(index,i,movement_factor)*v >= cos_lim_fov) {
+      result.push_back(ObjectBaseP(new StarWrapperSoa(this,index,i)));
+    }
+  }
+}
+
 void ZoneArray1::updateHipIndex(HipIndexStruct hip_index[]) const {
   for (const SpecialZoneData<Star1> *z=getZones()+(nr_of_zones-1);
        z>=getZones();z--) {
@@ -280,5 +551,18 @@ void ZoneArray1::updateHipIndex(HipIndexStruct hip_index[]) const {
   }
 }
 
+void ZoneArray1::updateLabels(vector<string> &labels) {
+  label_ids.resize(nr_of_stars);
+  for (unsigned int i=0;i<nr_of_stars;i++) {
+    const string name = stars[i].getNameI18n();
+    if (name.empty()) {
+      label_ids[i] = -1;
+    } else {
+      label_ids[i] = labels.size();
+      labels.push_back(name);
+    }
+  }
+}
+
 } // namespace BigStarCatalogExtension
 
@@ -26,6 +26,7 @@
 
 #include "zone_data.h"
 #include "hip_star.h"
+#include "soa_zone_file.h"
 
 #include "GLee.h"
 
@@ -62,13 +63,22 @@ namespace BigStarCatalogExtension {
 
 class ZoneArray {
 public:
+    // lb may be NULL when loading in the background
   static ZoneArray *create(const HipStarMgr &hip_star_mgr,
                            const string &extended_file_name,
-                           LoadingBar &lb);
+                           LoadingBar *lb);
+    // read the type and level of a catalogue without loading it
+  static bool readHeader(const string &extended_file_name,
+                         int &type,int &level);
+    // the rest of create for a structure-of-arrays catalogue
+  static ZoneArray *createSoa(const HipStarMgr &hip_star_mgr,
+                              FILE *f,LoadingBar *lb);
   virtual ~ZoneArray(void) {nr_of_zones = 0;}
   virtual void generateNativeDebugFile(const char *fname) const = 0;
   unsigned int getNrOfStars(void) const {return nr_of_stars;}
   virtual void updateHipIndex(HipIndexStruct hip_index[]) const {}
+    // fill label_ids, appending the label texts to labels
+  virtual void updateLabels(vector<string> &labels) {}
   virtual void searchAround(int index,const Vec3d &v,double cos_lim_fov,
                             vector<ObjectBaseP > &result) = 0;
   virtual void draw(int index,bool is_inside,
@@ -77,10 +87,10 @@ public:
                     s_font *starFont,
                     s_texture* starTexture) const = 0;
   bool isInitialized(void) const {return (nr_of_zones>0);}
-  void initTriangle(int index,
-                    const Vec3d &c0,
-                    const Vec3d &c1,
-                    const Vec3d &c2);
+  virtual void initTriangle(int index,
+                            const Vec3d &c0,
+                            const Vec3d &c1,
+                            const Vec3d &c2);
   virtual void scaleAxis(void) = 0;
   const int level;
   const int mag_min;
@@ -90,19 +100,24 @@ public:
   const HipStarMgr &hip_star_mgr;
 protected:
   static bool readFileWithLoadingBar(FILE *f,
-                                     void *data,size_t size,LoadingBar &lb);
+                                     void *data,size_t size,LoadingBar *lb);
   ZoneArray(const HipStarMgr &hip_star_mgr,int level,
             int mag_min,int mag_range,int mag_steps);
   unsigned int nr_of_zones;
   unsigned int nr_of_stars;
   ZoneData *zones;
+    // scratch space for projecting a whole zone at once
+  mutable ProjectionBatch projection_batch;
+    // label of each star as an index in HipStarMgr::getStarLabel,
+    // -1 for no label, empty when the stars have no names
+  vector<int> label_ids;
 };
 
 template<class Star>
 class SpecialZoneArray : public ZoneArray {
 public:
   SpecialZoneArray(FILE *f,bool byte_swap,bool use_mmap,
-                   LoadingBar &lb,
+                   LoadingBar *lb,
                    const HipStarMgr &hip_star_mgr,int level,
                    int mag_min,int mag_range,int mag_steps);
   ~SpecialZoneArray(void);
@@ -135,6 +150,50 @@ void SpecialZoneArray<Star>::scaleAxis(void) {
 }
 
 
+// Stars of a structure-of-arrays catalogue (see soa_zone_file.h).
+// The file is mapped as it is: the zone axes come scaled from the file,
+// and the positions of a zone are decoded in one loop over plain arrays.
+
+class SoaZoneArray : public ZoneArray {
+public:
+  SoaZoneArray(FILE *f,const SoaFileHeader &header,LoadingBar *lb,
+               const HipStarMgr &hip_star_mgr);
+  ~SoaZoneArray(void);
+  void generateNativeDebugFile(const char *fname) const {}
+  Vec3d getJ2000Pos(int zone,unsigned int i,double movement_factor) const;
+  const SoaZone &getZone(int zone) const {return soa_zones[zone];}
+  unsigned char getMag(unsigned int i) const {return mag[i];}
+  unsigned char getBV(unsigned int i) const {return b_v[i];}
+private:
+  void initTriangle(int index,
+                    const Vec3d &c0,
+                    const Vec3d &c1,
+                    const Vec3d &c2) {}
+  void scaleAxis(void) {}
+  void decodeZone(int index,unsigned int count,double movement_factor) const;
+  void searchAround(int index,const Vec3d &v,double cos_lim_fov,
+                    vector<ObjectBaseP > &result);
+  void draw(int index,bool is_inside,
+            const float *rcmag_table, Projector *prj,
+            unsigned int max_mag_star_name,float names_brightness,
+            s_font *starFont,s_texture* starTexture) const;
+
+  char *data;                  // start of the file in memory
+  char *read_buffer;           // when the file could not be mapped
+  size_t data_size;
+#ifdef WIN32
+  HANDLE mapping_handle;
+#endif
+  const SoaZone *soa_zones;
+  const Int32 *x0;
+  const Int32 *x1;
+  const Int16 *dx0;            // NULL without proper motions
+  const Int16 *dx1;
+  const unsigned char *mag;
+  const unsigned char *b_v;
+};
+
+
 #define NR_OF_HIP 120416
 
 struct HipIndexStruct {
@@ -146,12 +205,13 @@ struct HipIndexStruct {
 class ZoneArray1 : public SpecialZoneArray<Star1> {
 public:
   ZoneArray1(FILE *f,bool byte_swap,bool use_mmap,
-             LoadingBar &lb,const HipStarMgr &hip_star_mgr,
+             LoadingBar *lb,const HipStarMgr &hip_star_mgr,
              int level,int mag_min,int mag_range,int mag_steps)
     : SpecialZoneArray<Star1>(f,byte_swap,use_mmap,lb,hip_star_mgr,level,
                               mag_min,mag_range,mag_steps) {}
 private:
   void updateHipIndex(HipIndexStruct hip_index[]) const;
+  void updateLabels(vector<string> &labels);
 };
 
 
@@ -168,7 +228,7 @@ void SpecialZoneArray<Star>::generateNativeDebugFile(const char *fname) const {
 
 template<class Star>
 SpecialZoneArray<Star>::SpecialZoneArray(FILE *f,bool byte_swap,bool use_mmap,
-                                         LoadingBar &lb,
+                                         LoadingBar *lb,
                                          const HipStarMgr &hip_star_mgr,
                                          int level,
                                          int mag_min,int mag_range,
@@ -184,7 +244,7 @@ SpecialZoneArray<Star>::SpecialZoneArray(FILE *f,bool byte_swap,bool use_mmap,
 #endif                        
 {
   if (nr_of_zones > 0) {
-	lb.Draw(0.f);
+    if (lb) lb->Draw(0.f);
     zones = new SpecialZoneData<Star>[nr_of_zones];
     if (zones == 0) {
       cerr << "ERROR: SpecialZoneArray(" << level << ")::SpecialZoneArray: "
@@ -253,6 +313,14 @@ SpecialZoneArray<Star>::SpecialZoneArray(FILE *f,bool byte_swap,bool use_mmap,
             getZones()[z].stars = s;
             s += getZones()[z].size;
           }
+          if (!lb) {
+              // loading in the background: fault the pages in now
+              // rather than while drawing
+            volatile char sum = 0;
+            const char *const p = (const char*)mmap_start;
+            const long length = mmap_offset+sizeof(Star)*nr_of_stars;
+            for (long i=0;i<length;i+=page_size) sum += p[i];
+          }
         }
 #else
         HANDLE file_handle = (void*)_get_osfhandle(_fileno(f));
@@ -346,7 +414,7 @@ SpecialZoneArray<Star>::SpecialZoneArray(FILE *f,bool byte_swap,bool use_mmap,
         }
       }
     }
-	lb.Draw(1.f);
+    if (lb) lb->Draw(1.f);
   }
 }
 
@@ -383,7 +451,8 @@ void SpecialZoneArray<Star>::draw(int index,bool is_inside,
                                   float names_brightness,
                                   s_font *starFont,
                                   s_texture* starTexture) const {
-  if (hip_star_mgr.getFlagPointStar()) {
+  const bool batching = hip_star_mgr.getFlagStarBatching();
+  if (!batching && hip_star_mgr.getFlagPointStar()) {
     glDisable(GL_TEXTURE_2D);
     glPointSize(0.1);
   }
@@ -394,17 +463,46 @@ void SpecialZoneArray<Star>::draw(int index,bool is_inside,
   const double movement_factor = (M_PI/180)*(0.0001/3600)
                            * ((HipStarMgr::getCurrentJDay()-d2000)/365.25)
                            / star_position_scale;            
-  for (const Star *s=z->getStars();s<end;s++) {
-    if (is_inside
-        ? prj->project_j2000(s->getJ2000Pos(z,movement_factor),xy)
-        : prj->project_j2000_check(s->getJ2000Pos(z,movement_factor),xy)) {
+    // Stars are sorted by magnitude: only the ones before the first star
+    // too faint to be drawn need to be projected.
+  const Star *const begin = z->getStars();
+  const Star *last = begin;
+  while (last < end && rcmag_table[2*(last->mag)] > 0.f
+                    && rcmag_table[2*(last->mag)+1] > 0.f) last++;
+  const unsigned int count = last - begin;
+  projection_batch.resize(count);
+  for (unsigned int i=0;i<count;i++) {
+    projection_batch.set(i,begin[i].getJ2000Pos(z,movement_factor));
+  }
+  prj->project_j2000_batch(projection_batch);
+  if (!is_inside) prj->check_in_viewport_batch(projection_batch);
+  for (unsigned int i=0;i<count;i++) {
+    const Star *const s = begin + i;
+    if (projection_batch.visible[i]) {
+      projection_batch.getWin(i,xy);
+      if (batching) {
+        // stars and labels are submitted by HipStarMgr::draw
+        if (0 > hip_star_mgr.batchStar(prj,xy,rcmag_table + 2*(s->mag),
+                                       HipStarMgr::color_table[s->b_v])) {
+          break;
+        }
+        if (s->mag < max_mag_star_name && !label_ids.empty()) {
+          const int label = label_ids[s - stars];
+          if (label >= 0) {
+            const Vec3f &c = HipStarMgr::color_table[s->b_v];
+            hip_star_mgr.batchStarName(xy,Vec4f(c[0]*0.75,c[1]*0.75,c[2]*0.75,
+                                                names_brightness),label);
+          }
+        }
+        continue;
+      }
       if (0 > hip_star_mgr.drawStar(prj,xy,rcmag_table + 2*(s->mag),
                                     HipStarMgr::color_table[s->b_v])) {
         break;
       }
-      if (s->mag < max_mag_star_name) {
-        const string starname = s->getNameI18n();
-        if (!starname.empty()) {
+      if (s->mag < max_mag_star_name && !label_ids.empty()) {
+        const int label = label_ids[s - stars];
+        if (label >= 0) {
           glColor4f(HipStarMgr::color_table[s->b_v][0]*0.75,
                     HipStarMgr::color_table[s->b_v][1]*0.75,
                     HipStarMgr::color_table[s->b_v][2]*0.75,
@@ -413,7 +511,7 @@ void SpecialZoneArray<Star>::draw(int index,bool is_inside,
             glEnable(GL_TEXTURE_2D);
           }
 
-          prj->drawText(starFont,xy[0],xy[1], starname, 0, 4, 4, false);
+          prj->drawText(starFont,xy[0],xy[1], hip_star_mgr.getStarLabel(label), 0, 4, 4, false);
           if (hip_star_mgr.getFlagPointStar()) {
             glDisable(GL_TEXTURE_2D);
           } else {
@@ -423,7 +521,7 @@ void SpecialZoneArray<Star>::draw(int index,bool is_inside,
       }
     }
   }
-  if (hip_star_mgr.getFlagPointStar()) {
+  if (!batching && hip_star_mgr.getFlagPointStar()) {
     glEnable(GL_TEXTURE_2D);
   }
 }
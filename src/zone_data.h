@@ -21,6 +21,7 @@
 #define _ZONE_DATA_HPP_
 
 #include <boost/intrusive_ptr.hpp>
+#include <cmath>
 
   // just for Vect3d.
   // Take any Vector class instead, if you want to use the star feature in a
@@ -48,6 +49,29 @@ struct ZoneData { // a single Triangle
   void *stars;
 };
 
+  // Center and axes of the zone spanned by c0,c1,c2, as used by the
+  // catalogues. scale is raised to the largest star coordinate the zone
+  // needs, before division by Star::max_pos_val.
+static inline void InitZoneAxes(const Vec3d &c0,const Vec3d &c1,
+                                const Vec3d &c2,ZoneData &z,double &scale) {
+  static const Vec3d north(0,0,1);
+  z.center = c0+c1+c2;
+  z.center.normalize();
+  z.axis0 = north ^ z.center;
+  z.axis0.normalize();
+  z.axis1 = z.center ^ z.axis0;
+  const Vec3d *const c[3] = {&c0,&c1,&c2};
+  for (int i=0;i<3;i++) {
+    const double mu0 = (*c[i]-z.center)*z.axis0;
+    const double mu1 = (*c[i]-z.center)*z.axis1;
+    const double f = 1.0/sqrt(1.0-mu0*mu0-mu1*mu1);
+    double h = fabs(mu0)*f;
+    if (scale < h) scale = h;
+    h = fabs(mu1)*f;
+    if (scale < h) scale = h;
+  }
+}
+
 template <class Star>
 struct SpecialZoneData : public ZoneData {
   boost::intrusive_ptr<StelObject> createStelObject(const Star *s) const